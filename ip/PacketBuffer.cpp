@@ -0,0 +1,135 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#include "ip/PacketBuffer.h"
+
+#include <stdexcept>
+
+
+// buffers start on cache line boundaries
+static const std::size_t BUFFER_ALIGNMENT = 64;
+
+
+PacketBufferPool::PacketBufferPool( std::size_t bufferSize, std::size_t bufferCount )
+    : bufferSize_( bufferSize )
+    , bufferCount_( bufferCount )
+    , memory_( 0 )
+    , buffers_( 0 )
+    , freeList_( 0 )
+    , availableCount_( bufferCount )
+    , heapAllocationCount_( 0 )
+{
+    if( bufferCount >= 0xFFFFFFFFUL )
+        throw std::runtime_error("too many packet buffers\n");
+
+    std::size_t stride = (HEADROOM + bufferSize + BUFFER_ALIGNMENT - 1) & ~(BUFFER_ALIGNMENT - 1);
+    memory_ = new char[ bufferCount * stride + BUFFER_ALIGNMENT ];
+    buffers_ = new PacketBuffer[ bufferCount ];
+
+    char *base = memory_ + (BUFFER_ALIGNMENT - (std::size_t)memory_ % BUFFER_ALIGNMENT) % BUFFER_ALIGNMENT;
+    for( std::size_t i = 0; i < bufferCount; ++i ){
+        PacketBuffer& buffer = buffers_[i];
+        buffer.pool_ = this;
+        buffer.data_ = base + i * stride + HEADROOM;
+        buffer.capacity_ = bufferSize;
+        buffer.index_ = (unsigned long)i;
+        buffer.nextFree_.store( (i + 1 < bufferCount) ? (unsigned long)(i + 2) : 0, std::memory_order_relaxed );
+    }
+
+    freeList_.store( (bufferCount > 0) ? 1 : 0, std::memory_order_release );
+}
+
+
+PacketBufferPool::~PacketBufferPool()
+{
+    // every buffer must have been released
+    assert( AvailableCount() == bufferCount_ );
+
+    delete [] buffers_;
+    delete [] memory_;
+}
+
+
+PacketBuffer *PacketBufferPool::Acquire()
+{
+    unsigned long long head = freeList_.load( std::memory_order_acquire );
+    for(;;){
+        unsigned long first = (unsigned long)(head & 0xFFFFFFFFULL);
+        if( first == 0 )
+            break;
+
+        // the next link may be stale if another thread takes the buffer
+        // first, in which case the pop count makes the exchange fail
+        PacketBuffer *buffer = &buffers_[ first - 1 ];
+        unsigned long long next = buffer->nextFree_.load( std::memory_order_relaxed );
+        unsigned long long newHead = (((head >> 32) + 1) << 32) | next;
+        if( freeList_.compare_exchange_weak( head, newHead,
+                std::memory_order_acquire, std::memory_order_acquire ) ){
+            availableCount_.fetch_sub( 1, std::memory_order_relaxed );
+            return buffer;
+        }
+    }
+
+    heapAllocationCount_.fetch_add( 1, std::memory_order_relaxed );
+
+    PacketBuffer *buffer = new PacketBuffer;
+    char *memory = new char[ HEADROOM + bufferSize_ ];
+    buffer->pool_ = this;
+    buffer->data_ = memory + HEADROOM;
+    buffer->capacity_ = bufferSize_;
+    buffer->isPooled_ = false;
+    return buffer;
+}
+
+
+void PacketBufferPool::Recycle( PacketBuffer *buffer )
+{
+    if( !buffer->isPooled_ ){
+        delete [] (buffer->data_ - HEADROOM);
+        delete buffer;
+        return;
+    }
+
+    unsigned long long head = freeList_.load( std::memory_order_relaxed );
+    unsigned long long newHead;
+    do{
+        buffer->nextFree_.store( (unsigned long)(head & 0xFFFFFFFFULL), std::memory_order_relaxed );
+        newHead = (head & ~0xFFFFFFFFULL) | (buffer->index_ + 1);
+    }while( !freeList_.compare_exchange_weak( head, newHead,
+            std::memory_order_release, std::memory_order_relaxed ) );
+
+    availableCount_.fetch_add( 1, std::memory_order_relaxed );
+}
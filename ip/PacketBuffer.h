@@ -0,0 +1,235 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_PACKETBUFFER_H
+#define INCLUDED_OSCPACK_PACKETBUFFER_H
+
+#include <atomic>
+#include <cassert>
+#include <cstring> // size_t
+
+#include "IpEndpointName.h"
+#include "PacketListener.h" // PacketTimestamp
+
+
+class PacketBufferPool;
+
+
+// A fixed size buffer from a PacketBufferPool, along with the source and
+// receive time of the datagram received into it. Buffers are reference
+// counted by PacketRef, and go back to their pool when the last reference
+// is released. PacketBufferPool::HEADROOM bytes in front of Data() also
+// belong to the buffer.
+
+class PacketBuffer{
+    friend class PacketBufferPool;
+    friend class PacketRef;
+
+    PacketBufferPool *pool_;
+    char *data_;
+    std::size_t capacity_;
+    std::atomic<long> referenceCount_;
+
+    // free list link: the index + 1 of the next free buffer, 0 at the end
+    std::atomic<unsigned long> nextFree_;
+    unsigned long index_;
+    bool isPooled_; // false for buffers allocated because the pool was empty
+
+    PacketBuffer()
+        : pool_( 0 ), data_( 0 ), capacity_( 0 ), referenceCount_( 0 )
+        , nextFree_( 0 ), index_( 0 ), isPooled_( true ), timestamped( false ) {}
+
+    PacketBuffer( const PacketBuffer& ); // no copy
+    PacketBuffer& operator=( const PacketBuffer& );
+
+    void AddReference() { referenceCount_.fetch_add( 1, std::memory_order_relaxed ); }
+    inline void Release();
+
+public:
+    char *Data() { return data_; }
+    const char *Data() const { return data_; }
+    std::size_t Capacity() const { return capacity_; }
+
+    // filled in by whoever receives into the buffer
+    IpEndpointName remoteEndpoint;
+    PacketTimestamp timestamp;
+    bool timestamped; // false if the socket doesn't have receive timestamps enabled
+};
+
+
+// A reference to a packet held in a PacketBuffer: Size() bytes starting at
+// Data(). The buffer, and so the packet data and any osc::ReceivedPacket
+// or osc::ReceivedMessage parsed from it, stay valid for as long as a
+// PacketRef to it exists. PacketRefs may be copied, and released, from
+// any thread.
+
+class PacketRef{
+    PacketBuffer *buffer_;
+    const char *data_;
+    std::size_t size_;
+
+public:
+    PacketRef()
+        : buffer_( 0 ), data_( 0 ), size_( 0 ) {}
+
+    // refers to the whole of the buffer's Data()
+    explicit PacketRef( PacketBuffer *buffer )
+        : buffer_( buffer ), data_( buffer->Data() ), size_( buffer->Capacity() )
+    {
+        buffer_->AddReference();
+    }
+
+    // refers to size bytes at data, which must lie within the buffer
+    PacketRef( PacketBuffer *buffer, const char *data, std::size_t size )
+        : buffer_( buffer ), data_( data ), size_( size )
+    {
+        buffer_->AddReference();
+    }
+
+    PacketRef( const PacketRef& other )
+        : buffer_( other.buffer_ ), data_( other.data_ ), size_( other.size_ )
+    {
+        if( buffer_ )
+            buffer_->AddReference();
+    }
+
+    ~PacketRef()
+    {
+        if( buffer_ )
+            buffer_->Release();
+    }
+
+    PacketRef& operator=( const PacketRef& other )
+    {
+        if( other.buffer_ )
+            other.buffer_->AddReference();
+        if( buffer_ )
+            buffer_->Release();
+
+        buffer_ = other.buffer_;
+        data_ = other.data_;
+        size_ = other.size_;
+        return *this;
+    }
+
+    void Reset() { *this = PacketRef(); }
+
+    bool IsNull() const { return buffer_ == 0; }
+
+    // true if this is the only reference to the buffer, so its contents
+    // can be overwritten
+    bool IsUnique() const
+        { return buffer_ && buffer_->referenceCount_.load( std::memory_order_acquire ) == 1; }
+
+    PacketBuffer *Buffer() const { return buffer_; }
+
+    const char *Data() const { return data_; }
+    std::size_t Size() const { return size_; }
+
+    const IpEndpointName& RemoteEndpoint() const { return buffer_->remoteEndpoint; }
+
+    // the receive timestamp, 0 unless the socket has receive timestamps enabled
+    const PacketTimestamp *Timestamp() const
+        { return (buffer_->timestamped) ? &buffer_->timestamp : 0; }
+
+    // a reference to size bytes at offset within this packet
+    PacketRef Slice( std::size_t offset, std::size_t size ) const
+    {
+        assert( offset + size <= size_ );
+        return PacketRef( buffer_, data_ + offset, size );
+    }
+};
+
+
+// A fixed set of equally sized packet buffers, allocated up front. Acquire()
+// and the release of the last reference to a buffer are lock-free, and may
+// be called from any thread. If every buffer is in use Acquire() allocates
+// a new one from the heap, which is freed rather than pooled when released.
+//
+// The pool must outlive every PacketRef to its buffers, including those
+// held by multiplexers and sockets which receive into it.
+
+class PacketBufferPool{
+    friend class PacketBuffer;
+
+    std::size_t bufferSize_;
+    std::size_t bufferCount_;
+    char *memory_;
+    PacketBuffer *buffers_;
+
+    // the pop count in the high 32 bits, which prevents ABA, and the index + 1
+    // of the first free buffer in the low 32 bits (0 if the list is empty)
+    std::atomic<unsigned long long> freeList_;
+    std::atomic<std::size_t> availableCount_;
+    std::atomic<unsigned long> heapAllocationCount_;
+
+    PacketBufferPool( const PacketBufferPool& ); // no copy
+    PacketBufferPool& operator=( const PacketBufferPool& );
+
+    void Recycle( PacketBuffer *buffer );
+
+public:
+    // space in front of each buffer's data, where the io_uring backend has
+    // the kernel write its recvmsg headers
+    enum { HEADROOM=256 };
+
+    PacketBufferPool( std::size_t bufferSize, std::size_t bufferCount );
+    ~PacketBufferPool();
+
+    std::size_t BufferSize() const { return bufferSize_; }
+    std::size_t BufferCount() const { return bufferCount_; }
+
+    // the number of pooled buffers not in use. may be out of date by the
+    // time it returns if other threads are using the pool.
+    std::size_t AvailableCount() const { return availableCount_.load( std::memory_order_relaxed ); }
+
+    // the number of times Acquire() found the pool empty
+    unsigned long HeapAllocationCount() const { return heapAllocationCount_.load( std::memory_order_relaxed ); }
+
+    // take an unreferenced buffer. wrap it in a PacketRef straight away:
+    // it returns to the pool when the last PacketRef to it is released.
+    PacketBuffer *Acquire();
+};
+
+
+inline void PacketBuffer::Release()
+{
+    if( referenceCount_.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+        pool_->Recycle( this );
+}
+
+
+#endif /* INCLUDED_OSCPACK_PACKETBUFFER_H */
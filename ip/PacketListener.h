@@ -37,14 +37,123 @@
 #ifndef INCLUDED_OSCPACK_PACKETLISTENER_H
 #define INCLUDED_OSCPACK_PACKETLISTENER_H
 
+#include <cstring> // size_t
+
+#include "IpEndpointName.h"
+
+
+class PacketRef;
+
+
+// The time at which a packet was received, as reported by the kernel.
+// Software timestamps are taken from the system clock (the same clock as
+// gettimeofday() and OSC time tags) when the packet reached the network
+// stack. Hardware timestamps come from the network card's clock.
+
+struct PacketTimestamp{
+    enum Source{
+        NO_TIMESTAMP,       // the kernel didn't provide a timestamp
+        SOFTWARE_TIMESTAMP,
+        HARDWARE_TIMESTAMP
+    };
+
+    PacketTimestamp()
+        : source( NO_TIMESTAMP ), seconds( 0 ), nanoseconds( 0 ) {}
+
+    Source source;
+    long seconds;       // since the epoch (1970) for software timestamps
+    long nanoseconds;
+};
+
+
+// One packet of a PacketBatch.
+
+struct BatchedPacket{
+    BatchedPacket()
+        : data( 0 ), size( 0 ), timestamped( false ), packet( 0 ) {}
+
+    const char *data;
+    int size;
+    IpEndpointName remoteEndpoint;
+    PacketTimestamp timestamp;
+    bool timestamped;   // false unless the socket has receive timestamps enabled
+
+    // refers to data when received into a PacketBufferPool, 0 otherwise.
+    // copying it (see PacketBuffer.h) keeps the data valid.
+    const PacketRef *packet;
+
+    const PacketTimestamp *Timestamp() const { return (timestamped) ? &timestamp : 0; }
+};
+
+
+// The packets read from one socket in one wakeup of the multiplexer, in
+// arrival order. The packet data is valid until ProcessPackets() returns,
+// except for pooled packets which can be kept by copying their PacketRef.
+
+class PacketBatch{
+    const BatchedPacket *packets_;
+    std::size_t size_;
+    const volatile bool *breakFlag_;
+
+public:
+    PacketBatch( const BatchedPacket *packets, std::size_t size, const volatile bool *breakFlag=0 )
+        : packets_( packets ), size_( size ), breakFlag_( breakFlag ) {}
+
+    std::size_t Size() const { return size_; }
+    const BatchedPacket& operator[]( std::size_t i ) const { return packets_[i]; }
+
+    // true once the multiplexer's Break() has been called. the packets
+    // not yet processed at that point should be discarded.
+    bool BreakRequested() const { return breakFlag_ && *breakFlag_; }
+};
 
-class IpEndpointName;
 
 class PacketListener{
 public:
     virtual ~PacketListener() {}
     virtual void ProcessPacket( const char *data, int size, 
 			const IpEndpointName& remoteEndpoint ) = 0;
+
+    // Called instead of ProcessPacket() for packets received on a socket
+    // with receive timestamps enabled (see UdpSocket::SetReceiveTimestamps()).
+    // The default implementation ignores the timestamp and calls ProcessPacket().
+    virtual void ProcessTimestampedPacket( const char *data, int size,
+            const IpEndpointName& remoteEndpoint, const PacketTimestamp& /*timestamp*/ )
+        { ProcessPacket( data, size, remoteEndpoint ); }
+
+    // Called instead of the methods above when the multiplexer receives
+    // into a PacketBufferPool (see SocketReceiveMultiplexer::SetPacketBufferPool()).
+    // Keeping a copy of *packet.packet keeps the data valid after returning,
+    // so it can be processed later or on another thread without copying it.
+    // The default implementation calls ProcessTimestampedPacket() if the
+    // packet has a timestamp, ProcessPacket() otherwise.
+    virtual void ProcessPooledPacket( const BatchedPacket& packet )
+    {
+        if( packet.timestamped )
+            ProcessTimestampedPacket( packet.data, packet.size, packet.remoteEndpoint, packet.timestamp );
+        else
+            ProcessPacket( packet.data, packet.size, packet.remoteEndpoint );
+    }
+
+    // Called by the multiplexer with all the packets it read from the
+    // socket in one wakeup: up to UdpSocket::ReceiveBatchSize() datagrams
+    // (with the io_uring backend, all those completed since the last
+    // wakeup), with any that the kernel coalesced split up again. Overriding it lets
+    // a listener take locks, or hand packets on to other threads, once per
+    // batch rather than once per packet. The default implementation passes
+    // each packet to the methods above until Break() is called.
+    virtual void ProcessPackets( const PacketBatch& batch )
+    {
+        for( std::size_t i = 0; i < batch.Size() && !batch.BreakRequested(); ++i ){
+            const BatchedPacket& p = batch[i];
+            if( p.packet )
+                ProcessPooledPacket( p );
+            else if( p.timestamped )
+                ProcessTimestampedPacket( p.data, p.size, p.remoteEndpoint, p.timestamp );
+            else
+                ProcessPacket( p.data, p.size, p.remoteEndpoint );
+        }
+    }
 };
 
 #endif /* INCLUDED_OSCPACK_PACKETLISTENER_H */
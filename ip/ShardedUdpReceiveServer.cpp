@@ -0,0 +1,191 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#include "ip/ShardedUdpReceiveServer.h"
+
+#include <cassert>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ip/UdpSocket.h"
+#include "ip/PacketListener.h"
+
+
+class ShardedUdpReceiveServer::Implementation{
+    struct Shard{
+        Shard() : listener( 0 ) {}
+
+        UdpSocket socket;
+        SocketReceiveMultiplexer mux;
+        PacketListener *listener;
+        std::thread thread;
+        std::string error;
+    };
+
+    std::vector<Shard*> shards_;
+    bool isRunning_;
+
+    static void RunShard( Shard *shard )
+    {
+        try{
+            shard->mux.Run();
+        }catch( std::exception& e ){
+            shard->error = e.what();
+        }
+    }
+
+    void DeleteShards()
+    {
+        for( std::vector<Shard*>::iterator i = shards_.begin(); i != shards_.end(); ++i ){
+            if( (*i)->listener )
+                (*i)->mux.DetachSocketListener( &(*i)->socket, (*i)->listener );
+            delete *i;
+        }
+        shards_.clear();
+    }
+
+public:
+    Implementation( const IpEndpointName& localEndpoint,
+            PacketListener **listeners, std::size_t shardCount )
+        : isRunning_( false )
+    {
+        assert( shardCount > 0 );
+
+        // every shard must bind the same port, so it can't be left to the system
+        if( localEndpoint.port == IpEndpointName::ANY_PORT )
+            throw std::runtime_error( "sharded server requires an explicit port\n" );
+
+        try{
+            for( std::size_t i = 0; i < shardCount; ++i ){
+                Shard *shard = new Shard;
+                shards_.push_back( shard );
+
+                shard->socket.SetAllowReusePort( true );
+                shard->socket.Bind( localEndpoint );
+
+                shard->mux.AttachSocketListener( &shard->socket, listeners[i] );
+                shard->listener = listeners[i];
+            }
+        }catch(...){
+            DeleteShards();
+            throw;
+        }
+    }
+
+    ~Implementation()
+    {
+        try{
+            Stop();
+        }catch( std::exception& ){
+            // errors are only reported by an explicit call to Stop()
+        }
+
+        DeleteShards();
+    }
+
+    std::size_t ShardCount() const { return shards_.size(); }
+
+    UdpSocket& Socket( std::size_t shardIndex )
+    {
+        assert( shardIndex < shards_.size() );
+        return shards_[ shardIndex ]->socket;
+    }
+
+    void Start()
+    {
+        assert( !isRunning_ );
+
+        for( std::vector<Shard*>::iterator i = shards_.begin(); i != shards_.end(); ++i ){
+            (*i)->error.clear();
+            (*i)->thread = std::thread( RunShard, *i );
+        }
+
+        isRunning_ = true;
+    }
+
+    void Stop()
+    {
+        if( !isRunning_ )
+            return;
+
+        for( std::vector<Shard*>::iterator i = shards_.begin(); i != shards_.end(); ++i )
+            (*i)->mux.AsynchronousBreak();
+
+        for( std::vector<Shard*>::iterator i = shards_.begin(); i != shards_.end(); ++i )
+            (*i)->thread.join();
+
+        isRunning_ = false;
+
+        for( std::vector<Shard*>::iterator i = shards_.begin(); i != shards_.end(); ++i ){
+            if( !(*i)->error.empty() )
+                throw std::runtime_error( (*i)->error );
+        }
+    }
+};
+
+
+ShardedUdpReceiveServer::ShardedUdpReceiveServer( const IpEndpointName& localEndpoint,
+        PacketListener **listeners, std::size_t shardCount )
+{
+    impl_ = new Implementation( localEndpoint, listeners, shardCount );
+}
+
+ShardedUdpReceiveServer::~ShardedUdpReceiveServer()
+{
+    delete impl_;
+}
+
+std::size_t ShardedUdpReceiveServer::ShardCount() const
+{
+    return impl_->ShardCount();
+}
+
+UdpSocket& ShardedUdpReceiveServer::Socket( std::size_t shardIndex )
+{
+    return impl_->Socket( shardIndex );
+}
+
+void ShardedUdpReceiveServer::Start()
+{
+    impl_->Start();
+}
+
+void ShardedUdpReceiveServer::Stop()
+{
+    impl_->Stop();
+}
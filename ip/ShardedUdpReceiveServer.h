@@ -0,0 +1,83 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_SHARDEDUDPRECEIVESERVER_H
+#define INCLUDED_OSCPACK_SHARDEDUDPRECEIVESERVER_H
+
+#include <cstring> // size_t
+
+#include "IpEndpointName.h"
+
+
+class PacketListener;
+class UdpSocket;
+
+
+// ShardedUdpReceiveServer binds several UdpSockets to the same local
+// endpoint using SO_REUSEPORT and runs a SocketReceiveMultiplexer for each
+// socket on its own thread. On Linux the kernel distributes incoming
+// datagrams across the sockets by flow (source address and port), so
+// packets from a given sender are always delivered to the same shard,
+// in order. Other platforms don't load balance and may refuse to bind
+// more than one shard.
+//
+// Each shard has its own PacketListener, which is only ever called from
+// that shard's thread.
+
+class ShardedUdpReceiveServer{
+    class Implementation;
+    Implementation *impl_;
+
+public:
+    // listeners must point to an array of shardCount listeners.
+    // Ctor throws std::runtime_error if the sockets can't be bound.
+    ShardedUdpReceiveServer( const IpEndpointName& localEndpoint,
+            PacketListener **listeners, std::size_t shardCount );
+    ~ShardedUdpReceiveServer(); // calls Stop()
+
+    std::size_t ShardCount() const;
+
+    // access a shard's socket, e.g. to set its receive batch size before Start()
+    UdpSocket& Socket( std::size_t shardIndex );
+
+    void Start();  // start one receive thread per shard
+    // break each shard's multiplexer and wait for the threads to finish.
+    // throws std::runtime_error if a shard's receive loop failed.
+    void Stop();
+};
+
+
+#endif /* INCLUDED_OSCPACK_SHARDEDUDPRECEIVESERVER_H */
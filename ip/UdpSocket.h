@@ -44,7 +44,9 @@
 
 
 class PacketListener;
+class PacketBufferPool;
 class TimerListener;
+class SendCompletionListener;
 
 class UdpSocket;
 
@@ -55,10 +57,37 @@ class SocketReceiveMultiplexer{
 	friend class UdpSocket;
 
 public:
-    SocketReceiveMultiplexer();
+    // By default Run() waits using the most scalable mechanism available
+    // on the host: epoll on Linux, select() on other POSIX systems and
+    // WaitForMultipleObjects() on Win32. SELECT_BACKEND forces the
+    // portable select() loop (POSIX only). Backends that are unavailable
+    // fall back to the default.
+    //
+    // IO_URING_BACKEND (Linux 6.0 and later) keeps a multishot recvmsg
+    // posted on every attached socket, so datagrams are received without a
+    // system call each. Timers are driven by ring timeouts, and Send() or
+    // SendTo() called from a listener are submitted through the same ring.
+    // It is never chosen by default. If the kernel doesn't support it Run()
+    // falls back to epoll, then select().
+    enum Backend{
+        DEFAULT_BACKEND,
+        SELECT_BACKEND,
+        EPOLL_BACKEND,
+        IO_URING_BACKEND
+    };
+
+    explicit SocketReceiveMultiplexer( Backend backend=DEFAULT_BACKEND );
     ~SocketReceiveMultiplexer();
 
-	// only call the attach/detach methods _before_ calling Run
+	// The attach/detach methods may be called at any time, including from
+	// other threads and from listeners while Run() is active. While Run()
+	// is active the change is queued and Run() is woken to apply it, so
+	// packet dispatch takes no locks. A call from another thread returns
+	// once the change has been applied: after a detach the listener won't
+	// be called again and the socket may be destroyed. A call from a
+	// listener or timer callback returns immediately and the change is
+	// applied once the current wakeup has been processed, so a detached
+	// listener may still receive datagrams that were already read.
 
     // only one listener per socket, each socket at most once
     void AttachSocketListener( UdpSocket *socket, PacketListener *listener );
@@ -67,15 +96,89 @@ public:
     void AttachPeriodicTimerListener( int periodMilliseconds, TimerListener *listener );
 	void AttachPeriodicTimerListener(
             int initialDelayMilliseconds, int periodMilliseconds, TimerListener *listener );
+
+    // Timers with sub-millisecond periods, e.g. at audio block rate. On
+    // POSIX timers run on the monotonic clock and each expiry is scheduled
+    // one period after the previous one, so periods don't drift. On Linux
+    // Run() waits on a timerfd, giving timers microsecond accuracy.
+    // Elsewhere they are limited by the resolution of the wait (select():
+    // microseconds, Win32: milliseconds).
+    void AttachPeriodicTimerListenerMicroseconds(
+            long initialDelayMicroseconds, long periodMicroseconds, TimerListener *listener );
+    void AttachPeriodicTimerListenerNanoseconds(
+            long long initialDelayNanoseconds, long long periodNanoseconds, TimerListener *listener );
     void DetachPeriodicTimerListener( TimerListener *listener );  
 
-    void Run();      // loop and block processing messages indefinitely
+    // Low latency mode. After each wakeup Run() keeps reading from the
+    // attached sockets without waiting, until nothing has arrived for
+    // idleMicroseconds, and only then blocks again. This saves the wakeup
+    // latency of the blocking wait at the cost of keeping a CPU core busy,
+    // so it only helps when the sender and Run() can use different cores.
+    // Timers, Break() and attach/detach calls are still handled while
+    // polling. 0 disables busy polling (the default). Applies to the
+    // select(), epoll and Win32 loops, the io_uring backend ignores it.
+    // Call before Run().
+    void SetBusyPollPeriod( long idleMicroseconds );
+
+    // Receive into buffers from pool rather than a single buffer reused
+    // for every packet, and pass packets to listeners with
+    // PacketListener::ProcessPooledPacket(). A listener can keep a packet
+    // by holding on to its PacketRef instead of copying it. Datagrams
+    // larger than pool->BufferSize() are truncated, so it should be at
+    // least the MaxReceivePacketSize() of the attached sockets (or
+    // MAX_UDP_PACKET_SIZE with receive coalescing). The pool must outlive
+    // the multiplexer and the attached sockets, which keep buffers for
+    // their next reads. Pass 0 to stop using a pool. Call before Run().
+    void SetPacketBufferPool( PacketBufferPool *pool );
+
+    // Drive the multiplexer from an existing event loop instead of Run().
+    // PollDescriptor() returns a file descriptor (an epoll instance on
+    // Linux) that becomes readable when an attached socket has data, a
+    // timer is due, or AsynchronousBreak() or an attach/detach call from
+    // another thread needs attention. Add it to the application's own
+    // poll()/epoll set and call ProcessReady() whenever it is readable.
+    // ProcessReady() never blocks: it reads from the ready sockets in turn
+    // until they are drained or maxPackets datagrams have been read (a
+    // batched read counts each of its datagrams, so it can go over by
+    // less than a batch), dispatches them to their listeners, runs expired
+    // timers and applies queued attach/detach calls. The descriptor stays
+    // readable while packets are left. Returns the number of datagrams
+    // read. Break() from a listener makes ProcessReady() return early.
+    // Use either Run() or ProcessReady() with a multiplexer, and call
+    // ProcessReady() from one thread at a time. The descriptor is owned
+    // by the multiplexer. The io_uring backend and busy polling don't
+    // apply. Both throw std::runtime_error where epoll and timerfd aren't
+    // available (including Win32).
+    int PollDescriptor();
+    std::size_t ProcessReady( std::size_t maxPackets );
+
+    void Run();     // loop and block processing messages indefinitely
 	void RunUntilSigInt();
     void Break();    // call this from a listener to exit once the listener returns
     void AsynchronousBreak(); // call this from another thread or signal handler to exit the Run() state
 };
 
 
+// One datagram to be sent with UdpSocket::SendBatch() or
+// UdpSocket::SendToBatch(). The caller fills in the first three fields,
+// the results are written to bytesSent and error.
+
+struct UdpBatchEntry{
+    UdpBatchEntry()
+        : data( 0 ), size( 0 ), bytesSent( 0 ), error( 0 ) {}
+    UdpBatchEntry( const IpEndpointName& remoteEndpoint_, const char *data_, std::size_t size_ )
+        : remoteEndpoint( remoteEndpoint_ ), data( data_ ), size( size_ )
+        , bytesSent( 0 ), error( 0 ) {}
+
+    IpEndpointName remoteEndpoint; // ignored by SendBatch()
+    const char *data;
+    std::size_t size;
+
+    std::size_t bytesSent;
+    int error; // 0 if the datagram was sent, otherwise the system error code
+};
+
+
 class UdpSocket{
     class Implementation;
     Implementation *impl_;
@@ -102,6 +205,12 @@ public:
 	// operating systems.
 	void SetAllowReuse( bool allowReuse );
 
+	// Allow several sockets to bind the same local endpoint and share
+	// its incoming datagrams. Sets SO_REUSEPORT where available. On
+	// Linux the kernel spreads datagrams across the sockets by flow
+	// (see ShardedUdpReceiveServer). Has no effect on Win32.
+	void SetAllowReusePort( bool allowReusePort );
+
 
 	// The socket is created in an unbound, unconnected state
 	// such a socket can only be used to send to an arbitrary
@@ -113,12 +222,64 @@ public:
 	// Retrieve the local endpoint name when sending to 'to'
 	IpEndpointName LocalEndpointFor( const IpEndpointName& remoteEndpoint ) const;
 
+	// Remember the results of LocalEndpointFor() for each remote address
+	// for timeoutMilliseconds, so repeated lookups for the same peer make
+	// no system calls. On Linux the cache is also cleared when routes or
+	// interface addresses change. A timeout of 0 (the default) disables
+	// the cache.
+	void SetLocalEndpointCacheTimeout( long timeoutMilliseconds );
+
+	// Fill the LocalEndpointFor() cache from received datagrams: each
+	// datagram received by SocketReceiveMultiplexer records the local
+	// address it arrived at (IP_PKTINFO) for its sender. Requires the
+	// cache to be enabled. Returns false if this is not supported
+	// (e.g. on Win32). Once learning is enabled, only call
+	// LocalEndpointFor() from the thread running the multiplexer.
+	bool SetEnableLocalEndpointLearning( bool enableLearning );
+
 	// Connect to a remote endpoint which is used as the target
 	// for calls to Send()
 	void Connect( const IpEndpointName& remoteEndpoint );	
 	void Send( const char *data, std::size_t size );
     void SendTo( const IpEndpointName& remoteEndpoint, const char *data, std::size_t size );
 
+	// Send count datagrams using as few system calls as possible
+	// (sendmmsg() on Linux). SendBatch() sends to the connected endpoint,
+	// SendToBatch() to each entry's remoteEndpoint. The result for each
+	// datagram is stored in its entry. Returns the number of datagrams sent.
+	std::size_t SendBatch( UdpBatchEntry *entries, std::size_t count );
+	std::size_t SendToBatch( UdpBatchEntry *entries, std::size_t count );
+
+	// Let SendBatch() and SendToBatch() hand runs of consecutive entries
+	// with the same size and destination to the kernel as a single send,
+	// which is split into datagrams by the kernel or the network card
+	// (UDP_SEGMENT on Linux 4.18 and later). Receivers see ordinary
+	// datagrams. If segmentation isn't supported, or the kernel refuses a
+	// send, the datagrams are sent individually instead.
+	// SendSegmentation() reports whether segmentation is still enabled.
+	// Has no effect on Win32.
+	void SetEnableSendSegmentation( bool enableSendSegmentation );
+	bool SendSegmentation() const;
+
+	// Send datagrams of at least thresholdBytes from Send() and SendTo()
+	// without copying them into the kernel (MSG_ZEROCOPY, Linux only).
+	// Smaller datagrams are copied as usual. The caller must not modify
+	// or free a zero-copy buffer until listener->SendCompleted() is
+	// called for it. Completions are collected by
+	// ProcessSendCompletions(). A SocketReceiveMultiplexer calls this
+	// automatically for attached sockets. Otherwise the caller must call
+	// it, e.g. before reusing a buffer. A threshold of 0 disables
+	// zero-copy (the default). Returns false if zero-copy isn't
+	// supported.
+	bool SetZeroCopySendThreshold( std::size_t thresholdBytes, SendCompletionListener *listener );
+
+	// Reads pending zero-copy completions without blocking and notifies
+	// the listener. Returns the number of buffers released.
+	std::size_t ProcessSendCompletions();
+
+	// The number of zero-copy buffers still held by the kernel
+	std::size_t PendingZeroCopySendCount() const;
+
 
 	// Bind a local endpoint to receive incoming data. Endpoint
 	// can be 'any' for the system to choose an endpoint
@@ -126,6 +287,57 @@ public:
 	bool IsBound() const;
 
     std::size_t ReceiveFrom( IpEndpointName& remoteEndpoint, char *data, std::size_t size );
+
+	// Set the maximum number of datagrams that SocketReceiveMultiplexer
+	// reads from this socket each time it becomes readable. The default
+	// is 1. Larger values drain queued datagrams with a single recvmmsg()
+	// call on Linux (a non-blocking recvfrom() loop elsewhere) and pass
+	// them to the listener's ProcessPackets() as one batch, in arrival
+	// order. Call before Run().
+	void SetReceiveBatchSize( std::size_t batchSize );
+	std::size_t ReceiveBatchSize() const;
+
+	// Set the size of the largest datagram SocketReceiveMultiplexer will
+	// receive from this socket, up to MAX_UDP_PACKET_SIZE. Longer datagrams
+	// are truncated. The default is DEFAULT_MAX_RECEIVE_PACKET_SIZE. Call
+	// before Run().
+	enum { DEFAULT_MAX_RECEIVE_PACKET_SIZE=4098, MAX_UDP_PACKET_SIZE=65536 };
+	void SetMaxReceivePacketSize( std::size_t maxPacketSize );
+	std::size_t MaxReceivePacketSize() const;
+
+	// Allow the kernel to coalesce consecutive datagrams from the same
+	// sender into a single read (sets UDP_GRO on Linux, has no effect
+	// elsewhere). SocketReceiveMultiplexer splits them up again and calls
+	// ProcessPacket() once per datagram, so listeners see no difference.
+	// ReceiveFrom() does not split coalesced reads, so don't use it
+	// directly on a socket with coalescing enabled. Call before Run().
+	void SetEnableReceiveCoalescing( bool enableReceiveCoalescing );
+
+	// Ask the kernel to timestamp each datagram on arrival.
+	// SocketReceiveMultiplexer then passes the timestamp to the listener's
+	// ProcessTimestampedPacket() instead of calling ProcessPacket().
+	// SOFTWARE_RECEIVE_TIMESTAMPS uses SO_TIMESTAMPNS on Linux (SO_TIMESTAMP,
+	// with microsecond resolution, elsewhere). HARDWARE_RECEIVE_TIMESTAMPS
+	// uses SO_TIMESTAMPING on Linux and reports network card timestamps
+	// where the card has hardware timestamping enabled (e.g. with
+	// hwstamp_ctl), software timestamps otherwise. Returns false if the
+	// mode isn't supported (always on Win32, except for
+	// NO_RECEIVE_TIMESTAMPS). Call before Run().
+	enum ReceiveTimestampMode{
+		NO_RECEIVE_TIMESTAMPS,
+		SOFTWARE_RECEIVE_TIMESTAMPS,
+		HARDWARE_RECEIVE_TIMESTAMPS
+	};
+	bool SetReceiveTimestamps( ReceiveTimestampMode mode );
+	ReceiveTimestampMode ReceiveTimestamps() const;
+
+	// Let the kernel busy poll the network device queue for up to
+	// microseconds when a read finds this socket empty (SO_BUSY_POLL,
+	// Linux only). Values above net.core.busy_read need CAP_NET_ADMIN.
+	// Only devices with NAPI polling benefit, loopback doesn't. Combine
+	// with SocketReceiveMultiplexer::SetBusyPollPeriod(). Returns false if
+	// not supported. 0 disables it.
+	bool SetKernelBusyPoll( int microseconds );
 };
 
 
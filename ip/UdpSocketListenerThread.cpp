@@ -0,0 +1,384 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#include "ip/UdpSocketListenerThread.h"
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ip/UdpSocket.h"
+#include "ip/IpEndpointName.h"
+#include "ip/PacketListener.h"
+
+
+// the receive thread's multiplexer calls the Implementation's
+// PacketListener methods, which copy each packet into the queue.
+
+class UdpSocketListenerThread::Implementation : public PacketListener{
+
+    // a bounded queue of packet indices. only one thread pushes, but two
+    // threads may pop (Drain() and, for DROP_OLDEST, the receive thread),
+    // so the head is advanced with compare-and-swap. the capacity is
+    // larger than the number of packets, so a push never finds it full.
+    class IndexQueue{
+        std::vector< std::atomic<std::size_t> > entries_;
+        std::size_t mask_;
+        std::atomic<std::size_t> head_;
+        std::atomic<std::size_t> tail_;
+
+        static std::size_t RoundUpToPowerOfTwo( std::size_t n )
+        {
+            std::size_t result = 1;
+            while( result < n )
+                result <<= 1;
+            return result;
+        }
+
+    public:
+        explicit IndexQueue( std::size_t maxSize )
+            : entries_( RoundUpToPowerOfTwo( maxSize + 1 ) )
+            , mask_( entries_.size() - 1 )
+            , head_( 0 )
+            , tail_( 0 ) {}
+
+        void Push( std::size_t index )
+        {
+            std::size_t tail = tail_.load( std::memory_order_relaxed );
+            entries_[ tail & mask_ ].store( index, std::memory_order_relaxed );
+            tail_.store( tail + 1, std::memory_order_release );
+        }
+
+        // pops up to maxCount indices into result. returns the number popped.
+        std::size_t Pop( std::size_t *result, std::size_t maxCount )
+        {
+            std::size_t head = head_.load( std::memory_order_acquire );
+            for(;;){
+                std::size_t count = tail_.load( std::memory_order_acquire ) - head;
+                if( count > maxCount )
+                    count = maxCount;
+                if( count == 0 )
+                    return 0;
+
+                // the entries can only be overwritten after the head has
+                // moved past them, in which case the exchange fails
+                for( std::size_t i = 0; i < count; ++i )
+                    result[i] = entries_[ (head + i) & mask_ ].load( std::memory_order_relaxed );
+
+                if( head_.compare_exchange_weak( head, head + count,
+                        std::memory_order_acq_rel, std::memory_order_acquire ) )
+                    return count;
+            }
+        }
+
+        std::size_t Size() const
+        {
+            std::size_t head = head_.load( std::memory_order_acquire );
+            return tail_.load( std::memory_order_acquire ) - head;
+        }
+    };
+
+    struct Packet{
+        std::vector<char> data;
+        std::size_t size;
+        IpEndpointName remoteEndpoint;
+        PacketTimestamp timestamp;
+        bool timestamped;
+    };
+
+    enum { DRAIN_BATCH_SIZE = 64 };
+
+    UdpSocket& socket_;
+    SocketReceiveMultiplexer mux_;
+    OverflowPolicy overflowPolicy_;
+
+    // each packet is either free, queued, or being passed to a listener by Drain()
+    std::vector<Packet> packets_;
+    IndexQueue freePackets_;   // pushed by Drain(), popped by the receive thread
+    IndexQueue queuedPackets_; // pushed by the receive thread, popped by Drain()
+
+    std::thread thread_;
+    std::string error_;
+    bool isRunning_;
+    std::atomic<bool> stopping_;
+
+    std::atomic<unsigned long> receivedCount_;
+    std::atomic<unsigned long> drainedCount_;
+    std::atomic<unsigned long> droppedNewestCount_;
+    std::atomic<unsigned long> droppedOldestCount_;
+    std::atomic<unsigned long> blockedCount_;
+    std::atomic<unsigned long> truncatedCount_;
+
+    static void RunReceiveThread( Implementation *impl )
+    {
+        try{
+            impl->mux_.Run();
+        }catch( std::exception& e ){
+            impl->error_ = e.what();
+        }
+    }
+
+    // called on the receive thread. returns false if there is no room for the packet.
+    bool AllocatePacket( std::size_t& index )
+    {
+        if( freePackets_.Pop( &index, 1 ) == 1 )
+            return true;
+
+        switch( overflowPolicy_ ){
+            case DROP_NEWEST:
+                break;
+
+            case DROP_OLDEST:
+                if( queuedPackets_.Pop( &index, 1 ) == 1 ){
+                    droppedOldestCount_.fetch_add( 1, std::memory_order_relaxed );
+                    return true;
+                }
+                break; // Drain() holds every packet
+
+            case BLOCK:
+                blockedCount_.fetch_add( 1, std::memory_order_relaxed );
+                while( !stopping_.load( std::memory_order_acquire ) ){
+                    // Drain() doesn't signal, poll for a free packet
+                    std::this_thread::sleep_for( std::chrono::microseconds( 50 ) );
+                    if( freePackets_.Pop( &index, 1 ) == 1 )
+                        return true;
+                }
+                break;
+        }
+
+        droppedNewestCount_.fetch_add( 1, std::memory_order_relaxed );
+        return false;
+    }
+
+    void QueuePacket( const char *data, int size,
+            const IpEndpointName& remoteEndpoint, const PacketTimestamp *timestamp )
+    {
+        receivedCount_.fetch_add( 1, std::memory_order_relaxed );
+
+        std::size_t index;
+        if( !AllocatePacket( index ) )
+            return;
+
+        Packet& packet = packets_[ index ];
+        packet.size = (std::size_t)size;
+        if( packet.size > packet.data.size() ){
+            packet.size = packet.data.size();
+            truncatedCount_.fetch_add( 1, std::memory_order_relaxed );
+        }
+        std::memcpy( &packet.data[0], data, packet.size );
+        packet.remoteEndpoint = remoteEndpoint;
+        packet.timestamped = ( timestamp != 0 );
+        if( timestamp )
+            packet.timestamp = *timestamp;
+
+        queuedPackets_.Push( index );
+    }
+
+public:
+    Implementation( UdpSocket& socket, std::size_t capacity, OverflowPolicy overflowPolicy )
+        : socket_( socket )
+        , overflowPolicy_( overflowPolicy )
+        , packets_( capacity )
+        , freePackets_( capacity )
+        , queuedPackets_( capacity )
+        , isRunning_( false )
+        , stopping_( false )
+        , receivedCount_( 0 )
+        , drainedCount_( 0 )
+        , droppedNewestCount_( 0 )
+        , droppedOldestCount_( 0 )
+        , blockedCount_( 0 )
+        , truncatedCount_( 0 )
+    {
+        assert( capacity > 0 );
+
+        for( std::size_t i = 0; i < capacity; ++i ){
+            packets_[i].data.resize( socket.MaxReceivePacketSize() );
+            freePackets_.Push( i );
+        }
+
+        mux_.AttachSocketListener( &socket_, this );
+    }
+
+    ~Implementation()
+    {
+        try{
+            Stop();
+        }catch( std::exception& ){
+            // errors are only reported by an explicit call to Stop()
+        }
+
+        mux_.DetachSocketListener( &socket_, this );
+    }
+
+    virtual void ProcessPacket( const char *data, int size,
+            const IpEndpointName& remoteEndpoint )
+    {
+        QueuePacket( data, size, remoteEndpoint, 0 );
+    }
+
+    virtual void ProcessTimestampedPacket( const char *data, int size,
+            const IpEndpointName& remoteEndpoint, const PacketTimestamp& timestamp )
+    {
+        QueuePacket( data, size, remoteEndpoint, &timestamp );
+    }
+
+    void Start()
+    {
+        assert( !isRunning_ );
+
+        error_.clear();
+        thread_ = std::thread( RunReceiveThread, this );
+        isRunning_ = true;
+    }
+
+    void Stop()
+    {
+        if( !isRunning_ )
+            return;
+
+        // stopping_ releases a receive thread waiting for a free packet
+        stopping_.store( true, std::memory_order_release );
+        mux_.AsynchronousBreak();
+        thread_.join();
+        stopping_.store( false, std::memory_order_release );
+
+        isRunning_ = false;
+
+        if( !error_.empty() )
+            throw std::runtime_error( error_ );
+    }
+
+    std::size_t Drain( PacketListener *listener, std::size_t maxPackets )
+    {
+        std::size_t drainedCount = 0;
+        std::size_t indices[ DRAIN_BATCH_SIZE ];
+
+        while( drainedCount < maxPackets ){
+            std::size_t remaining = maxPackets - drainedCount;
+            std::size_t count = queuedPackets_.Pop( indices,
+                    ( remaining < DRAIN_BATCH_SIZE ) ? remaining : (std::size_t)DRAIN_BATCH_SIZE );
+            if( count == 0 )
+                break;
+
+            // each packet is freed as soon as it has been processed
+            std::size_t i = 0;
+            try{
+                for( ; i < count; ++i ){
+                    const Packet& packet = packets_[ indices[i] ];
+                    if( packet.timestamped ){
+                        listener->ProcessTimestampedPacket( &packet.data[0], (int)packet.size,
+                                packet.remoteEndpoint, packet.timestamp );
+                    }else{
+                        listener->ProcessPacket( &packet.data[0], (int)packet.size, packet.remoteEndpoint );
+                    }
+                    freePackets_.Push( indices[i] );
+                }
+            }catch(...){
+                // the packet which threw counts as drained, the rest of the
+                // batch is discarded
+                std::size_t thrownIndex = i;
+                for( ; i < count; ++i )
+                    freePackets_.Push( indices[i] );
+                drainedCount_.fetch_add( drainedCount + thrownIndex + 1, std::memory_order_relaxed );
+                throw;
+            }
+
+            drainedCount += count;
+        }
+
+        drainedCount_.fetch_add( drainedCount, std::memory_order_relaxed );
+        return drainedCount;
+    }
+
+    std::size_t QueuedCount() const
+    {
+        return queuedPackets_.Size();
+    }
+
+    Counters GetCounters() const
+    {
+        Counters result;
+        result.receivedCount = receivedCount_.load( std::memory_order_relaxed );
+        result.drainedCount = drainedCount_.load( std::memory_order_relaxed );
+        result.droppedNewestCount = droppedNewestCount_.load( std::memory_order_relaxed );
+        result.droppedOldestCount = droppedOldestCount_.load( std::memory_order_relaxed );
+        result.blockedCount = blockedCount_.load( std::memory_order_relaxed );
+        result.truncatedCount = truncatedCount_.load( std::memory_order_relaxed );
+        return result;
+    }
+};
+
+
+UdpSocketListenerThread::UdpSocketListenerThread( UdpSocket& socket,
+        std::size_t capacity, OverflowPolicy overflowPolicy )
+{
+    impl_ = new Implementation( socket, capacity, overflowPolicy );
+}
+
+UdpSocketListenerThread::~UdpSocketListenerThread()
+{
+    delete impl_;
+}
+
+void UdpSocketListenerThread::Start()
+{
+    impl_->Start();
+}
+
+void UdpSocketListenerThread::Stop()
+{
+    impl_->Stop();
+}
+
+std::size_t UdpSocketListenerThread::Drain( PacketListener *listener, std::size_t maxPackets )
+{
+    return impl_->Drain( listener, maxPackets );
+}
+
+std::size_t UdpSocketListenerThread::QueuedCount() const
+{
+    return impl_->QueuedCount();
+}
+
+UdpSocketListenerThread::Counters UdpSocketListenerThread::GetCounters() const
+{
+    return impl_->GetCounters();
+}
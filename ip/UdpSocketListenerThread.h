@@ -0,0 +1,120 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_UDPSOCKETLISTENERTHREAD_H
+#define INCLUDED_OSCPACK_UDPSOCKETLISTENERTHREAD_H
+
+#include <cstring> // size_t
+
+
+class PacketListener;
+class UdpSocket;
+
+
+// UdpSocketListenerThread receives from a UdpSocket on a dedicated thread,
+// which runs a SocketReceiveMultiplexer and copies each packet into a
+// preallocated queue. Application threads then hand the queued packets to
+// a PacketListener in bulk by calling Drain(). Slow listener code
+// therefore never keeps the socket from being read, so the kernel receive
+// buffer doesn't overflow.
+//
+// The queue is lock-free: the receive thread never waits for Drain(),
+// except with the BLOCK policy. Drain() may be called from any thread but
+// only from one thread at a time.
+//
+// When the queue is full the OverflowPolicy decides what happens to a new
+// packet:
+//  DROP_NEWEST  the new packet is discarded.
+//  DROP_OLDEST  the oldest queued packet that Drain() isn't processing yet
+//               is discarded to make room. If Drain() holds every queued
+//               packet the new packet is discarded instead.
+//  BLOCK        the receive thread waits until Drain() frees a slot. The
+//               socket isn't read meanwhile, so the kernel may drop packets.
+
+class UdpSocketListenerThread{
+    class Implementation;
+    Implementation *impl_;
+
+public:
+    enum OverflowPolicy{
+        DROP_NEWEST,
+        DROP_OLDEST,
+        BLOCK
+    };
+
+    struct Counters{
+        Counters()
+            : receivedCount( 0 ), drainedCount( 0 ), droppedNewestCount( 0 )
+            , droppedOldestCount( 0 ), blockedCount( 0 ), truncatedCount( 0 ) {}
+
+        unsigned long receivedCount;       // packets read from the socket
+        unsigned long drainedCount;        // packets passed to a listener by Drain()
+        unsigned long droppedNewestCount;  // new packets discarded because the queue was full
+        unsigned long droppedOldestCount;  // queued packets discarded by DROP_OLDEST
+        unsigned long blockedCount;        // packets for which BLOCK had to wait for a free slot
+        unsigned long truncatedCount;      // packets queued truncated because they didn't fit
+    };
+
+    // The queue holds up to capacity packets of socket.MaxReceivePacketSize()
+    // bytes, as it is when the constructor is called. Longer packets are
+    // queued truncated and counted in truncatedCount: these arrive if the
+    // socket's SetMaxReceivePacketSize() is raised later, or if it has
+    // receive coalescing enabled. The socket must be bound, and must not be
+    // attached to another multiplexer while the thread is running.
+    UdpSocketListenerThread( UdpSocket& socket,
+            std::size_t capacity=1024, OverflowPolicy overflowPolicy=DROP_NEWEST );
+    ~UdpSocketListenerThread(); // calls Stop()
+
+    void Start(); // start the receive thread
+    // break the receive thread's multiplexer and wait for the thread to
+    // finish. throws std::runtime_error if the receive loop failed.
+    // packets still queued can be drained afterwards.
+    void Stop();
+
+    // pass up to maxPackets queued packets, in arrival order, to listener.
+    // ProcessTimestampedPacket() is called if the socket has receive
+    // timestamps enabled, ProcessPacket() otherwise. Returns the number of
+    // packets passed, 0 if the queue was empty.
+    std::size_t Drain( PacketListener *listener, std::size_t maxPackets=(std::size_t)-1 );
+
+    // the number of packets waiting to be drained
+    std::size_t QueuedCount() const;
+
+    Counters GetCounters() const;
+};
+
+
+#endif /* INCLUDED_OSCPACK_UDPSOCKETLISTENERTHREAD_H */
@@ -0,0 +1,363 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_IOURING_H
+#define INCLUDED_OSCPACK_IOURING_H
+
+/*
+    A minimal io_uring wrapper used by the POSIX SocketReceiveMultiplexer.
+    This is an internal header: it is only included by ip/posix/UdpSocket.cpp
+    on Linux, and only if <linux/io_uring.h> exists. It talks to the kernel
+    directly so that oscpack doesn't depend on liburing.
+
+    OSC_HAVE_IO_URING is defined if the kernel headers are recent enough to
+    support multishot recvmsg with provided buffer rings (Linux 6.0).
+*/
+
+#include <linux/io_uring.h>
+
+#if defined(IORING_RECV_MULTISHOT) && defined(IORING_ASYNC_CANCEL_ANY)
+
+#define OSC_HAVE_IO_URING
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <cstring> // for memset
+#include <vector>
+
+
+class IoUring{
+    int fd_;
+
+    // submission queue
+    unsigned *sqHead_;
+    unsigned *sqTail_;
+    unsigned sqMask_;
+    unsigned *sqArray_;
+    struct io_uring_sqe *sqes_;
+    unsigned sqLocalTail_; // includes sqes which haven't been submitted yet
+
+    // completion queue
+    unsigned *cqHead_;
+    unsigned *cqTail_;
+    unsigned cqMask_;
+    struct io_uring_cqe *cqes_;
+
+    void *sqRing_;
+    std::size_t sqRingSize_;
+    void *cqRing_;
+    std::size_t cqRingSize_;
+    std::size_t sqesSize_;
+
+    IoUring( const IoUring& ); // no copy
+    IoUring& operator=( const IoUring& );
+
+public:
+    IoUring()
+        : fd_( -1 )
+        , sqHead_( 0 ), sqTail_( 0 ), sqMask_( 0 ), sqArray_( 0 ), sqes_( 0 )
+        , sqLocalTail_( 0 )
+        , cqHead_( 0 ), cqTail_( 0 ), cqMask_( 0 ), cqes_( 0 )
+        , sqRing_( MAP_FAILED ), sqRingSize_( 0 )
+        , cqRing_( MAP_FAILED ), cqRingSize_( 0 )
+        , sqesSize_( 0 ) {}
+
+    ~IoUring() { Close(); }
+
+    // returns false if io_uring is unavailable (old kernel, disabled by
+    // sysctl or seccomp etc.)
+    bool Open( unsigned entries )
+    {
+        struct io_uring_params params;
+        std::memset( &params, 0, sizeof(params) );
+
+        fd_ = (int)syscall( __NR_io_uring_setup, entries, &params );
+        if( fd_ < 0 ){
+            fd_ = -1;
+            return false;
+        }
+
+        sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        if( params.features & IORING_FEAT_SINGLE_MMAP ){
+            if( cqRingSize_ > sqRingSize_ )
+                sqRingSize_ = cqRingSize_;
+            cqRingSize_ = sqRingSize_;
+        }
+
+        sqRing_ = mmap( 0, sqRingSize_, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING );
+        if( sqRing_ == MAP_FAILED ){
+            Close();
+            return false;
+        }
+
+        if( params.features & IORING_FEAT_SINGLE_MMAP ){
+            cqRing_ = sqRing_;
+        }else{
+            cqRing_ = mmap( 0, cqRingSize_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING );
+            if( cqRing_ == MAP_FAILED ){
+                Close();
+                return false;
+            }
+        }
+
+        sqesSize_ = params.sq_entries * sizeof(struct io_uring_sqe);
+        void *sqes = mmap( 0, sqesSize_, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES );
+        if( sqes == MAP_FAILED ){
+            Close();
+            return false;
+        }
+        sqes_ = (struct io_uring_sqe*)sqes;
+
+        char *sq = (char*)sqRing_;
+        sqHead_ = (unsigned*)(sq + params.sq_off.head);
+        sqTail_ = (unsigned*)(sq + params.sq_off.tail);
+        sqMask_ = *(unsigned*)(sq + params.sq_off.ring_mask);
+        sqArray_ = (unsigned*)(sq + params.sq_off.array);
+        sqLocalTail_ = *sqTail_;
+
+        char *cq = (char*)cqRing_;
+        cqHead_ = (unsigned*)(cq + params.cq_off.head);
+        cqTail_ = (unsigned*)(cq + params.cq_off.tail);
+        cqMask_ = *(unsigned*)(cq + params.cq_off.ring_mask);
+        cqes_ = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+        return true;
+    }
+
+    void Close()
+    {
+        if( sqes_ )
+            munmap( sqes_, sqesSize_ );
+        if( cqRing_ != MAP_FAILED && cqRing_ != sqRing_ )
+            munmap( cqRing_, cqRingSize_ );
+        if( sqRing_ != MAP_FAILED )
+            munmap( sqRing_, sqRingSize_ );
+        if( fd_ != -1 )
+            close( fd_ );
+
+        fd_ = -1;
+        sqes_ = 0;
+        sqRing_ = cqRing_ = MAP_FAILED;
+    }
+
+    bool IsOpen() const { return fd_ != -1; }
+
+    // returns a zeroed sqe. if the submission queue is full the queued sqes
+    // are submitted first. returns 0 if the kernel won't accept any more.
+    struct io_uring_sqe *GetSqe()
+    {
+        unsigned head = __atomic_load_n( sqHead_, __ATOMIC_ACQUIRE );
+        if( sqLocalTail_ - head > sqMask_ ){
+            Submit( 0 );
+            head = __atomic_load_n( sqHead_, __ATOMIC_ACQUIRE );
+            if( sqLocalTail_ - head > sqMask_ )
+                return 0;
+        }
+
+        unsigned index = sqLocalTail_ & sqMask_;
+        struct io_uring_sqe *sqe = &sqes_[ index ];
+        std::memset( sqe, 0, sizeof(*sqe) );
+        sqArray_[ index ] = index;
+        ++sqLocalTail_;
+
+        return sqe;
+    }
+
+    // submit queued sqes and optionally wait for at least waitCount
+    // completions. returns the number of sqes submitted, or -errno.
+    int Submit( unsigned waitCount )
+    {
+        // sqes left over from a partial submission are submitted again
+        __atomic_store_n( sqTail_, sqLocalTail_, __ATOMIC_RELEASE );
+        unsigned toSubmit = sqLocalTail_ - __atomic_load_n( sqHead_, __ATOMIC_ACQUIRE );
+
+        if( toSubmit == 0 && waitCount == 0 )
+            return 0;
+
+        int result = (int)syscall( __NR_io_uring_enter, fd_, toSubmit, waitCount,
+                (waitCount > 0) ? IORING_ENTER_GETEVENTS : 0, (void*)0, (std::size_t)0 );
+
+        return (result < 0) ? -errno : result;
+    }
+
+    // returns the next completion, or 0 if there are none
+    struct io_uring_cqe *PeekCqe()
+    {
+        unsigned head = *cqHead_;
+        if( head == __atomic_load_n( cqTail_, __ATOMIC_ACQUIRE ) )
+            return 0;
+
+        return &cqes_[ head & cqMask_ ];
+    }
+
+    // mark the completion returned by PeekCqe() as consumed
+    void SeenCqe()
+    {
+        __atomic_store_n( cqHead_, *cqHead_ + 1, __ATOMIC_RELEASE );
+    }
+
+    int Register( unsigned opcode, void *arg, unsigned argCount )
+    {
+        int result = (int)syscall( __NR_io_uring_register, fd_, opcode, arg, argCount );
+        return (result < 0) ? -errno : result;
+    }
+};
+
+
+// A ring of provided buffers which the kernel picks from when completing
+// IOSQE_BUFFER_SELECT requests (e.g. multishot recvmsg).
+
+class IoUringBufferRing{
+    IoUring& ring_;
+    unsigned short groupId_;
+    unsigned entries_;
+    std::size_t bufferSize_;
+
+    struct io_uring_buf_ring *bufRing_;
+    std::size_t bufRingSize_;
+    char *buffers_; // 0 if the buffers were supplied to Register()
+    std::vector<char*> bufferAddresses_;
+    unsigned short tail_;
+    bool isRegistered_;
+
+    IoUringBufferRing( const IoUringBufferRing& ); // no copy
+    IoUringBufferRing& operator=( const IoUringBufferRing& );
+
+public:
+    // entries must be a power of 2
+    IoUringBufferRing( IoUring& ring, unsigned short groupId, unsigned entries, std::size_t bufferSize )
+        : ring_( ring )
+        , groupId_( groupId )
+        , entries_( entries )
+        , bufferSize_( bufferSize )
+        , bufRing_( 0 )
+        , bufRingSize_( entries * sizeof(struct io_uring_buf) )
+        , buffers_( 0 )
+        , tail_( 0 )
+        , isRegistered_( false ) {}
+
+    ~IoUringBufferRing()
+    {
+        if( isRegistered_ ){
+            struct io_uring_buf_reg reg;
+            std::memset( &reg, 0, sizeof(reg) );
+            reg.bgid = groupId_;
+            ring_.Register( IORING_UNREGISTER_PBUF_RING, &reg, 1 );
+        }
+
+        if( bufRing_ )
+            munmap( bufRing_, bufRingSize_ );
+        delete [] buffers_;
+    }
+
+    // returns 0 on success or -errno (-EINVAL on kernels without buffer rings).
+    // the buffers are allocated here unless the caller supplies entries
+    // buffers of bufferSize bytes.
+    int Register( char *const *buffers=0 )
+    {
+        void *bufRing = mmap( 0, bufRingSize_, PROT_READ | PROT_WRITE,
+                MAP_ANONYMOUS | MAP_PRIVATE, -1, 0 );
+        if( bufRing == MAP_FAILED )
+            return -errno;
+        bufRing_ = (struct io_uring_buf_ring*)bufRing;
+
+        struct io_uring_buf_reg reg;
+        std::memset( &reg, 0, sizeof(reg) );
+        reg.ring_addr = (unsigned long)bufRing_;
+        reg.ring_entries = entries_;
+        reg.bgid = groupId_;
+
+        int result = ring_.Register( IORING_REGISTER_PBUF_RING, &reg, 1 );
+        if( result < 0 )
+            return result;
+        isRegistered_ = true;
+
+        if( buffers ){
+            bufferAddresses_.assign( buffers, buffers + entries_ );
+        }else{
+            buffers_ = new char[ entries_ * bufferSize_ ];
+            bufferAddresses_.resize( entries_ );
+            for( unsigned i = 0; i < entries_; ++i )
+                bufferAddresses_[i] = buffers_ + i * bufferSize_;
+        }
+
+        for( unsigned i = 0; i < entries_; ++i )
+            Add( (unsigned short)i );
+        Publish();
+
+        return 0;
+    }
+
+    unsigned short GroupId() const { return groupId_; }
+    std::size_t BufferSize() const { return bufferSize_; }
+    char *Buffer( unsigned short bufferId ) { return bufferAddresses_[ bufferId ]; }
+
+    // hand a buffer back to the kernel. takes effect after Publish()
+    void Add( unsigned short bufferId )
+    {
+        // bufs[] is not used because __DECLARE_FLEX_ARRAY gives it a nonzero
+        // offset when compiled as C++. the entries start at the ring base.
+        struct io_uring_buf *buf = (struct io_uring_buf*)bufRing_ + (tail_ & (entries_ - 1));
+        buf->addr = (unsigned long)Buffer( bufferId );
+        buf->len = (unsigned)bufferSize_;
+        buf->bid = bufferId;
+        ++tail_;
+    }
+
+    // hand a different buffer of bufferSize bytes to the kernel in place of
+    // bufferId, e.g. when the old one is still referenced by a listener
+    void Replace( unsigned short bufferId, char *buffer )
+    {
+        bufferAddresses_[ bufferId ] = buffer;
+        Add( bufferId );
+    }
+
+    void Publish()
+    {
+        __atomic_store_n( &bufRing_->tail, tail_, __ATOMIC_RELEASE );
+    }
+};
+
+#endif /* IORING_RECV_MULTISHOT */
+
+#endif /* INCLUDED_OSCPACK_IOURING_H */
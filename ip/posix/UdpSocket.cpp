@@ -45,6 +45,64 @@
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <netinet/in.h> // for sockaddr_in
+#include <poll.h>
+
+#if defined(__linux__) && !defined(OSC_DISABLE_EPOLL)
+#define OSC_HAVE_EPOLL
+#include <sys/epoll.h>
+#endif
+
+#if defined(__linux__) && !defined(OSC_DISABLE_RECVMMSG)
+#define OSC_HAVE_RECVMMSG
+#endif
+
+#if defined(__linux__) && !defined(OSC_DISABLE_SENDMMSG)
+#define OSC_HAVE_SENDMMSG
+#include <sys/uio.h> // for UIO_MAXIOV
+#endif
+
+#if defined(__linux__)
+#include <netinet/udp.h> // for UDP_GRO and UDP_SEGMENT
+#if defined(UDP_GRO) && !defined(OSC_DISABLE_UDP_GRO)
+#define OSC_HAVE_UDP_GRO
+#endif
+#if defined(UDP_SEGMENT) && !defined(OSC_DISABLE_UDP_GSO)
+#define OSC_HAVE_UDP_GSO
+#endif
+#endif
+
+#if defined(__linux__) && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY) && !defined(OSC_DISABLE_ZEROCOPY)
+#define OSC_HAVE_ZEROCOPY
+#include <linux/errqueue.h> // for sock_extended_err
+#endif
+
+#if defined(__linux__) && !defined(OSC_DISABLE_TIMERFD)
+#define OSC_HAVE_TIMERFD
+#include <sys/timerfd.h>
+#endif
+
+#if defined(__linux__) && !defined(OSC_DISABLE_TIMESTAMPING)
+#include <linux/net_tstamp.h> // for SOF_TIMESTAMPING_*
+#if defined(SO_TIMESTAMPING)
+#define OSC_HAVE_TIMESTAMPING
+#endif
+#endif
+
+#if defined(IP_PKTINFO) && !defined(OSC_DISABLE_PKTINFO)
+#define OSC_HAVE_PKTINFO
+#endif
+
+#if defined(__linux__) && !defined(OSC_DISABLE_ROUTE_MONITOR)
+#define OSC_HAVE_ROUTE_MONITOR
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h> // for RTMGRP_*
+#endif
+
+#if defined(__linux__) && !defined(OSC_DISABLE_IO_URING) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include "ip/posix/IoUring.h" // defines OSC_HAVE_IO_URING if the kernel headers are recent enough
+#endif
+#endif
 
 #include <signal.h>
 #include <math.h>
@@ -54,11 +112,15 @@
 #include <algorithm>
 #include <cassert>
 #include <cstring> // for memset
+#include <deque>
+#include <map>
 #include <stdexcept>
 #include <vector>
 
+#include "ip/PacketBuffer.h"
 #include "ip/PacketListener.h"
 #include "ip/TimerListener.h"
+#include "ip/SendCompletionListener.h"
 
 
 #if defined(__APPLE__) && !defined(_SOCKLEN_T)
@@ -97,6 +159,233 @@ static IpEndpointName IpEndpointNameFromSockaddr( const struct sockaddr_in& sock
 }
 
 
+// returns the current time in nanoseconds. the monotonic clock is used
+// where available so that timers aren't affected by changes to the system time.
+static long long GetCurrentTimeNs()
+{
+#if defined(CLOCK_MONOTONIC)
+	struct timespec t;
+	clock_gettime( CLOCK_MONOTONIC, &t );
+
+	return ((long long)t.tv_sec * 1000000000LL) + t.tv_nsec;
+#else
+	struct timeval t;
+	gettimeofday( &t, 0 );
+
+	return ((long long)t.tv_sec * 1000000000LL) + ((long long)t.tv_usec * 1000LL);
+#endif
+}
+
+
+// space for the control messages which can accompany a datagram: the
+// UDP_GRO segment size, a receive timestamp and the local address the
+// datagram arrived at. SO_TIMESTAMPING delivers three timespecs, the other
+// timestamp options a single timespec or timeval.
+#ifdef OSC_HAVE_UDP_GRO
+static const std::size_t GRO_CONTROL_SIZE = CMSG_SPACE( sizeof(int) );
+#else
+static const std::size_t GRO_CONTROL_SIZE = 0;
+#endif
+static const std::size_t TIMESTAMP_CONTROL_SIZE = CMSG_SPACE( sizeof(struct timespec) * 3 );
+#ifdef OSC_HAVE_PKTINFO
+static const std::size_t PKTINFO_CONTROL_SIZE = CMSG_SPACE( sizeof(struct in_pktinfo) );
+#else
+static const std::size_t PKTINFO_CONTROL_SIZE = 0;
+#endif
+static const std::size_t MAX_CONTROL_SIZE = GRO_CONTROL_SIZE + TIMESTAMP_CONTROL_SIZE + PKTINFO_CONTROL_SIZE;
+
+
+// reads the control messages of the datagram(s) described by msg.
+// segmentSize is set to the size of the datagrams which UDP_GRO coalesced
+// into the read, or 0 if the read holds a single datagram. localAddress
+// is set to the local address for replies (host byte order) if IP_PKTINFO
+// is enabled, 0 otherwise.
+static void ReadReceiveControl( struct msghdr *msg, std::size_t& segmentSize, PacketTimestamp& timestamp,
+		unsigned long& localAddress )
+{
+	segmentSize = 0;
+	timestamp = PacketTimestamp();
+	localAddress = 0;
+
+	for( struct cmsghdr *cmsg = CMSG_FIRSTHDR( msg ); cmsg != 0; cmsg = CMSG_NXTHDR( msg, cmsg ) ){
+#ifdef OSC_HAVE_PKTINFO
+		if( cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_PKTINFO ){
+			struct in_pktinfo info;
+			std::memcpy( &info, CMSG_DATA( cmsg ), sizeof(info) );
+			localAddress = ntohl( info.ipi_spec_dst.s_addr );
+			continue;
+		}
+#endif
+#ifdef OSC_HAVE_UDP_GRO
+		if( cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO ){
+			int size;
+			std::memcpy( &size, CMSG_DATA( cmsg ), sizeof(size) );
+			segmentSize = (size > 0) ? (std::size_t)size : 0;
+			continue;
+		}
+#endif
+		if( cmsg->cmsg_level != SOL_SOCKET )
+			continue;
+
+#ifdef OSC_HAVE_TIMESTAMPING
+		if( cmsg->cmsg_type == SCM_TIMESTAMPING ){
+			// [0] is the software timestamp, [2] the raw hardware timestamp
+			struct timespec ts[3];
+			std::memcpy( ts, CMSG_DATA( cmsg ), sizeof(ts) );
+			int i = (ts[2].tv_sec != 0 || ts[2].tv_nsec != 0) ? 2 : 0;
+			if( ts[i].tv_sec != 0 || ts[i].tv_nsec != 0 ){
+				timestamp.source = (i == 2) ? PacketTimestamp::HARDWARE_TIMESTAMP : PacketTimestamp::SOFTWARE_TIMESTAMP;
+				timestamp.seconds = (long)ts[i].tv_sec;
+				timestamp.nanoseconds = (long)ts[i].tv_nsec;
+			}
+			continue;
+		}
+#endif
+#ifdef SCM_TIMESTAMPNS
+		if( cmsg->cmsg_type == SCM_TIMESTAMPNS ){
+			struct timespec ts;
+			std::memcpy( &ts, CMSG_DATA( cmsg ), sizeof(ts) );
+			timestamp.source = PacketTimestamp::SOFTWARE_TIMESTAMP;
+			timestamp.seconds = (long)ts.tv_sec;
+			timestamp.nanoseconds = (long)ts.tv_nsec;
+			continue;
+		}
+#endif
+#ifdef SCM_TIMESTAMP
+		if( cmsg->cmsg_type == SCM_TIMESTAMP ){
+			struct timeval tv;
+			std::memcpy( &tv, CMSG_DATA( cmsg ), sizeof(tv) );
+			timestamp.source = PacketTimestamp::SOFTWARE_TIMESTAMP;
+			timestamp.seconds = (long)tv.tv_sec;
+			timestamp.nanoseconds = (long)tv.tv_usec * 1000;
+			continue;
+		}
+#endif
+	}
+}
+
+
+#ifdef OSC_HAVE_IO_URING
+
+// the type of each io_uring request is stored in the top byte of its
+// user_data, the lower bits hold the socket or send slot index.
+enum IoUringRequestType{
+	IO_URING_RECEIVE = 1,
+	IO_URING_BREAK,
+	IO_URING_TIMEOUT,
+	IO_URING_SEND,
+	IO_URING_CANCEL,
+	IO_URING_ERROR_POLL
+};
+
+static inline __u64 IoUringUserData( IoUringRequestType type, std::size_t index )
+{
+	return ((__u64)type << 56) | (__u64)index;
+}
+
+static inline IoUringRequestType IoUringRequestTypeOf( __u64 userData )
+{
+	return (IoUringRequestType)(userData >> 56);
+}
+
+static inline std::size_t IoUringRequestIndexOf( __u64 userData )
+{
+	return (std::size_t)(userData & ((((__u64)1) << 56) - 1));
+}
+
+
+// Datagrams sent by a listener (i.e. from the thread running an io_uring
+// multiplexer) are copied into a slot and submitted on the ring together
+// with the next round of receive requests, instead of costing a system
+// call each. Sends from other threads go straight to the socket.
+
+class IoUringSendQueue{
+	struct Slot{
+		struct msghdr message;
+		struct iovec iov;
+		struct sockaddr_in destination;
+		std::vector<char> data;
+	};
+
+	IoUring& ring_;
+	pthread_t runThread_;
+	std::vector<Slot> slots_;
+	std::vector<std::size_t> freeSlots_;
+
+public:
+	IoUringSendQueue( IoUring& ring, std::size_t slotCount )
+		: ring_( ring )
+		, runThread_( pthread_self() )
+		, slots_( slotCount )
+	{
+		freeSlots_.reserve( slotCount );
+		for( std::size_t i = 0; i < slotCount; ++i )
+			freeSlots_.push_back( slotCount - 1 - i );
+	}
+
+	// returns false if the datagram should be sent directly. destination
+	// is 0 for a connected socket.
+	bool Queue( int socket, const struct sockaddr_in *destination, const char *data, std::size_t size )
+	{
+		if( !pthread_equal( pthread_self(), runThread_ ) )
+			return false;
+
+		if( freeSlots_.empty() ){
+			// hand the queued datagrams to the kernel so that the caller's
+			// direct send doesn't overtake them
+			ring_.Submit( 0 );
+			return false;
+		}
+
+		struct io_uring_sqe *sqe = ring_.GetSqe();
+		if( !sqe )
+			return false;
+
+		std::size_t slotIndex = freeSlots_.back();
+		freeSlots_.pop_back();
+
+		Slot& slot = slots_[ slotIndex ];
+		slot.data.assign( data, data + size );
+		slot.iov.iov_base = (size > 0) ? &slot.data[0] : 0;
+		slot.iov.iov_len = size;
+		std::memset( &slot.message, 0, sizeof(slot.message) );
+		slot.message.msg_iov = &slot.iov;
+		slot.message.msg_iovlen = 1;
+		if( destination ){
+			slot.destination = *destination;
+			slot.message.msg_name = &slot.destination;
+			slot.message.msg_namelen = sizeof(slot.destination);
+		}
+
+		sqe->opcode = IORING_OP_SENDMSG;
+		sqe->fd = socket;
+		sqe->addr = (unsigned long)&slot.message;
+		sqe->len = 1;
+		sqe->user_data = IoUringUserData( IO_URING_SEND, slotIndex );
+
+		return true;
+	}
+
+	// hands the queued datagrams to the kernel before the caller sends
+	// one directly, e.g. with MSG_ZEROCOPY, so that it doesn't overtake them
+	void SubmitBeforeDirectSend()
+	{
+		if( InFlightCount() > 0 && pthread_equal( pthread_self(), runThread_ ) )
+			ring_.Submit( 0 );
+	}
+
+	// called when the send in slotIndex completes
+	void Release( std::size_t slotIndex )
+	{
+		freeSlots_.push_back( slotIndex );
+	}
+
+	std::size_t InFlightCount() const { return slots_.size() - freeSlots_.size(); }
+};
+
+#endif /* OSC_HAVE_IO_URING */
+
+
 class UdpSocket::Implementation{
 	bool isBound_;
 	bool isConnected_;
@@ -105,423 +394,2804 @@ class UdpSocket::Implementation{
 	struct sockaddr_in connectedAddr_;
 	struct sockaddr_in sendToAddr_;
 
+	std::size_t maxReceivePacketSize_;
+	bool receiveCoalescing_;
+	UdpSocket::ReceiveTimestampMode receiveTimestamps_;
+
+	// the bound endpoint as reported by getsockname(), so that it holds the
+	// port chosen by the system for ANY_PORT
+	struct sockaddr_in boundAddr_;
+
+	// LocalEndpointFor() results by remote address (host byte order), see
+	// SetLocalEndpointCacheTimeout()
+	struct CachedLocalAddress{
+		unsigned long address;
+		long long expiryNs;
+	};
+	typedef std::map< unsigned long, CachedLocalAddress > LocalAddressCache;
+	mutable LocalAddressCache localAddressCache_;
+	long long localAddressCacheTimeoutNs_; // 0 if the cache is disabled
+	bool learnLocalAddresses_;
+
+	// an unbound socket used to look up routes, so that LocalEndpointFor()
+	// doesn't disturb the connected state (or the port) of socket_
+	mutable int routeSocket_;
+#ifdef OSC_HAVE_ROUTE_MONITOR
+	// a netlink socket which receives routing and address changes, -1 if unavailable
+	int routeMonitorSocket_;
+	mutable long long nextRouteCheckNs_;
+#endif
+
+	// receive batch state. the buffers are allocated by ReceiveBatch()
+	// and reused for every batch. when receiving into a PacketBufferPool
+	// each slot holds a pool buffer instead, which is replaced once a
+	// listener keeps a reference to it.
+	std::size_t receiveBatchSize_;
+	std::size_t batchPacketCapacity_;
+	std::size_t batchCount_;
+	std::vector<char> batchData_;
+	PacketBufferPool *batchPool_;
+	std::vector<PacketRef> batchPackets_;
+	std::vector<std::size_t> batchSizes_;
+	std::vector<std::size_t> batchSegmentSizes_;
+	std::vector<PacketTimestamp> batchTimestamps_;
+	std::vector<struct sockaddr_in> batchAddrs_;
+#ifdef OSC_HAVE_RECVMMSG
+	std::vector<struct iovec> batchIovecs_;
+	std::vector<struct mmsghdr> batchHeaders_;
+	std::size_t batchControlSize_;
+	std::vector<char> batchControl_;
+#endif
+
+#ifdef OSC_HAVE_IO_URING
+	// set while the socket is attached to a running io_uring multiplexer
+	IoUringSendQueue *sendQueue_;
+#endif
+
+#ifdef OSC_HAVE_ZEROCOPY
+	// zero-copy sends still held by the kernel. the kernel numbers them
+	// consecutively, pendingZeroCopySends_[i] has the id
+	// firstPendingZeroCopyId_ + i. completions may arrive in any order,
+	// entries are removed from the front once they are completed.
+	struct PendingZeroCopySend{
+		const char *data;
+		std::size_t size;
+		bool completed;
+	};
+
+	std::size_t zeroCopyThreshold_;
+	SendCompletionListener *sendCompletionListener_;
+	std::deque<PendingZeroCopySend> pendingZeroCopySends_;
+	unsigned int firstPendingZeroCopyId_;
+	std::size_t pendingZeroCopyCount_;
+
+	// returns false if the datagram should be copied instead
+	bool SendZeroCopy( const struct sockaddr_in *destination, const char *data, std::size_t size )
+	{
+		ssize_t result = sendto( socket_, data, size, MSG_ZEROCOPY,
+				(sockaddr*)destination, (destination) ? sizeof(*destination) : 0 );
+		if( result < 0 ){
+			// ENOBUFS means the socket is out of memory for completion
+			// notifications. other errors would fail a copying send too.
+			return errno != ENOBUFS;
+		}
+
+		PendingZeroCopySend pending = { data, size, false };
+		pendingZeroCopySends_.push_back( pending );
+		++pendingZeroCopyCount_;
+
+		return true;
+	}
+
+	std::size_t CompleteZeroCopySends( unsigned int firstId, unsigned int lastId, bool copied )
+	{
+		std::size_t completedCount = 0;
+		for( unsigned int id = firstId; ; ++id ){
+			std::size_t index = (std::size_t)(id - firstPendingZeroCopyId_); // ids wrap around
+			if( index < pendingZeroCopySends_.size() && !pendingZeroCopySends_[index].completed ){
+				pendingZeroCopySends_[index].completed = true;
+				--pendingZeroCopyCount_;
+				++completedCount;
+
+				// the listener may send again, which appends to pendingZeroCopySends_
+				const char *data = pendingZeroCopySends_[index].data;
+				std::size_t size = pendingZeroCopySends_[index].size;
+				sendCompletionListener_->SendCompleted( data, size, copied );
+			}
+
+			if( id == lastId )
+				break;
+		}
+
+		while( !pendingZeroCopySends_.empty() && pendingZeroCopySends_.front().completed ){
+			pendingZeroCopySends_.pop_front();
+			++firstPendingZeroCopyId_;
+		}
+
+		return completedCount;
+	}
+#endif /* OSC_HAVE_ZEROCOPY */
+
+#ifdef OSC_HAVE_UDP_GSO
+	bool sendSegmentation_;
+	std::vector<struct iovec> segmentIovecs_; // reused by each call to SendSegmentRun()
+
+	// the kernel splits one send into at most 64 segments (128 on recent
+	// kernels), and the whole run must fit in a single IPv4 datagram.
+	enum { MAX_SEGMENT_COUNT=64, MAX_SEGMENTED_SEND_SIZE=65507 };
+
+	// returns the end of the run of entries starting at begin which can be
+	// sent as one segmented send: equal sizes, to the same destination.
+	std::size_t SegmentRunEnd( const UdpBatchEntry *entries, std::size_t begin, std::size_t count, bool useEntryEndpoints ) const
+	{
+		std::size_t segmentSize = entries[begin].size;
+		if( segmentSize == 0 )
+			return begin + 1;
+
+		std::size_t maxRunLength = MAX_SEGMENTED_SEND_SIZE / segmentSize;
+		if( maxRunLength > MAX_SEGMENT_COUNT )
+			maxRunLength = MAX_SEGMENT_COUNT;
+
+		std::size_t end = begin + 1;
+		while( end < count && end - begin < maxRunLength
+				&& entries[end].size == segmentSize
+				&& (!useEntryEndpoints || entries[end].remoteEndpoint == entries[begin].remoteEndpoint) )
+			++end;
+
+		return end;
+	}
+
+	// send entries [0, count) as one buffer which the kernel (or the NIC)
+	// splits into datagrams. the entries are gathered with an iovec each
+	// rather than copied. returns 0 or the errno of the failed send.
+	int SendSegmentRun( UdpBatchEntry *entries, std::size_t count, bool useEntryEndpoints )
+	{
+		if( segmentIovecs_.size() < count )
+			segmentIovecs_.resize( count );
+
+		for( std::size_t i = 0; i < count; ++i ){
+			segmentIovecs_[i].iov_base = (void*)entries[i].data;
+			segmentIovecs_[i].iov_len = entries[i].size;
+		}
+
+		union{
+			char buffer[ CMSG_SPACE( sizeof(unsigned short) ) ];
+			struct cmsghdr align;
+		} control;
+		std::memset( &control, 0, sizeof(control) );
+
+		struct sockaddr_in destination;
+		struct msghdr msg;
+		std::memset( &msg, 0, sizeof(msg) );
+		msg.msg_iov = &segmentIovecs_[0];
+		msg.msg_iovlen = count;
+		msg.msg_control = control.buffer;
+		msg.msg_controllen = sizeof(control.buffer);
+		if( useEntryEndpoints ){
+			SockaddrFromIpEndpointName( destination, entries[0].remoteEndpoint );
+			msg.msg_name = &destination;
+			msg.msg_namelen = sizeof(destination);
+		}
+
+		struct cmsghdr *cmsg = CMSG_FIRSTHDR( &msg );
+		cmsg->cmsg_level = SOL_UDP;
+		cmsg->cmsg_type = UDP_SEGMENT;
+		cmsg->cmsg_len = CMSG_LEN( sizeof(unsigned short) );
+		unsigned short segmentSize = (unsigned short)entries[0].size;
+		std::memcpy( CMSG_DATA( cmsg ), &segmentSize, sizeof(segmentSize) );
+
+		ssize_t result;
+		do{
+			result = sendmsg( socket_, &msg, 0 );
+		}while( result < 0 && errno == EINTR );
+
+		return (result < 0) ? errno : 0;
+	}
+
+	std::size_t SendSegmented( UdpBatchEntry *entries, std::size_t count, bool useEntryEndpoints )
+	{
+		std::size_t sentCount = 0;
+		std::size_t unsegmentedBegin = 0; // entries not yet sent, that aren't part of a run
+		std::size_t i = 0;
+		while( i < count ){
+			std::size_t runEnd = SegmentRunEnd( entries, i, count, useEntryEndpoints );
+			if( runEnd - i < 2 || !sendSegmentation_ ){
+				i = runEnd;
+				continue;
+			}
+
+			if( unsegmentedBegin < i )
+				sentCount += SendUnsegmented( entries + unsegmentedBegin, i - unsegmentedBegin, useEntryEndpoints );
+
+			int error = SendSegmentRun( entries + i, runEnd - i, useEntryEndpoints );
+			if( error == EIO || error == ENOPROTOOPT || error == EOPNOTSUPP ){
+				// the kernel or device can't segment (e.g. no checksum
+				// offload). send this run and all later ones unsegmented.
+				sendSegmentation_ = false;
+				unsegmentedBegin = i;
+			}else if( error == EINVAL || error == EMSGSIZE ){
+				// e.g. segments larger than the path MTU. send this run unsegmented.
+				unsegmentedBegin = i;
+			}else{
+				for( std::size_t j = i; j < runEnd; ++j ){
+					entries[j].bytesSent = (error == 0) ? entries[j].size : 0;
+					entries[j].error = error;
+				}
+				if( error == 0 )
+					sentCount += runEnd - i;
+				unsegmentedBegin = runEnd;
+			}
+
+			i = runEnd;
+		}
+
+		if( unsegmentedBegin < count )
+			sentCount += SendUnsegmented( entries + unsegmentedBegin, count - unsegmentedBegin, useEntryEndpoints );
+
+		return sentCount;
+	}
+#endif /* OSC_HAVE_UDP_GSO */
+
+#ifdef OSC_HAVE_SENDMMSG
+	// send batch state, reused by each call to SendBatch()
+	std::vector<struct iovec> sendIovecs_;
+	std::vector<struct mmsghdr> sendHeaders_;
+	std::vector<struct sockaddr_in> sendAddrs_;
+
+	std::size_t SendMultiple( UdpBatchEntry *entries, std::size_t count, bool useEntryEndpoints )
+	{
+		// sendmmsg() won't send more than UIO_MAXIOV messages per call
+		const std::size_t maxChunkSize = UIO_MAXIOV;
+		std::size_t chunkCapacity = (count < maxChunkSize) ? count : maxChunkSize;
+		if( sendHeaders_.size() < chunkCapacity ){
+			sendIovecs_.resize( chunkCapacity );
+			sendHeaders_.resize( chunkCapacity );
+			sendAddrs_.resize( chunkCapacity );
+		}
+
+		std::size_t sentCount = 0;
+		std::size_t i = 0;
+		while( i < count ){
+			std::size_t chunkSize = count - i;
+			if( chunkSize > chunkCapacity )
+				chunkSize = chunkCapacity;
+
+			std::memset( &sendHeaders_[0], 0, sizeof(struct mmsghdr) * chunkSize );
+			for( std::size_t j = 0; j < chunkSize; ++j ){
+				UdpBatchEntry& entry = entries[ i + j ];
+				sendIovecs_[j].iov_base = (void*)entry.data;
+				sendIovecs_[j].iov_len = entry.size;
+				sendHeaders_[j].msg_hdr.msg_iov = &sendIovecs_[j];
+				sendHeaders_[j].msg_hdr.msg_iovlen = 1;
+
+				if( useEntryEndpoints ){
+					SockaddrFromIpEndpointName( sendAddrs_[j], entry.remoteEndpoint );
+					sendHeaders_[j].msg_hdr.msg_name = &sendAddrs_[j];
+					sendHeaders_[j].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+				}
+			}
+
+			int result = sendmmsg( socket_, &sendHeaders_[0], (unsigned int)chunkSize, 0 );
+			if( result < 0 ){
+				if( errno == EINTR )
+					continue;
+
+				// sendmmsg() only reports an error when the first datagram
+				// fails. record it and carry on with the rest.
+				entries[i].bytesSent = 0;
+				entries[i].error = errno;
+				++i;
+			}else{
+				for( int j = 0; j < result; ++j ){
+					entries[ i + j ].bytesSent = sendHeaders_[j].msg_len;
+					entries[ i + j ].error = 0;
+				}
+				sentCount += (std::size_t)result;
+				i += (std::size_t)result;
+			}
+		}
+
+		return sentCount;
+	}
+#endif /* OSC_HAVE_SENDMMSG */
+
+	void AllocateBatchBuffers( std::size_t packetCapacity, PacketBufferPool *pool )
+	{
+		batchPacketCapacity_ = packetCapacity;
+		batchPool_ = pool;
+		batchData_.resize( (pool) ? 0 : receiveBatchSize_ * packetCapacity );
+		batchPackets_.clear();
+		batchPackets_.resize( (pool) ? receiveBatchSize_ : 0 );
+		batchSizes_.resize( receiveBatchSize_ );
+		batchSegmentSizes_.assign( receiveBatchSize_, 0 );
+		batchTimestamps_.assign( receiveBatchSize_, PacketTimestamp() );
+		batchAddrs_.resize( receiveBatchSize_ );
+
+#ifdef OSC_HAVE_RECVMMSG
+		batchControlSize_ = ControlSize();
+		batchControl_.resize( receiveBatchSize_ * batchControlSize_ );
+		batchIovecs_.resize( receiveBatchSize_ );
+		batchHeaders_.resize( receiveBatchSize_ );
+		std::memset( &batchHeaders_[0], 0, sizeof(struct mmsghdr) * receiveBatchSize_ );
+		for( std::size_t i = 0; i < receiveBatchSize_; ++i ){
+			batchIovecs_[i].iov_base = (pool) ? 0 : &batchData_[ i * packetCapacity ]; // see ReceiveBatch()
+			batchIovecs_[i].iov_len = packetCapacity;
+			batchHeaders_[i].msg_hdr.msg_iov = &batchIovecs_[i];
+			batchHeaders_[i].msg_hdr.msg_iovlen = 1;
+			batchHeaders_[i].msg_hdr.msg_name = &batchAddrs_[i];
+		}
+#endif
+	}
+
+	// recvmsg() without blocking, reading the control messages enabled on
+	// this socket (see ControlSize()). returns the size of the read or -1.
+	ssize_t ReceiveMessage( struct sockaddr_in& fromAddr, char *data, std::size_t size,
+			std::size_t& segmentSize, PacketTimestamp& timestamp )
+	{
+		struct iovec iov;
+		iov.iov_base = data;
+		iov.iov_len = size;
+
+		union{
+			char buffer[ MAX_CONTROL_SIZE ];
+			struct cmsghdr align;
+		} control;
+
+		struct msghdr msg;
+		std::memset( &msg, 0, sizeof(msg) );
+		msg.msg_name = &fromAddr;
+		msg.msg_namelen = sizeof(fromAddr);
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control.buffer;
+		msg.msg_controllen = ControlSize();
+
+		ssize_t result = recvmsg( socket_, &msg, MSG_DONTWAIT );
+		if( result >= 0 ){
+			unsigned long localAddress;
+			ReadReceiveControl( &msg, segmentSize, timestamp, localAddress );
+			if( learnLocalAddresses_ )
+				LearnLocalAddress( fromAddr, localAddress );
+		}
+
+		return result;
+	}
+
+	// the local address the kernel picks when sending to remoteEndpoint
+	unsigned long LookUpLocalAddress( const IpEndpointName& remoteEndpoint ) const
+	{
+		if( routeSocket_ == -1 ){
+			if( (routeSocket_ = socket( AF_INET, SOCK_DGRAM, 0 )) == -1 )
+				throw std::runtime_error("unable to create udp socket\n");
+		}
+
+		// connecting a udp socket only selects a route, nothing is sent
+        struct sockaddr_in connectSockAddr;
+		SockaddrFromIpEndpointName( connectSockAddr, remoteEndpoint );
+       
+        if (connect(routeSocket_, (struct sockaddr *)&connectSockAddr, sizeof(connectSockAddr)) < 0) {
+            throw std::runtime_error("unable to connect udp socket\n");
+        }
+
+        struct sockaddr_in sockAddr;
+        std::memset( (char *)&sockAddr, 0, sizeof(sockAddr ) );
+        socklen_t length = sizeof(sockAddr);
+        if (getsockname(routeSocket_, (struct sockaddr *)&sockAddr, &length) < 0) {
+            throw std::runtime_error("unable to getsockname\n");
+        }
+
+		return ntohl( sockAddr.sin_addr.s_addr );
+	}
+
+	IpEndpointName LocalEndpoint( unsigned long localAddress ) const
+	{
+		struct sockaddr_in sockAddr = boundAddr_;
+		sockAddr.sin_addr.s_addr = htonl( localAddress );
+		return IpEndpointNameFromSockaddr( sockAddr );
+	}
+
+	void CacheLocalAddress( unsigned long remoteAddress, unsigned long localAddress, long long currentTimeNs ) const
+	{
+		// a crude bound on the memory held by entries for peers which have gone away
+		const std::size_t MAX_CACHED_LOCAL_ADDRESSES = 65536;
+		if( localAddressCache_.size() >= MAX_CACHED_LOCAL_ADDRESSES )
+			localAddressCache_.clear();
+
+		CachedLocalAddress& entry = localAddressCache_[ remoteAddress ];
+		entry.address = localAddress;
+		entry.expiryNs = currentTimeNs + localAddressCacheTimeoutNs_;
+	}
+
+	// clears the cache if the routing table or the interface addresses have
+	// changed. the netlink socket is read at most once a millisecond.
+	void CheckForRouteChanges( long long currentTimeNs ) const
+	{
+#ifdef OSC_HAVE_ROUTE_MONITOR
+		const long long ROUTE_CHECK_INTERVAL_NS = 1000000;
+
+		if( routeMonitorSocket_ == -1 || currentTimeNs < nextRouteCheckNs_ )
+			return;
+		nextRouteCheckNs_ = currentTimeNs + ROUTE_CHECK_INTERVAL_NS;
+
+		bool changed = false;
+		char buffer[ 4096 ];
+		for(;;){
+			ssize_t result = recv( routeMonitorSocket_, buffer, sizeof(buffer), MSG_DONTWAIT );
+			if( result > 0 || (result < 0 && errno == ENOBUFS) ){
+				// ENOBUFS means notifications were lost
+				changed = true;
+			}else if( result < 0 && errno == EINTR ){
+				continue;
+			}else{
+				break;
+			}
+		}
+
+		if( changed )
+			localAddressCache_.clear();
+#else
+		(void) currentTimeNs;
+#endif
+	}
+
+#ifdef OSC_HAVE_ROUTE_MONITOR
+	void OpenRouteMonitor()
+	{
+		// without it cache entries only expire by their timeout
+		int fd = socket( AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_ROUTE );
+		if( fd == -1 )
+			return;
+
+		struct sockaddr_nl addr;
+		std::memset( &addr, 0, sizeof(addr) );
+		addr.nl_family = AF_NETLINK;
+		addr.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV4_ROUTE;
+		if( bind( fd, (struct sockaddr *)&addr, sizeof(addr) ) < 0 ){
+			close( fd );
+			return;
+		}
+
+		routeMonitorSocket_ = fd;
+	}
+#endif
+
 public:
 
 	Implementation()
 		: isBound_( false )
 		, isConnected_( false )
 		, socket_( -1 )
+		, maxReceivePacketSize_( UdpSocket::DEFAULT_MAX_RECEIVE_PACKET_SIZE )
+		, receiveCoalescing_( false )
+		, receiveTimestamps_( UdpSocket::NO_RECEIVE_TIMESTAMPS )
+		, localAddressCacheTimeoutNs_( 0 )
+		, learnLocalAddresses_( false )
+		, routeSocket_( -1 )
+#ifdef OSC_HAVE_ROUTE_MONITOR
+		, routeMonitorSocket_( -1 )
+		, nextRouteCheckNs_( 0 )
+#endif
+		, receiveBatchSize_( 1 )
+		, batchPacketCapacity_( 0 )
+		, batchCount_( 0 )
+		, batchPool_( 0 )
+#ifdef OSC_HAVE_RECVMMSG
+		, batchControlSize_( 0 )
+#endif
+#ifdef OSC_HAVE_IO_URING
+		, sendQueue_( 0 )
+#endif
+#ifdef OSC_HAVE_ZEROCOPY
+		, zeroCopyThreshold_( 0 )
+		, sendCompletionListener_( 0 )
+		, firstPendingZeroCopyId_( 0 )
+		, pendingZeroCopyCount_( 0 )
+#endif
+#ifdef OSC_HAVE_UDP_GSO
+		, sendSegmentation_( false )
+#endif
 	{
 		if( (socket_ = socket( AF_INET, SOCK_DGRAM, 0 )) == -1 ){
             throw std::runtime_error("unable to create udp socket\n");
         }
 
-		std::memset( &sendToAddr_, 0, sizeof(sendToAddr_) );
-        sendToAddr_.sin_family = AF_INET;
+		std::memset( &sendToAddr_, 0, sizeof(sendToAddr_) );
+        sendToAddr_.sin_family = AF_INET;
+		std::memset( &boundAddr_, 0, sizeof(boundAddr_) );
+	}
+
+	~Implementation()
+	{
+		if (socket_ != -1) close(socket_);
+		if (routeSocket_ != -1) close(routeSocket_);
+#ifdef OSC_HAVE_ROUTE_MONITOR
+		if (routeMonitorSocket_ != -1) close(routeMonitorSocket_);
+#endif
+	}
+
+	void SetEnableBroadcast( bool enableBroadcast )
+	{
+		int broadcast = (enableBroadcast) ? 1 : 0; // int on posix
+		setsockopt(socket_, SOL_SOCKET, SO_BROADCAST, &broadcast, sizeof(broadcast));
+	}
+
+	void SetAllowReuse( bool allowReuse )
+	{
+		int reuseAddr = (allowReuse) ? 1 : 0; // int on posix
+		setsockopt(socket_, SOL_SOCKET, SO_REUSEADDR, &reuseAddr, sizeof(reuseAddr));
+
+#ifdef __APPLE__
+		// needed also for OS X - enable multiple listeners for a single port on same network interface
+		int reusePort = (allowReuse) ? 1 : 0; // int on posix
+		setsockopt(socket_, SOL_SOCKET, SO_REUSEPORT, &reusePort, sizeof(reusePort));
+#endif
+	}
+
+	void SetAllowReusePort( bool allowReusePort )
+	{
+#ifdef SO_REUSEPORT
+		int reusePort = (allowReusePort) ? 1 : 0; // int on posix
+		setsockopt(socket_, SOL_SOCKET, SO_REUSEPORT, &reusePort, sizeof(reusePort));
+#else
+		(void) allowReusePort;
+#endif
+	}
+
+	IpEndpointName LocalEndpointFor( const IpEndpointName& remoteEndpoint ) const
+	{
+		assert( isBound_ );
+
+		// a socket bound to a specific address always sends from it
+		if( boundAddr_.sin_addr.s_addr != INADDR_ANY )
+			return IpEndpointNameFromSockaddr( boundAddr_ );
+
+		if( localAddressCacheTimeoutNs_ == 0 )
+			return LocalEndpoint( LookUpLocalAddress( remoteEndpoint ) );
+
+		long long currentTimeNs = GetCurrentTimeNs();
+		CheckForRouteChanges( currentTimeNs );
+
+		LocalAddressCache::const_iterator i = localAddressCache_.find( remoteEndpoint.address );
+		if( i != localAddressCache_.end() && i->second.expiryNs > currentTimeNs )
+			return LocalEndpoint( i->second.address );
+
+		unsigned long localAddress = LookUpLocalAddress( remoteEndpoint );
+		CacheLocalAddress( remoteEndpoint.address, localAddress, currentTimeNs );
+		return LocalEndpoint( localAddress );
+	}
+
+	void SetLocalEndpointCacheTimeout( long timeoutMilliseconds )
+	{
+		localAddressCacheTimeoutNs_ = (timeoutMilliseconds > 0) ? timeoutMilliseconds * 1000000LL : 0;
+		localAddressCache_.clear();
+
+#ifdef OSC_HAVE_ROUTE_MONITOR
+		if( localAddressCacheTimeoutNs_ > 0 && routeMonitorSocket_ == -1 )
+			OpenRouteMonitor();
+#endif
+	}
+
+	bool SetEnableLocalEndpointLearning( bool enableLearning )
+	{
+#ifdef OSC_HAVE_PKTINFO
+		int on = (enableLearning) ? 1 : 0;
+		if( setsockopt( socket_, IPPROTO_IP, IP_PKTINFO, &on, sizeof(on) ) != 0 )
+			return false;
+
+		learnLocalAddresses_ = enableLearning;
+		batchPacketCapacity_ = 0; // reallocate on the next ReceiveBatch()
+		return true;
+#else
+		return !enableLearning;
+#endif
+	}
+
+	void Connect( const IpEndpointName& remoteEndpoint )
+	{
+		SockaddrFromIpEndpointName( connectedAddr_, remoteEndpoint );
+       
+        if (connect(socket_, (struct sockaddr *)&connectedAddr_, sizeof(connectedAddr_)) < 0) {
+            throw std::runtime_error("unable to connect udp socket\n");
+        }
+
+		isConnected_ = true;
+	}
+
+	void Send( const char *data, std::size_t size )
+	{
+		assert( isConnected_ );
+
+#ifdef OSC_HAVE_ZEROCOPY
+		if( zeroCopyThreshold_ > 0 && size >= zeroCopyThreshold_ ){
+#ifdef OSC_HAVE_IO_URING
+			if( sendQueue_ )
+				sendQueue_->SubmitBeforeDirectSend();
+#endif
+			if( SendZeroCopy( 0, data, size ) )
+				return;
+		}
+#endif
+
+#ifdef OSC_HAVE_IO_URING
+		if( sendQueue_ && sendQueue_->Queue( socket_, 0, data, size ) )
+			return;
+#endif
+
+        send( socket_, data, size, 0 );
+	}
+
+    void SendTo( const IpEndpointName& remoteEndpoint, const char *data, std::size_t size )
+	{
+		sendToAddr_.sin_addr.s_addr = htonl( remoteEndpoint.address );
+        sendToAddr_.sin_port = htons( remoteEndpoint.port );
+
+#ifdef OSC_HAVE_ZEROCOPY
+		if( zeroCopyThreshold_ > 0 && size >= zeroCopyThreshold_ ){
+#ifdef OSC_HAVE_IO_URING
+			if( sendQueue_ )
+				sendQueue_->SubmitBeforeDirectSend();
+#endif
+			if( SendZeroCopy( &sendToAddr_, data, size ) )
+				return;
+		}
+#endif
+
+#ifdef OSC_HAVE_IO_URING
+		if( sendQueue_ && sendQueue_->Queue( socket_, &sendToAddr_, data, size ) )
+			return;
+#endif
+
+        sendto( socket_, data, size, 0, (sockaddr*)&sendToAddr_, sizeof(sendToAddr_) );
+	}
+
+	// sends each entry as a separate datagram
+	std::size_t SendUnsegmented( UdpBatchEntry *entries, std::size_t count, bool useEntryEndpoints )
+	{
+#ifdef OSC_HAVE_SENDMMSG
+		return SendMultiple( entries, count, useEntryEndpoints );
+#else
+		std::size_t sentCount = 0;
+		for( std::size_t i = 0; i < count; ++i ){
+			ssize_t result;
+			if( useEntryEndpoints ){
+				struct sockaddr_in destination;
+				SockaddrFromIpEndpointName( destination, entries[i].remoteEndpoint );
+
+				result = sendto( socket_, entries[i].data, entries[i].size, 0,
+						(sockaddr*)&destination, sizeof(destination) );
+			}else{
+				result = send( socket_, entries[i].data, entries[i].size, 0 );
+			}
+			entries[i].bytesSent = (result < 0) ? 0 : (std::size_t)result;
+			entries[i].error = (result < 0) ? errno : 0;
+			if( result >= 0 )
+				++sentCount;
+		}
+		return sentCount;
+#endif
+	}
+
+	std::size_t SendEntries( UdpBatchEntry *entries, std::size_t count, bool useEntryEndpoints )
+	{
+#ifdef OSC_HAVE_UDP_GSO
+		if( sendSegmentation_ )
+			return SendSegmented( entries, count, useEntryEndpoints );
+#endif
+		return SendUnsegmented( entries, count, useEntryEndpoints );
+	}
+
+	std::size_t SendBatch( UdpBatchEntry *entries, std::size_t count )
+	{
+		assert( isConnected_ );
+
+		return SendEntries( entries, count, false );
+	}
+
+	std::size_t SendToBatch( UdpBatchEntry *entries, std::size_t count )
+	{
+		return SendEntries( entries, count, true );
+	}
+
+	void SetEnableSendSegmentation( bool enableSendSegmentation )
+	{
+#ifdef OSC_HAVE_UDP_GSO
+		// kernels without UDP_SEGMENT would ignore the control message and
+		// send each run as one large datagram, so check for support first.
+		int segmentSize = 0;
+		socklen_t length = sizeof(segmentSize);
+		sendSegmentation_ = enableSendSegmentation
+				&& getsockopt( socket_, SOL_UDP, UDP_SEGMENT, &segmentSize, &length ) == 0;
+#else
+		(void) enableSendSegmentation;
+#endif
+	}
+
+	bool SetZeroCopySendThreshold( std::size_t thresholdBytes, SendCompletionListener *listener )
+	{
+#ifdef OSC_HAVE_ZEROCOPY
+		if( thresholdBytes == 0 ){
+			zeroCopyThreshold_ = 0; // sends already pending still complete through the listener
+			return true;
+		}
+
+		assert( listener != 0 );
+
+		int zeroCopy = 1;
+		if( setsockopt( socket_, SOL_SOCKET, SO_ZEROCOPY, &zeroCopy, sizeof(zeroCopy) ) != 0 )
+			return false;
+
+		zeroCopyThreshold_ = thresholdBytes;
+		sendCompletionListener_ = listener;
+		return true;
+#else
+		(void) listener;
+		return thresholdBytes == 0;
+#endif
+	}
+
+	std::size_t ProcessSendCompletions()
+	{
+		std::size_t completedCount = 0;
+#ifdef OSC_HAVE_ZEROCOPY
+		while( pendingZeroCopyCount_ > 0 ){
+			union{
+				char buffer[ CMSG_SPACE( sizeof(struct sock_extended_err) + sizeof(struct sockaddr_in) ) ];
+				struct cmsghdr align;
+			} control;
+
+			struct msghdr msg;
+			std::memset( &msg, 0, sizeof(msg) );
+			msg.msg_control = control.buffer;
+			msg.msg_controllen = sizeof(control.buffer);
+
+			if( recvmsg( socket_, &msg, MSG_ERRQUEUE | MSG_DONTWAIT ) < 0 )
+				break;
+
+			for( struct cmsghdr *cmsg = CMSG_FIRSTHDR( &msg ); cmsg != 0; cmsg = CMSG_NXTHDR( &msg, cmsg ) ){
+				if( cmsg->cmsg_level != SOL_IP || cmsg->cmsg_type != IP_RECVERR )
+					continue;
+
+				struct sock_extended_err error;
+				std::memcpy( &error, CMSG_DATA( cmsg ), sizeof(error) );
+				if( error.ee_errno != 0 || error.ee_origin != SO_EE_ORIGIN_ZEROCOPY )
+					continue;
+
+				// each notification covers the range of sends [ee_info, ee_data]
+				completedCount += CompleteZeroCopySends( error.ee_info, error.ee_data,
+						(error.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0 );
+			}
+		}
+#endif
+		return completedCount;
+	}
+
+	std::size_t ZeroCopySendThreshold() const
+	{
+#ifdef OSC_HAVE_ZEROCOPY
+		return zeroCopyThreshold_;
+#else
+		return 0;
+#endif
+	}
+
+	std::size_t PendingZeroCopySendCount() const
+	{
+#ifdef OSC_HAVE_ZEROCOPY
+		return pendingZeroCopyCount_;
+#else
+		return 0;
+#endif
+	}
+
+	bool SendSegmentation() const
+	{
+#ifdef OSC_HAVE_UDP_GSO
+		return sendSegmentation_;
+#else
+		return false;
+#endif
+	}
+
+	void Bind( const IpEndpointName& localEndpoint )
+	{
+		struct sockaddr_in bindSockAddr;
+		SockaddrFromIpEndpointName( bindSockAddr, localEndpoint );
+
+        if (bind(socket_, (struct sockaddr *)&bindSockAddr, sizeof(bindSockAddr)) < 0) {
+            throw std::runtime_error("unable to bind udp socket\n");
+        }
+
+        socklen_t length = sizeof(boundAddr_);
+        if (getsockname(socket_, (struct sockaddr *)&boundAddr_, &length) < 0) {
+            throw std::runtime_error("unable to getsockname\n");
+        }
+
+		isBound_ = true;
+	}
+
+	bool IsBound() const { return isBound_; }
+
+    std::size_t ReceiveFrom( IpEndpointName& remoteEndpoint, char *data, std::size_t size, int flags=0 )
+	{
+		assert( isBound_ );
+
+		struct sockaddr_in fromAddr;
+        socklen_t fromAddrLen = sizeof(fromAddr);
+             	 
+        ssize_t result = recvfrom(socket_, data, size, flags,
+                    (struct sockaddr *) &fromAddr, (socklen_t*)&fromAddrLen);
+		if( result < 0 )
+			return 0;
+
+		remoteEndpoint.address = ntohl(fromAddr.sin_addr.s_addr);
+		remoteEndpoint.port = ntohs(fromAddr.sin_port);
+
+		return (std::size_t)result;
+	}
+
+	void SetReceiveBatchSize( std::size_t batchSize )
+	{
+		assert( batchSize > 0 );
+		receiveBatchSize_ = batchSize;
+		batchPacketCapacity_ = 0; // reallocate on the next ReceiveBatch()
+		batchCount_ = 0;
+	}
+
+	std::size_t ReceiveBatchSize() const { return receiveBatchSize_; }
+
+	void SetMaxReceivePacketSize( std::size_t maxPacketSize )
+	{
+		assert( maxPacketSize > 0 && maxPacketSize <= UdpSocket::MAX_UDP_PACKET_SIZE );
+		maxReceivePacketSize_ = maxPacketSize;
+	}
+
+	std::size_t MaxReceivePacketSize() const { return maxReceivePacketSize_; }
+
+	void SetEnableReceiveCoalescing( bool enableReceiveCoalescing )
+	{
+#ifdef OSC_HAVE_UDP_GRO
+		int gro = (enableReceiveCoalescing) ? 1 : 0;
+		if( setsockopt( socket_, SOL_UDP, UDP_GRO, &gro, sizeof(gro) ) == 0 ){
+			receiveCoalescing_ = enableReceiveCoalescing;
+			batchPacketCapacity_ = 0; // reallocate on the next ReceiveBatch()
+		}
+#else
+		(void) enableReceiveCoalescing;
+#endif
+	}
+
+
+	bool SetKernelBusyPoll( int microseconds )
+	{
+#ifdef SO_BUSY_POLL
+		return setsockopt( socket_, SOL_SOCKET, SO_BUSY_POLL, &microseconds, sizeof(microseconds) ) == 0;
+#else
+		(void) microseconds;
+		return false;
+#endif
+	}
+
+
+	void DisableReceiveTimestamps()
+	{
+		int off = 0;
+#ifdef OSC_HAVE_TIMESTAMPING
+		setsockopt( socket_, SOL_SOCKET, SO_TIMESTAMPING, &off, sizeof(off) );
+#endif
+#ifdef SO_TIMESTAMPNS
+		setsockopt( socket_, SOL_SOCKET, SO_TIMESTAMPNS, &off, sizeof(off) );
+#endif
+#ifdef SO_TIMESTAMP
+		setsockopt( socket_, SOL_SOCKET, SO_TIMESTAMP, &off, sizeof(off) );
+#endif
+		(void) off;
+	}
+
+	bool SetReceiveTimestamps( UdpSocket::ReceiveTimestampMode mode )
+	{
+		// only one option is left enabled, otherwise the kernel sends a
+		// control message for each of them
+		DisableReceiveTimestamps();
+		receiveTimestamps_ = UdpSocket::NO_RECEIVE_TIMESTAMPS;
+		batchPacketCapacity_ = 0; // reallocate on the next ReceiveBatch()
+
+		int result = -1;
+		if( mode == UdpSocket::NO_RECEIVE_TIMESTAMPS ){
+			return true;
+		}else if( mode == UdpSocket::SOFTWARE_RECEIVE_TIMESTAMPS ){
+			int on = 1;
+#if defined(SO_TIMESTAMPNS)
+			result = setsockopt( socket_, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on) );
+#elif defined(SO_TIMESTAMP)
+			result = setsockopt( socket_, SOL_SOCKET, SO_TIMESTAMP, &on, sizeof(on) );
+#endif
+			(void) on;
+		}else if( mode == UdpSocket::HARDWARE_RECEIVE_TIMESTAMPS ){
+#ifdef OSC_HAVE_TIMESTAMPING
+			// software timestamps are requested too, they are reported
+			// when the card doesn't provide a hardware timestamp
+			int flags = SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE
+					| SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+			result = setsockopt( socket_, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags) );
+#endif
+		}
+
+		if( result != 0 )
+			return false;
+
+		receiveTimestamps_ = mode;
+		return true;
+	}
+
+	UdpSocket::ReceiveTimestampMode ReceiveTimestamps() const { return receiveTimestamps_; }
+
+	bool LearnsLocalAddresses() const { return learnLocalAddresses_; }
+
+	// records the local address a datagram from fromAddr arrived at
+	void LearnLocalAddress( const struct sockaddr_in& fromAddr, unsigned long localAddress )
+	{
+		if( localAddress != 0 && localAddressCacheTimeoutNs_ > 0 )
+			CacheLocalAddress( ntohl( fromAddr.sin_addr.s_addr ), localAddress, GetCurrentTimeNs() );
+	}
+
+	// the space needed for the control messages of each read
+	std::size_t ControlSize() const
+	{
+		return ((receiveCoalescing_) ? GRO_CONTROL_SIZE : 0)
+				+ ((receiveTimestamps_ != UdpSocket::NO_RECEIVE_TIMESTAMPS) ? TIMESTAMP_CONTROL_SIZE : 0)
+				+ ((learnLocalAddresses_) ? PKTINFO_CONTROL_SIZE : 0);
+	}
+
+	// the size of the reads SocketReceiveMultiplexer makes from this socket.
+	// a coalesced read can be as large as the largest datagram.
+	std::size_t ReceiveCapacity() const
+	{
+		return (receiveCoalescing_) ? (std::size_t)UdpSocket::MAX_UDP_PACKET_SIZE : maxReceivePacketSize_;
+	}
+
+	// read one datagram, or several coalesced by UDP_GRO, without blocking.
+	// segmentSize is set to the size of the coalesced datagrams, or 0 for a
+	// single datagram. timestamp is set if receive timestamps are enabled.
+	std::size_t ReceiveSegments( IpEndpointName& remoteEndpoint, char *data, std::size_t size,
+			std::size_t& segmentSize, PacketTimestamp& timestamp )
+	{
+		segmentSize = 0;
+		if( ControlSize() == 0 )
+			return ReceiveFrom( remoteEndpoint, data, size, MSG_DONTWAIT );
+
+		struct sockaddr_in fromAddr;
+		ssize_t result = ReceiveMessage( fromAddr, data, size, segmentSize, timestamp );
+		if( result < 0 )
+			return 0;
+
+		remoteEndpoint.address = ntohl(fromAddr.sin_addr.s_addr);
+		remoteEndpoint.port = ntohs(fromAddr.sin_port);
+
+		return (std::size_t)result;
+	}
+
+	// read up to ReceiveBatchSize() datagrams of at most packetCapacity bytes
+	// without blocking, into buffers from pool if it is given. returns the
+	// number of datagrams read, which can be accessed with the Batch*()
+	// methods below until the next call.
+	std::size_t ReceiveBatch( std::size_t packetCapacity, PacketBufferPool *pool=0 )
+	{
+		assert( isBound_ );
+		assert( !pool || packetCapacity <= pool->BufferSize() );
+
+		if( batchPacketCapacity_ != packetCapacity || batchPool_ != pool )
+			AllocateBatchBuffers( packetCapacity, pool );
+
+		batchCount_ = 0;
+
+		// slots whose buffers are still referenced by a listener get new ones
+		for( std::size_t i = 0; i < batchPackets_.size(); ++i ){
+			if( !batchPackets_[i].IsUnique() ){
+				batchPackets_[i] = PacketRef( pool->Acquire() );
+#ifdef OSC_HAVE_RECVMMSG
+				batchIovecs_[i].iov_base = batchPackets_[i].Buffer()->Data();
+#endif
+			}
+		}
+
+#ifdef OSC_HAVE_RECVMMSG
+		for( std::size_t i = 0; i < receiveBatchSize_; ++i ){
+			batchHeaders_[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+			if( batchControlSize_ > 0 ){
+				batchHeaders_[i].msg_hdr.msg_control = &batchControl_[ i * batchControlSize_ ];
+				batchHeaders_[i].msg_hdr.msg_controllen = batchControlSize_;
+			}
+		}
+
+		int result = recvmmsg( socket_, &batchHeaders_[0], (unsigned int)receiveBatchSize_, MSG_DONTWAIT, 0 );
+		if( result > 0 ){
+			for( int i = 0; i < result; ++i ){
+				batchSizes_[i] = batchHeaders_[i].msg_len;
+				if( batchControlSize_ > 0 ){
+					unsigned long localAddress;
+					ReadReceiveControl( &batchHeaders_[i].msg_hdr, batchSegmentSizes_[i], batchTimestamps_[i], localAddress );
+					if( learnLocalAddresses_ )
+						LearnLocalAddress( batchAddrs_[i], localAddress );
+				}
+			}
+			batchCount_ = (std::size_t)result;
+		}
+#else
+		while( batchCount_ < receiveBatchSize_ ){
+			char *data = (pool) ? batchPackets_[ batchCount_ ].Buffer()->Data() : &batchData_[ batchCount_ * packetCapacity ];
+			ssize_t result = ReceiveMessage( batchAddrs_[ batchCount_ ], data,
+					packetCapacity, batchSegmentSizes_[ batchCount_ ], batchTimestamps_[ batchCount_ ] );
+			if( result < 0 )
+				break;
+
+			batchSizes_[ batchCount_++ ] = (std::size_t)result;
+		}
+#endif
+
+		if( pool ){
+			for( std::size_t i = 0; i < batchCount_; ++i ){
+				PacketBuffer *buffer = batchPackets_[i].Buffer();
+				buffer->remoteEndpoint = BatchRemoteEndpoint( i );
+				buffer->timestamp = batchTimestamps_[i];
+				buffer->timestamped = (receiveTimestamps_ != UdpSocket::NO_RECEIVE_TIMESTAMPS);
+			}
+		}
+
+		return batchCount_;
+	}
+
+	// a reference to datagram i when receiving into a PacketBufferPool
+	PacketRef BatchPacket( std::size_t i ) const
+	{
+		assert( i < batchCount_ && batchPool_ );
+		PacketBuffer *buffer = batchPackets_[i].Buffer();
+		return PacketRef( buffer, buffer->Data(), batchSizes_[i] );
+	}
+
+	const char *BatchPacketData( std::size_t i ) const
+	{
+		assert( i < batchCount_ );
+		return (batchPool_) ? batchPackets_[i].Buffer()->Data() : &batchData_[ i * batchPacketCapacity_ ];
+	}
+
+	std::size_t BatchPacketSize( std::size_t i ) const
+	{
+		assert( i < batchCount_ );
+		return batchSizes_[i];
+	}
+
+	// 0 unless the datagram is several coalesced by UDP_GRO
+	std::size_t BatchSegmentSize( std::size_t i ) const
+	{
+		assert( i < batchCount_ );
+		return batchSegmentSizes_[i];
+	}
+
+	const PacketTimestamp& BatchTimestamp( std::size_t i ) const
+	{
+		assert( i < batchCount_ );
+		return batchTimestamps_[i];
+	}
+
+	IpEndpointName BatchRemoteEndpoint( std::size_t i ) const
+	{
+		assert( i < batchCount_ );
+		return IpEndpointName( ntohl(batchAddrs_[i].sin_addr.s_addr), ntohs(batchAddrs_[i].sin_port) );
+	}
+
+#ifdef OSC_HAVE_IO_URING
+	void SetSendQueue( IoUringSendQueue *sendQueue ) { sendQueue_ = sendQueue; }
+#endif
+
+	int Socket() { return socket_; }
+};
+
+UdpSocket::UdpSocket()
+{
+	impl_ = new Implementation();
+}
+
+UdpSocket::~UdpSocket()
+{
+	delete impl_;
+}
+
+void UdpSocket::SetEnableBroadcast( bool enableBroadcast )
+{
+    impl_->SetEnableBroadcast( enableBroadcast );
+}
+
+void UdpSocket::SetAllowReuse( bool allowReuse )
+{
+    impl_->SetAllowReuse( allowReuse );
+}
+
+void UdpSocket::SetAllowReusePort( bool allowReusePort )
+{
+    impl_->SetAllowReusePort( allowReusePort );
+}
+
+IpEndpointName UdpSocket::LocalEndpointFor( const IpEndpointName& remoteEndpoint ) const
+{
+	return impl_->LocalEndpointFor( remoteEndpoint );
+}
+
+void UdpSocket::SetLocalEndpointCacheTimeout( long timeoutMilliseconds )
+{
+	impl_->SetLocalEndpointCacheTimeout( timeoutMilliseconds );
+}
+
+bool UdpSocket::SetEnableLocalEndpointLearning( bool enableLearning )
+{
+	return impl_->SetEnableLocalEndpointLearning( enableLearning );
+}
+
+void UdpSocket::Connect( const IpEndpointName& remoteEndpoint )
+{
+	impl_->Connect( remoteEndpoint );
+}
+
+void UdpSocket::Send( const char *data, std::size_t size )
+{
+	impl_->Send( data, size );
+}
+
+void UdpSocket::SendTo( const IpEndpointName& remoteEndpoint, const char *data, std::size_t size )
+{
+	impl_->SendTo( remoteEndpoint, data, size );
+}
+
+std::size_t UdpSocket::SendBatch( UdpBatchEntry *entries, std::size_t count )
+{
+	return impl_->SendBatch( entries, count );
+}
+
+std::size_t UdpSocket::SendToBatch( UdpBatchEntry *entries, std::size_t count )
+{
+	return impl_->SendToBatch( entries, count );
+}
+
+void UdpSocket::SetEnableSendSegmentation( bool enableSendSegmentation )
+{
+	impl_->SetEnableSendSegmentation( enableSendSegmentation );
+}
+
+bool UdpSocket::SendSegmentation() const
+{
+	return impl_->SendSegmentation();
+}
+
+bool UdpSocket::SetZeroCopySendThreshold( std::size_t thresholdBytes, SendCompletionListener *listener )
+{
+	return impl_->SetZeroCopySendThreshold( thresholdBytes, listener );
+}
+
+std::size_t UdpSocket::ProcessSendCompletions()
+{
+	return impl_->ProcessSendCompletions();
+}
+
+std::size_t UdpSocket::PendingZeroCopySendCount() const
+{
+	return impl_->PendingZeroCopySendCount();
+}
+
+void UdpSocket::Bind( const IpEndpointName& localEndpoint )
+{
+	impl_->Bind( localEndpoint );
+}
+
+bool UdpSocket::IsBound() const
+{
+	return impl_->IsBound();
+}
+
+std::size_t UdpSocket::ReceiveFrom( IpEndpointName& remoteEndpoint, char *data, std::size_t size )
+{
+	return impl_->ReceiveFrom( remoteEndpoint, data, size );
+}
+
+void UdpSocket::SetReceiveBatchSize( std::size_t batchSize )
+{
+	impl_->SetReceiveBatchSize( batchSize );
+}
+
+std::size_t UdpSocket::ReceiveBatchSize() const
+{
+	return impl_->ReceiveBatchSize();
+}
+
+void UdpSocket::SetMaxReceivePacketSize( std::size_t maxPacketSize )
+{
+	impl_->SetMaxReceivePacketSize( maxPacketSize );
+}
+
+std::size_t UdpSocket::MaxReceivePacketSize() const
+{
+	return impl_->MaxReceivePacketSize();
+}
+
+void UdpSocket::SetEnableReceiveCoalescing( bool enableReceiveCoalescing )
+{
+	impl_->SetEnableReceiveCoalescing( enableReceiveCoalescing );
+}
+
+bool UdpSocket::SetReceiveTimestamps( ReceiveTimestampMode mode )
+{
+	return impl_->SetReceiveTimestamps( mode );
+}
+
+UdpSocket::ReceiveTimestampMode UdpSocket::ReceiveTimestamps() const
+{
+	return impl_->ReceiveTimestamps();
+}
+
+bool UdpSocket::SetKernelBusyPoll( int microseconds )
+{
+	return impl_->SetKernelBusyPoll( microseconds );
+}
+
+
+struct AttachedTimerListener{
+	AttachedTimerListener( long long id, long long p, TimerListener *tl )
+		: initialDelayNs( id )
+		, periodNs( p )
+		, listener( tl ) {}
+	long long initialDelayNs;
+	long long periodNs;
+	TimerListener *listener;
+};
+
+
+
+// the periodic timers of a running multiplexer, kept in a binary heap
+// ordered by expiry time so that rescheduling a timer costs O(log n)
+// rather than a sort of the whole queue.
+class TimerQueue{
+	struct ScheduledTimer{
+		ScheduledTimer( long long e, const AttachedTimerListener& t )
+			: expiryNs( e ), timer( t ) {}
+		long long expiryNs;
+		AttachedTimerListener timer;
+	};
+
+	static bool ExpiresLater( const ScheduledTimer& lhs, const ScheduledTimer& rhs )
+	{
+		return lhs.expiryNs > rhs.expiryNs;
+	}
+
+	std::vector<ScheduledTimer> heap_;
+	std::vector<ScheduledTimer> expired_; // reused by ExecuteExpired()
+
+public:
+	void Schedule( long long expiryNs, const AttachedTimerListener& timer )
+	{
+		heap_.push_back( ScheduledTimer( expiryNs, timer ) );
+		std::push_heap( heap_.begin(), heap_.end(), ExpiresLater );
+	}
+
+	bool Empty() const { return heap_.empty(); }
+
+	// removes one of the timers calling listener. returns false if there is none
+	bool Remove( TimerListener *listener )
+	{
+		for( std::vector<ScheduledTimer>::iterator i = heap_.begin(); i != heap_.end(); ++i ){
+			if( i->timer.listener == listener ){
+				*i = heap_.back();
+				heap_.pop_back();
+				std::make_heap( heap_.begin(), heap_.end(), ExpiresLater );
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	long long NextExpiryNs() const
+	{
+		assert( !heap_.empty() );
+		return heap_.front().expiryNs;
+	}
+
+	// calls each timer which is due at currentTimeNs once, then reschedules
+	// it one period after its previous expiry, so that periods don't drift.
+	// the remaining timers aren't called once break_ is set.
+	void ExecuteExpired( long long currentTimeNs, volatile bool& break_ )
+	{
+		while( !heap_.empty() && heap_.front().expiryNs <= currentTimeNs ){
+			std::pop_heap( heap_.begin(), heap_.end(), ExpiresLater );
+			expired_.push_back( heap_.back() );
+			heap_.pop_back();
+		}
+
+		for( std::vector<ScheduledTimer>::iterator i = expired_.begin(); i != expired_.end(); ++i ){
+			if( !break_ ){
+				i->timer.listener->TimerExpired();
+				i->expiryNs += i->timer.periodNs;
+			}
+			Schedule( i->expiryNs, i->timer );
+		}
+		expired_.clear();
+	}
+};
+
+
+// an attach or detach requested while Run() is active. the calling thread
+// queues it and wakes Run() through the break pipe. the thread running Run()
+// applies it between wakeups, so dispatch itself needs no locking.
+struct MultiplexerCommand{
+	enum Type{
+		ATTACH_SOCKET_LISTENER,
+		DETACH_SOCKET_LISTENER,
+		ATTACH_TIMER_LISTENER,
+		DETACH_TIMER_LISTENER
+	};
+
+	MultiplexerCommand( Type t, UdpSocket *s, PacketListener *pl )
+		: type( t ), socket( s ), packetListener( pl ), timer( 0, 0, 0 ) {}
+	MultiplexerCommand( Type t, const AttachedTimerListener& tl )
+		: type( t ), socket( 0 ), packetListener( 0 ), timer( tl ) {}
+
+	Type type;
+	UdpSocket *socket;
+	PacketListener *packetListener;
+	AttachedTimerListener timer; // only timer.listener is used by DETACH_TIMER_LISTENER
+};
+
+
+class ScopedMutexLock{
+	pthread_mutex_t& mutex_;
+public:
+	explicit ScopedMutexLock( pthread_mutex_t& mutex )
+		: mutex_( mutex ) { pthread_mutex_lock( &mutex_ ); }
+	~ScopedMutexLock() { pthread_mutex_unlock( &mutex_ ); }
+};
+
+
+#ifdef OSC_HAVE_EPOLL
+// each socket is registered with epoll using the index of its entry in
+// socketListeners_. the break pipe and the timerfd use these tokens instead.
+static const unsigned long long EPOLL_BREAK_PIPE_TOKEN = ~0ULL;
+static const unsigned long long EPOLL_TIMER_FD_TOKEN = ~0ULL - 1;
+
+static void EpollControl( int epollFd, int operation, int fd, unsigned long long token )
+{
+	struct epoll_event event;
+	std::memset( &event, 0, sizeof(event) );
+	event.events = EPOLLIN;
+	event.data.u64 = token;
+	if( epoll_ctl( epollFd, operation, fd, &event ) < 0 )
+		throw std::runtime_error("epoll_ctl failed\n");
+}
+#endif /* OSC_HAVE_EPOLL */
+
+
+SocketReceiveMultiplexer *multiplexerInstanceToAbortWithSigInt_ = 0;
+
+extern "C" /*static*/ void InterruptSignalHandler( int );
+/*static*/ void InterruptSignalHandler( int )
+{
+	multiplexerInstanceToAbortWithSigInt_->AsynchronousBreak();
+	signal( SIGINT, SIG_DFL );
+}
+
+
+class SocketReceiveMultiplexer::Implementation{
+	std::vector< std::pair< PacketListener*, UdpSocket* > > socketListeners_;
+	std::vector< AttachedTimerListener > timerListeners_;
+
+	Backend backend_;
+
+	volatile bool break_;
+	int breakPipe_[2]; // [0] is the reader descriptor and [1] the writer
+
+	// when available the select() and epoll loops also wait on a timerfd
+	// which expires with the earliest timer, so timers aren't limited to
+	// the resolution of the wait timeout (milliseconds for epoll_wait()).
+	int timerFd_;
+	long long timerFdExpiryNs_; // the expiry time timerFd_ is armed with, 0 if disarmed, -1 if unknown
+
+	long long busyPollNs_; // see SetBusyPollPeriod(), 0 if disabled
+
+	// see SetPacketBufferPool(). single reads go into receivePacket_'s
+	// buffer, which is kept for the next read unless a listener holds on to it
+	PacketBufferPool *packetBufferPool_;
+	PacketRef receivePacket_;
+
+	// the packets passed to a listener's ProcessPackets(), reused for every
+	// batch. when receiving into a pool batchPacketRefs_[i] is batch_[i].packet
+	std::vector<BatchedPacket> batch_;
+	std::vector<PacketRef> batchPacketRefs_;
+
+	// see PollDescriptor(). pollEpollFd_ is -1 until it is first called,
+	// after which attach/detach calls also update it and pollTimerQueue_.
+	// the rest is reused by each ProcessReady() call.
+	int pollEpollFd_;
+	TimerQueue pollTimerQueue_;
+	std::vector<char> pollData_;
+	std::vector<std::size_t> pollReadySockets_;
+
+	// set when a command is queued so that BusyPoll() notices it without
+	// reading the break pipe
+	volatile bool commandsQueued_;
+
+	// attach/detach calls made while Run() is active are queued here.
+	// commandMutex_ guards everything below, running_ is set for the
+	// duration of Run(). the counts let a calling thread wait until the
+	// loop has applied its command.
+	pthread_mutex_t commandMutex_;
+	pthread_cond_t commandsApplied_;
+	std::vector<MultiplexerCommand> queuedCommands_;
+	unsigned long queuedCommandCount_;
+	unsigned long appliedCommandCount_;
+	bool running_;
+	pthread_t runThread_;
+
+#ifdef OSC_HAVE_EPOLL
+	// applies an epoll_ctl() operation for the socket attached at index to
+	// epollFd (-1 if there is none) and to the PollDescriptor() descriptor.
+	// removals don't fail, the socket may already have been closed.
+	void UpdateEpollRegistrations( int epollFd, int operation, int socket, std::size_t index )
+	{
+		int epollFds[2] = { epollFd, (pollEpollFd_ != epollFd) ? pollEpollFd_ : -1 };
+		for( int i = 0; i < 2; ++i ){
+			if( epollFds[i] == -1 )
+				continue;
+
+			if( operation == EPOLL_CTL_DEL )
+				epoll_ctl( epollFds[i], EPOLL_CTL_DEL, socket, 0 );
+			else
+				EpollControl( epollFds[i], operation, socket, index );
+		}
+	}
+#endif /* OSC_HAVE_EPOLL */
+
+	// applies a command to the attached listeners. while Run() is active
+	// timerQueue is the running timer queue, and epollFd the epoll
+	// descriptor (or -1 if epoll isn't in use). the PollDescriptor() state
+	// is updated too once it exists. returns true if the set of attached
+	// sockets changed.
+	bool ApplyCommand( const MultiplexerCommand& command, TimerQueue *timerQueue, int epollFd )
+	{
+#ifndef OSC_HAVE_EPOLL
+		(void) epollFd;
+#endif
+		TimerQueue *pollTimerQueue = ( pollEpollFd_ != -1 && timerQueue != &pollTimerQueue_ ) ? &pollTimerQueue_ : 0;
+
+		switch( command.type ){
+			case MultiplexerCommand::ATTACH_SOCKET_LISTENER:
+				assert( std::find( socketListeners_.begin(), socketListeners_.end(),
+						std::make_pair(command.packetListener, command.socket) ) == socketListeners_.end() );
+				// we don't check that the same socket has been added multiple times, even though this is an error
+				socketListeners_.push_back( std::make_pair( command.packetListener, command.socket ) );
+#ifdef OSC_HAVE_EPOLL
+				UpdateEpollRegistrations( epollFd, EPOLL_CTL_ADD, command.socket->impl_->Socket(), socketListeners_.size() - 1 );
+#endif
+				return true;
+
+			case MultiplexerCommand::DETACH_SOCKET_LISTENER:
+			{
+				std::vector< std::pair< PacketListener*, UdpSocket* > >::iterator i =
+						std::find( socketListeners_.begin(), socketListeners_.end(),
+						std::make_pair(command.packetListener, command.socket) );
+				assert( i != socketListeners_.end() );
+
+#ifdef OSC_HAVE_EPOLL
+				UpdateEpollRegistrations( epollFd, EPOLL_CTL_DEL, i->second->impl_->Socket(), 0 );
+#endif
+				// the last entry is moved into the gap, so that only its index changes
+				std::size_t index = i - socketListeners_.begin();
+				*i = socketListeners_.back();
+				socketListeners_.pop_back();
+#ifdef OSC_HAVE_EPOLL
+				if( index < socketListeners_.size() )
+					UpdateEpollRegistrations( epollFd, EPOLL_CTL_MOD, socketListeners_[ index ].second->impl_->Socket(), index );
+#else
+				(void) index;
+#endif
+				return true;
+			}
+
+			case MultiplexerCommand::ATTACH_TIMER_LISTENER:
+				timerListeners_.push_back( command.timer );
+				if( timerQueue )
+					timerQueue->Schedule( GetCurrentTimeNs() + command.timer.initialDelayNs, command.timer );
+				if( pollTimerQueue )
+					pollTimerQueue->Schedule( GetCurrentTimeNs() + command.timer.initialDelayNs, command.timer );
+				return false;
+
+			case MultiplexerCommand::DETACH_TIMER_LISTENER:
+			{
+				std::vector< AttachedTimerListener >::iterator i = timerListeners_.begin();
+				while( i != timerListeners_.end() ){
+					if( i->listener == command.timer.listener )
+						break;
+					++i;
+				}
+
+				assert( i != timerListeners_.end() );
+
+				timerListeners_.erase( i );
+				if( timerQueue )
+					timerQueue->Remove( command.timer.listener );
+				if( pollTimerQueue )
+					pollTimerQueue->Remove( command.timer.listener );
+				return false;
+			}
+		}
+
+		return false;
+	}
+
+	// applies a command right away if Run() isn't active. otherwise queues
+	// it and wakes the loop. a thread other than the one running Run()
+	// waits until the loop has applied it.
+	void ExecuteCommand( const MultiplexerCommand& command )
+	{
+		ScopedMutexLock lock( commandMutex_ );
+
+		if( !running_ ){
+			ApplyCommand( command, 0, -1 );
+			// the PollDescriptor() descriptor becomes readable when a new timer is due
+			if( pollEpollFd_ != -1 )
+				ArmTimerFd( pollTimerQueue_ );
+			return;
+		}
+
+		// one byte wakes the loop for all the commands queued before it runs
+		if( queuedCommands_.empty() ){
+			commandsQueued_ = true;
+			write( breakPipe_[1], "*", 1 );
+		}
+
+		queuedCommands_.push_back( command );
+		unsigned long ticket = ++queuedCommandCount_;
+
+		if( !pthread_equal( pthread_self(), runThread_ ) ){
+			while( running_ && appliedCommandCount_ < ticket )
+				pthread_cond_wait( &commandsApplied_, &commandMutex_ );
+		}
+	}
+
+	// called by the Run() thread after a wakeup through the break pipe.
+	// returns true if the set of attached sockets changed.
+	bool ApplyQueuedCommands( TimerQueue& timerQueue, int epollFd )
+	{
+		std::vector<MultiplexerCommand> commands;
+		{
+			ScopedMutexLock lock( commandMutex_ );
+			commands.swap( queuedCommands_ );
+			commandsQueued_ = false;
+		}
+
+		if( commands.empty() )
+			return false;
+
+		bool socketsChanged = false;
+		std::size_t i = 0;
+		try{
+			for( ; i < commands.size(); ++i ){
+				if( ApplyCommand( commands[i], &timerQueue, epollFd ) )
+					socketsChanged = true;
+			}
+		}catch(...){
+			// the loop is about to exit. keep the lists consistent
+			for( ++i; i < commands.size(); ++i )
+				ApplyCommand( commands[i], 0, -1 );
+			MarkCommandsApplied( commands.size() );
+			throw;
+		}
+
+		MarkCommandsApplied( commands.size() );
+		return socketsChanged;
+	}
+
+	bool SocketCommandsQueued()
+	{
+		ScopedMutexLock lock( commandMutex_ );
+		for( std::size_t i = 0; i < queuedCommands_.size(); ++i ){
+			if( queuedCommands_[i].type == MultiplexerCommand::ATTACH_SOCKET_LISTENER
+					|| queuedCommands_[i].type == MultiplexerCommand::DETACH_SOCKET_LISTENER )
+				return true;
+		}
+
+		return false;
+	}
+
+	void MarkCommandsApplied( std::size_t count )
+	{
+		ScopedMutexLock lock( commandMutex_ );
+		appliedCommandCount_ += count;
+		pthread_cond_broadcast( &commandsApplied_ );
+	}
+
+	void BeginRunning()
+	{
+		ScopedMutexLock lock( commandMutex_ );
+		running_ = true;
+		runThread_ = pthread_self();
+	}
+
+	// applies any commands the loop didn't get to and releases the threads
+	// waiting for them
+	void EndRunning()
+	{
+		ScopedMutexLock lock( commandMutex_ );
+		for( std::size_t i = 0; i < queuedCommands_.size(); ++i )
+			ApplyCommand( queuedCommands_[i], 0, -1 );
+		appliedCommandCount_ += queuedCommands_.size();
+		queuedCommands_.clear();
+		commandsQueued_ = false;
+		running_ = false;
+		pthread_cond_broadcast( &commandsApplied_ );
+	}
+
+	void InitializeTimerQueue( TimerQueue& timerQueue )
+	{
+		long long currentTimeNs = GetCurrentTimeNs();
+
+		for( std::vector< AttachedTimerListener >::iterator i = timerListeners_.begin();
+				i != timerListeners_.end(); ++i )
+			timerQueue.Schedule( currentTimeNs + i->initialDelayNs, *i );
+	}
+
+	// returns the time until the next timer expires, or -1 if there are no timers
+	double TimeoutMs( const TimerQueue& timerQueue ) const
+	{
+		if( timerQueue.Empty() )
+			return -1.;
+
+		double timeoutMs = (double)(timerQueue.NextExpiryNs() - GetCurrentTimeNs()) * .000001;
+		if( timeoutMs < 0 )
+			timeoutMs = 0;
+
+		return timeoutMs;
+	}
+
+	void ExecuteExpiredTimers( TimerQueue& timerQueue )
+	{
+		if( !timerQueue.Empty() )
+			timerQueue.ExecuteExpired( GetCurrentTimeNs(), break_ );
+	}
+
+	// arm timerFd_ to expire when the earliest timer is due. returns false
+	// if there is no timerfd, in which case the wait needs a timeout.
+	bool ArmTimerFd( const TimerQueue& timerQueue )
+	{
+#ifdef OSC_HAVE_TIMERFD
+		if( timerFd_ == -1 )
+			return false;
+
+		long long expiryNs = (timerQueue.Empty()) ? 0 : timerQueue.NextExpiryNs();
+		if( expiryNs <= 0 && !timerQueue.Empty() )
+			expiryNs = 1; // an all zero it_value would disarm the timer
+
+		if( expiryNs != timerFdExpiryNs_ ){
+			struct itimerspec spec;
+			std::memset( &spec, 0, sizeof(spec) );
+			spec.it_value.tv_sec = (time_t)(expiryNs / 1000000000LL);
+			spec.it_value.tv_nsec = (long)(expiryNs % 1000000000LL);
+			if( timerfd_settime( timerFd_, TFD_TIMER_ABSTIME, &spec, 0 ) != 0 )
+				throw std::runtime_error("timerfd_settime failed\n");
+
+			timerFdExpiryNs_ = expiryNs;
+		}
+
+		return true;
+#else
+		(void) timerQueue;
+		return false;
+#endif
+	}
+
+	void ClearTimerFd()
+	{
+		// read the expiration count so that the descriptor isn't ready until
+		// it expires again
+		unsigned long long expirations;
+		read( timerFd_, &expirations, sizeof(expirations) );
+	}
+
+	// the size of the buffer needed to read from any of the attached sockets
+	std::size_t ReceiveBufferSize() const
+	{
+		std::size_t result = 0;
+		for( std::vector< std::pair< PacketListener*, UdpSocket* > >::const_iterator i = socketListeners_.begin();
+				i != socketListeners_.end(); ++i ){
+			if( result < i->second->impl_->ReceiveCapacity() )
+				result = i->second->impl_->ReceiveCapacity();
+		}
+
+		return result;
+	}
+
+	// add one read to batch_. if the kernel coalesced several datagrams
+	// into it (UDP_GRO) they are split up again: each is segmentSize bytes
+	// except the last, which may be shorter. timestamp is 0 unless the
+	// socket has receive timestamps enabled. packet refers to the read if
+	// it is held in a pool buffer, and is null otherwise.
+	void AppendSegments( const char *data, std::size_t size, std::size_t segmentSize,
+			const IpEndpointName& remoteEndpoint, const PacketTimestamp *timestamp, const PacketRef& packet )
+	{
+		if( segmentSize == 0 || segmentSize >= size ){
+			AppendPacket( data, size, remoteEndpoint, timestamp, packet );
+			return;
+		}
+
+		for( std::size_t offset = 0; offset < size; offset += segmentSize ){
+			std::size_t remaining = size - offset;
+			std::size_t length = (remaining < segmentSize) ? remaining : segmentSize;
+			AppendPacket( data + offset, length, remoteEndpoint, timestamp,
+					(packet.IsNull()) ? packet : packet.Slice( offset, length ) );
+		}
+	}
+
+	void AppendPacket( const char *data, std::size_t size,
+			const IpEndpointName& remoteEndpoint, const PacketTimestamp *timestamp, const PacketRef& packet )
+	{
+		batch_.push_back( BatchedPacket() );
+		BatchedPacket& batchedPacket = batch_.back();
+		batchedPacket.data = data;
+		batchedPacket.size = (int)size;
+		batchedPacket.remoteEndpoint = remoteEndpoint;
+		if( timestamp ){
+			batchedPacket.timestamp = *timestamp;
+			batchedPacket.timestamped = true;
+		}
+		if( !packet.IsNull() )
+			batchPacketRefs_.push_back( packet );
+	}
+
+	// also releases the batch's references to pool buffers
+	void ClearBatch()
+	{
+		batch_.clear();
+		batchPacketRefs_.clear();
+	}
+
+	// pass the packets in batch_ to a listener. packets remaining in the
+	// batch are discarded if a listener calls Break()
+	void DispatchBatch( PacketListener *listener )
+	{
+		if( !batch_.empty() ){
+			// linked only now that the vector of refs won't grow again
+			assert( batchPacketRefs_.empty() || batchPacketRefs_.size() == batch_.size() );
+			for( std::size_t i = 0; i < batchPacketRefs_.size(); ++i )
+				batch_[i].packet = &batchPacketRefs_[i];
+
+			listener->ProcessPackets( PacketBatch( &batch_[0], batch_.size(), &break_ ) );
+			ClearBatch();
+		}
+	}
+
+	// read the pending datagram(s) from a readable socket and pass them to its
+	// listener. returns the number of reads, 0 if nothing was pending.
+	std::size_t ReceiveAndDispatch( std::pair< PacketListener*, UdpSocket* >& socketListener,
+			char *data, std::size_t dataSize, IpEndpointName& remoteEndpoint )
+	{
+		UdpSocket::Implementation *socket = socketListener.second->impl_;
+		assert( socket->ReceiveCapacity() <= dataSize );
+		(void) dataSize; // only used by the assert
+
+		// zero-copy send completions also make the socket ready (POLLERR).
+		// the reads below don't block in case there is nothing else.
+		if( socket->PendingZeroCopySendCount() > 0 )
+			socket->ProcessSendCompletions();
+
+		bool timestamped = (socket->ReceiveTimestamps() != UdpSocket::NO_RECEIVE_TIMESTAMPS);
+
+		// larger datagrams are truncated when receiving into the pool
+		std::size_t capacity = socket->ReceiveCapacity();
+		if( packetBufferPool_ && capacity > packetBufferPool_->BufferSize() )
+			capacity = packetBufferPool_->BufferSize();
+
+		std::size_t count = 0;
+		ClearBatch();
+
+		if( socket->ReceiveBatchSize() > 1 ){
+			count = socket->ReceiveBatch( capacity, packetBufferPool_ );
+			for( std::size_t i = 0; i < count; ++i ){
+				AppendSegments( socket->BatchPacketData( i ), socket->BatchPacketSize( i ),
+						socket->BatchSegmentSize( i ), socket->BatchRemoteEndpoint( i ),
+						(timestamped) ? &socket->BatchTimestamp( i ) : 0,
+						(packetBufferPool_) ? socket->BatchPacket( i ) : PacketRef() );
+			}
+		}else if( packetBufferPool_ ){
+			if( !receivePacket_.IsUnique() )
+				receivePacket_ = PacketRef( packetBufferPool_->Acquire() );
+
+			PacketBuffer *buffer = receivePacket_.Buffer();
+			std::size_t segmentSize = 0;
+			std::size_t size = socket->ReceiveSegments( buffer->remoteEndpoint, buffer->Data(), capacity,
+					segmentSize, buffer->timestamp );
+			if( size > 0 ){
+				buffer->timestamped = timestamped;
+				AppendSegments( buffer->Data(), size, segmentSize, buffer->remoteEndpoint,
+						(timestamped) ? &buffer->timestamp : 0, PacketRef( buffer, buffer->Data(), size ) );
+				count = 1;
+			}
+		}else{
+			std::size_t segmentSize = 0;
+			PacketTimestamp timestamp;
+			std::size_t size = socket->ReceiveSegments( remoteEndpoint, data, capacity, segmentSize, timestamp );
+			if( size > 0 ){
+				AppendSegments( data, size, segmentSize, remoteEndpoint, (timestamped) ? &timestamp : 0, PacketRef() );
+				count = 1;
+			}
+		}
+
+		DispatchBatch( socketListener.first );
+		return count;
+	}
+
+	// low latency mode: keeps reading from the attached sockets without
+	// waiting until nothing has arrived for busyPollNs_, running timers as
+	// they fall due. returns early on Break() or when commands are queued,
+	// which the blocking wait that follows picks up.
+	void BusyPoll( std::vector<char>& data, TimerQueue& timerQueue )
+	{
+		IpEndpointName remoteEndpoint;
+		long long lastReceiveNs = GetCurrentTimeNs();
+
+		while( !break_ && !commandsQueued_ ){
+			bool received = false;
+			for( std::vector< std::pair< PacketListener*, UdpSocket* > >::iterator i = socketListeners_.begin();
+					i != socketListeners_.end(); ++i ){
+				if( ReceiveAndDispatch( *i, &data[0], data.size(), remoteEndpoint ) > 0 )
+					received = true;
+				if( break_ )
+					return;
+			}
+
+			long long currentTimeNs = GetCurrentTimeNs();
+			if( !timerQueue.Empty() && timerQueue.NextExpiryNs() <= currentTimeNs )
+				timerQueue.ExecuteExpired( currentTimeNs, break_ );
+
+			if( received )
+				lastReceiveNs = currentTimeNs;
+			else if( currentTimeNs - lastReceiveNs >= busyPollNs_ )
+				break;
+		}
 	}
 
-	~Implementation()
+	void ClearBreakPipe()
 	{
-		if (socket_ != -1) close(socket_);
+		// clear pending data from the asynchronous break pipe
+		char c;
+		read( breakPipe_[0], &c, 1 );
 	}
 
-	void SetEnableBroadcast( bool enableBroadcast )
+	// configure the master fd_set for select(). returns the highest descriptor
+	int BuildSelectFdSet( fd_set& masterfds )
 	{
-		int broadcast = (enableBroadcast) ? 1 : 0; // int on posix
-		setsockopt(socket_, SOL_SOCKET, SO_BROADCAST, &broadcast, sizeof(broadcast));
+		FD_ZERO( &masterfds );
+
+		// in addition to listening to the inbound sockets we
+		// also listen to the asynchronous break pipe, so that AsynchronousBreak()
+		// can break us out of select() from another thread.
+		FD_SET( breakPipe_[0], &masterfds );
+		int fdmax = breakPipe_[0];		
+
+		if( timerFd_ != -1 ){
+			if( timerFd_ >= FD_SETSIZE )
+				throw std::runtime_error("timer descriptor exceeds FD_SETSIZE\n");
+
+			FD_SET( timerFd_, &masterfds );
+			if( fdmax < timerFd_ )
+				fdmax = timerFd_;
+		}
+
+		for( std::vector< std::pair< PacketListener*, UdpSocket* > >::iterator i = socketListeners_.begin();
+				i != socketListeners_.end(); ++i ){
+
+			if( i->second->impl_->Socket() >= FD_SETSIZE )
+				throw std::runtime_error("socket descriptor exceeds FD_SETSIZE\n");
+
+			if( fdmax < i->second->impl_->Socket() )
+				fdmax = i->second->impl_->Socket();
+			FD_SET( i->second->impl_->Socket(), &masterfds );
+		}
+
+		return fdmax;
 	}
 
-	void SetAllowReuse( bool allowReuse )
+	// grows the receive buffer when a socket with a larger capacity is attached while running
+	void ResizeReceiveBuffer( std::vector<char>& data ) const
 	{
-		int reuseAddr = (allowReuse) ? 1 : 0; // int on posix
-		setsockopt(socket_, SOL_SOCKET, SO_REUSEADDR, &reuseAddr, sizeof(reuseAddr));
-
-#ifdef __APPLE__
-		// needed also for OS X - enable multiple listeners for a single port on same network interface
-		int reusePort = (allowReuse) ? 1 : 0; // int on posix
-		setsockopt(socket_, SOL_SOCKET, SO_REUSEPORT, &reusePort, sizeof(reusePort));
-#endif
+		if( data.size() < ReceiveBufferSize() )
+			data.resize( ReceiveBufferSize() );
 	}
 
-	IpEndpointName LocalEndpointFor( const IpEndpointName& remoteEndpoint ) const
+	void RunSelect( std::vector<char>& data, TimerQueue& timerQueue )
 	{
-		assert( isBound_ );
+		fd_set masterfds, tempfds;
+		FD_ZERO( &tempfds );
+		int fdmax = BuildSelectFdSet( masterfds );
 
-		// first connect the socket to the remote server
-        
-        struct sockaddr_in connectSockAddr;
-		SockaddrFromIpEndpointName( connectSockAddr, remoteEndpoint );
-       
-        if (connect(socket_, (struct sockaddr *)&connectSockAddr, sizeof(connectSockAddr)) < 0) {
-            throw std::runtime_error("unable to connect udp socket\n");
-        }
+		IpEndpointName remoteEndpoint;
 
-        // get the address
+		struct timeval timeout;
 
-        struct sockaddr_in sockAddr;
-        std::memset( (char *)&sockAddr, 0, sizeof(sockAddr ) );
-        socklen_t length = sizeof(sockAddr);
-        if (getsockname(socket_, (struct sockaddr *)&sockAddr, &length) < 0) {
-            throw std::runtime_error("unable to getsockname\n");
-        }
-        
-		if( isConnected_ ){
-			// reconnect to the connected address
-			
-			if (connect(socket_, (struct sockaddr *)&connectedAddr_, sizeof(connectedAddr_)) < 0) {
-				throw std::runtime_error("unable to connect udp socket\n");
+		while( !break_ ){
+			if( busyPollNs_ > 0 ){
+				BusyPoll( data, timerQueue );
+				if( break_ )
+					break;
 			}
 
-		}else{
-			// unconnect from the remote address
-		
-			struct sockaddr_in unconnectSockAddr;
-			std::memset( (char *)&unconnectSockAddr, 0, sizeof(unconnectSockAddr ) );
-			unconnectSockAddr.sin_family = AF_UNSPEC;
-			// address fields are zero
-			int connectResult = connect(socket_, (struct sockaddr *)&unconnectSockAddr, sizeof(unconnectSockAddr));
-			if ( connectResult < 0 && errno != EAFNOSUPPORT ) {
-				throw std::runtime_error("unable to un-connect udp socket\n");
+			tempfds = masterfds;
+
+			struct timeval *timeoutPtr = 0;
+			double timeoutMs = ( ArmTimerFd( timerQueue ) ) ? -1. : TimeoutMs( timerQueue );
+			if( timeoutMs >= 0 ){
+				long timoutSecondsPart = (long)(timeoutMs * .001);
+				timeout.tv_sec = (time_t)timoutSecondsPart;
+				// 1000000 microseconds in a second
+				timeout.tv_usec = (suseconds_t)((timeoutMs - (timoutSecondsPart * 1000)) * 1000);
+				timeoutPtr = &timeout;
 			}
-		}
 
-		return IpEndpointNameFromSockaddr( sockAddr );
-	}
+			if( select( fdmax + 1, &tempfds, 0, 0, timeoutPtr ) < 0 ){
+				if( break_ ){
+					break;
+				}else if( errno == EINTR ){
+					// on returning an error, select() doesn't clear tempfds.
+					// so tempfds would remain all set, which would cause read( breakPipe_[0]...
+					// below to block indefinitely. therefore if select returns EINTR we restart
+					// the while() loop instead of continuing on to below.
+					continue;
+				}else{
+					throw std::runtime_error("select failed\n");
+				}
+			}
 
-	void Connect( const IpEndpointName& remoteEndpoint )
-	{
-		SockaddrFromIpEndpointName( connectedAddr_, remoteEndpoint );
-       
-        if (connect(socket_, (struct sockaddr *)&connectedAddr_, sizeof(connectedAddr_)) < 0) {
-            throw std::runtime_error("unable to connect udp socket\n");
-        }
+			bool wokenUp = FD_ISSET( breakPipe_[0], &tempfds );
+			if( wokenUp )
+				ClearBreakPipe();
 
-		isConnected_ = true;
+			if( timerFd_ != -1 && FD_ISSET( timerFd_, &tempfds ) )
+				ClearTimerFd();
+			
+			if( break_ )
+				break;
+
+			for( std::vector< std::pair< PacketListener*, UdpSocket* > >::iterator i = socketListeners_.begin();
+					i != socketListeners_.end(); ++i ){
+
+				if( FD_ISSET( i->second->impl_->Socket(), &tempfds ) ){
+
+					ReceiveAndDispatch( *i, &data[0], data.size(), remoteEndpoint );
+					if( break_ )
+						break;
+				}
+			}
+
+			// execute any expired timers
+			ExecuteExpiredTimers( timerQueue );
+
+			// apply attach/detach calls made since the last wakeup
+			if( wokenUp && ApplyQueuedCommands( timerQueue, -1 ) ){
+				fdmax = BuildSelectFdSet( masterfds );
+				ResizeReceiveBuffer( data );
+			}
+		}
 	}
 
-	void Send( const char *data, std::size_t size )
+#ifdef OSC_HAVE_EPOLL
+	// returns false if epoll is not available, in which case the caller
+	// should fall back to select()
+	bool RunEpoll( std::vector<char>& data, TimerQueue& timerQueue )
 	{
-		assert( isConnected_ );
+		int epollFd = epoll_create1( EPOLL_CLOEXEC );
+		if( epollFd == -1 )
+			return false;
+
+		try{
+			EpollControl( epollFd, EPOLL_CTL_ADD, breakPipe_[0], EPOLL_BREAK_PIPE_TOKEN );
+
+			if( timerFd_ != -1 )
+				EpollControl( epollFd, EPOLL_CTL_ADD, timerFd_, EPOLL_TIMER_FD_TOKEN );
+
+			for( std::size_t i = 0; i < socketListeners_.size(); ++i )
+				EpollControl( epollFd, EPOLL_CTL_ADD, socketListeners_[i].second->impl_->Socket(), i );
+
+			const int MAX_EVENTS = 64;
+			struct epoll_event events[ MAX_EVENTS ];
+			IpEndpointName remoteEndpoint;
+
+			while( !break_ ){
+				if( busyPollNs_ > 0 ){
+					BusyPoll( data, timerQueue );
+					if( break_ )
+						break;
+				}
+
+				// epoll_wait() only has millisecond resolution. without a timerfd
+				// round up so that we don't wake up early and spin until the next
+				// timer is due.
+				double timeoutMs = ( ArmTimerFd( timerQueue ) ) ? -1. : TimeoutMs( timerQueue );
+				int timeout = (timeoutMs >= 0) ? (int)ceil( timeoutMs ) : -1;
+
+				// only the ready descriptors are returned, so the cost of a
+				// wakeup doesn't depend on the number of attached sockets.
+				int readyCount = epoll_wait( epollFd, events, MAX_EVENTS, timeout );
+				if( readyCount < 0 ){
+					if( break_ ){
+						break;
+					}else if( errno == EINTR ){
+						continue;
+					}else{
+						throw std::runtime_error("epoll_wait failed\n");
+					}
+				}
+
+				bool wokenUp = false;
+				for( int i = 0; i < readyCount; ++i ){
+					if( events[i].data.u64 == EPOLL_BREAK_PIPE_TOKEN ){
+						ClearBreakPipe();
+						wokenUp = true;
+					}else if( events[i].data.u64 == EPOLL_TIMER_FD_TOKEN ){
+						ClearTimerFd();
+					}
+				}
+
+				if( break_ )
+					break;
+
+				for( int i = 0; i < readyCount; ++i ){
+					if( events[i].data.u64 == EPOLL_BREAK_PIPE_TOKEN || events[i].data.u64 == EPOLL_TIMER_FD_TOKEN )
+						continue;
+
+					ReceiveAndDispatch( socketListeners_[ (std::size_t)events[i].data.u64 ],
+							&data[0], data.size(), remoteEndpoint );
+					if( break_ )
+						break;
+				}
+
+				// execute any expired timers
+				ExecuteExpiredTimers( timerQueue );
+
+				// apply attach/detach calls made since the last wakeup. the
+				// registrations are updated in place, so events[] must not be
+				// used after this.
+				if( wokenUp && ApplyQueuedCommands( timerQueue, epollFd ) )
+					ResizeReceiveBuffer( data );
+			}
 
-        send( socket_, data, size, 0 );
+			close( epollFd );
+		}catch(...){
+			close( epollFd );
+			throw;
+		}
+
+		return true;
 	}
 
-    void SendTo( const IpEndpointName& remoteEndpoint, const char *data, std::size_t size )
+	// creates the PollDescriptor() descriptor: an epoll instance watching
+	// the break pipe, the timer descriptor and the attached sockets
+	int CreatePollEpoll()
 	{
-		sendToAddr_.sin_addr.s_addr = htonl( remoteEndpoint.address );
-        sendToAddr_.sin_port = htons( remoteEndpoint.port );
+		if( timerFd_ == -1 )
+			throw std::runtime_error("PollDescriptor() requires timerfd support\n");
+
+		int epollFd = epoll_create1( EPOLL_CLOEXEC );
+		if( epollFd == -1 )
+			throw std::runtime_error("epoll_create1 failed\n");
+
+		try{
+			EpollControl( epollFd, EPOLL_CTL_ADD, breakPipe_[0], EPOLL_BREAK_PIPE_TOKEN );
+			EpollControl( epollFd, EPOLL_CTL_ADD, timerFd_, EPOLL_TIMER_FD_TOKEN );
+
+			for( std::size_t i = 0; i < socketListeners_.size(); ++i )
+				EpollControl( epollFd, EPOLL_CTL_ADD, socketListeners_[i].second->impl_->Socket(), i );
+
+			TimerQueue timerQueue;
+			InitializeTimerQueue( timerQueue );
+			timerFdExpiryNs_ = -1;
+			ArmTimerFd( timerQueue );
+			pollTimerQueue_ = timerQueue;
+		}catch(...){
+			close( epollFd );
+			throw;
+		}
 
-        sendto( socket_, data, size, 0, (sockaddr*)&sendToAddr_, sizeof(sendToAddr_) );
+		return epollFd;
 	}
 
-	void Bind( const IpEndpointName& localEndpoint )
+	// one non-blocking pass over the PollDescriptor() descriptor, see
+	// ProcessReady(). returns the number of reads dispatched.
+	std::size_t ProcessReadyEvents( std::size_t maxPackets )
 	{
-		struct sockaddr_in bindSockAddr;
-		SockaddrFromIpEndpointName( bindSockAddr, localEndpoint );
+		const int MAX_EVENTS = 64;
+		struct epoll_event events[ MAX_EVENTS ];
+
+		int readyCount = epoll_wait( pollEpollFd_, events, MAX_EVENTS, 0 );
+		if( readyCount < 0 ){
+			if( errno == EINTR )
+				return 0;
+			throw std::runtime_error("epoll_wait failed\n");
+		}
 
-        if (bind(socket_, (struct sockaddr *)&bindSockAddr, sizeof(bindSockAddr)) < 0) {
-            throw std::runtime_error("unable to bind udp socket\n");
-        }
+		bool wokenUp = false;
+		pollReadySockets_.clear();
+		for( int i = 0; i < readyCount; ++i ){
+			if( events[i].data.u64 == EPOLL_BREAK_PIPE_TOKEN ){
+				ClearBreakPipe();
+				wokenUp = true;
+			}else if( events[i].data.u64 == EPOLL_TIMER_FD_TOKEN ){
+				ClearTimerFd();
+			}else{
+				pollReadySockets_.push_back( (std::size_t)events[i].data.u64 );
+			}
+		}
 
-		isBound_ = true;
-	}
+		if( pollData_.size() < std::max( ReceiveBufferSize(), (std::size_t)1 ) )
+			pollData_.resize( std::max( ReceiveBufferSize(), (std::size_t)1 ) );
+
+		// the ready sockets take turns, so that a busy one doesn't hold up
+		// the others, until they are drained or maxPackets have been read.
+		// sockets left readable keep the descriptor readable.
+		IpEndpointName remoteEndpoint;
+		std::size_t count = 0;
+		while( !pollReadySockets_.empty() && count < maxPackets && !break_ ){
+			std::size_t i = 0;
+			while( i < pollReadySockets_.size() && count < maxPackets && !break_ ){
+				std::size_t readCount = ReceiveAndDispatch( socketListeners_[ pollReadySockets_[i] ],
+						&pollData_[0], pollData_.size(), remoteEndpoint );
+				if( readCount == 0 ){
+					pollReadySockets_[i] = pollReadySockets_.back();
+					pollReadySockets_.pop_back();
+				}else{
+					count += readCount;
+					++i;
+				}
+			}
+		}
 
-	bool IsBound() const { return isBound_; }
+		ExecuteExpiredTimers( pollTimerQueue_ );
 
-    std::size_t ReceiveFrom( IpEndpointName& remoteEndpoint, char *data, std::size_t size )
-	{
-		assert( isBound_ );
+		// apply attach/detach calls queued by other threads since the last call
+		if( wokenUp )
+			ApplyQueuedCommands( pollTimerQueue_, pollEpollFd_ );
 
-		struct sockaddr_in fromAddr;
-        socklen_t fromAddrLen = sizeof(fromAddr);
-             	 
-        ssize_t result = recvfrom(socket_, data, size, 0,
-                    (struct sockaddr *) &fromAddr, (socklen_t*)&fromAddrLen);
-		if( result < 0 )
-			return 0;
+		return count;
+	}
+#endif /* OSC_HAVE_EPOLL */
 
-		remoteEndpoint.address = ntohl(fromAddr.sin_addr.s_addr);
-		remoteEndpoint.port = ntohs(fromAddr.sin_port);
+#ifdef OSC_HAVE_IO_URING
+	void ArmIoUringReceive( IoUring& ring, unsigned short bufferGroup, std::size_t index, struct msghdr *header )
+	{
+		struct io_uring_sqe *sqe = ring.GetSqe();
+		if( !sqe )
+			throw std::runtime_error("io_uring submission queue full\n");
+
+		// one multishot recvmsg keeps producing a completion per datagram,
+		// each written to a buffer picked from the provided buffer ring.
+		sqe->opcode = IORING_OP_RECVMSG;
+		sqe->fd = socketListeners_[ index ].second->impl_->Socket();
+		sqe->addr = (unsigned long)header;
+		sqe->len = 1;
+		sqe->ioprio = IORING_RECV_MULTISHOT;
+		sqe->flags = IOSQE_BUFFER_SELECT;
+		sqe->buf_group = bufferGroup;
+		sqe->user_data = IoUringUserData( IO_URING_RECEIVE, index );
+	}
 
-		return (std::size_t)result;
+	// zero-copy send completions are queued on the socket's error queue,
+	// which multishot recvmsg doesn't read. a multishot poll reports them.
+	void ArmIoUringErrorPoll( IoUring& ring, std::size_t index )
+	{
+		struct io_uring_sqe *sqe = ring.GetSqe();
+		if( !sqe )
+			throw std::runtime_error("io_uring submission queue full\n");
+
+		sqe->opcode = IORING_OP_POLL_ADD;
+		sqe->fd = socketListeners_[ index ].second->impl_->Socket();
+		sqe->poll32_events = POLLERR;
+		sqe->len = IORING_POLL_ADD_MULTI;
+		sqe->user_data = IoUringUserData( IO_URING_ERROR_POLL, index );
 	}
 
-	int Socket() { return socket_; }
-};
+	void ArmIoUringBreakRead( IoUring& ring, char *breakByte )
+	{
+		struct io_uring_sqe *sqe = ring.GetSqe();
+		if( !sqe )
+			throw std::runtime_error("io_uring submission queue full\n");
+
+		sqe->opcode = IORING_OP_READ;
+		sqe->fd = breakPipe_[0];
+		sqe->addr = (unsigned long)breakByte;
+		sqe->len = 1;
+		sqe->off = (__u64)-1; // pipes have no file position
+		sqe->user_data = IoUringUserData( IO_URING_BREAK, 0 );
+	}
 
-UdpSocket::UdpSocket()
-{
-	impl_ = new Implementation();
-}
+	// the timeout expires at expiryNs on the monotonic clock, which is the
+	// clock of GetCurrentTimeNs()
+	void ArmIoUringTimeout( IoUring& ring, struct __kernel_timespec *timeout, long long expiryNs )
+	{
+		struct io_uring_sqe *sqe = ring.GetSqe();
+		if( !sqe )
+			throw std::runtime_error("io_uring submission queue full\n");
+
+		timeout->tv_sec = expiryNs / 1000000000LL;
+		timeout->tv_nsec = expiryNs % 1000000000LL;
+
+		sqe->opcode = IORING_OP_TIMEOUT;
+		sqe->addr = (unsigned long)timeout;
+		sqe->len = 1;
+		sqe->timeout_flags = IORING_TIMEOUT_ABS;
+		sqe->user_data = IoUringUserData( IO_URING_TIMEOUT, 0 );
+	}
 
-UdpSocket::~UdpSocket()
-{
-	delete impl_;
-}
+	// a datagram received by multishot recvmsg, waiting to be dispatched
+	struct IoUringReceive{
+		IoUringReceive( std::size_t index_, unsigned short bufferId_, std::size_t length_ )
+			: index( index_ ), bufferId( bufferId_ ), length( length_ ) {}
+
+		std::size_t index; // of the socket in socketListeners_
+		unsigned short bufferId;
+		std::size_t length;
+	};
+
+	// adds a datagram received by multishot recvmsg to batch_. the buffer
+	// holds an io_uring_recvmsg_out header, the source address, controlSize
+	// bytes of control messages and the payload. pooledBuffer is the
+	// PacketBuffer holding it when receiving into packetBufferPool_.
+	void AppendIoUringPacket( std::pair< PacketListener*, UdpSocket* >& socketListener,
+			char *buffer, std::size_t length, std::size_t controlSize, PacketBuffer *pooledBuffer )
+	{
+		const std::size_t headerSize = sizeof(struct io_uring_recvmsg_out) + sizeof(struct sockaddr_in) + controlSize;
+		if( length < headerSize )
+			return;
 
-void UdpSocket::SetEnableBroadcast( bool enableBroadcast )
-{
-    impl_->SetEnableBroadcast( enableBroadcast );
-}
+		struct io_uring_recvmsg_out out;
+		std::memcpy( &out, buffer, sizeof(out) );
+		struct sockaddr_in fromAddr;
+		std::memcpy( &fromAddr, buffer + sizeof(out), sizeof(fromAddr) );
+
+		// payloadlen is the size of the datagram, which is larger than the
+		// space in the buffer if the datagram was truncated
+		std::size_t size = out.payloadlen;
+		if( size > length - headerSize )
+			size = length - headerSize;
+		if( size > socketListener.second->impl_->ReceiveCapacity() )
+			size = socketListener.second->impl_->ReceiveCapacity();
+
+		std::size_t segmentSize = 0;
+		PacketTimestamp timestamp;
+		if( controlSize > 0 ){
+			struct msghdr msg;
+			std::memset( &msg, 0, sizeof(msg) );
+			msg.msg_control = buffer + sizeof(out) + sizeof(fromAddr);
+			msg.msg_controllen = out.controllen;
+			unsigned long localAddress;
+			ReadReceiveControl( &msg, segmentSize, timestamp, localAddress );
+			if( socketListener.second->impl_->LearnsLocalAddresses() )
+				socketListener.second->impl_->LearnLocalAddress( fromAddr, localAddress );
+		}
 
-void UdpSocket::SetAllowReuse( bool allowReuse )
-{
-    impl_->SetAllowReuse( allowReuse );
-}
+		if( size == 0 )
+			return;
+
+		bool timestamped = (socketListener.second->impl_->ReceiveTimestamps() != UdpSocket::NO_RECEIVE_TIMESTAMPS);
+		IpEndpointName remoteEndpoint( ntohl(fromAddr.sin_addr.s_addr), ntohs(fromAddr.sin_port) );
+		if( pooledBuffer ){
+			pooledBuffer->remoteEndpoint = remoteEndpoint;
+			pooledBuffer->timestamp = timestamp;
+			pooledBuffer->timestamped = timestamped;
+			AppendSegments( buffer + headerSize, size, segmentSize, remoteEndpoint, (timestamped) ? &timestamp : 0,
+					PacketRef( pooledBuffer, buffer + headerSize, size ) );
+		}else{
+			AppendSegments( buffer + headerSize, size, segmentSize, remoteEndpoint, (timestamped) ? &timestamp : 0,
+					PacketRef() );
+		}
+	}
 
-IpEndpointName UdpSocket::LocalEndpointFor( const IpEndpointName& remoteEndpoint ) const
-{
-	return impl_->LocalEndpointFor( remoteEndpoint );
-}
+	// pass the datagrams received in one pass over the completion queue to
+	// their sockets' listeners, as one batch per socket. the receives are
+	// marked as dispatched by setting their index to NO_SOCKET.
+	void DispatchIoUringReceives( std::vector<IoUringReceive>& receives, IoUringBufferRing& buffers,
+			const std::vector<struct msghdr>& receiveHeaders, std::vector<PacketRef> *ringPackets )
+	{
+		const std::size_t NO_SOCKET = (std::size_t)-1;
+
+		for( std::size_t i = 0; i < receives.size() && !break_; ++i ){
+			std::size_t index = receives[i].index;
+			if( index == NO_SOCKET )
+				continue;
+
+			ClearBatch();
+			for( std::size_t j = i; j < receives.size(); ++j ){
+				if( receives[j].index != index )
+					continue;
+
+				unsigned short bufferId = receives[j].bufferId;
+				AppendIoUringPacket( socketListeners_[ index ], buffers.Buffer( bufferId ), receives[j].length,
+						receiveHeaders[ index ].msg_controllen, (ringPackets) ? (*ringPackets)[ bufferId ].Buffer() : 0 );
+				receives[j].index = NO_SOCKET;
+			}
 
-void UdpSocket::Connect( const IpEndpointName& remoteEndpoint )
-{
-	impl_->Connect( remoteEndpoint );
-}
+			DispatchBatch( socketListeners_[ index ].first );
+		}
+	}
 
-void UdpSocket::Send( const char *data, std::size_t size )
-{
-	impl_->Send( data, size );
-}
+	// cancel every request still held by the kernel and wait for them to
+	// finish, so that the buffers they refer to can be released. when
+	// buffers is given, datagrams which were already received are
+	// dispatched rather than dropped, unless Break() has been called.
+	// ringPackets holds the pool buffers when receiving into packetBufferPool_.
+	void CancelIoUringRequests( IoUring& ring, IoUringSendQueue& sendQueue, std::size_t& outstanding,
+			IoUringBufferRing *buffers=0, const std::vector<struct msghdr> *receiveHeaders=0,
+			std::vector<PacketRef> *ringPackets=0 )
+	{
+		struct io_uring_sqe *sqe = ring.GetSqe();
+		if( !sqe )
+			return; // the ring is unusable. closing it cancels everything
+
+		sqe->opcode = IORING_OP_ASYNC_CANCEL;
+		sqe->fd = -1;
+		sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+		sqe->user_data = IoUringUserData( IO_URING_CANCEL, 0 );
+		++outstanding;
+
+		std::vector<IoUringReceive> receives;
+
+		while( outstanding > 0 || sendQueue.InFlightCount() > 0 ){
+			int result = ring.Submit( 1 );
+			if( result < 0 && result != -EINTR && result != -EBUSY )
+				return;
+
+			while( struct io_uring_cqe *cqe = ring.PeekCqe() ){
+				__u64 userData = cqe->user_data;
+				int res = cqe->res;
+				unsigned flags = cqe->flags;
+				ring.SeenCqe();
+
+				switch( IoUringRequestTypeOf( userData ) ){
+					case IO_URING_RECEIVE:
+						if( buffers && res > 0 && (flags & IORING_CQE_F_BUFFER) ){
+							receives.push_back( IoUringReceive( IoUringRequestIndexOf( userData ),
+									(unsigned short)(flags >> IORING_CQE_BUFFER_SHIFT), (std::size_t)res ) );
+						}
+						if( !(flags & IORING_CQE_F_MORE) )
+							--outstanding;
+						break;
+					case IO_URING_ERROR_POLL:
+						if( !(flags & IORING_CQE_F_MORE) )
+							--outstanding;
+						break;
+					case IO_URING_SEND:
+						sendQueue.Release( IoUringRequestIndexOf( userData ) );
+						break;
+					default:
+						--outstanding;
+						break;
+				}
+			}
+		}
 
-void UdpSocket::SendTo( const IpEndpointName& remoteEndpoint, const char *data, std::size_t size )
-{
-	impl_->SendTo( remoteEndpoint, data, size );
-}
+		// the buffers stay valid until the buffer ring is destroyed
+		if( buffers )
+			DispatchIoUringReceives( receives, *buffers, *receiveHeaders, ringPackets );
+	}
 
-void UdpSocket::Bind( const IpEndpointName& localEndpoint )
-{
-	impl_->Bind( localEndpoint );
-}
+	void ArmIoUringTimeoutRemove( IoUring& ring )
+	{
+		struct io_uring_sqe *sqe = ring.GetSqe();
+		if( !sqe )
+			throw std::runtime_error("io_uring submission queue full\n");
 
-bool UdpSocket::IsBound() const
-{
-	return impl_->IsBound();
-}
+		sqe->opcode = IORING_OP_TIMEOUT_REMOVE;
+		sqe->addr = IoUringUserData( IO_URING_TIMEOUT, 0 );
+		sqe->user_data = IoUringUserData( IO_URING_CANCEL, 0 );
+	}
 
-std::size_t UdpSocket::ReceiveFrom( IpEndpointName& remoteEndpoint, char *data, std::size_t size )
-{
-	return impl_->ReceiveFrom( remoteEndpoint, data, size );
-}
+	// returns false if io_uring is not available, in which case the caller
+	// should fall back to epoll or select(). the ring is set up for the
+	// sockets attached when it starts, so it returns with socketsChanged set
+	// if sockets are attached or detached while it runs, to be restarted.
+	bool RunIoUring( std::size_t dataSize, TimerQueue& timerQueue, bool& socketsChanged )
+	{
+		socketsChanged = false;
+
+		const unsigned RING_ENTRIES = 256;
+		const unsigned MAX_RECEIVE_BUFFER_COUNT = 256; // must be a power of 2
+		const std::size_t MAX_RECEIVE_BUFFER_MEMORY = 4 * 1024 * 1024;
+		const std::size_t SEND_SLOT_COUNT = 64;
+
+		// the pool buffers given to the kernel when receiving into
+		// packetBufferPool_, indexed by buffer id. declared before the ring so
+		// that they are released after it is closed.
+		std::vector<PacketRef> ringPackets;
+
+		IoUring ring;
+		if( !ring.Open( RING_ENTRIES ) )
+			return false;
+
+		// recvmsg only uses msg_namelen and msg_controllen from these, to lay
+		// out the buffers. sockets with UDP_GRO or receive timestamps enabled
+		// need control space.
+		std::size_t controlSize = 0;
+		std::vector<struct msghdr> receiveHeaders( socketListeners_.size() );
+		for( std::size_t i = 0; i < receiveHeaders.size(); ++i ){
+			std::memset( &receiveHeaders[i], 0, sizeof(struct msghdr) );
+			receiveHeaders[i].msg_namelen = sizeof(struct sockaddr_in);
+			receiveHeaders[i].msg_controllen = socketListeners_[i].second->impl_->ControlSize();
+			if( controlSize < receiveHeaders[i].msg_controllen )
+				controlSize = receiveHeaders[i].msg_controllen;
+		}
 
+		const std::size_t headerSize = sizeof(struct io_uring_recvmsg_out) + sizeof(struct sockaddr_in) + controlSize;
+		std::size_t bufferSize;
+		unsigned bufferCount = MAX_RECEIVE_BUFFER_COUNT;
+		std::vector<char*> ringBufferAddresses;
+
+		if( packetBufferPool_ ){
+			// the kernel receives straight into pool buffers. the payload lands
+			// at the start of each buffer's data and the headers in the headroom
+			// in front of it. at most half the pool is lent to the kernel.
+			assert( headerSize <= PacketBufferPool::HEADROOM );
+			bufferSize = headerSize + ((dataSize < packetBufferPool_->BufferSize()) ? dataSize : packetBufferPool_->BufferSize());
+			while( bufferCount > 16 && bufferCount > packetBufferPool_->BufferCount() / 2 )
+				bufferCount /= 2;
+
+			ringPackets.resize( bufferCount );
+			ringBufferAddresses.resize( bufferCount );
+			for( unsigned i = 0; i < bufferCount; ++i ){
+				ringPackets[i] = PacketRef( packetBufferPool_->Acquire() );
+				ringBufferAddresses[i] = ringPackets[i].Buffer()->Data() - headerSize;
+			}
+		}else{
+			// buffer size is rounded up to keep the recvmsg headers aligned. fewer
+			// buffers are used when they are large.
+			bufferSize = (headerSize + dataSize + 15) & ~(std::size_t)15;
+			while( bufferCount > 16 && bufferCount * bufferSize > MAX_RECEIVE_BUFFER_MEMORY )
+				bufferCount /= 2;
+		}
 
-struct AttachedTimerListener{
-	AttachedTimerListener( int id, int p, TimerListener *tl )
-		: initialDelayMs( id )
-		, periodMs( p )
-		, listener( tl ) {}
-	int initialDelayMs;
-	int periodMs;
-	TimerListener *listener;
-};
+		IoUringBufferRing buffers( ring, 0, bufferCount, bufferSize );
+		if( buffers.Register( (packetBufferPool_) ? &ringBufferAddresses[0] : 0 ) < 0 )
+			return false;
 
+		IoUringSendQueue sendQueue( ring, SEND_SLOT_COUNT );
 
-static bool CompareScheduledTimerCalls( 
-		const std::pair< double, AttachedTimerListener > & lhs, const std::pair< double, AttachedTimerListener > & rhs )
-{
-	return lhs.first < rhs.first;
-}
+		char breakByte;
+		bool wokenUp = false;
+		struct __kernel_timespec timeout;
+		bool timeoutArmed = false;
+		long long timeoutExpiryNs = 0;
 
+		std::vector<IoUringReceive> receives; // see DispatchIoUringReceives()
 
-SocketReceiveMultiplexer *multiplexerInstanceToAbortWithSigInt_ = 0;
+		std::size_t outstanding = 0; // requests which haven't produced their final completion
+		bool supported = true;
+		bool dispatchedAny = false;
 
-extern "C" /*static*/ void InterruptSignalHandler( int );
-/*static*/ void InterruptSignalHandler( int )
-{
-	multiplexerInstanceToAbortWithSigInt_->AsynchronousBreak();
-	signal( SIGINT, SIG_DFL );
-}
+		for( std::size_t i = 0; i < socketListeners_.size(); ++i )
+			socketListeners_[i].second->impl_->SetSendQueue( &sendQueue );
 
+		try{
+			for( std::size_t i = 0; i < socketListeners_.size(); ++i ){
+				ArmIoUringReceive( ring, buffers.GroupId(), i, &receiveHeaders[i] );
+				++outstanding;
 
-class SocketReceiveMultiplexer::Implementation{
-	std::vector< std::pair< PacketListener*, UdpSocket* > > socketListeners_;
-	std::vector< AttachedTimerListener > timerListeners_;
+				UdpSocket::Implementation *socket = socketListeners_[i].second->impl_;
+				if( socket->ZeroCopySendThreshold() > 0 || socket->PendingZeroCopySendCount() > 0 ){
+					ArmIoUringErrorPoll( ring, i );
+					++outstanding;
+				}
+			}
 
-	volatile bool break_;
-	int breakPipe_[2]; // [0] is the reader descriptor and [1] the writer
+			ArmIoUringBreakRead( ring, &breakByte );
+			++outstanding;
+
+			while( !break_ ){
+				// a single timeout request tracks the earliest timer
+				if( !timeoutArmed && !timerQueue.Empty() ){
+					timeoutExpiryNs = timerQueue.NextExpiryNs();
+					ArmIoUringTimeout( ring, &timeout, timeoutExpiryNs );
+					timeoutArmed = true;
+					++outstanding;
+				}
+
+				// submits re-armed requests and queued sends, then waits
+				int result = ring.Submit( 1 );
+				if( result < 0 && result != -EINTR && result != -EBUSY )
+					throw std::runtime_error("io_uring_enter failed\n");
+
+				while( !break_ ){
+					struct io_uring_cqe *cqe = ring.PeekCqe();
+					if( !cqe )
+						break;
+
+					__u64 userData = cqe->user_data;
+					int res = cqe->res;
+					unsigned flags = cqe->flags;
+					ring.SeenCqe();
+
+					std::size_t index = IoUringRequestIndexOf( userData );
+					switch( IoUringRequestTypeOf( userData ) ){
+						case IO_URING_RECEIVE:
+							if( flags & IORING_CQE_F_BUFFER ){
+								unsigned short bufferId = (unsigned short)(flags >> IORING_CQE_BUFFER_SHIFT);
+								if( res > 0 ){
+									// dispatched once the completion queue is empty
+									receives.push_back( IoUringReceive( index, bufferId, (std::size_t)res ) );
+									dispatchedAny = true;
+								}else{
+									buffers.Add( bufferId );
+								}
+							}else if( res == -EINVAL ){
+								// multishot recvmsg isn't supported by this kernel
+								if( dispatchedAny )
+									throw std::runtime_error("io_uring recvmsg failed\n");
+								supported = false;
+							}
+
+							// the request stops when it runs out of buffers (-ENOBUFS) or
+							// on a socket error. post a new one.
+							if( !(flags & IORING_CQE_F_MORE) ){
+								--outstanding;
+								if( supported ){
+									ArmIoUringReceive( ring, buffers.GroupId(), index, &receiveHeaders[ index ] );
+									++outstanding;
+								}
+							}
+							break;
+
+						case IO_URING_BREAK:
+							ArmIoUringBreakRead( ring, &breakByte );
+							wokenUp = true;
+							break;
+
+						case IO_URING_TIMEOUT:
+							timeoutArmed = false;
+							--outstanding;
+							break;
+
+						case IO_URING_SEND:
+							sendQueue.Release( index );
+							break;
+
+						case IO_URING_ERROR_POLL:
+							socketListeners_[ index ].second->impl_->ProcessSendCompletions();
+							if( !(flags & IORING_CQE_F_MORE) ){
+								--outstanding;
+								ArmIoUringErrorPoll( ring, index );
+								++outstanding;
+							}
+							break;
+
+						default:
+							--outstanding;
+							break;
+					}
+				}
+
+				// a batch per socket, then the buffers go back to the kernel
+				DispatchIoUringReceives( receives, buffers, receiveHeaders,
+						(packetBufferPool_) ? &ringPackets : 0 );
+				for( std::size_t i = 0; i < receives.size(); ++i ){
+					unsigned short bufferId = receives[i].bufferId;
+					if( packetBufferPool_ && !ringPackets[ bufferId ].IsUnique() ){
+						// a listener kept the packet, give the kernel another buffer
+						ringPackets[ bufferId ] = PacketRef( packetBufferPool_->Acquire() );
+						buffers.Replace( bufferId, ringPackets[ bufferId ].Buffer()->Data() - headerSize );
+					}else{
+						buffers.Add( bufferId );
+					}
+				}
+				receives.clear();
+
+				buffers.Publish();
+
+				if( !supported || break_ )
+					break;
+
+				// execute any expired timers
+				ExecuteExpiredTimers( timerQueue );
+
+				// apply attach/detach calls made since the last wakeup
+				if( wokenUp ){
+					wokenUp = false;
+					if( SocketCommandsQueued() ){
+						// the requests in flight refer to sockets by index, so
+						// Run() applies the commands once they are cancelled
+						socketsChanged = true;
+						break;
+					}
+
+					ApplyQueuedCommands( timerQueue, -1 );
+
+					// a newly attached timer may be due before the armed timeout.
+					// once it is removed the loop arms a new one.
+					if( timeoutArmed && !timerQueue.Empty() && timerQueue.NextExpiryNs() < timeoutExpiryNs ){
+						ArmIoUringTimeoutRemove( ring );
+						++outstanding;
+					}
+				}
+			}
 
-	double GetCurrentTimeMs() const
-	{
-		struct timeval t;
+			if( socketsChanged )
+				CancelIoUringRequests( ring, sendQueue, outstanding, &buffers, &receiveHeaders,
+						(packetBufferPool_) ? &ringPackets : 0 );
+			else
+				CancelIoUringRequests( ring, sendQueue, outstanding );
+		}catch(...){
+			CancelIoUringRequests( ring, sendQueue, outstanding );
+			for( std::size_t i = 0; i < socketListeners_.size(); ++i )
+				socketListeners_[i].second->impl_->SetSendQueue( 0 );
+			throw;
+		}
 
-		gettimeofday( &t, 0 );
+		for( std::size_t i = 0; i < socketListeners_.size(); ++i )
+			socketListeners_[i].second->impl_->SetSendQueue( 0 );
 
-		return ((double)t.tv_sec*1000.) + ((double)t.tv_usec / 1000.);
+		return supported;
 	}
+#endif /* OSC_HAVE_IO_URING */
 
 public:
-    Implementation()
+    Implementation( Backend backend )
+		: backend_( backend )
+		, break_( false )
+		, timerFd_( -1 )
+		, timerFdExpiryNs_( 0 )
+		, busyPollNs_( 0 )
+		, packetBufferPool_( 0 )
+		, pollEpollFd_( -1 )
+		, commandsQueued_( false )
+		, queuedCommandCount_( 0 )
+		, appliedCommandCount_( 0 )
+		, running_( false )
 	{
 		if( pipe(breakPipe_) != 0 )
 			throw std::runtime_error( "creation of asynchronous break pipes failed\n" );
+
+		pthread_mutex_init( &commandMutex_, 0 );
+		pthread_cond_init( &commandsApplied_, 0 );
+
+#ifdef OSC_HAVE_TIMERFD
+		// without a timerfd timers fall back to the wait timeout
+		timerFd_ = timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC );
+#endif
 	}
 
     ~Implementation()
 	{
 		close( breakPipe_[0] );
 		close( breakPipe_[1] );
+		if( timerFd_ != -1 )
+			close( timerFd_ );
+		if( pollEpollFd_ != -1 )
+			close( pollEpollFd_ );
+		pthread_cond_destroy( &commandsApplied_ );
+		pthread_mutex_destroy( &commandMutex_ );
 	}
 
     void AttachSocketListener( UdpSocket *socket, PacketListener *listener )
 	{
-		assert( std::find( socketListeners_.begin(), socketListeners_.end(), std::make_pair(listener, socket) ) == socketListeners_.end() );
-		// we don't check that the same socket has been added multiple times, even though this is an error
-		socketListeners_.push_back( std::make_pair( listener, socket ) );
+		ExecuteCommand( MultiplexerCommand( MultiplexerCommand::ATTACH_SOCKET_LISTENER, socket, listener ) );
 	}
 
     void DetachSocketListener( UdpSocket *socket, PacketListener *listener )
 	{
-		std::vector< std::pair< PacketListener*, UdpSocket* > >::iterator i = 
-				std::find( socketListeners_.begin(), socketListeners_.end(), std::make_pair(listener, socket) );
-		assert( i != socketListeners_.end() );
-
-		socketListeners_.erase( i );
-	}
-
-    void AttachPeriodicTimerListener( int periodMilliseconds, TimerListener *listener )
-	{
-		timerListeners_.push_back( AttachedTimerListener( periodMilliseconds, periodMilliseconds, listener ) );
+		ExecuteCommand( MultiplexerCommand( MultiplexerCommand::DETACH_SOCKET_LISTENER, socket, listener ) );
 	}
 
-	void AttachPeriodicTimerListener( int initialDelayMilliseconds, int periodMilliseconds, TimerListener *listener )
+	void AttachPeriodicTimerListenerNanoseconds( long long initialDelayNanoseconds, long long periodNanoseconds, TimerListener *listener )
 	{
-		timerListeners_.push_back( AttachedTimerListener( initialDelayMilliseconds, periodMilliseconds, listener ) );
+		assert( periodNanoseconds > 0 );
+		ExecuteCommand( MultiplexerCommand( MultiplexerCommand::ATTACH_TIMER_LISTENER,
+				AttachedTimerListener( initialDelayNanoseconds, periodNanoseconds, listener ) ) );
 	}
 
     void DetachPeriodicTimerListener( TimerListener *listener )
 	{
-		std::vector< AttachedTimerListener >::iterator i = timerListeners_.begin();
-		while( i != timerListeners_.end() ){
-			if( i->listener == listener )
-				break;
-			++i;
-		}
-
-		assert( i != timerListeners_.end() );
-
-		timerListeners_.erase( i );
+		ExecuteCommand( MultiplexerCommand( MultiplexerCommand::DETACH_TIMER_LISTENER,
+				AttachedTimerListener( 0, 0, listener ) ) );
 	}
 
     void Run()
 	{
-		break_ = false;
-        char *data = 0;
-        
-        try{
-            
-            // configure the master fd_set for select()
-
-            fd_set masterfds, tempfds;
-            FD_ZERO( &masterfds );
-            FD_ZERO( &tempfds );
-            
-            // in addition to listening to the inbound sockets we
-            // also listen to the asynchronous break pipe, so that AsynchronousBreak()
-            // can break us out of select() from another thread.
-            FD_SET( breakPipe_[0], &masterfds );
-            int fdmax = breakPipe_[0];		
-
-            for( std::vector< std::pair< PacketListener*, UdpSocket* > >::iterator i = socketListeners_.begin();
-                    i != socketListeners_.end(); ++i ){
-
-                if( fdmax < i->second->impl_->Socket() )
-                    fdmax = i->second->impl_->Socket();
-                FD_SET( i->second->impl_->Socket(), &masterfds );
-            }
-
+        // from here on attach/detach calls are queued for the loop
+        BeginRunning();
 
+        try{
             // configure the timer queue
-            double currentTimeMs = GetCurrentTimeMs();
-
-            // expiry time ms, listener
-            std::vector< std::pair< double, AttachedTimerListener > > timerQueue_;
-            for( std::vector< AttachedTimerListener >::iterator i = timerListeners_.begin();
-                    i != timerListeners_.end(); ++i )
-                timerQueue_.push_back( std::make_pair( currentTimeMs + i->initialDelayMs, *i ) );
-            std::sort( timerQueue_.begin(), timerQueue_.end(), CompareScheduledTimerCalls );
-
-            const int MAX_BUFFER_SIZE = 4098;
-            data = new char[ MAX_BUFFER_SIZE ];
-            IpEndpointName remoteEndpoint;
-
-            struct timeval timeout;
-
-            while( !break_ ){
-                tempfds = masterfds;
-
-                struct timeval *timeoutPtr = 0;
-                if( !timerQueue_.empty() ){
-                    double timeoutMs = timerQueue_.front().first - GetCurrentTimeMs();
-                    if( timeoutMs < 0 )
-                        timeoutMs = 0;
-                
-                    long timoutSecondsPart = (long)(timeoutMs * .001);
-                    timeout.tv_sec = (time_t)timoutSecondsPart;
-                    // 1000000 microseconds in a second
-                    timeout.tv_usec = (suseconds_t)((timeoutMs - (timoutSecondsPart * 1000)) * 1000);
-                    timeoutPtr = &timeout;
-                }
-
-                if( select( fdmax + 1, &tempfds, 0, 0, timeoutPtr ) < 0 ){
-                    if( break_ ){
-                        break;
-                    }else if( errno == EINTR ){
-                        // on returning an error, select() doesn't clear tempfds.
-                        // so tempfds would remain all set, which would cause read( breakPipe_[0]...
-                        // below to block indefinitely. therefore if select returns EINTR we restart
-                        // the while() loop instead of continuing on to below.
-                        continue;
-                    }else{
-                        throw std::runtime_error("select failed\n");
-                    }
-                }
-
-                if( FD_ISSET( breakPipe_[0], &tempfds ) ){
-                    // clear pending data from the asynchronous break pipe
-                    char c;
-                    read( breakPipe_[0], &c, 1 );
-                }
-                
-                if( break_ )
-                    break;
-
-                for( std::vector< std::pair< PacketListener*, UdpSocket* > >::iterator i = socketListeners_.begin();
-                        i != socketListeners_.end(); ++i ){
-
-                    if( FD_ISSET( i->second->impl_->Socket(), &tempfds ) ){
-
-                        std::size_t size = i->second->ReceiveFrom( remoteEndpoint, data, MAX_BUFFER_SIZE );
-                        if( size > 0 ){
-                            i->first->ProcessPacket( data, (int)size, remoteEndpoint );
-                            if( break_ )
-                                break;
-                        }
-                    }
-                }
-
-                // execute any expired timers
-                currentTimeMs = GetCurrentTimeMs();
-                bool resort = false;
-                for( std::vector< std::pair< double, AttachedTimerListener > >::iterator i = timerQueue_.begin();
-                        i != timerQueue_.end() && i->first <= currentTimeMs; ++i ){
-
-                    i->second.listener->TimerExpired();
-                    if( break_ )
-                        break;
-
-                    i->first += i->second.periodMs;
-                    resort = true;
-                }
-                if( resort )
-                    std::sort( timerQueue_.begin(), timerQueue_.end(), CompareScheduledTimerCalls );
+            TimerQueue timerQueue;
+            InitializeTimerQueue( timerQueue );
+            timerFdExpiryNs_ = -1; // re-armed by the first wait
+
+            bool done = false;
+#ifdef OSC_HAVE_IO_URING
+            if( backend_ == IO_URING_BACKEND ){
+                bool socketsChanged = false;
+                do{
+                    done = RunIoUring( ReceiveBufferSize(), timerQueue, socketsChanged );
+                    if( socketsChanged )
+                        ApplyQueuedCommands( timerQueue, -1 );
+                }while( done && socketsChanged && !break_ );
             }
+#endif
 
-            delete [] data;
+            // large enough for the biggest read from any attached socket
+            std::vector<char> data( std::max( ReceiveBufferSize(), (std::size_t)1 ) );
+
+#ifdef OSC_HAVE_EPOLL
+            if( !done && backend_ != SELECT_BACKEND )
+                done = RunEpoll( data, timerQueue );
+#endif
+            if( !done )
+                RunSelect( data, timerQueue );
         }catch(...){
-            if( data )
-                delete [] data;
+            EndRunning();
+            break_ = false;
             throw;
         }
+
+        EndRunning();
+
+        // break_ is reset on exit rather than on entry so that an
+        // AsynchronousBreak() issued just before Run() isn't lost.
+        break_ = false;
+	}
+
+	void SetBusyPollPeriod( long idleMicroseconds )
+	{
+		busyPollNs_ = (idleMicroseconds > 0) ? idleMicroseconds * 1000LL : 0;
+	}
+
+	void SetPacketBufferPool( PacketBufferPool *pool )
+	{
+		packetBufferPool_ = pool;
+		receivePacket_.Reset();
+	}
+
+	int PollDescriptor()
+	{
+#ifdef OSC_HAVE_EPOLL
+		// attach/detach calls from other threads update the descriptor once it exists
+		ScopedMutexLock lock( commandMutex_ );
+		if( pollEpollFd_ == -1 )
+			pollEpollFd_ = CreatePollEpoll();
+
+		return pollEpollFd_;
+#else
+		throw std::runtime_error("PollDescriptor() requires epoll\n");
+#endif
+	}
+
+	std::size_t ProcessReady( std::size_t maxPackets )
+	{
+#ifdef OSC_HAVE_EPOLL
+		PollDescriptor();
+
+		// attach/detach calls made meanwhile are queued, as in Run()
+		BeginRunning();
+
+		std::size_t count = 0;
+		try{
+			count = ProcessReadyEvents( maxPackets );
+		}catch(...){
+			EndRunning();
+			break_ = false;
+			throw;
+		}
+
+		EndRunning();
+		break_ = false;
+
+		// wake up the caller again when the next timer is due
+		ScopedMutexLock lock( commandMutex_ );
+		ArmTimerFd( pollTimerQueue_ );
+
+		return count;
+#else
+		(void) maxPackets;
+		throw std::runtime_error("ProcessReady() requires epoll\n");
+#endif
 	}
 
     void Break()
@@ -540,9 +3210,9 @@ public:
 
 
 
-SocketReceiveMultiplexer::SocketReceiveMultiplexer()
+SocketReceiveMultiplexer::SocketReceiveMultiplexer( Backend backend )
 {
-	impl_ = new Implementation();
+	impl_ = new Implementation( backend );
 }
 
 SocketReceiveMultiplexer::~SocketReceiveMultiplexer()
@@ -562,12 +3232,27 @@ void SocketReceiveMultiplexer::DetachSocketListener( UdpSocket *socket, PacketLi
 
 void SocketReceiveMultiplexer::AttachPeriodicTimerListener( int periodMilliseconds, TimerListener *listener )
 {
-	impl_->AttachPeriodicTimerListener( periodMilliseconds, listener );
+	impl_->AttachPeriodicTimerListenerNanoseconds(
+			periodMilliseconds * 1000000LL, periodMilliseconds * 1000000LL, listener );
 }
 
 void SocketReceiveMultiplexer::AttachPeriodicTimerListener( int initialDelayMilliseconds, int periodMilliseconds, TimerListener *listener )
 {
-	impl_->AttachPeriodicTimerListener( initialDelayMilliseconds, periodMilliseconds, listener );
+	impl_->AttachPeriodicTimerListenerNanoseconds(
+			initialDelayMilliseconds * 1000000LL, periodMilliseconds * 1000000LL, listener );
+}
+
+void SocketReceiveMultiplexer::AttachPeriodicTimerListenerMicroseconds(
+		long initialDelayMicroseconds, long periodMicroseconds, TimerListener *listener )
+{
+	impl_->AttachPeriodicTimerListenerNanoseconds(
+			initialDelayMicroseconds * 1000LL, periodMicroseconds * 1000LL, listener );
+}
+
+void SocketReceiveMultiplexer::AttachPeriodicTimerListenerNanoseconds(
+		long long initialDelayNanoseconds, long long periodNanoseconds, TimerListener *listener )
+{
+	impl_->AttachPeriodicTimerListenerNanoseconds( initialDelayNanoseconds, periodNanoseconds, listener );
 }
 
 void SocketReceiveMultiplexer::DetachPeriodicTimerListener( TimerListener *listener )
@@ -575,6 +3260,26 @@ void SocketReceiveMultiplexer::DetachPeriodicTimerListener( TimerListener *liste
 	impl_->DetachPeriodicTimerListener( listener );
 }
 
+void SocketReceiveMultiplexer::SetBusyPollPeriod( long idleMicroseconds )
+{
+	impl_->SetBusyPollPeriod( idleMicroseconds );
+}
+
+void SocketReceiveMultiplexer::SetPacketBufferPool( PacketBufferPool *pool )
+{
+	impl_->SetPacketBufferPool( pool );
+}
+
+int SocketReceiveMultiplexer::PollDescriptor()
+{
+	return impl_->PollDescriptor();
+}
+
+std::size_t SocketReceiveMultiplexer::ProcessReady( std::size_t maxPackets )
+{
+	return impl_->ProcessReady( maxPackets );
+}
+
 void SocketReceiveMultiplexer::Run()
 {
 	impl_->Run();
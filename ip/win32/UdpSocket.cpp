@@ -46,6 +46,7 @@
 #include <algorithm>
 #include <cassert>
 #include <cstring> // for memset
+#include <map>
 #include <stdexcept>
 #include <vector>
 
@@ -54,6 +55,7 @@
                           // std::size_t usage.
 
 #include "ip/NetworkingUtils.h"
+#include "ip/PacketBuffer.h"
 #include "ip/PacketListener.h"
 #include "ip/TimerListener.h"
 
@@ -101,12 +103,27 @@ class UdpSocket::Implementation{
 	struct sockaddr_in connectedAddr_;
 	struct sockaddr_in sendToAddr_;
 
+	std::size_t receiveBatchSize_;
+	std::size_t maxReceivePacketSize_;
+
+	// LocalEndpointFor() results by remote address, see SetLocalEndpointCacheTimeout()
+	struct CachedLocalEndpoint{
+		IpEndpointName endpoint;
+		DWORD cachedTimeMs;
+	};
+	typedef std::map< unsigned long, CachedLocalEndpoint > LocalEndpointCache;
+	mutable LocalEndpointCache localEndpointCache_;
+	DWORD localEndpointCacheTimeoutMs_; // 0 if the cache is disabled
+
 public:
 
 	Implementation()
 		: isBound_( false )
 		, isConnected_( false )
 		, socket_( INVALID_SOCKET )
+		, receiveBatchSize_( 1 )
+		, maxReceivePacketSize_( UdpSocket::DEFAULT_MAX_RECEIVE_PACKET_SIZE )
+		, localEndpointCacheTimeoutMs_( 0 )
 	{
 		if( (socket_ = socket( AF_INET, SOCK_DGRAM, 0 )) == INVALID_SOCKET ){
             throw std::runtime_error("unable to create udp socket\n");
@@ -137,10 +154,50 @@ public:
 		setsockopt(socket_, SOL_SOCKET, SO_REUSEADDR, &reuseAddr, sizeof(reuseAddr));
 	}
 
+	void SetAllowReusePort( bool allowReusePort )
+	{
+		// Winsock has no SO_REUSEPORT
+		(void) allowReusePort;
+	}
+
 	IpEndpointName LocalEndpointFor( const IpEndpointName& remoteEndpoint ) const
 	{
 		assert( isBound_ );
 
+		if( localEndpointCacheTimeoutMs_ == 0 )
+			return LookUpLocalEndpoint( remoteEndpoint );
+
+		// timeGetTime() wraps, so compare elapsed times rather than expiry times
+		DWORD currentTimeMs = timeGetTime();
+		LocalEndpointCache::const_iterator i = localEndpointCache_.find( remoteEndpoint.address );
+		if( i != localEndpointCache_.end() && currentTimeMs - i->second.cachedTimeMs < localEndpointCacheTimeoutMs_ )
+			return i->second.endpoint;
+
+		// a crude bound on the memory held by entries for peers which have gone away
+		const std::size_t MAX_CACHED_LOCAL_ENDPOINTS = 65536;
+		if( localEndpointCache_.size() >= MAX_CACHED_LOCAL_ENDPOINTS )
+			localEndpointCache_.clear();
+
+		CachedLocalEndpoint& entry = localEndpointCache_[ remoteEndpoint.address ];
+		entry.endpoint = LookUpLocalEndpoint( remoteEndpoint );
+		entry.cachedTimeMs = currentTimeMs;
+		return entry.endpoint;
+	}
+
+	void SetLocalEndpointCacheTimeout( long timeoutMilliseconds )
+	{
+		localEndpointCacheTimeoutMs_ = (timeoutMilliseconds > 0) ? (DWORD)timeoutMilliseconds : 0;
+		localEndpointCache_.clear();
+	}
+
+	bool SetEnableLocalEndpointLearning( bool enableLearning )
+	{
+		// not implemented (would need WSARecvMsg() with IP_PKTINFO)
+		return !enableLearning;
+	}
+
+	IpEndpointName LookUpLocalEndpoint( const IpEndpointName& remoteEndpoint ) const
+	{
 		// first connect the socket to the remote server
         
         struct sockaddr_in connectSockAddr;
@@ -207,6 +264,40 @@ public:
         sendto( socket_, data, (int)size, 0, (sockaddr*)&sendToAddr_, sizeof(sendToAddr_) );
 	}
 
+	// Winsock has no equivalent of sendmmsg(), so batches are sent one datagram at a time
+
+	std::size_t SendBatch( UdpBatchEntry *entries, std::size_t count )
+	{
+		assert( isConnected_ );
+
+		std::size_t sentCount = 0;
+		for( std::size_t i = 0; i < count; ++i ){
+			int result = send( socket_, entries[i].data, (int)entries[i].size, 0 );
+			entries[i].bytesSent = (result == SOCKET_ERROR) ? 0 : (std::size_t)result;
+			entries[i].error = (result == SOCKET_ERROR) ? WSAGetLastError() : 0;
+			if( result != SOCKET_ERROR )
+				++sentCount;
+		}
+		return sentCount;
+	}
+
+	std::size_t SendToBatch( UdpBatchEntry *entries, std::size_t count )
+	{
+		std::size_t sentCount = 0;
+		for( std::size_t i = 0; i < count; ++i ){
+			struct sockaddr_in destination;
+			SockaddrFromIpEndpointName( destination, entries[i].remoteEndpoint );
+
+			int result = sendto( socket_, entries[i].data, (int)entries[i].size, 0,
+					(sockaddr*)&destination, sizeof(destination) );
+			entries[i].bytesSent = (result == SOCKET_ERROR) ? 0 : (std::size_t)result;
+			entries[i].error = (result == SOCKET_ERROR) ? WSAGetLastError() : 0;
+			if( result != SOCKET_ERROR )
+				++sentCount;
+		}
+		return sentCount;
+	}
+
 	void Bind( const IpEndpointName& localEndpoint )
 	{
 		struct sockaddr_in bindSockAddr;
@@ -239,6 +330,22 @@ public:
 		return result;
 	}
 
+	void SetReceiveBatchSize( std::size_t batchSize )
+	{
+		assert( batchSize > 0 );
+		receiveBatchSize_ = batchSize;
+	}
+
+	std::size_t ReceiveBatchSize() const { return receiveBatchSize_; }
+
+	void SetMaxReceivePacketSize( std::size_t maxPacketSize )
+	{
+		assert( maxPacketSize > 0 && maxPacketSize <= UdpSocket::MAX_UDP_PACKET_SIZE );
+		maxReceivePacketSize_ = maxPacketSize;
+	}
+
+	std::size_t MaxReceivePacketSize() const { return maxReceivePacketSize_; }
+
 	SOCKET& Socket() { return socket_; }
 };
 
@@ -262,11 +369,26 @@ void UdpSocket::SetAllowReuse( bool allowReuse )
     impl_->SetAllowReuse( allowReuse );
 }
 
+void UdpSocket::SetAllowReusePort( bool allowReusePort )
+{
+    impl_->SetAllowReusePort( allowReusePort );
+}
+
 IpEndpointName UdpSocket::LocalEndpointFor( const IpEndpointName& remoteEndpoint ) const
 {
 	return impl_->LocalEndpointFor( remoteEndpoint );
 }
 
+void UdpSocket::SetLocalEndpointCacheTimeout( long timeoutMilliseconds )
+{
+	impl_->SetLocalEndpointCacheTimeout( timeoutMilliseconds );
+}
+
+bool UdpSocket::SetEnableLocalEndpointLearning( bool enableLearning )
+{
+	return impl_->SetEnableLocalEndpointLearning( enableLearning );
+}
+
 void UdpSocket::Connect( const IpEndpointName& remoteEndpoint )
 {
 	impl_->Connect( remoteEndpoint );
@@ -282,6 +404,16 @@ void UdpSocket::SendTo( const IpEndpointName& remoteEndpoint, const char *data,
 	impl_->SendTo( remoteEndpoint, data, size );
 }
 
+std::size_t UdpSocket::SendBatch( UdpBatchEntry *entries, std::size_t count )
+{
+	return impl_->SendBatch( entries, count );
+}
+
+std::size_t UdpSocket::SendToBatch( UdpBatchEntry *entries, std::size_t count )
+{
+	return impl_->SendToBatch( entries, count );
+}
+
 void UdpSocket::Bind( const IpEndpointName& localEndpoint )
 {
 	impl_->Bind( localEndpoint );
@@ -297,14 +429,85 @@ std::size_t UdpSocket::ReceiveFrom( IpEndpointName& remoteEndpoint, char *data,
 	return impl_->ReceiveFrom( remoteEndpoint, data, size );
 }
 
+void UdpSocket::SetReceiveBatchSize( std::size_t batchSize )
+{
+	impl_->SetReceiveBatchSize( batchSize );
+}
+
+std::size_t UdpSocket::ReceiveBatchSize() const
+{
+	return impl_->ReceiveBatchSize();
+}
+
+void UdpSocket::SetEnableSendSegmentation( bool enableSendSegmentation )
+{
+	// UDP send offload (UDP_SEND_MSG_SIZE) isn't supported here
+	(void) enableSendSegmentation;
+}
+
+bool UdpSocket::SendSegmentation() const
+{
+	return false;
+}
+
+bool UdpSocket::SetZeroCopySendThreshold( std::size_t thresholdBytes, SendCompletionListener *listener )
+{
+	// zero-copy sends aren't supported on Win32
+	(void) listener;
+	return thresholdBytes == 0;
+}
+
+std::size_t UdpSocket::ProcessSendCompletions()
+{
+	return 0;
+}
+
+std::size_t UdpSocket::PendingZeroCopySendCount() const
+{
+	return 0;
+}
+
+void UdpSocket::SetMaxReceivePacketSize( std::size_t maxPacketSize )
+{
+	impl_->SetMaxReceivePacketSize( maxPacketSize );
+}
+
+std::size_t UdpSocket::MaxReceivePacketSize() const
+{
+	return impl_->MaxReceivePacketSize();
+}
+
+void UdpSocket::SetEnableReceiveCoalescing( bool enableReceiveCoalescing )
+{
+	// Windows has UDP_RECV_MAX_COALESCED_SIZE, but it isn't supported here
+	(void) enableReceiveCoalescing;
+}
+
+bool UdpSocket::SetReceiveTimestamps( ReceiveTimestampMode mode )
+{
+	// SIO_TIMESTAMPING needs Windows 11, it isn't supported here
+	return mode == NO_RECEIVE_TIMESTAMPS;
+}
+
+UdpSocket::ReceiveTimestampMode UdpSocket::ReceiveTimestamps() const
+{
+	return NO_RECEIVE_TIMESTAMPS;
+}
+
+bool UdpSocket::SetKernelBusyPoll( int microseconds )
+{
+	// SO_BUSY_POLL is Linux only
+	return microseconds == 0;
+}
+
 
 struct AttachedTimerListener{
-	AttachedTimerListener( int id, int p, TimerListener *tl )
+	AttachedTimerListener( double id, double p, TimerListener *tl )
 		: initialDelayMs( id )
 		, periodMs( p )
 		, listener( tl ) {}
-	int initialDelayMs;
-	int periodMs;
+	double initialDelayMs; // fractional for sub-millisecond timers
+	double periodMs;
 	TimerListener *listener;
 };
 
@@ -328,6 +531,42 @@ extern "C" /*static*/ void InterruptSignalHandler( int );
 }
 
 
+// an attach or detach requested while Run() is active. the calling thread
+// queues it and wakes Run() through the break event. the thread running
+// Run() applies it between wakeups, so dispatch itself needs no locking.
+struct MultiplexerCommand{
+	enum Type{
+		ATTACH_SOCKET_LISTENER,
+		DETACH_SOCKET_LISTENER,
+		ATTACH_TIMER_LISTENER,
+		DETACH_TIMER_LISTENER
+	};
+
+	MultiplexerCommand( Type t, UdpSocket *s, PacketListener *pl )
+		: type( t ), socket( s ), packetListener( pl ), timer( 0, 0, 0 ), appliedEvent( 0 ) {}
+	MultiplexerCommand( Type t, const AttachedTimerListener& tl )
+		: type( t ), socket( 0 ), packetListener( 0 ), timer( tl ), appliedEvent( 0 ) {}
+
+	Type type;
+	UdpSocket *socket;
+	PacketListener *packetListener;
+	AttachedTimerListener timer; // only timer.listener is used by DETACH_TIMER_LISTENER
+	HANDLE appliedEvent; // set once applied if the calling thread is waiting, otherwise 0
+};
+
+
+class ScopedCriticalSection{
+	CRITICAL_SECTION& criticalSection_;
+public:
+	explicit ScopedCriticalSection( CRITICAL_SECTION& criticalSection )
+		: criticalSection_( criticalSection ) { EnterCriticalSection( &criticalSection_ ); }
+	~ScopedCriticalSection() { LeaveCriticalSection( &criticalSection_ ); }
+};
+
+
+typedef std::vector< std::pair< double, AttachedTimerListener > > TimerQueue;
+
+
 class SocketReceiveMultiplexer::Implementation{
     NetworkInitializer networkInitializer_;
 
@@ -337,6 +576,32 @@ class SocketReceiveMultiplexer::Implementation{
 	volatile bool break_;
 	HANDLE breakEvent_;
 
+	// set when a command is queued. WaitForMultipleObjects() only reports
+	// the lowest signalled event, so the break event alone isn't enough to
+	// notice commands while a socket is busy.
+	volatile bool commandsQueued_;
+
+	double busyPollMs_; // see SetBusyPollPeriod(), 0 if disabled
+
+	// see SetPacketBufferPool(). the nth read of a batch goes into
+	// receivePackets_[n]'s buffer, which is kept for the next batch unless a
+	// listener holds on to it
+	PacketBufferPool *packetBufferPool_;
+	std::vector<PacketRef> receivePackets_;
+
+	// the packets passed to a listener's ProcessPackets(), reused for every
+	// batch. when receiving into a pool batchPacketRefs_[i] is batch_[i].packet
+	std::vector<BatchedPacket> batch_;
+	std::vector<PacketRef> batchPacketRefs_;
+
+	// attach/detach calls made while Run() is active are queued here.
+	// commandLock_ guards everything below, running_ is set for the
+	// duration of Run().
+	CRITICAL_SECTION commandLock_;
+	std::vector<MultiplexerCommand> queuedCommands_;
+	bool running_;
+	DWORD runThreadId_;
+
 	double GetCurrentTimeMs() const
 	{
 #ifndef WINCE
@@ -346,95 +611,343 @@ class SocketReceiveMultiplexer::Implementation{
 #endif
     }
 
-public:
-    Implementation()
+	// applies a command to the attached listeners. while Run() is active
+	// timerQueue is the running timer queue. returns true if the set of
+	// attached sockets changed.
+	bool ApplyCommand( const MultiplexerCommand& command, TimerQueue *timerQueue )
 	{
-		breakEvent_ = CreateEvent( NULL, FALSE, FALSE, NULL );
+		switch( command.type ){
+			case MultiplexerCommand::ATTACH_SOCKET_LISTENER:
+				assert( std::find( socketListeners_.begin(), socketListeners_.end(),
+						std::make_pair(command.packetListener, command.socket) ) == socketListeners_.end() );
+				// we don't check that the same socket has been added multiple times, even though this is an error
+				socketListeners_.push_back( std::make_pair( command.packetListener, command.socket ) );
+				return true;
+
+			case MultiplexerCommand::DETACH_SOCKET_LISTENER:
+			{
+				std::vector< std::pair< PacketListener*, UdpSocket* > >::iterator i = 
+						std::find( socketListeners_.begin(), socketListeners_.end(),
+						std::make_pair(command.packetListener, command.socket) );
+				assert( i != socketListeners_.end() );
+
+				socketListeners_.erase( i );
+				return true;
+			}
+
+			case MultiplexerCommand::ATTACH_TIMER_LISTENER:
+				timerListeners_.push_back( command.timer );
+				if( timerQueue ){
+					timerQueue->push_back( std::make_pair( GetCurrentTimeMs() + command.timer.initialDelayMs, command.timer ) );
+					std::sort( timerQueue->begin(), timerQueue->end(), CompareScheduledTimerCalls );
+				}
+				return false;
+
+			case MultiplexerCommand::DETACH_TIMER_LISTENER:
+			{
+				std::vector< AttachedTimerListener >::iterator i = timerListeners_.begin();
+				while( i != timerListeners_.end() ){
+					if( i->listener == command.timer.listener )
+						break;
+					++i;
+				}
+
+				assert( i != timerListeners_.end() );
+
+				timerListeners_.erase( i );
+
+				if( timerQueue ){
+					for( TimerQueue::iterator j = timerQueue->begin(); j != timerQueue->end(); ++j ){
+						if( j->second.listener == command.timer.listener ){
+							timerQueue->erase( j );
+							break;
+						}
+					}
+				}
+				return false;
+			}
+		}
+
+		return false;
 	}
 
-    ~Implementation()
+	// applies a command right away if Run() isn't active. otherwise queues
+	// it and wakes the loop. a thread other than the one running Run()
+	// waits until the loop has applied it.
+	void ExecuteCommand( MultiplexerCommand command )
 	{
-		CloseHandle( breakEvent_ );
+		{
+			ScopedCriticalSection lock( commandLock_ );
+
+			if( !running_ ){
+				ApplyCommand( command, 0 );
+				return;
+			}
+
+			if( GetCurrentThreadId() != runThreadId_ ){
+				command.appliedEvent = CreateEvent( NULL, TRUE, FALSE, NULL );
+				if( command.appliedEvent == NULL )
+					throw std::runtime_error("unable to create event\n");
+			}
+
+			// one signal wakes the loop for all the commands queued before it runs
+			if( queuedCommands_.empty() ){
+				commandsQueued_ = true;
+				SetEvent( breakEvent_ );
+			}
+
+			try{
+				queuedCommands_.push_back( command );
+			}catch(...){
+				if( command.appliedEvent )
+					CloseHandle( command.appliedEvent );
+				throw;
+			}
+		}
+
+		if( command.appliedEvent ){
+			WaitForSingleObject( command.appliedEvent, INFINITE );
+			CloseHandle( command.appliedEvent );
+		}
 	}
 
-    void AttachSocketListener( UdpSocket *socket, PacketListener *listener )
+	static void SignalCommandsApplied( const std::vector<MultiplexerCommand>& commands )
 	{
-		assert( std::find( socketListeners_.begin(), socketListeners_.end(), std::make_pair(listener, socket) ) == socketListeners_.end() );
-		// we don't check that the same socket has been added multiple times, even though this is an error
-		socketListeners_.push_back( std::make_pair( listener, socket ) );
+		for( std::size_t i = 0; i < commands.size(); ++i ){
+			if( commands[i].appliedEvent )
+				SetEvent( commands[i].appliedEvent );
+		}
 	}
 
-    void DetachSocketListener( UdpSocket *socket, PacketListener *listener )
+	// creates an event for each attached socket, which is signalled when the
+	// socket has data, followed by the break event
+	void CreateSocketEvents( std::vector<HANDLE>& events )
 	{
-		std::vector< std::pair< PacketListener*, UdpSocket* > >::iterator i = 
-				std::find( socketListeners_.begin(), socketListeners_.end(), std::make_pair(listener, socket) );
-		assert( i != socketListeners_.end() );
+		events.clear();
+		for( std::vector< std::pair< PacketListener*, UdpSocket* > >::iterator i = socketListeners_.begin();
+				i != socketListeners_.end(); ++i ){
+
+			HANDLE event = CreateEvent( NULL, FALSE, FALSE, NULL );
+			WSAEventSelect( i->second->impl_->Socket(), event, FD_READ ); // note that this makes the socket non-blocking which is why we can safely call RecieveFrom() on all sockets below
+			events.push_back( event );
+		}
 
-		socketListeners_.erase( i );
+		events.push_back( breakEvent_ ); // last event in the collection is the break event
 	}
 
-    void AttachPeriodicTimerListener( int periodMilliseconds, TimerListener *listener )
+	void CloseSocketEvents( std::vector<HANDLE>& events )
 	{
-		timerListeners_.push_back( AttachedTimerListener( periodMilliseconds, periodMilliseconds, listener ) );
+		for( std::size_t j = 0; j + 1 < events.size(); ++j ){
+			SOCKET socket = socketListeners_[j].second->impl_->Socket();
+			WSAEventSelect( socket, events[j], 0 ); // remove association between socket and event
+			CloseHandle( events[j] );
+			unsigned long enableNonblocking = 0;
+			ioctlsocket( socket, FIONBIO, &enableNonblocking );  // make the socket blocking again
+		}
+
+		events.clear();
 	}
 
-	void AttachPeriodicTimerListener( int initialDelayMilliseconds, int periodMilliseconds, TimerListener *listener )
+	// called by the Run() thread after a wakeup through the break event.
+	// the socket events are recreated if the set of sockets changes.
+	void ApplyQueuedCommands( std::vector<HANDLE>& events, TimerQueue& timerQueue, std::vector<char>& data )
 	{
-		timerListeners_.push_back( AttachedTimerListener( initialDelayMilliseconds, periodMilliseconds, listener ) );
+		std::vector<MultiplexerCommand> commands;
+		{
+			ScopedCriticalSection lock( commandLock_ );
+			commands.swap( queuedCommands_ );
+			commandsQueued_ = false;
+		}
+
+		bool socketsChanging = false;
+		for( std::size_t i = 0; i < commands.size(); ++i ){
+			if( commands[i].type == MultiplexerCommand::ATTACH_SOCKET_LISTENER
+					|| commands[i].type == MultiplexerCommand::DETACH_SOCKET_LISTENER )
+				socketsChanging = true;
+		}
+
+		if( socketsChanging )
+			CloseSocketEvents( events );
+
+		for( std::size_t i = 0; i < commands.size(); ++i )
+			ApplyCommand( commands[i], &timerQueue );
+
+		if( socketsChanging ){
+			CreateSocketEvents( events );
+			if( data.size() < ReceiveBufferSize() )
+				data.resize( ReceiveBufferSize() );
+		}
+
+		SignalCommandsApplied( commands );
 	}
 
-    void DetachPeriodicTimerListener( TimerListener *listener )
+	// large enough for a full batch of the biggest datagrams from any attached socket
+	std::size_t ReceiveBufferSize() const
 	{
-		std::vector< AttachedTimerListener >::iterator i = timerListeners_.begin();
-		while( i != timerListeners_.end() ){
-			if( i->listener == listener )
-				break;
-			++i;
+		std::size_t result = 0;
+		for( std::vector< std::pair< PacketListener*, UdpSocket* > >::const_iterator i = socketListeners_.begin();
+				i != socketListeners_.end(); ++i ){
+			std::size_t batchBufferSize = i->second->MaxReceivePacketSize() * i->second->ReceiveBatchSize();
+			if( result < batchBufferSize )
+				result = batchBufferSize;
 		}
 
-		assert( i != timerListeners_.end() );
+		return result;
+	}
 
-		timerListeners_.erase( i );
+	void BeginRunning()
+	{
+		ScopedCriticalSection lock( commandLock_ );
+		running_ = true;
+		runThreadId_ = GetCurrentThreadId();
 	}
 
-    void Run()
+	// applies any commands the loop didn't get to and releases the threads
+	// waiting for them
+	void EndRunning()
 	{
-		break_ = false;
+		ScopedCriticalSection lock( commandLock_ );
+		for( std::size_t i = 0; i < queuedCommands_.size(); ++i )
+			ApplyCommand( queuedCommands_[i], 0 );
+		SignalCommandsApplied( queuedCommands_ );
+		queuedCommands_.clear();
+		commandsQueued_ = false;
+		running_ = false;
+	}
 
-		// prepare the window events which we use to wake up on incoming data
-		// we use this instead of select() primarily to support the AsyncBreak() 
-		// mechanism.
+	// read up to ReceiveBatchSize() datagrams from a socket and pass them to
+	// its listener as one batch. returns the number of datagrams read
+	std::size_t ReceiveAndDispatch( std::pair< PacketListener*, UdpSocket* >& socketListener,
+			std::vector<char>& data, IpEndpointName& remoteEndpoint )
+	{
+		UdpSocket *socket = socketListener.second;
+		std::size_t batchSize = socket->ReceiveBatchSize();
+		std::size_t capacity = socket->MaxReceivePacketSize();
+		if( packetBufferPool_ ){
+			// larger datagrams are truncated
+			if( capacity > packetBufferPool_->BufferSize() )
+				capacity = packetBufferPool_->BufferSize();
+			if( receivePackets_.size() < batchSize )
+				receivePackets_.resize( batchSize );
+		}
+		assert( packetBufferPool_ || batchSize * capacity <= data.size() );
+
+		// the sockets are non-blocking while we're running, so we can keep
+		// reading until the batch is full or no more datagrams are queued.
+		batch_.clear();
+		for( std::size_t j = 0; j < batchSize; ++j ){
+			BatchedPacket packet;
+			if( packetBufferPool_ ){
+				if( !receivePackets_[j].IsUnique() )
+					receivePackets_[j] = PacketRef( packetBufferPool_->Acquire() );
+
+				PacketBuffer *buffer = receivePackets_[j].Buffer();
+				std::size_t size = socket->ReceiveFrom( buffer->remoteEndpoint, buffer->Data(), capacity );
+				if( size == 0 )
+					break;
 
-		std::vector<HANDLE> events( socketListeners_.size() + 1, 0 );
-		int j=0;
-		for( std::vector< std::pair< PacketListener*, UdpSocket* > >::iterator i = socketListeners_.begin();
-				i != socketListeners_.end(); ++i, ++j ){
+				packet.data = buffer->Data();
+				packet.size = (int)size;
+				packet.remoteEndpoint = buffer->remoteEndpoint;
+				batchPacketRefs_.push_back( PacketRef( buffer, buffer->Data(), size ) );
+			}else{
+				char *packetData = &data[ j * capacity ];
+				std::size_t size = socket->ReceiveFrom( remoteEndpoint, packetData, capacity );
+				if( size == 0 )
+					break;
 
-			HANDLE event = CreateEvent( NULL, FALSE, FALSE, NULL );
-			WSAEventSelect( i->second->impl_->Socket(), event, FD_READ ); // note that this makes the socket non-blocking which is why we can safely call RecieveFrom() on all sockets below
-			events[j] = event;
+				packet.data = packetData;
+				packet.size = (int)size;
+				packet.remoteEndpoint = remoteEndpoint;
+			}
+			batch_.push_back( packet );
 		}
 
+		// packets remaining in the batch are discarded if a listener calls Break()
+		std::size_t count = batch_.size();
+		if( count > 0 ){
+			for( std::size_t j = 0; j < batchPacketRefs_.size(); ++j )
+				batch_[j].packet = &batchPacketRefs_[j];
 
-		events[ socketListeners_.size() ] = breakEvent_; // last event in the collection is the break event
+			socketListener.first->ProcessPackets( PacketBatch( &batch_[0], count, &break_ ) );
+			batch_.clear();
+			batchPacketRefs_.clear();
+		}
+
+		return count;
+	}
+
+	void ExecuteExpiredTimers( TimerQueue& timerQueue )
+	{
+		double currentTimeMs = GetCurrentTimeMs();
+		bool resort = false;
+		for( TimerQueue::iterator i = timerQueue.begin();
+				i != timerQueue.end() && i->first <= currentTimeMs; ++i ){
+
+			i->second.listener->TimerExpired();
+			if( break_ )
+				break;
+
+			i->first += i->second.periodMs;
+			resort = true;
+		}
+		if( resort )
+			std::sort( timerQueue.begin(), timerQueue.end(), CompareScheduledTimerCalls );
+	}
+
+	// low latency mode: keeps reading from the attached sockets without
+	// waiting until nothing has arrived for busyPollMs_, running timers as
+	// they fall due. returns early on Break() or when commands are queued.
+	void BusyPoll( std::vector<char>& data, TimerQueue& timerQueue )
+	{
+		IpEndpointName remoteEndpoint;
+		double lastReceiveMs = GetCurrentTimeMs();
+
+		while( !break_ && !commandsQueued_ ){
+			bool received = false;
+			for( std::size_t i = 0; i < socketListeners_.size() && !break_; ++i ){
+				if( ReceiveAndDispatch( socketListeners_[i], data, remoteEndpoint ) > 0 )
+					received = true;
+			}
+
+			ExecuteExpiredTimers( timerQueue );
+
+			double currentTimeMs = GetCurrentTimeMs();
+			if( received )
+				lastReceiveMs = currentTimeMs;
+			else if( currentTimeMs - lastReceiveMs >= busyPollMs_ )
+				break;
+		}
+	}
+
+	void RunLoop( std::vector<HANDLE>& events )
+	{
+		// prepare the window events which we use to wake up on incoming data
+		// we use this instead of select() primarily to support the AsyncBreak() 
+		// mechanism.
+		CreateSocketEvents( events );
 
-		
 		// configure the timer queue
 		double currentTimeMs = GetCurrentTimeMs();
 
 		// expiry time ms, listener
-		std::vector< std::pair< double, AttachedTimerListener > > timerQueue_;
+		TimerQueue timerQueue_;
 		for( std::vector< AttachedTimerListener >::iterator i = timerListeners_.begin();
 				i != timerListeners_.end(); ++i )
 			timerQueue_.push_back( std::make_pair( currentTimeMs + i->initialDelayMs, *i ) );
 		std::sort( timerQueue_.begin(), timerQueue_.end(), CompareScheduledTimerCalls );
 
-		const int MAX_BUFFER_SIZE = 4098;
-		char *data = new char[ MAX_BUFFER_SIZE ];
+		std::vector<char> data( ReceiveBufferSize() > 0 ? ReceiveBufferSize() : 1 );
 		IpEndpointName remoteEndpoint;
 
 		while( !break_ ){
 
+			if( busyPollMs_ > 0 ){
+				BusyPoll( data, timerQueue_ );
+				if( break_ )
+					break;
+			}
+
 			double currentTimeMs = GetCurrentTimeMs();
 
             DWORD waitTime = INFINITE;
@@ -445,50 +958,114 @@ public:
                             : 0 );
             }
 
-			DWORD waitResult = WaitForMultipleObjects( (DWORD)socketListeners_.size() + 1, &events[0], FALSE, waitTime );
+			DWORD waitResult = WaitForMultipleObjects( (DWORD)events.size(), &events[0], FALSE, waitTime );
 			if( break_ )
 				break;
 
 			if( waitResult != WAIT_TIMEOUT ){
-				for( int i = waitResult - WAIT_OBJECT_0; i < (int)socketListeners_.size(); ++i ){
-					std::size_t size = socketListeners_[i].second->ReceiveFrom( remoteEndpoint, data, MAX_BUFFER_SIZE );
-					if( size > 0 ){
-						socketListeners_[i].first->ProcessPacket( data, (int)size, remoteEndpoint );
-						if( break_ )
-							break;
-					}
-				}
+				for( int i = waitResult - WAIT_OBJECT_0; i < (int)socketListeners_.size() && !break_; ++i )
+					ReceiveAndDispatch( socketListeners_[i], data, remoteEndpoint );
 			}
 
 			// execute any expired timers
-			currentTimeMs = GetCurrentTimeMs();
-			bool resort = false;
-			for( std::vector< std::pair< double, AttachedTimerListener > >::iterator i = timerQueue_.begin();
-					i != timerQueue_.end() && i->first <= currentTimeMs; ++i ){
-
-				i->second.listener->TimerExpired();
-				if( break_ )
-					break;
+			ExecuteExpiredTimers( timerQueue_ );
 
-				i->first += i->second.periodMs;
-				resort = true;
-			}
-			if( resort )
-				std::sort( timerQueue_.begin(), timerQueue_.end(), CompareScheduledTimerCalls );
+			// apply attach/detach calls made since the last wakeup
+			if( commandsQueued_ && !break_ )
+				ApplyQueuedCommands( events, timerQueue_, data );
 		}
+	}
 
-		delete [] data;
+public:
+    Implementation()
+		: break_( false )
+		, commandsQueued_( false )
+		, busyPollMs_( 0 )
+		, packetBufferPool_( 0 )
+		, running_( false )
+		, runThreadId_( 0 )
+	{
+		breakEvent_ = CreateEvent( NULL, FALSE, FALSE, NULL );
+		InitializeCriticalSection( &commandLock_ );
+	}
 
-		// free events
-		j = 0;
-		for( std::vector< std::pair< PacketListener*, UdpSocket* > >::iterator i = socketListeners_.begin();
-				i != socketListeners_.end(); ++i, ++j ){
+    ~Implementation()
+	{
+		DeleteCriticalSection( &commandLock_ );
+		CloseHandle( breakEvent_ );
+	}
 
-			WSAEventSelect( i->second->impl_->Socket(), events[j], 0 ); // remove association between socket and event
-			CloseHandle( events[j] );
-			unsigned long enableNonblocking = 0;
-			ioctlsocket( i->second->impl_->Socket(), FIONBIO, &enableNonblocking );  // make the socket blocking again
+    void AttachSocketListener( UdpSocket *socket, PacketListener *listener )
+	{
+		ExecuteCommand( MultiplexerCommand( MultiplexerCommand::ATTACH_SOCKET_LISTENER, socket, listener ) );
+	}
+
+    void DetachSocketListener( UdpSocket *socket, PacketListener *listener )
+	{
+		ExecuteCommand( MultiplexerCommand( MultiplexerCommand::DETACH_SOCKET_LISTENER, socket, listener ) );
+	}
+
+    void AttachPeriodicTimerListener( int periodMilliseconds, TimerListener *listener )
+	{
+		ExecuteCommand( MultiplexerCommand( MultiplexerCommand::ATTACH_TIMER_LISTENER,
+				AttachedTimerListener( periodMilliseconds, periodMilliseconds, listener ) ) );
+	}
+
+	void AttachPeriodicTimerListener( int initialDelayMilliseconds, int periodMilliseconds, TimerListener *listener )
+	{
+		ExecuteCommand( MultiplexerCommand( MultiplexerCommand::ATTACH_TIMER_LISTENER,
+				AttachedTimerListener( initialDelayMilliseconds, periodMilliseconds, listener ) ) );
+	}
+
+	// WaitForMultipleObjects() has millisecond resolution, timers due within
+	// the next millisecond are polled for
+	void AttachPeriodicTimerListenerNanoseconds( long long initialDelayNanoseconds, long long periodNanoseconds, TimerListener *listener )
+	{
+		assert( periodNanoseconds > 0 );
+		ExecuteCommand( MultiplexerCommand( MultiplexerCommand::ATTACH_TIMER_LISTENER,
+				AttachedTimerListener( initialDelayNanoseconds * .000001, periodNanoseconds * .000001, listener ) ) );
+	}
+
+    void DetachPeriodicTimerListener( TimerListener *listener )
+	{
+		ExecuteCommand( MultiplexerCommand( MultiplexerCommand::DETACH_TIMER_LISTENER,
+				AttachedTimerListener( 0, 0, listener ) ) );
+	}
+
+    void Run()
+	{
+		// from here on attach/detach calls are queued for the loop
+		BeginRunning();
+
+		std::vector<HANDLE> events;
+		try{
+			RunLoop( events );
+		}catch(...){
+			CloseSocketEvents( events );
+			EndRunning();
+			break_ = false;
+			throw;
 		}
+
+		// free events
+		CloseSocketEvents( events );
+		EndRunning();
+
+		// break_ is reset on exit rather than on entry so that an
+		// AsynchronousBreak() issued just before Run() isn't lost.
+		break_ = false;
+	}
+
+	// timeGetTime() limits the period to millisecond resolution
+	void SetBusyPollPeriod( long idleMicroseconds )
+	{
+		busyPollMs_ = (idleMicroseconds > 0) ? idleMicroseconds * .001 : 0;
+	}
+
+	void SetPacketBufferPool( PacketBufferPool *pool )
+	{
+		packetBufferPool_ = pool;
+		receivePackets_.clear();
 	}
 
     void Break()
@@ -505,8 +1082,9 @@ public:
 
 
 
-SocketReceiveMultiplexer::SocketReceiveMultiplexer()
+SocketReceiveMultiplexer::SocketReceiveMultiplexer( Backend backend )
 {
+	(void) backend; // Win32 only provides the WaitForMultipleObjects() backend
 	impl_ = new Implementation();
 }
 
@@ -535,11 +1113,45 @@ void SocketReceiveMultiplexer::AttachPeriodicTimerListener( int initialDelayMill
 	impl_->AttachPeriodicTimerListener( initialDelayMilliseconds, periodMilliseconds, listener );
 }
 
+void SocketReceiveMultiplexer::AttachPeriodicTimerListenerMicroseconds(
+		long initialDelayMicroseconds, long periodMicroseconds, TimerListener *listener )
+{
+	impl_->AttachPeriodicTimerListenerNanoseconds(
+			initialDelayMicroseconds * 1000LL, periodMicroseconds * 1000LL, listener );
+}
+
+void SocketReceiveMultiplexer::AttachPeriodicTimerListenerNanoseconds(
+		long long initialDelayNanoseconds, long long periodNanoseconds, TimerListener *listener )
+{
+	impl_->AttachPeriodicTimerListenerNanoseconds( initialDelayNanoseconds, periodNanoseconds, listener );
+}
+
 void SocketReceiveMultiplexer::DetachPeriodicTimerListener( TimerListener *listener )
 {
 	impl_->DetachPeriodicTimerListener( listener );
 }
 
+void SocketReceiveMultiplexer::SetBusyPollPeriod( long idleMicroseconds )
+{
+	impl_->SetBusyPollPeriod( idleMicroseconds );
+}
+
+void SocketReceiveMultiplexer::SetPacketBufferPool( PacketBufferPool *pool )
+{
+	impl_->SetPacketBufferPool( pool );
+}
+
+// sockets can't be waited on together with a single descriptor here
+int SocketReceiveMultiplexer::PollDescriptor()
+{
+	throw std::runtime_error("PollDescriptor() is not supported on Win32\n");
+}
+
+std::size_t SocketReceiveMultiplexer::ProcessReady( std::size_t /*maxPackets*/ )
+{
+	throw std::runtime_error("ProcessReady() is not supported on Win32\n");
+}
+
 void SocketReceiveMultiplexer::Run()
 {
 	impl_->Run();
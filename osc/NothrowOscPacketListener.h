@@ -0,0 +1,126 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_NOTHROWOSCPACKETLISTENER_H
+#define INCLUDED_OSCPACK_NOTHROWOSCPACKETLISTENER_H
+
+#include "OscReceivedElements.h"
+#include "../ip/PacketListener.h"
+
+
+namespace osc{
+
+// NothrowOscPacketListener is an alternative to OscPacketListener that
+// parses packets with the non-throwing TryParse() methods. Malformed
+// packets are passed to ProcessMalformedPacket() instead of throwing from
+// ProcessPacket(), so rejecting a flood of garbage doesn't pay for
+// unwinding an exception per packet. Use it where misbehaving or hostile
+// senders are expected.
+//
+// The elements of a bundle are parsed one at a time: a malformed element
+// is passed to ProcessMalformedPacket() and the remaining elements are
+// still processed. Exceptions thrown by ProcessMessage() itself, such as
+// WrongArgumentTypeException, propagate as usual.
+
+class NothrowOscPacketListener : public PacketListener{
+protected:
+    virtual void ProcessBundle( const osc::ReceivedBundle& b,
+				const IpEndpointName& remoteEndpoint )
+    {
+        // ignore bundle time tag for now
+
+        for( ReceivedBundle::const_iterator i = b.ElementsBegin();
+				i != b.ElementsEnd(); ++i ){
+            ParseStatus status;
+            if( i->IsBundle() ){
+                ReceivedBundle bundle;
+                status = bundle.TryParse( *i );
+                if( status == PARSE_OK )
+                    ProcessBundle( bundle, remoteEndpoint );
+            }else{
+                ReceivedMessage message;
+                status = message.TryParse( *i );
+                if( status == PARSE_OK )
+                    ProcessMessage( message, remoteEndpoint );
+            }
+
+            if( status != PARSE_OK )
+                ProcessMalformedPacket( i->Contents(), i->Size(), remoteEndpoint, status );
+        }
+    }
+
+    virtual void ProcessMessage( const osc::ReceivedMessage& m,
+				const IpEndpointName& remoteEndpoint ) = 0;
+
+    // Called with each malformed packet, or malformed bundle element, and
+    // the reason it was rejected. The default implementation ignores it.
+    virtual void ProcessMalformedPacket( const char *data, int size,
+            const IpEndpointName& remoteEndpoint, ParseStatus status )
+    {
+        (void) data; // suppress unused parameter warnings
+        (void) size;
+        (void) remoteEndpoint;
+        (void) status;
+    }
+
+public:
+	virtual void ProcessPacket( const char *data, int size,
+			const IpEndpointName& remoteEndpoint )
+    {
+        osc::ReceivedPacket p;
+        ParseStatus status = p.TryParse( data, size );
+        if( status == PARSE_OK ){
+            if( p.IsBundle() ){
+                ReceivedBundle bundle;
+                status = bundle.TryParse( p );
+                if( status == PARSE_OK )
+                    ProcessBundle( bundle, remoteEndpoint );
+            }else{
+                ReceivedMessage message;
+                status = message.TryParse( p );
+                if( status == PARSE_OK )
+                    ProcessMessage( message, remoteEndpoint );
+            }
+        }
+
+        if( status != PARSE_OK )
+            ProcessMalformedPacket( data, size, remoteEndpoint, status );
+    }
+};
+
+} // namespace osc
+
+#endif /* INCLUDED_OSCPACK_NOTHROWOSCPACKETLISTENER_H */
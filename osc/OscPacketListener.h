@@ -37,32 +37,78 @@
 #ifndef INCLUDED_OSCPACK_OSCPACKETLISTENER_H
 #define INCLUDED_OSCPACK_OSCPACKETLISTENER_H
 
+#include <vector>
+
 #include "OscReceivedElements.h"
 #include "../ip/PacketListener.h"
+#include "../ip/IpEndpointName.h"
 
 
 namespace osc{
 
 class OscPacketListener : public PacketListener{ 
+    bool trustAllSenders_;
+    std::vector<IpEndpointName> trustedSenders_;
+
 protected:
     virtual void ProcessBundle( const osc::ReceivedBundle& b, 
 				const IpEndpointName& remoteEndpoint )
     {
         // ignore bundle time tag for now
 
+        ArgumentValidation validation = ArgumentValidationFor( remoteEndpoint );
         for( ReceivedBundle::const_iterator i = b.ElementsBegin(); 
 				i != b.ElementsEnd(); ++i ){
             if( i->IsBundle() )
                 ProcessBundle( ReceivedBundle(*i), remoteEndpoint );
             else
-                ProcessMessage( ReceivedMessage(*i), remoteEndpoint );
+                ProcessMessage( ReceivedMessage(*i, validation), remoteEndpoint );
         }
     }
 
     virtual void ProcessMessage( const osc::ReceivedMessage& m, 
 				const IpEndpointName& remoteEndpoint ) = 0;
-    
+
+    // Returns whether packets from remoteEndpoint come from a trusted
+    // sender. The arguments of messages from trusted senders are validated
+    // as they are read rather than up front (see ArgumentValidation in
+    // OscReceivedElements.h), so ProcessMessage() must be prepared for the
+    // argument iterators to throw MalformedMessageException. Override it
+    // to implement another policy.
+    virtual bool IsTrustedSender( const IpEndpointName& remoteEndpoint ) const
+    {
+        if( trustAllSenders_ )
+            return true;
+
+        for( std::vector<IpEndpointName>::const_iterator i = trustedSenders_.begin();
+                i != trustedSenders_.end(); ++i ){
+            if( i->address == remoteEndpoint.address
+                    && ( i->port == IpEndpointName::ANY_PORT || i->port == remoteEndpoint.port ) )
+                return true;
+        }
+
+        return false;
+    }
+
+    ArgumentValidation ArgumentValidationFor( const IpEndpointName& remoteEndpoint ) const
+    {
+        return ( IsTrustedSender( remoteEndpoint ) )
+                ? VALIDATE_ARGUMENTS_ON_ACCESS : VALIDATE_ARGUMENTS_UP_FRONT;
+    }
+
 public:
+    OscPacketListener()
+        : trustAllSenders_( false ) {}
+
+    // Trusts every sender, e.g. when the socket is only reachable from a
+    // private network.
+    void SetTrustAllSenders( bool trustAllSenders ) { trustAllSenders_ = trustAllSenders; }
+
+    // Trusts the sender at endpoint. An endpoint with port ANY_PORT trusts
+    // every port at its address. Not to be called while packets are being
+    // processed.
+    void AddTrustedSender( const IpEndpointName& endpoint ) { trustedSenders_.push_back( endpoint ); }
+
 	virtual void ProcessPacket( const char *data, int size, 
 			const IpEndpointName& remoteEndpoint )
     {
@@ -70,7 +116,7 @@ public:
         if( p.IsBundle() )
             ProcessBundle( ReceivedBundle(p), remoteEndpoint );
         else
-            ProcessMessage( ReceivedMessage(p), remoteEndpoint );
+            ProcessMessage( ReceivedMessage(p, ArgumentValidationFor( remoteEndpoint )), remoteEndpoint );
     }
 };
 
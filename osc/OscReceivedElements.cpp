@@ -37,6 +37,7 @@
 #include "OscReceivedElements.h"
 
 #include "OscHostEndianness.h"
+#include "OscStringScan.h"
 
 #include <cstddef> // ptrdiff_t
 
@@ -45,7 +46,9 @@ namespace osc{
 
 // return the first 4 byte boundary after the end of a str4
 // be careful about calling this version if you don't know whether
-// the string is terminated correctly.
+// the string is terminated correctly. unlike the bounded version in
+// OscStringScan.h it doesn't know where the packet ends, so it can't
+// safely read more than a word at a time.
 static inline const char* FindStr4End( const char *p )
 {
 	if( p[0] == '\0' )    // special case for SuperCollider integer address pattern
@@ -60,29 +63,6 @@ static inline const char* FindStr4End( const char *p )
 }
 
 
-// return the first 4 byte boundary after the end of a str4
-// returns 0 if p == end or if the string is unterminated
-static inline const char* FindStr4End( const char *p, const char *end )
-{
-    if( p >= end )
-        return 0;
-
-	if( p[0] == '\0' )    // special case for SuperCollider integer address pattern
-		return p + 4;
-
-    p += 3;
-    end -= 1;
-
-    while( p < end && *p )
-        p += 4;
-
-    if( *p )
-        return 0;
-    else
-        return p + 1;
-}
-
-
 // round up to the next highest multiple of 4. unless x is already a multiple of 4
 static inline uint32 RoundUp4( uint32 x ) 
 {
@@ -90,91 +70,63 @@ static inline uint32 RoundUp4( uint32 x )
 }
 
 
+// the big endian readers in OscStringScan.h compile to a load and bswap
 static inline int32 ToInt32( const char *p )
 {
-#ifdef OSC_HOST_LITTLE_ENDIAN
-    union{
-        osc::int32 i;
-        char c[4];
-    } u;
-
-    u.c[0] = p[3];
-    u.c[1] = p[2];
-    u.c[2] = p[1];
-    u.c[3] = p[0];
-
-    return u.i;
-#else
-	return *(int32*)p;
-#endif
+    return (int32)ReadBigEndian32( p );
 }
 
 
 static inline uint32 ToUInt32( const char *p )
 {
-#ifdef OSC_HOST_LITTLE_ENDIAN
-    union{
-        osc::uint32 i;
-        char c[4];
-    } u;
-
-    u.c[0] = p[3];
-    u.c[1] = p[2];
-    u.c[2] = p[1];
-    u.c[3] = p[0];
-
-    return u.i;
-#else
-	return *(uint32*)p;
-#endif
+    return ReadBigEndian32( p );
 }
 
 
 static inline int64 ToInt64( const char *p )
 {
-#ifdef OSC_HOST_LITTLE_ENDIAN
-    union{
-        osc::int64 i;
-        char c[8];
-    } u;
-
-    u.c[0] = p[7];
-    u.c[1] = p[6];
-    u.c[2] = p[5];
-    u.c[3] = p[4];
-    u.c[4] = p[3];
-    u.c[5] = p[2];
-    u.c[6] = p[1];
-    u.c[7] = p[0];
-
-    return u.i;
-#else
-	return *(int64*)p;
-#endif
+    return (int64)ReadBigEndian64( p );
 }
 
 
 static inline uint64 ToUInt64( const char *p )
 {
-#ifdef OSC_HOST_LITTLE_ENDIAN
-    union{
-        osc::uint64 i;
-        char c[8];
-    } u;
+    return ReadBigEndian64( p );
+}
 
-    u.c[0] = p[7];
-    u.c[1] = p[6];
-    u.c[2] = p[5];
-    u.c[3] = p[4];
-    u.c[4] = p[3];
-    u.c[5] = p[2];
-    u.c[6] = p[1];
-    u.c[7] = p[0];
-
-    return u.i;
-#else
-	return *(uint64*)p;
-#endif
+//------------------------------------------------------------------------------
+
+const char* ParseStatusString( ParseStatus status )
+{
+    switch( status ){
+        case PARSE_OK: return "ok";
+
+        case PARSE_INVALID_PACKET_SIZE: return "invalid packet size";
+        case PARSE_ZERO_LENGTH_PACKET: return "zero length elements not permitted";
+        case PARSE_PACKET_SIZE_NOT_MULTIPLE_OF_4: return "element size must be multiple of four";
+
+        case PARSE_INVALID_MESSAGE_SIZE: return "invalid message size";
+        case PARSE_ZERO_LENGTH_MESSAGE: return "zero length messages not permitted";
+        case PARSE_MESSAGE_SIZE_NOT_MULTIPLE_OF_4: return "message size must be multiple of four";
+        case PARSE_UNTERMINATED_ADDRESS_PATTERN: return "unterminated address pattern";
+        case PARSE_TYPE_TAGS_NOT_PRESENT: return "type tags not present";
+        case PARSE_UNTERMINATED_TYPE_TAGS: return "type tags were not terminated before end of message";
+        case PARSE_ARGUMENTS_EXCEED_MESSAGE_SIZE: return "arguments exceed message size";
+        case PARSE_UNTERMINATED_STRING_ARGUMENT: return "unterminated string argument";
+        case PARSE_UNKNOWN_TYPE_TAG: return "unknown type tag";
+        case PARSE_UNTERMINATED_ARRAY: return "array was not terminated before end of message (expected ']' end of array tag)";
+
+        case PARSE_INVALID_BUNDLE_SIZE: return "invalid bundle size";
+        case PARSE_BUNDLE_TOO_SHORT: return "packet too short for bundle";
+        case PARSE_BUNDLE_SIZE_NOT_MULTIPLE_OF_4: return "bundle size must be multiple of four";
+        case PARSE_BAD_BUNDLE_ADDRESS_PATTERN: return "bad bundle address pattern";
+        case PARSE_BUNDLE_TOO_SHORT_FOR_ELEMENT_SIZE: return "packet too short for elementSize";
+        case PARSE_BUNDLE_ELEMENT_SIZE_NOT_MULTIPLE_OF_4: return "bundle element size must be multiple of four";
+        case PARSE_BUNDLE_TOO_SHORT_FOR_ELEMENT: return "packet too short for bundle element";
+        case PARSE_BAD_BUNDLE_CONTENTS: return "bundle contents ";
+    }
+
+    return "unknown parse status";
 }
 
 //------------------------------------------------------------------------------
@@ -236,21 +188,7 @@ int32 ReceivedMessageArgument::AsInt32() const
 
 int32 ReceivedMessageArgument::AsInt32Unchecked() const
 {
-#ifdef OSC_HOST_LITTLE_ENDIAN
-    union{
-        osc::int32 i;
-        char c[4];
-    } u;
-
-    u.c[0] = argumentPtr_[3];
-    u.c[1] = argumentPtr_[2];
-    u.c[2] = argumentPtr_[1];
-    u.c[3] = argumentPtr_[0];
-
-    return u.i;
-#else
-	return *(int32*)argumentPtr_;
-#endif
+    return ToInt32( argumentPtr_ );
 }
 
 
@@ -267,21 +205,13 @@ float ReceivedMessageArgument::AsFloat() const
 
 float ReceivedMessageArgument::AsFloatUnchecked() const
 {
-#ifdef OSC_HOST_LITTLE_ENDIAN
     union{
+        uint32 i;
         float f;
-        char c[4];
     } u;
 
-    u.c[0] = argumentPtr_[3];
-    u.c[1] = argumentPtr_[2];
-    u.c[2] = argumentPtr_[1];
-    u.c[3] = argumentPtr_[0];
-
+    u.i = ToUInt32( argumentPtr_ );
     return u.f;
-#else
-	return *(float*)argumentPtr_;
-#endif
 }
 
 
@@ -383,25 +313,13 @@ double ReceivedMessageArgument::AsDouble() const
 
 double ReceivedMessageArgument::AsDoubleUnchecked() const
 {
-#ifdef OSC_HOST_LITTLE_ENDIAN
     union{
+        uint64 i;
         double d;
-        char c[8];
     } u;
 
-    u.c[0] = argumentPtr_[7];
-    u.c[1] = argumentPtr_[6];
-    u.c[2] = argumentPtr_[5];
-    u.c[3] = argumentPtr_[4];
-    u.c[4] = argumentPtr_[3];
-    u.c[5] = argumentPtr_[2];
-    u.c[6] = argumentPtr_[1];
-    u.c[7] = argumentPtr_[0];
-
+    u.i = ToUInt64( argumentPtr_ );
     return u.d;
-#else
-	return *(double*)argumentPtr_;
-#endif
 }
 
 
@@ -484,80 +402,124 @@ std::size_t ReceivedMessageArgument::ComputeArrayItemCount() const
 
 //------------------------------------------------------------------------------
 
-void ReceivedMessageArgumentIterator::Advance()
+void ReceivedMessageArgumentIterator::CheckArgument()
 {
     if( !value_.typeTagPtr_ )
         return;
-        
-    switch( *value_.typeTagPtr_++ ){
-        case '\0':
-            // don't advance past end
-            --value_.typeTagPtr_;
-            break;
-            
-        case TRUE_TYPE_TAG:
-        case FALSE_TYPE_TAG:
-        case NIL_TYPE_TAG:
-        case INFINITUM_TYPE_TAG:
-        
-            // zero length
+
+    const char *argument = value_.argumentPtr_;
+    int tagClass = TypeTagClass( *value_.typeTagPtr_ );
+    if( tagClass >= 0 ){
+        if( tagClass > end_ - argument )
+            throw MalformedMessageException( "arguments exceed message size" );
+        next_ = argument + tagClass;
+        return;
+    }
+
+    switch( tagClass ){
+        case STRING_TYPE_TAG_CLASS:
+            if( argument == end_ )
+                throw MalformedMessageException( "arguments exceed message size" );
+            next_ = FindStr4End( argument, end_ );
+            if( next_ == 0 )
+                throw MalformedMessageException( "unterminated string argument" );
             break;
 
-        case INT32_TYPE_TAG:
-        case FLOAT_TYPE_TAG: 					
-        case CHAR_TYPE_TAG:
-        case RGBA_COLOR_TYPE_TAG:
-        case MIDI_MESSAGE_TYPE_TAG:
+        case BLOB_TYPE_TAG_CLASS:
+            {
+                if( end_ - argument < osc::OSC_SIZEOF_INT32 )
+                    throw MalformedMessageException( "arguments exceed message size" );
 
-            value_.argumentPtr_ += 4;
+                // treat blob size as an unsigned int for the purposes of this calculation
+                uint32 blobSize = ToUInt32( argument );
+                if( blobSize > (uint32)(end_ - argument - osc::OSC_SIZEOF_INT32) )
+                    throw MalformedMessageException( "arguments exceed message size" );
+                next_ = argument + osc::OSC_SIZEOF_INT32 + RoundUp4( blobSize );
+            }
             break;
 
-        case INT64_TYPE_TAG:
-        case TIME_TAG_TYPE_TAG:
-        case DOUBLE_TYPE_TAG:
-				
-            value_.argumentPtr_ += 8;
+        case END_TYPE_TAG_CLASS:
+            next_ = argument;
             break;
 
-        case STRING_TYPE_TAG: 
-        case SYMBOL_TYPE_TAG:
+        default:
+            throw MalformedMessageException( "unknown type tag" );
+    }
+}
+
+
+void ReceivedMessageArgumentIterator::Advance()
+{
+    if( !value_.typeTagPtr_ )
+        return;
+
+    if( end_ ){
+        // the current argument was checked when the iterator reached it
+        if( *value_.typeTagPtr_ == '\0' )
+            return; // don't advance past end
+
+        value_.argumentPtr_ = next_;
+        ++value_.typeTagPtr_;
+
+        int tagClass = TypeTagClass( *value_.typeTagPtr_ );
+        if( tagClass >= 0 && tagClass <= end_ - next_ )
+            next_ += tagClass; // fixed size argument that fits
+        else
+            CheckArgument();
+        return;
+    }
+
+    int tagClass = TypeTagClass( *value_.typeTagPtr_ );
+    if( tagClass >= 0 ){
+        // fixed size, zero for the array markers and the other tags
+        // without argument data
+        value_.argumentPtr_ += tagClass;
+        ++value_.typeTagPtr_;
+        return;
+    }
+
+    switch( tagClass ){
+        case STRING_TYPE_TAG_CLASS:
 
             // we use the unsafe function FindStr4End(char*) here because all of
             // the arguments have already been validated in
             // ReceivedMessage::Init() below.
-            
+
             value_.argumentPtr_ = FindStr4End( value_.argumentPtr_ );
+            ++value_.typeTagPtr_;
             break;
 
-        case BLOB_TYPE_TAG:
+        case BLOB_TYPE_TAG_CLASS:
             {
                 // treat blob size as an unsigned int for the purposes of this calculation
                 uint32 blobSize = ToUInt32( value_.argumentPtr_ );
                 value_.argumentPtr_ = value_.argumentPtr_ + osc::OSC_SIZEOF_INT32 + RoundUp4( blobSize );
+                ++value_.typeTagPtr_;
             }
             break;
 
-        case ARRAY_BEGIN_TYPE_TAG:
-        case ARRAY_END_TYPE_TAG: 
-
-            //    [ Indicates the beginning of an array. The tags following are for
-            //        data in the Array until a close brace tag is reached.
-            //    ] Indicates the end of an array.
-
-            // zero length, don't advance argument ptr
-            break;
-
-        default:    // unknown type tag
+        default:    // end of the type tags, or unknown type tag
             // don't advance
-            --value_.typeTagPtr_;
             break;
     }
 }
 
 //------------------------------------------------------------------------------
 
+static inline uint32 ArgumentOffsetsCapacity( uint32 *argumentOffsets, std::size_t capacity )
+{
+    if( !argumentOffsets )
+        return 0;
+    return ( capacity > OSC_INT32_MAX ) ? (uint32)OSC_INT32_MAX : (uint32)capacity;
+}
+
+
 ReceivedMessage::ReceivedMessage( const ReceivedPacket& packet )
     : addressPattern_( packet.Contents() )
+    , uncheckedArgumentsEnd_( 0 )
+    , argumentOffsets_( 0 )
+    , argumentOffsetsCapacity_( INLINE_ARGUMENT_INDEX_SIZE )
+    , indexedArgumentCount_( 0 )
 {
     Init( packet.Contents(), packet.Size() );
 }
@@ -565,11 +527,113 @@ ReceivedMessage::ReceivedMessage( const ReceivedPacket& packet )
 
 ReceivedMessage::ReceivedMessage( const ReceivedBundleElement& bundleElement )
     : addressPattern_( bundleElement.Contents() )
+    , uncheckedArgumentsEnd_( 0 )
+    , argumentOffsets_( 0 )
+    , argumentOffsetsCapacity_( INLINE_ARGUMENT_INDEX_SIZE )
+    , indexedArgumentCount_( 0 )
 {
     Init( bundleElement.Contents(), bundleElement.Size() );
 }
 
 
+ReceivedMessage::ReceivedMessage( const ReceivedPacket& packet,
+        uint32 *argumentOffsets, std::size_t argumentOffsetsCapacity )
+    : addressPattern_( packet.Contents() )
+    , uncheckedArgumentsEnd_( 0 )
+    , argumentOffsets_( argumentOffsets )
+    , argumentOffsetsCapacity_( ArgumentOffsetsCapacity( argumentOffsets, argumentOffsetsCapacity ) )
+    , indexedArgumentCount_( 0 )
+{
+    Init( packet.Contents(), packet.Size() );
+}
+
+
+ReceivedMessage::ReceivedMessage( const ReceivedBundleElement& bundleElement,
+        uint32 *argumentOffsets, std::size_t argumentOffsetsCapacity )
+    : addressPattern_( bundleElement.Contents() )
+    , uncheckedArgumentsEnd_( 0 )
+    , argumentOffsets_( argumentOffsets )
+    , argumentOffsetsCapacity_( ArgumentOffsetsCapacity( argumentOffsets, argumentOffsetsCapacity ) )
+    , indexedArgumentCount_( 0 )
+{
+    Init( bundleElement.Contents(), bundleElement.Size() );
+}
+
+
+ReceivedMessage::ReceivedMessage( const ReceivedPacket& packet, ArgumentValidation validation )
+    : addressPattern_( packet.Contents() )
+    , uncheckedArgumentsEnd_( ( validation == VALIDATE_ARGUMENTS_ON_ACCESS )
+            ? packet.Contents() + packet.Size() : 0 )
+    , argumentOffsets_( 0 )
+    , argumentOffsetsCapacity_( INLINE_ARGUMENT_INDEX_SIZE )
+    , indexedArgumentCount_( 0 )
+{
+    Init( packet.Contents(), packet.Size() );
+}
+
+
+ReceivedMessage::ReceivedMessage( const ReceivedBundleElement& bundleElement, ArgumentValidation validation )
+    : addressPattern_( bundleElement.Contents() )
+    , uncheckedArgumentsEnd_( ( validation == VALIDATE_ARGUMENTS_ON_ACCESS )
+            ? bundleElement.Contents() + bundleElement.Size() : 0 )
+    , argumentOffsets_( 0 )
+    , argumentOffsetsCapacity_( INLINE_ARGUMENT_INDEX_SIZE )
+    , indexedArgumentCount_( 0 )
+{
+    Init( bundleElement.Contents(), bundleElement.Size() );
+}
+
+
+ReceivedMessage::ReceivedMessage()
+    : addressPattern_( 0 )
+    , typeTagsBegin_( 0 )
+    , typeTagsEnd_( 0 )
+    , arguments_( 0 )
+    , uncheckedArgumentsEnd_( 0 )
+    , argumentOffsets_( 0 )
+    , argumentOffsetsCapacity_( INLINE_ARGUMENT_INDEX_SIZE )
+    , indexedArgumentCount_( 0 )
+{
+}
+
+
+ReceivedMessage::ReceivedMessage( uint32 *argumentOffsets, std::size_t argumentOffsetsCapacity )
+    : addressPattern_( 0 )
+    , typeTagsBegin_( 0 )
+    , typeTagsEnd_( 0 )
+    , arguments_( 0 )
+    , uncheckedArgumentsEnd_( 0 )
+    , argumentOffsets_( argumentOffsets )
+    , argumentOffsetsCapacity_( ArgumentOffsetsCapacity( argumentOffsets, argumentOffsetsCapacity ) )
+    , indexedArgumentCount_( 0 )
+{
+}
+
+
+ReceivedMessageArgument ReceivedMessage::Argument( uint32 i ) const
+{
+    if( i >= ArgumentCount() )
+        throw MissingArgumentException();
+
+    const uint32 *offsets = ArgumentOffsets();
+    if( i < indexedArgumentCount_ )
+        return ReceivedMessageArgument( typeTagsBegin_ + i, arguments_ + offsets[i] );
+
+    // step over the arguments after the last indexed one
+    uint32 j = 0;
+    ReceivedMessageArgumentIterator k = ArgumentsBegin();
+    if( indexedArgumentCount_ > 0 ){
+        j = indexedArgumentCount_ - 1;
+        k = ReceivedMessageArgumentIterator( typeTagsBegin_ + j, arguments_ + offsets[j] );
+    }
+
+    for( ; j < i; ++j )
+        ++k;
+
+    return *k;
+}
+
+
 bool ReceivedMessage::AddressPatternIsUInt32() const
 {
 	return (addressPattern_[0] == '\0');
@@ -584,21 +648,50 @@ uint32 ReceivedMessage::AddressPatternAsUInt32() const
 
 void ReceivedMessage::Init( const char *message, osc_bundle_element_size_t size )
 {
+    ParseStatus status = Parse( message, size );
+    if( status != PARSE_OK )
+        throw MalformedMessageException( ParseStatusString( status ) );
+}
+
+
+ParseStatus ReceivedMessage::TryParse( const char *message, osc_bundle_element_size_t size )
+{
+    addressPattern_ = message;
+    uncheckedArgumentsEnd_ = 0;
+
+    ParseStatus status = Parse( message, size );
+    if( status != PARSE_OK ){
+        addressPattern_ = 0;
+        typeTagsBegin_ = 0;
+        typeTagsEnd_ = 0;
+        arguments_ = 0;
+        indexedArgumentCount_ = 0;
+    }
+    return status;
+}
+
+
+ParseStatus ReceivedMessage::Parse( const char *message, osc_bundle_element_size_t size )
+{
+    // a reused message mustn't keep the type tags or index of the last one
+    typeTagsEnd_ = 0;
+    indexedArgumentCount_ = 0;
+
     if( !IsValidElementSizeValue(size) )
-        throw MalformedMessageException( "invalid message size" );
+        return PARSE_INVALID_MESSAGE_SIZE;
 
     if( size == 0 )
-        throw MalformedMessageException( "zero length messages not permitted" );
+        return PARSE_ZERO_LENGTH_MESSAGE;
 
     if( !IsMultipleOf4(size) )
-        throw MalformedMessageException( "message size must be multiple of four" );
+        return PARSE_MESSAGE_SIZE_NOT_MULTIPLE_OF_4;
 
     const char *end = message + size;
 
     typeTagsBegin_ = FindStr4End( addressPattern_, end );
     if( typeTagsBegin_ == 0 ){
         // address pattern was not terminated before end
-        throw MalformedMessageException( "unterminated address pattern" );
+        return PARSE_UNTERMINATED_ADDRESS_PATTERN;
     }
 
     if( typeTagsBegin_ == end ){
@@ -609,7 +702,7 @@ void ReceivedMessage::Init( const char *message, osc_bundle_element_size_t size
             
     }else{
         if( *typeTagsBegin_ != ',' )
-            throw MalformedMessageException( "type tags not present" );
+            return PARSE_TYPE_TAGS_NOT_PRESENT;
 
         if( *(typeTagsBegin_ + 1) == '\0' ){
             // zero length type tags
@@ -622,93 +715,108 @@ void ReceivedMessage::Init( const char *message, osc_bundle_element_size_t size
                 
             arguments_ = FindStr4End( typeTagsBegin_, end );
             if( arguments_ == 0 ){
-                throw MalformedMessageException( "type tags were not terminated before end of message" );
+                return PARSE_UNTERMINATED_TYPE_TAGS;
             }
 
             ++typeTagsBegin_; // advance past initial ','
-            
+
+            if( uncheckedArgumentsEnd_ ){
+                // the type tags were terminated before arguments_, the
+                // arguments are checked by the argument iterator
+                typeTagsEnd_ = typeTagsBegin_ + std::strlen( typeTagsBegin_ );
+                return PARSE_OK;
+            }
+
             const char *typeTag = typeTagsBegin_;
             const char *argument = arguments_;
+            std::size_t fixedSizeBytes = 0;
             unsigned int arrayLevel = 0;
-                        
-            do{
-                switch( *typeTag ){
-                    case TRUE_TYPE_TAG:
-                    case FALSE_TYPE_TAG:
-                    case NIL_TYPE_TAG:
-                    case INFINITUM_TYPE_TAG:
-                        // zero length
-                        break;
 
-                    //    [ Indicates the beginning of an array. The tags following are for
-                    //        data in the Array until a close brace tag is reached.
-                    //    ] Indicates the end of an array.
-                    case ARRAY_BEGIN_TYPE_TAG:
-                        ++arrayLevel;
-                        // (zero length argument data)
-                        break;
+            // the offsets of the first argumentOffsetsCapacity_ arguments
+            // are recorded in the argument index as they are validated
+            uint32 *offsets = ( argumentOffsets_ ) ? argumentOffsets_ : inlineArgumentOffsets_;
+
+            const char *fixedSizeRunBegin = typeTag;
+
+            for(;;){
+                int tagClass = TypeTagClass( *typeTag );
+                std::size_t index = (std::size_t)(typeTag - typeTagsBegin_);
+
+                if( tagClass >= 0 ){
+                    // the sizes of a run of fixed size arguments are added
+                    // up and checked against the end of the message
+                    // together. once a run past the indexed arguments is a
+                    // few tags long the rest of it is classified in bulk.
+                    if( index >= argumentOffsetsCapacity_ && typeTag - fixedSizeRunBegin >= 2
+                            && arguments_ - typeTag >= 16 ){
+                        typeTag = SkipFixedSizeTypeTags( typeTag, arguments_, fixedSizeBytes, arrayLevel );
+                    }else{
+                        if( index < argumentOffsetsCapacity_ )
+                            offsets[ index ] = (uint32)( (argument - arguments_) + fixedSizeBytes );
+
+                        //    [ Indicates the beginning of an array. The tags following are for
+                        //        data in the Array until a close brace tag is reached.
+                        //    ] Indicates the end of an array.
+                        if( *typeTag == ARRAY_BEGIN_TYPE_TAG )
+                            ++arrayLevel;
+                        else if( *typeTag == ARRAY_END_TYPE_TAG )
+                            --arrayLevel;
+
+                        fixedSizeBytes += tagClass;
+                        ++typeTag;
+                    }
+                    continue;
+                }
 
-                    case ARRAY_END_TYPE_TAG:
-                        --arrayLevel;
-                        // (zero length argument data)
-                        break;
+                if( fixedSizeBytes > (std::size_t)(end - argument) )
+                    return PARSE_ARGUMENTS_EXCEED_MESSAGE_SIZE;
+                argument += fixedSizeBytes;
+                fixedSizeBytes = 0;
 
-                    case INT32_TYPE_TAG:
-                    case FLOAT_TYPE_TAG:
-                    case CHAR_TYPE_TAG:
-                    case RGBA_COLOR_TYPE_TAG:
-                    case MIDI_MESSAGE_TYPE_TAG:
+                if( tagClass == END_TYPE_TAG_CLASS )
+                    break;
 
-                        if( argument == end )
-                            throw MalformedMessageException( "arguments exceed message size" );
-                        argument += 4;
-                        if( argument > end )
-                            throw MalformedMessageException( "arguments exceed message size" );
-                        break;
+                fixedSizeRunBegin = typeTag + 1;
 
-                    case INT64_TYPE_TAG:
-                    case TIME_TAG_TYPE_TAG:
-                    case DOUBLE_TYPE_TAG:
+                if( index < argumentOffsetsCapacity_ )
+                    offsets[ index ] = (uint32)(argument - arguments_);
 
-                        if( argument == end )
-                            throw MalformedMessageException( "arguments exceed message size" );
-                        argument += 8;
-                        if( argument > end )
-                            throw MalformedMessageException( "arguments exceed message size" );
-                        break;
+                switch( tagClass ){
+                    case STRING_TYPE_TAG_CLASS:
 
-                    case STRING_TYPE_TAG: 
-                    case SYMBOL_TYPE_TAG:
-                    
                         if( argument == end )
-                            throw MalformedMessageException( "arguments exceed message size" );
+                            return PARSE_ARGUMENTS_EXCEED_MESSAGE_SIZE;
                         argument = FindStr4End( argument, end );
                         if( argument == 0 )
-                            throw MalformedMessageException( "unterminated string argument" );
+                            return PARSE_UNTERMINATED_STRING_ARGUMENT;
                         break;
 
-                    case BLOB_TYPE_TAG:
+                    case BLOB_TYPE_TAG_CLASS:
                         {
-                            if( argument + osc::OSC_SIZEOF_INT32 > end )
-                                MalformedMessageException( "arguments exceed message size" );
-                                
+                            if( end - argument < osc::OSC_SIZEOF_INT32 )
+                                return PARSE_ARGUMENTS_EXCEED_MESSAGE_SIZE;
+
                             // treat blob size as an unsigned int for the purposes of this calculation
                             uint32 blobSize = ToUInt32( argument );
-                            argument = argument + osc::OSC_SIZEOF_INT32 + RoundUp4( blobSize );
-                            if( argument > end )
-                                MalformedMessageException( "arguments exceed message size" );
+                            argument += osc::OSC_SIZEOF_INT32;
+                            if( blobSize > (uint32)(end - argument) )
+                                return PARSE_ARGUMENTS_EXCEED_MESSAGE_SIZE;
+                            argument += RoundUp4( blobSize );
                         }
                         break;
-                        
+
                     default:
-                        throw MalformedMessageException( "unknown type tag" );
+                        return PARSE_UNKNOWN_TYPE_TAG;
                 }
 
-            }while( *++typeTag != '\0' );
+                ++typeTag;
+            }
             typeTagsEnd_ = typeTag;
+            indexedArgumentCount_ = ( typeTagsEnd_ - typeTagsBegin_ < (std::ptrdiff_t)argumentOffsetsCapacity_ )
+                    ? (uint32)(typeTagsEnd_ - typeTagsBegin_) : argumentOffsetsCapacity_;
 
             if( arrayLevel !=  0 )
-                throw MalformedMessageException( "array was not terminated before end of message (expected ']' end of array tag)" );
+                return PARSE_UNTERMINATED_ARRAY;
         }
 
         // These invariants should be guaranteed by the above code.
@@ -719,6 +827,8 @@ void ReceivedMessage::Init( const char *message, osc_bundle_element_size_t size
         assert( argumentCount <= OSC_INT32_MAX );
 #endif
     }
+
+    return PARSE_OK;
 }
 
 //------------------------------------------------------------------------------
@@ -737,17 +847,50 @@ ReceivedBundle::ReceivedBundle( const ReceivedBundleElement& bundleElement )
 }
 
 
+// the time tag of an empty bundle, so that its elements iterators are equal
+static const char emptyBundleTimeTag_[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+
+
+ReceivedBundle::ReceivedBundle()
+    : timeTag_( emptyBundleTimeTag_ )
+    , end_( emptyBundleTimeTag_ + 8 )
+    , elementCount_( 0 )
+{
+}
+
+
 void ReceivedBundle::Init( const char *bundle, osc_bundle_element_size_t size )
 {
+    ParseStatus status = Parse( bundle, size );
+    if( status != PARSE_OK )
+        throw MalformedBundleException( ParseStatusString( status ) );
+}
+
+
+ParseStatus ReceivedBundle::TryParse( const char *bundle, osc_bundle_element_size_t size )
+{
+    elementCount_ = 0;
+
+    ParseStatus status = Parse( bundle, size );
+    if( status != PARSE_OK ){
+        timeTag_ = emptyBundleTimeTag_;
+        end_ = emptyBundleTimeTag_ + 8;
+        elementCount_ = 0;
+    }
+    return status;
+}
+
 
+ParseStatus ReceivedBundle::Parse( const char *bundle, osc_bundle_element_size_t size )
+{
     if( !IsValidElementSizeValue(size) )
-        throw MalformedBundleException( "invalid bundle size" );
+        return PARSE_INVALID_BUNDLE_SIZE;
 
     if( size < 16 )
-        throw MalformedBundleException( "packet too short for bundle" );
+        return PARSE_BUNDLE_TOO_SHORT;
 
     if( !IsMultipleOf4(size) )
-        throw MalformedBundleException( "bundle size must be multiple of four" );
+        return PARSE_BUNDLE_SIZE_NOT_MULTIPLE_OF_4;
 
     if( bundle[0] != '#'
         || bundle[1] != 'b'
@@ -757,7 +900,7 @@ void ReceivedBundle::Init( const char *bundle, osc_bundle_element_size_t size )
         || bundle[5] != 'l'
         || bundle[6] != 'e'
         || bundle[7] != '\0' )
-            throw MalformedBundleException( "bad bundle address pattern" );    
+            return PARSE_BAD_BUNDLE_ADDRESS_PATTERN;    
 
     end_ = bundle + size;
 
@@ -767,22 +910,24 @@ void ReceivedBundle::Init( const char *bundle, osc_bundle_element_size_t size )
         
     while( p < end_ ){
         if( p + osc::OSC_SIZEOF_INT32 > end_ )
-            throw MalformedBundleException( "packet too short for elementSize" );
+            return PARSE_BUNDLE_TOO_SHORT_FOR_ELEMENT_SIZE;
 
         // treat element size as an unsigned int for the purposes of this calculation
         uint32 elementSize = ToUInt32( p );
         if( (elementSize & ((uint32)0x03)) != 0 )
-            throw MalformedBundleException( "bundle element size must be multiple of four" );
+            return PARSE_BUNDLE_ELEMENT_SIZE_NOT_MULTIPLE_OF_4;
 
         p += osc::OSC_SIZEOF_INT32 + elementSize;
         if( p > end_ )
-            throw MalformedBundleException( "packet too short for bundle element" );
+            return PARSE_BUNDLE_TOO_SHORT_FOR_ELEMENT;
 
         ++elementCount_;
     }
 
     if( p != end_ )
-        throw MalformedBundleException( "bundle contents " );
+        return PARSE_BAD_BUNDLE_CONTENTS;
+
+    return PARSE_OK;
 }
 
 
@@ -40,6 +40,7 @@
 #include <cassert>
 #include <cstddef>
 #include <cstring> // size_t
+#include <iterator>
 
 #include "OscTypes.h"
 #include "OscException.h"
@@ -85,8 +86,48 @@ public:
 };
 
 
+// The result of the non-throwing TryParse() methods below. Each failure
+// corresponds to the MalformedPacketException, MalformedMessageException
+// or MalformedBundleException the constructors would throw, and
+// ParseStatusString() returns the same description.
+enum ParseStatus{
+    PARSE_OK = 0,
+
+    PARSE_INVALID_PACKET_SIZE,
+    PARSE_ZERO_LENGTH_PACKET,
+    PARSE_PACKET_SIZE_NOT_MULTIPLE_OF_4,
+
+    PARSE_INVALID_MESSAGE_SIZE,
+    PARSE_ZERO_LENGTH_MESSAGE,
+    PARSE_MESSAGE_SIZE_NOT_MULTIPLE_OF_4,
+    PARSE_UNTERMINATED_ADDRESS_PATTERN,
+    PARSE_TYPE_TAGS_NOT_PRESENT,
+    PARSE_UNTERMINATED_TYPE_TAGS,
+    PARSE_ARGUMENTS_EXCEED_MESSAGE_SIZE,
+    PARSE_UNTERMINATED_STRING_ARGUMENT,
+    PARSE_UNKNOWN_TYPE_TAG,
+    PARSE_UNTERMINATED_ARRAY,
+
+    PARSE_INVALID_BUNDLE_SIZE,
+    PARSE_BUNDLE_TOO_SHORT,
+    PARSE_BUNDLE_SIZE_NOT_MULTIPLE_OF_4,
+    PARSE_BAD_BUNDLE_ADDRESS_PATTERN,
+    PARSE_BUNDLE_TOO_SHORT_FOR_ELEMENT_SIZE,
+    PARSE_BUNDLE_ELEMENT_SIZE_NOT_MULTIPLE_OF_4,
+    PARSE_BUNDLE_TOO_SHORT_FOR_ELEMENT,
+    PARSE_BAD_BUNDLE_CONTENTS
+};
+
+const char* ParseStatusString( ParseStatus status );
+
+
 class ReceivedPacket{
 public:
+    // an empty packet, to be filled in by TryParse()
+    ReceivedPacket()
+        : contents_( 0 )
+        , size_( 0 ) {}
+
     // Although the OSC spec is not entirely clear on this, we only support
     // packets up to 0x7FFFFFFC bytes long (the maximum 4-byte aligned value
     // representable by an int32). An exception will be raised if you pass a 
@@ -106,6 +147,16 @@ public:
         , size_( ValidateSize( (osc_bundle_element_size_t)size ) ) {}
 #endif
 
+    // Checks size as the constructors do, returning the result rather
+    // than throwing. The packet is empty unless the result is PARSE_OK.
+    ParseStatus TryParse( const char *contents, osc_bundle_element_size_t size )
+    {
+        ParseStatus status = CheckSize( size );
+        contents_ = ( status == PARSE_OK ) ? contents : 0;
+        size_ = ( status == PARSE_OK ) ? size : 0;
+        return status;
+    }
+
     bool IsMessage() const { return !IsBundle(); }
     bool IsBundle() const;
 
@@ -116,6 +167,20 @@ private:
     const char *contents_;
     osc_bundle_element_size_t size_;
 
+    static ParseStatus CheckSize( osc_bundle_element_size_t size )
+    {
+        if( !IsValidElementSizeValue(size) )
+            return PARSE_INVALID_PACKET_SIZE;
+
+        if( size == 0 )
+            return PARSE_ZERO_LENGTH_PACKET;
+
+        if( !IsMultipleOf4(size) )
+            return PARSE_PACKET_SIZE_NOT_MULTIPLE_OF_4;
+
+        return PARSE_OK;
+    }
+
     static osc_bundle_element_size_t ValidateSize( osc_bundle_element_size_t size )
     {
         // sanity check integer types declared in OscTypes.h 
@@ -125,14 +190,9 @@ private:
         assert( sizeof(osc::int64) == 8 );
         assert( sizeof(osc::uint64) == 8 );
 
-        if( !IsValidElementSizeValue(size) )
-            throw MalformedPacketException( "invalid packet size" );
-
-        if( size == 0 )
-            throw MalformedPacketException( "zero length elements not permitted" );
-
-        if( !IsMultipleOf4(size) )
-            throw MalformedPacketException( "element size must be multiple of four" );
+        ParseStatus status = CheckSize( size );
+        if( status != PARSE_OK )
+            throw MalformedPacketException( ParseStatusString( status ) );
 
         return size;
     }
@@ -278,6 +338,11 @@ public:
     // Only valid at array start. Will throw an exception if IsArrayStart() == false.
     std::size_t ComputeArrayItemCount() const;
 
+    // Where the argument's type tag and data are in the message, for
+    // decoders that read them directly, such as ArrayView.
+    const char* TypeTagPointer() const { return typeTagPtr_; }
+    const char* ArgumentData() const { return argumentPtr_; }
+
 private:
 	const char *typeTagPtr_;
 	const char *argumentPtr_;
@@ -287,7 +352,21 @@ private:
 class ReceivedMessageArgumentIterator{
 public:
 	ReceivedMessageArgumentIterator( const char *typeTags, const char *arguments )
-        : value_( typeTags, arguments ) {}
+        : value_( typeTags, arguments )
+        , end_( 0 )
+        , next_( 0 ) {}
+
+    // An iterator over arguments that haven't been validated. Each one is
+    // checked to be well formed and to end before end when the iterator
+    // reaches it, and MalformedMessageException is thrown if it isn't.
+	ReceivedMessageArgumentIterator( const char *typeTags, const char *arguments, const char *end )
+        : value_( typeTags, arguments )
+        , end_( end )
+        , next_( 0 )
+    {
+        if( end_ )
+            CheckArgument();
+    }
 
 	ReceivedMessageArgumentIterator operator++()
 	{
@@ -311,8 +390,11 @@ public:
 
 private:
 	ReceivedMessageArgument value_;
+    const char *end_;   // 0 if the arguments have already been validated
+    const char *next_;  // the checked end of the current argument, if end_
 
 	void Advance();
+    void CheckArgument();
 
     bool IsEqualTo( const ReceivedMessageArgumentIterator& rhs ) const
     {
@@ -471,12 +553,168 @@ public:
 };
 
 
+class ReceivedMessage;
+
+
+// How a ReceivedMessage checks that its arguments are well formed.
+enum ArgumentValidation{
+    // the constructor checks every argument, so any malformed message is
+    // rejected before it reaches the application
+    VALIDATE_ARGUMENTS_UP_FRONT,
+
+    // the constructor only checks the message size, address pattern and
+    // type tags. each argument is checked as an argument iterator reaches
+    // it, so a malformed argument throws MalformedMessageException from
+    // the iterator instead. intended for trusted senders: the arguments
+    // that are never read cost nothing, but a handler may have acted on
+    // earlier arguments before the error is found. unbalanced array type
+    // tags are not reported.
+    VALIDATE_ARGUMENTS_ON_ACCESS
+};
+
+
+// A random access iterator over the arguments of a message, by position.
+// Dereferencing takes constant time for arguments covered by the message's
+// argument index (see ReceivedMessage::Argument()).
+class ReceivedMessageIndexedArgumentIterator{
+public:
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef ReceivedMessageArgument value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const ReceivedMessageArgument* pointer;
+    typedef ReceivedMessageArgument reference;
+
+    ReceivedMessageIndexedArgumentIterator()
+        : message_( 0 ), index_( 0 ) {}
+
+    ReceivedMessageIndexedArgumentIterator( const ReceivedMessage *message, uint32 index )
+        : message_( message ), index_( index ) {}
+
+    inline ReceivedMessageArgument operator*() const;
+    inline ReceivedMessageArgument operator[]( difference_type n ) const;
+
+    // allows i->AsFloat() etc. on the argument returned by value
+    class ArgumentPointer{
+        friend class ReceivedMessageIndexedArgumentIterator;
+        explicit ArgumentPointer( const ReceivedMessageArgument& value ) : value_( value ) {}
+        ReceivedMessageArgument value_;
+    public:
+        const ReceivedMessageArgument* operator->() const { return &value_; }
+    };
+
+    ArgumentPointer operator->() const { return ArgumentPointer( **this ); }
+
+    ReceivedMessageIndexedArgumentIterator& operator++() { ++index_; return *this; }
+    ReceivedMessageIndexedArgumentIterator& operator--() { --index_; return *this; }
+
+    ReceivedMessageIndexedArgumentIterator operator++(int)
+    {
+        ReceivedMessageIndexedArgumentIterator old( *this );
+        ++index_;
+        return old;
+    }
+
+    ReceivedMessageIndexedArgumentIterator operator--(int)
+    {
+        ReceivedMessageIndexedArgumentIterator old( *this );
+        --index_;
+        return old;
+    }
+
+    ReceivedMessageIndexedArgumentIterator& operator+=( difference_type n ) { index_ += (uint32)n; return *this; }
+    ReceivedMessageIndexedArgumentIterator& operator-=( difference_type n ) { index_ -= (uint32)n; return *this; }
+
+    ReceivedMessageIndexedArgumentIterator operator+( difference_type n ) const
+    {
+        return ReceivedMessageIndexedArgumentIterator( message_, index_ + (uint32)n );
+    }
+
+    ReceivedMessageIndexedArgumentIterator operator-( difference_type n ) const
+    {
+        return ReceivedMessageIndexedArgumentIterator( message_, index_ - (uint32)n );
+    }
+
+    difference_type operator-( const ReceivedMessageIndexedArgumentIterator& rhs ) const
+    {
+        return (difference_type)index_ - (difference_type)rhs.index_;
+    }
+
+    // the position of the argument in the message
+    uint32 Index() const { return index_; }
+
+    friend bool operator==( const ReceivedMessageIndexedArgumentIterator& lhs,
+            const ReceivedMessageIndexedArgumentIterator& rhs )
+        { return lhs.index_ == rhs.index_; }
+    friend bool operator!=( const ReceivedMessageIndexedArgumentIterator& lhs,
+            const ReceivedMessageIndexedArgumentIterator& rhs )
+        { return lhs.index_ != rhs.index_; }
+    friend bool operator<( const ReceivedMessageIndexedArgumentIterator& lhs,
+            const ReceivedMessageIndexedArgumentIterator& rhs )
+        { return lhs.index_ < rhs.index_; }
+    friend bool operator>( const ReceivedMessageIndexedArgumentIterator& lhs,
+            const ReceivedMessageIndexedArgumentIterator& rhs )
+        { return lhs.index_ > rhs.index_; }
+    friend bool operator<=( const ReceivedMessageIndexedArgumentIterator& lhs,
+            const ReceivedMessageIndexedArgumentIterator& rhs )
+        { return lhs.index_ <= rhs.index_; }
+    friend bool operator>=( const ReceivedMessageIndexedArgumentIterator& lhs,
+            const ReceivedMessageIndexedArgumentIterator& rhs )
+        { return lhs.index_ >= rhs.index_; }
+
+private:
+    const ReceivedMessage *message_;
+    uint32 index_;
+};
+
+inline ReceivedMessageIndexedArgumentIterator operator+(
+        ReceivedMessageIndexedArgumentIterator::difference_type n,
+        const ReceivedMessageIndexedArgumentIterator& i )
+{
+    return i + n;
+}
+
+
 class ReceivedMessage{
     void Init( const char *bundle, osc_bundle_element_size_t size );
+    ParseStatus Parse( const char *message, osc_bundle_element_size_t size );
 public:
     explicit ReceivedMessage( const ReceivedPacket& packet );
     explicit ReceivedMessage( const ReceivedBundleElement& bundleElement );
 
+    // While the message is validated the offset of each argument is
+    // recorded in an argument index, so that Argument() can find it in
+    // constant time. By default the first INLINE_ARGUMENT_INDEX_SIZE
+    // arguments are indexed, in storage inside the message. These
+    // constructors index up to argumentOffsetsCapacity arguments in
+    // argumentOffsets instead, which must stay valid for the lifetime of
+    // the message (and of any copies of it). Passing 0 builds no index.
+    ReceivedMessage( const ReceivedPacket& packet,
+            uint32 *argumentOffsets, std::size_t argumentOffsetsCapacity );
+    ReceivedMessage( const ReceivedBundleElement& bundleElement,
+            uint32 *argumentOffsets, std::size_t argumentOffsetsCapacity );
+
+    // With VALIDATE_ARGUMENTS_ON_ACCESS no argument index is built.
+    ReceivedMessage( const ReceivedPacket& packet, ArgumentValidation validation );
+    ReceivedMessage( const ReceivedBundleElement& bundleElement, ArgumentValidation validation );
+
+    // An empty message, to be filled in by TryParse(). The arguments are
+    // indexed as by the first constructors above, or in argumentOffsets.
+    ReceivedMessage();
+    ReceivedMessage( uint32 *argumentOffsets, std::size_t argumentOffsetsCapacity );
+
+    // Parses and validates a message without throwing: instead of throwing
+    // MalformedMessageException these return a status other than PARSE_OK,
+    // and leave the message with no address pattern and no arguments. The
+    // arguments are always validated up front, so iterating over them
+    // doesn't throw either.
+    ParseStatus TryParse( const char *message, osc_bundle_element_size_t size );
+    ParseStatus TryParse( const ReceivedPacket& packet )
+        { return TryParse( packet.Contents(), packet.Size() ); }
+    ParseStatus TryParse( const ReceivedBundleElement& bundleElement )
+        { return TryParse( bundleElement.Contents(), bundleElement.Size() ); }
+
+    enum { INLINE_ARGUMENT_INDEX_SIZE = 8 };
+
 	const char *AddressPattern() const { return addressPattern_; }
 
 	// Support for non-standard SuperCollider integer address patterns:
@@ -492,7 +730,7 @@ public:
     
 	ReceivedMessageArgumentIterator ArgumentsBegin() const
     {
-        return ReceivedMessageArgumentIterator( typeTagsBegin_, arguments_ );
+        return ReceivedMessageArgumentIterator( typeTagsBegin_, arguments_, uncheckedArgumentsEnd_ );
     }
      
 	ReceivedMessageArgumentIterator ArgumentsEnd() const
@@ -505,20 +743,85 @@ public:
         return ReceivedMessageArgumentStream( ArgumentsBegin(), ArgumentsEnd() );
     }
 
+    // The argument data following the type tags, for decoders that read
+    // it directly, such as TypedMessage. If the arguments are validated on
+    // access UncheckedArgumentsEnd() returns the end of the message,
+    // otherwise 0.
+    const char *ArgumentData() const { return arguments_; }
+    const char *UncheckedArgumentsEnd() const { return uncheckedArgumentsEnd_; }
+
+    // Returns argument i, counting array markers as ArgumentCount() does.
+    // Takes constant time when i < IndexedArgumentCount(), otherwise the
+    // arguments after the last indexed one are stepped over. Throws
+    // MissingArgumentException if i >= ArgumentCount().
+    ReceivedMessageArgument Argument( uint32 i ) const;
+
+    // The number of leading arguments covered by the argument index
+    uint32 IndexedArgumentCount() const { return indexedArgumentCount_; }
+
+    typedef ReceivedMessageIndexedArgumentIterator const_indexed_iterator;
+
+    ReceivedMessageIndexedArgumentIterator IndexedArgumentsBegin() const
+    {
+        return ReceivedMessageIndexedArgumentIterator( this, 0 );
+    }
+
+    ReceivedMessageIndexedArgumentIterator IndexedArgumentsEnd() const
+    {
+        return ReceivedMessageIndexedArgumentIterator( this, ArgumentCount() );
+    }
+
 private:
 	const char *addressPattern_;
 	const char *typeTagsBegin_;
 	const char *typeTagsEnd_;
     const char *arguments_;
+
+    // the end of the message if its arguments are validated on access,
+    // otherwise 0
+    const char *uncheckedArgumentsEnd_;
+
+    // offsets of the indexed arguments from arguments_. the caller's
+    // storage, or 0 if the inline storage is used
+    uint32 *argumentOffsets_;
+    uint32 argumentOffsetsCapacity_;
+    uint32 indexedArgumentCount_;
+    uint32 inlineArgumentOffsets_[ INLINE_ARGUMENT_INDEX_SIZE ];
+
+    const uint32 *ArgumentOffsets() const
+        { return ( argumentOffsets_ ) ? argumentOffsets_ : inlineArgumentOffsets_; }
 };
 
 
+inline ReceivedMessageArgument ReceivedMessageIndexedArgumentIterator::operator*() const
+{
+    return message_->Argument( index_ );
+}
+
+inline ReceivedMessageArgument ReceivedMessageIndexedArgumentIterator::operator[]( difference_type n ) const
+{
+    return message_->Argument( index_ + (uint32)n );
+}
+
+
 class ReceivedBundle{
     void Init( const char *message, osc_bundle_element_size_t size );
+    ParseStatus Parse( const char *bundle, osc_bundle_element_size_t size );
 public:
     explicit ReceivedBundle( const ReceivedPacket& packet );
     explicit ReceivedBundle( const ReceivedBundleElement& bundleElement );
 
+    // An empty bundle, to be filled in by TryParse()
+    ReceivedBundle();
+
+    // Validates a bundle without throwing, as ReceivedMessage::TryParse().
+    // The bundle's elements are not parsed.
+    ParseStatus TryParse( const char *bundle, osc_bundle_element_size_t size );
+    ParseStatus TryParse( const ReceivedPacket& packet )
+        { return TryParse( packet.Contents(), packet.Size() ); }
+    ParseStatus TryParse( const ReceivedBundleElement& bundleElement )
+        { return TryParse( bundleElement.Contents(), bundleElement.Size() ); }
+
     uint64 TimeTag() const;
 
     uint32 ElementCount() const { return elementCount_; }
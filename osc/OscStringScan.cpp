@@ -0,0 +1,851 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#include "OscStringScan.h"
+
+#include <atomic>
+#include <cstring> // memcpy
+
+#include "OscTypes.h"
+#include "OscHostEndianness.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OSC_HAVE_SSE2_STRING_SCAN
+#include <emmintrin.h>
+
+// AVX2 code is compiled for a target attribute rather than with -mavx2,
+// so that the rest of the library still runs on CPUs without it
+#if defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#define OSC_HAVE_AVX2_STRING_SCAN
+#define OSC_AVX2_FUNCTION __attribute__((target("avx2")))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && _MSC_VER >= 1700
+#define OSC_HAVE_AVX2_STRING_SCAN
+#define OSC_AVX2_FUNCTION
+#include <immintrin.h>
+#endif
+#endif
+
+#if (defined(__ARM_NEON) || defined(__ARM_NEON__)) && (defined(__aarch64__) || defined(_M_ARM64))
+#define OSC_HAVE_NEON_STRING_SCAN
+#include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+namespace osc{
+
+
+#if defined(OSC_HAVE_SSE2_STRING_SCAN) || defined(OSC_HAVE_NEON_STRING_SCAN)
+// the index of the lowest set bit, x must not be 0
+static inline unsigned int CountTrailingZeros( unsigned long long x )
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+#if defined(_M_X64) || defined(_M_ARM64)
+    _BitScanForward64( &index, x );
+#else
+    if( !_BitScanForward( &index, (unsigned long)x ) ){
+        _BitScanForward( &index, (unsigned long)(x >> 32) );
+        index += 32;
+    }
+#endif
+    return (unsigned int)index;
+#else
+    return (unsigned int)__builtin_ctzll( x );
+#endif
+}
+#endif
+
+
+// the scanners below are called by FindStr4End() once it has checked
+// the first few words, with p <= end. they look at the last byte of each
+// word, so the vector versions keep the bits for bytes 3, 7, 11... of
+// each comparison mask.
+
+static const char* FindStr4EndScalar( const char *p, const char *end )
+{
+    for( ; end - p >= 4; p += 4 ){
+        if( p[3] == '\0' )
+            return p + 4;
+    }
+
+    return 0;
+}
+
+
+#ifdef OSC_HAVE_SSE2_STRING_SCAN
+static const char* FindStr4EndSse2( const char *p, const char *end )
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    while( end - p >= 16 ){
+        __m128i bytes = _mm_loadu_si128( reinterpret_cast<const __m128i*>( p ) );
+        unsigned int mask = (unsigned int)_mm_movemask_epi8( _mm_cmpeq_epi8( bytes, zero ) ) & 0x8888U;
+        if( mask )
+            return p + CountTrailingZeros( mask ) + 1;
+        p += 16;
+    }
+
+    return FindStr4EndScalar( p, end );
+}
+#endif /* OSC_HAVE_SSE2_STRING_SCAN */
+
+
+#ifdef OSC_HAVE_AVX2_STRING_SCAN
+OSC_AVX2_FUNCTION static const char* FindStr4EndAvx2( const char *p, const char *end )
+{
+    const __m256i zero = _mm256_setzero_si256();
+
+    while( end - p >= 32 ){
+        __m256i bytes = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( p ) );
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8( _mm256_cmpeq_epi8( bytes, zero ) ) & 0x88888888U;
+        if( mask )
+            return p + CountTrailingZeros( mask ) + 1;
+        p += 32;
+    }
+
+    if( end - p >= 16 ){
+        __m128i bytes = _mm_loadu_si128( reinterpret_cast<const __m128i*>( p ) );
+        unsigned int mask = (unsigned int)_mm_movemask_epi8( _mm_cmpeq_epi8( bytes, _mm_setzero_si128() ) ) & 0x8888U;
+        if( mask )
+            return p + CountTrailingZeros( mask ) + 1;
+        p += 16;
+    }
+
+    return FindStr4EndScalar( p, end );
+}
+
+
+static bool CpuSupportsAvx2()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid( info, 0 );
+    if( info[0] < 7 )
+        return false;
+
+    // the OS must also save the AVX registers on context switches
+    __cpuid( info, 1 );
+    const int OSXSAVE_AND_AVX = (1 << 27) | (1 << 28);
+    if( (info[2] & OSXSAVE_AND_AVX) != OSXSAVE_AND_AVX || (_xgetbv( 0 ) & 6) != 6 )
+        return false;
+
+    __cpuidex( info, 7, 0 );
+    return (info[1] & (1 << 5)) != 0;
+#else
+    // also checks that the OS supports AVX
+    __builtin_cpu_init();
+    return __builtin_cpu_supports( "avx2" ) != 0;
+#endif
+}
+#endif /* OSC_HAVE_AVX2_STRING_SCAN */
+
+
+#ifdef OSC_HAVE_NEON_STRING_SCAN
+static const char* FindStr4EndNeon( const char *p, const char *end )
+{
+    while( end - p >= 16 ){
+        uint8x16_t isZero = vceqq_u8( vld1q_u8( reinterpret_cast<const uint8_t*>( p ) ), vdupq_n_u8( 0 ) );
+        // there is no movemask, narrowing gives 4 bits per byte instead
+        uint64_t mask = vget_lane_u64( vreinterpret_u64_u8(
+                vshrn_n_u16( vreinterpretq_u16_u8( isZero ), 4 ) ), 0 ) & 0xF000F000F000F000ULL;
+        if( mask )
+            return p + (CountTrailingZeros( mask ) >> 2) + 1;
+        p += 16;
+    }
+
+    return FindStr4EndScalar( p, end );
+}
+#endif /* OSC_HAVE_NEON_STRING_SCAN */
+
+//------------------------------------------------------------------------------
+
+#define S STRING_TYPE_TAG_CLASS
+#define B BLOB_TYPE_TAG_CLASS
+#define E END_TYPE_TAG_CLASS
+#define U UNKNOWN_TYPE_TAG_CLASS
+
+const signed char typeTagClasses_[256] = {
+    E, U, U, U, U, U, U, U, U, U, U, U, U, U, U, U,
+    U, U, U, U, U, U, U, U, U, U, U, U, U, U, U, U,
+    U, U, U, U, U, U, U, U, U, U, U, U, U, U, U, U,
+    U, U, U, U, U, U, U, U, U, U, U, U, U, U, U, U,
+    U, U, U, U, U, U, 0, U, U, 0, U, U, U, U, 0, U,    // F I N
+    U, U, U, S, 0, U, U, U, U, U, U, 0, U, 0, U, U,    // S T [ ]
+    U, U, B, 4, 8, U, 4, U, 8, 4, U, U, U, 4, U, U,    // b c d f h i m
+    U, U, 4, S, 8, U, U, U, U, U, U, U, U, U, U, U,    // r s t
+    U, U, U, U, U, U, U, U, U, U, U, U, U, U, U, U,
+    U, U, U, U, U, U, U, U, U, U, U, U, U, U, U, U,
+    U, U, U, U, U, U, U, U, U, U, U, U, U, U, U, U,
+    U, U, U, U, U, U, U, U, U, U, U, U, U, U, U, U,
+    U, U, U, U, U, U, U, U, U, U, U, U, U, U, U, U,
+    U, U, U, U, U, U, U, U, U, U, U, U, U, U, U, U,
+    U, U, U, U, U, U, U, U, U, U, U, U, U, U, U, U,
+    U, U, U, U, U, U, U, U, U, U, U, U, U, U, U, U
+};
+
+#undef S
+#undef B
+#undef E
+#undef U
+
+
+static inline unsigned int PopCount( unsigned int x )
+{
+    unsigned int count = 0;
+    for( ; x; x &= x - 1 )
+        ++count;
+    return count;
+}
+
+
+// the bulk versions below look at a whole block of tags at a time. if
+// they are all fixed size their sizes are added up, otherwise the rest
+// of the run is left to the scalar version
+
+static const char* SkipFixedSizeTypeTagsScalar( const char *p, const char *end,
+        std::size_t& argumentBytes, unsigned int& arrayLevel )
+{
+    (void) end;
+
+    std::size_t bytes = 0;
+    for( int tagClass = TypeTagClass( *p ); tagClass >= 0; tagClass = TypeTagClass( *++p ) ){
+        bytes += tagClass;
+        if( *p == ARRAY_BEGIN_TYPE_TAG )
+            ++arrayLevel;
+        else if( *p == ARRAY_END_TYPE_TAG )
+            --arrayLevel;
+    }
+
+    argumentBytes += bytes;
+    return p;
+}
+
+
+#ifdef OSC_HAVE_SSE2_STRING_SCAN
+static inline __m128i TagsEqual( __m128i tags, char tag )
+{
+    return _mm_cmpeq_epi8( tags, _mm_set1_epi8( tag ) );
+}
+
+
+static const char* SkipFixedSizeTypeTagsSse2( const char *p, const char *end,
+        std::size_t& argumentBytes, unsigned int& arrayLevel )
+{
+    while( end - p >= 16 ){
+        __m128i tags = _mm_loadu_si128( reinterpret_cast<const __m128i*>( p ) );
+
+        __m128i size4 = _mm_or_si128(
+                _mm_or_si128( TagsEqual( tags, INT32_TYPE_TAG ), TagsEqual( tags, FLOAT_TYPE_TAG ) ),
+                _mm_or_si128( _mm_or_si128( TagsEqual( tags, CHAR_TYPE_TAG ), TagsEqual( tags, RGBA_COLOR_TYPE_TAG ) ),
+                        TagsEqual( tags, MIDI_MESSAGE_TYPE_TAG ) ) );
+        __m128i size8 = _mm_or_si128( _mm_or_si128( TagsEqual( tags, INT64_TYPE_TAG ), TagsEqual( tags, TIME_TAG_TYPE_TAG ) ),
+                TagsEqual( tags, DOUBLE_TYPE_TAG ) );
+        __m128i arrayBegins = TagsEqual( tags, ARRAY_BEGIN_TYPE_TAG );
+        __m128i arrayEnds = TagsEqual( tags, ARRAY_END_TYPE_TAG );
+        __m128i size0 = _mm_or_si128(
+                _mm_or_si128( _mm_or_si128( TagsEqual( tags, TRUE_TYPE_TAG ), TagsEqual( tags, FALSE_TYPE_TAG ) ),
+                        _mm_or_si128( TagsEqual( tags, NIL_TYPE_TAG ), TagsEqual( tags, INFINITUM_TYPE_TAG ) ) ),
+                _mm_or_si128( arrayBegins, arrayEnds ) );
+
+        // the tags before the first one that isn't fixed size belong to the run
+        unsigned int fixed = (unsigned int)_mm_movemask_epi8( _mm_or_si128( _mm_or_si128( size0, size4 ), size8 ) );
+        unsigned int count = ( fixed == 0xFFFF ) ? 16 : CountTrailingZeros( ~fixed );
+        __m128i inRun = _mm_cmplt_epi8( _mm_setr_epi8( 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 ),
+                _mm_set1_epi8( (char)count ) );
+
+        // each byte becomes the size of its argument. _mm_sad_epu8() adds
+        // up each half
+        __m128i sizes = _mm_and_si128( inRun,
+                _mm_or_si128( _mm_and_si128( size4, _mm_set1_epi8( 4 ) ), _mm_and_si128( size8, _mm_set1_epi8( 8 ) ) ) );
+        __m128i sums = _mm_sad_epu8( sizes, _mm_setzero_si128() );
+        argumentBytes += (std::size_t)( _mm_cvtsi128_si32( sums ) + _mm_extract_epi16( sums, 4 ) );
+
+        unsigned int runMask = (unsigned int)_mm_movemask_epi8( inRun );
+        arrayLevel += PopCount( (unsigned int)_mm_movemask_epi8( arrayBegins ) & runMask );
+        arrayLevel -= PopCount( (unsigned int)_mm_movemask_epi8( arrayEnds ) & runMask );
+
+        p += count;
+        if( count < 16 )
+            return p;
+    }
+
+    return SkipFixedSizeTypeTagsScalar( p, end, argumentBytes, arrayLevel );
+}
+#endif /* OSC_HAVE_SSE2_STRING_SCAN */
+
+
+#ifdef OSC_HAVE_AVX2_STRING_SCAN
+OSC_AVX2_FUNCTION static inline __m256i TagsEqual256( __m256i tags, char tag )
+{
+    return _mm256_cmpeq_epi8( tags, _mm256_set1_epi8( tag ) );
+}
+
+
+OSC_AVX2_FUNCTION static const char* SkipFixedSizeTypeTagsAvx2( const char *p, const char *end,
+        std::size_t& argumentBytes, unsigned int& arrayLevel )
+{
+    while( end - p >= 32 ){
+        __m256i tags = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( p ) );
+
+        __m256i size4 = _mm256_or_si256(
+                _mm256_or_si256( TagsEqual256( tags, INT32_TYPE_TAG ), TagsEqual256( tags, FLOAT_TYPE_TAG ) ),
+                _mm256_or_si256( _mm256_or_si256( TagsEqual256( tags, CHAR_TYPE_TAG ), TagsEqual256( tags, RGBA_COLOR_TYPE_TAG ) ),
+                        TagsEqual256( tags, MIDI_MESSAGE_TYPE_TAG ) ) );
+        __m256i size8 = _mm256_or_si256( _mm256_or_si256( TagsEqual256( tags, INT64_TYPE_TAG ), TagsEqual256( tags, TIME_TAG_TYPE_TAG ) ),
+                TagsEqual256( tags, DOUBLE_TYPE_TAG ) );
+        __m256i arrayBegins = TagsEqual256( tags, ARRAY_BEGIN_TYPE_TAG );
+        __m256i arrayEnds = TagsEqual256( tags, ARRAY_END_TYPE_TAG );
+        __m256i size0 = _mm256_or_si256(
+                _mm256_or_si256( _mm256_or_si256( TagsEqual256( tags, TRUE_TYPE_TAG ), TagsEqual256( tags, FALSE_TYPE_TAG ) ),
+                        _mm256_or_si256( TagsEqual256( tags, NIL_TYPE_TAG ), TagsEqual256( tags, INFINITUM_TYPE_TAG ) ) ),
+                _mm256_or_si256( arrayBegins, arrayEnds ) );
+
+        // the tags before the first one that isn't fixed size belong to the run
+        unsigned int fixed = (unsigned int)_mm256_movemask_epi8( _mm256_or_si256( _mm256_or_si256( size0, size4 ), size8 ) );
+        unsigned int count = ( fixed == 0xFFFFFFFFU ) ? 32 : CountTrailingZeros( ~fixed );
+        __m256i inRun = _mm256_cmpgt_epi8( _mm256_set1_epi8( (char)count ),
+                _mm256_setr_epi8( 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+                        16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31 ) );
+
+        // each byte becomes the size of its argument. _mm256_sad_epu8()
+        // adds up each quarter
+        __m256i sizes = _mm256_and_si256( inRun, _mm256_or_si256( _mm256_and_si256( size4, _mm256_set1_epi8( 4 ) ),
+                _mm256_and_si256( size8, _mm256_set1_epi8( 8 ) ) ) );
+        __m256i sums = _mm256_sad_epu8( sizes, _mm256_setzero_si256() );
+        __m128i halves = _mm_add_epi32( _mm256_castsi256_si128( sums ), _mm256_extracti128_si256( sums, 1 ) );
+        argumentBytes += (std::size_t)( _mm_cvtsi128_si32( halves ) + _mm_extract_epi16( halves, 4 ) );
+
+        unsigned int runMask = (unsigned int)_mm256_movemask_epi8( inRun );
+        arrayLevel += PopCount( (unsigned int)_mm256_movemask_epi8( arrayBegins ) & runMask );
+        arrayLevel -= PopCount( (unsigned int)_mm256_movemask_epi8( arrayEnds ) & runMask );
+
+        p += count;
+        if( count < 32 )
+            return p;
+    }
+
+    return SkipFixedSizeTypeTagsSse2( p, end, argumentBytes, arrayLevel );
+}
+#endif /* OSC_HAVE_AVX2_STRING_SCAN */
+
+
+#ifdef OSC_HAVE_NEON_STRING_SCAN
+static inline uint8x16_t TagsEqual( uint8x16_t tags, char tag )
+{
+    return vceqq_u8( tags, vdupq_n_u8( (uint8_t)tag ) );
+}
+
+
+static const char* SkipFixedSizeTypeTagsNeon( const char *p, const char *end,
+        std::size_t& argumentBytes, unsigned int& arrayLevel )
+{
+    while( end - p >= 16 ){
+        uint8x16_t tags = vld1q_u8( reinterpret_cast<const uint8_t*>( p ) );
+
+        uint8x16_t size4 = vorrq_u8(
+                vorrq_u8( TagsEqual( tags, INT32_TYPE_TAG ), TagsEqual( tags, FLOAT_TYPE_TAG ) ),
+                vorrq_u8( vorrq_u8( TagsEqual( tags, CHAR_TYPE_TAG ), TagsEqual( tags, RGBA_COLOR_TYPE_TAG ) ),
+                        TagsEqual( tags, MIDI_MESSAGE_TYPE_TAG ) ) );
+        uint8x16_t size8 = vorrq_u8( vorrq_u8( TagsEqual( tags, INT64_TYPE_TAG ), TagsEqual( tags, TIME_TAG_TYPE_TAG ) ),
+                TagsEqual( tags, DOUBLE_TYPE_TAG ) );
+        uint8x16_t arrayBegins = TagsEqual( tags, ARRAY_BEGIN_TYPE_TAG );
+        uint8x16_t arrayEnds = TagsEqual( tags, ARRAY_END_TYPE_TAG );
+        uint8x16_t size0 = vorrq_u8(
+                vorrq_u8( vorrq_u8( TagsEqual( tags, TRUE_TYPE_TAG ), TagsEqual( tags, FALSE_TYPE_TAG ) ),
+                        vorrq_u8( TagsEqual( tags, NIL_TYPE_TAG ), TagsEqual( tags, INFINITUM_TYPE_TAG ) ) ),
+                vorrq_u8( arrayBegins, arrayEnds ) );
+
+        if( vminvq_u8( vorrq_u8( vorrq_u8( size0, size4 ), size8 ) ) != 0xFF )
+            break;
+
+        uint8x16_t sizes = vorrq_u8( vandq_u8( size4, vdupq_n_u8( 4 ) ), vandq_u8( size8, vdupq_n_u8( 8 ) ) );
+        argumentBytes += vaddlvq_u8( sizes );
+
+        arrayLevel += vaddlvq_u8( vandq_u8( arrayBegins, vdupq_n_u8( 1 ) ) );
+        arrayLevel -= vaddlvq_u8( vandq_u8( arrayEnds, vdupq_n_u8( 1 ) ) );
+
+        p += 16;
+    }
+
+    return SkipFixedSizeTypeTagsScalar( p, end, argumentBytes, arrayLevel );
+}
+#endif /* OSC_HAVE_NEON_STRING_SCAN */
+
+//------------------------------------------------------------------------------
+
+// runs of a single type tag, such as the elements of a homogeneous array
+
+static const char* SkipTypeTagRunScalar( const char *p, const char *end, char typeTag )
+{
+    (void) end;
+
+    while( *p == typeTag )
+        ++p;
+    return p;
+}
+
+
+#ifdef OSC_HAVE_SSE2_STRING_SCAN
+static const char* SkipTypeTagRunSse2( const char *p, const char *end, char typeTag )
+{
+    while( end - p >= 16 ){
+        unsigned int same = (unsigned int)_mm_movemask_epi8(
+                TagsEqual( _mm_loadu_si128( reinterpret_cast<const __m128i*>( p ) ), typeTag ) );
+        if( same != 0xFFFF )
+            return p + CountTrailingZeros( ~same );
+        p += 16;
+    }
+
+    return SkipTypeTagRunScalar( p, end, typeTag );
+}
+#endif /* OSC_HAVE_SSE2_STRING_SCAN */
+
+
+#ifdef OSC_HAVE_AVX2_STRING_SCAN
+OSC_AVX2_FUNCTION static const char* SkipTypeTagRunAvx2( const char *p, const char *end, char typeTag )
+{
+    while( end - p >= 32 ){
+        unsigned int same = (unsigned int)_mm256_movemask_epi8(
+                TagsEqual256( _mm256_loadu_si256( reinterpret_cast<const __m256i*>( p ) ), typeTag ) );
+        if( same != 0xFFFFFFFFU )
+            return p + CountTrailingZeros( ~same );
+        p += 32;
+    }
+
+    return SkipTypeTagRunSse2( p, end, typeTag );
+}
+#endif /* OSC_HAVE_AVX2_STRING_SCAN */
+
+
+#ifdef OSC_HAVE_NEON_STRING_SCAN
+static const char* SkipTypeTagRunNeon( const char *p, const char *end, char typeTag )
+{
+    while( end - p >= 16 ){
+        if( vminvq_u8( TagsEqual( vld1q_u8( reinterpret_cast<const uint8_t*>( p ) ), typeTag ) ) != 0xFF )
+            break;
+        p += 16;
+    }
+
+    return SkipTypeTagRunScalar( p, end, typeTag );
+}
+#endif /* OSC_HAVE_NEON_STRING_SCAN */
+
+//------------------------------------------------------------------------------
+
+// big endian to host byte order copies. the vector versions reverse the
+// bytes of each element in a whole register at a time, and leave the last
+// few elements to the scalar version.
+
+static void CopyBigEndian32Scalar( void *dst, const char *src, std::size_t count )
+{
+    char *d = static_cast<char*>( dst );
+    for( ; count; --count, src += 4, d += 4 ){
+        uint32 value = ReadBigEndian32( src );
+        std::memcpy( d, &value, 4 );
+    }
+}
+
+
+static void CopyBigEndian64Scalar( void *dst, const char *src, std::size_t count )
+{
+    char *d = static_cast<char*>( dst );
+    for( ; count; --count, src += 8, d += 8 ){
+        uint64 value = ReadBigEndian64( src );
+        std::memcpy( d, &value, 8 );
+    }
+}
+
+
+#ifdef OSC_HAVE_SSE2_STRING_SCAN
+// SSE2 has no byte shuffle: swap the bytes of each 16 bit word, then
+// reverse the words of each element
+static inline __m128i SwapBytesOfWords( __m128i x )
+{
+    return _mm_or_si128( _mm_slli_epi16( x, 8 ), _mm_srli_epi16( x, 8 ) );
+}
+
+
+static void CopyBigEndian32Sse2( void *dst, const char *src, std::size_t count )
+{
+    char *d = static_cast<char*>( dst );
+    for( ; count >= 4; count -= 4, src += 16, d += 16 ){
+        __m128i x = SwapBytesOfWords( _mm_loadu_si128( reinterpret_cast<const __m128i*>( src ) ) );
+        x = _mm_shufflehi_epi16( _mm_shufflelo_epi16( x, _MM_SHUFFLE( 2, 3, 0, 1 ) ), _MM_SHUFFLE( 2, 3, 0, 1 ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( d ), x );
+    }
+
+    CopyBigEndian32Scalar( d, src, count );
+}
+
+
+static void CopyBigEndian64Sse2( void *dst, const char *src, std::size_t count )
+{
+    char *d = static_cast<char*>( dst );
+    for( ; count >= 2; count -= 2, src += 16, d += 16 ){
+        __m128i x = SwapBytesOfWords( _mm_loadu_si128( reinterpret_cast<const __m128i*>( src ) ) );
+        x = _mm_shufflehi_epi16( _mm_shufflelo_epi16( x, _MM_SHUFFLE( 0, 1, 2, 3 ) ), _MM_SHUFFLE( 0, 1, 2, 3 ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( d ), x );
+    }
+
+    CopyBigEndian64Scalar( d, src, count );
+}
+#endif /* OSC_HAVE_SSE2_STRING_SCAN */
+
+
+#ifdef OSC_HAVE_AVX2_STRING_SCAN
+// _mm256_shuffle_epi8() shuffles within each 128 bit lane, so the
+// pattern is repeated for both
+OSC_AVX2_FUNCTION static inline void CopyBigEndianAvx2( char *&d, const char *&src, std::size_t bytes, __m256i shuffle )
+{
+    for( ; bytes >= 64; bytes -= 64, src += 64, d += 64 ){
+        __m256i x0 = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( src ) );
+        __m256i x1 = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( src + 32 ) );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( d ), _mm256_shuffle_epi8( x0, shuffle ) );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( d + 32 ), _mm256_shuffle_epi8( x1, shuffle ) );
+    }
+
+    if( bytes >= 32 ){
+        __m256i x = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( src ) );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( d ), _mm256_shuffle_epi8( x, shuffle ) );
+        src += 32;
+        d += 32;
+    }
+}
+
+
+OSC_AVX2_FUNCTION static void CopyBigEndian32Avx2( void *dst, const char *src, std::size_t count )
+{
+    char *d = static_cast<char*>( dst );
+    CopyBigEndianAvx2( d, src, count * 4, _mm256_setr_epi8(
+            3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+            3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 ) );
+
+    CopyBigEndian32Sse2( d, src, count & 7 );
+}
+
+
+OSC_AVX2_FUNCTION static void CopyBigEndian64Avx2( void *dst, const char *src, std::size_t count )
+{
+    char *d = static_cast<char*>( dst );
+    CopyBigEndianAvx2( d, src, count * 8, _mm256_setr_epi8(
+            7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+            7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8 ) );
+
+    CopyBigEndian64Sse2( d, src, count & 3 );
+}
+#endif /* OSC_HAVE_AVX2_STRING_SCAN */
+
+
+#ifdef OSC_HAVE_NEON_STRING_SCAN
+static void CopyBigEndian32Neon( void *dst, const char *src, std::size_t count )
+{
+    char *d = static_cast<char*>( dst );
+    for( ; count >= 4; count -= 4, src += 16, d += 16 )
+        vst1q_u8( reinterpret_cast<uint8_t*>( d ), vrev32q_u8( vld1q_u8( reinterpret_cast<const uint8_t*>( src ) ) ) );
+
+    CopyBigEndian32Scalar( d, src, count );
+}
+
+
+static void CopyBigEndian64Neon( void *dst, const char *src, std::size_t count )
+{
+    char *d = static_cast<char*>( dst );
+    for( ; count >= 2; count -= 2, src += 16, d += 16 )
+        vst1q_u8( reinterpret_cast<uint8_t*>( d ), vrev64q_u8( vld1q_u8( reinterpret_cast<const uint8_t*>( src ) ) ) );
+
+    CopyBigEndian64Scalar( d, src, count );
+}
+#endif /* OSC_HAVE_NEON_STRING_SCAN */
+
+//------------------------------------------------------------------------------
+
+typedef const char* (*FindStr4EndFunction)( const char *p, const char *end );
+
+typedef const char* (*SkipFixedSizeTypeTagsFunction)( const char *p, const char *end,
+        std::size_t& argumentBytes, unsigned int& arrayLevel );
+
+typedef const char* (*SkipTypeTagRunFunction)( const char *p, const char *end, char typeTag );
+
+typedef void (*CopyBigEndianFunction)( void *dst, const char *src, std::size_t count );
+
+static const char* FindStr4EndFirstCall( const char *p, const char *end );
+static const char* SkipFixedSizeTypeTagsFirstCall( const char *p, const char *end,
+        std::size_t& argumentBytes, unsigned int& arrayLevel );
+static const char* SkipTypeTagRunFirstCall( const char *p, const char *end, char typeTag );
+static void CopyBigEndian32FirstCall( void *dst, const char *src, std::size_t count );
+static void CopyBigEndian64FirstCall( void *dst, const char *src, std::size_t count );
+
+// start out pointing at the FirstCall functions, which pick the
+// implementation. so no static initialization order issues arise.
+static std::atomic<FindStr4EndFunction> findStr4End_( FindStr4EndFirstCall );
+static std::atomic<SkipFixedSizeTypeTagsFunction> skipFixedSizeTypeTags_( SkipFixedSizeTypeTagsFirstCall );
+static std::atomic<SkipTypeTagRunFunction> skipTypeTagRun_( SkipTypeTagRunFirstCall );
+static std::atomic<CopyBigEndianFunction> copyBigEndian32_( CopyBigEndian32FirstCall );
+static std::atomic<CopyBigEndianFunction> copyBigEndian64_( CopyBigEndian64FirstCall );
+static std::atomic<int> activeImplementation_( -1 );
+
+
+static StringScanImplementation BestStringScanImplementation()
+{
+#if defined(OSC_HAVE_NEON_STRING_SCAN)
+    return NEON_STRING_SCAN;
+#else
+#if defined(OSC_HAVE_AVX2_STRING_SCAN)
+    if( CpuSupportsAvx2() )
+        return AVX2_STRING_SCAN;
+#endif
+#if defined(OSC_HAVE_SSE2_STRING_SCAN)
+    return SSE2_STRING_SCAN;
+#else
+    return SCALAR_STRING_SCAN;
+#endif
+#endif
+}
+
+
+static void SelectBestStringScanImplementation()
+{
+    if( activeImplementation_.load( std::memory_order_acquire ) == -1 )
+        SetStringScanImplementation( BestStringScanImplementation() );
+}
+
+
+static const char* FindStr4EndFirstCall( const char *p, const char *end )
+{
+    SelectBestStringScanImplementation();
+    return findStr4End_.load( std::memory_order_relaxed )( p, end );
+}
+
+
+static const char* SkipFixedSizeTypeTagsFirstCall( const char *p, const char *end,
+        std::size_t& argumentBytes, unsigned int& arrayLevel )
+{
+    SelectBestStringScanImplementation();
+    return skipFixedSizeTypeTags_.load( std::memory_order_relaxed )( p, end, argumentBytes, arrayLevel );
+}
+
+
+static const char* SkipTypeTagRunFirstCall( const char *p, const char *end, char typeTag )
+{
+    SelectBestStringScanImplementation();
+    return skipTypeTagRun_.load( std::memory_order_relaxed )( p, end, typeTag );
+}
+
+
+static void CopyBigEndian32FirstCall( void *dst, const char *src, std::size_t count )
+{
+    SelectBestStringScanImplementation();
+    copyBigEndian32_.load( std::memory_order_relaxed )( dst, src, count );
+}
+
+
+static void CopyBigEndian64FirstCall( void *dst, const char *src, std::size_t count )
+{
+    SelectBestStringScanImplementation();
+    copyBigEndian64_.load( std::memory_order_relaxed )( dst, src, count );
+}
+
+
+const char* FindStr4End( const char *p, const char *end )
+{
+    if( p >= end )
+        return 0;
+
+    if( p[0] == '\0' )    // special case for SuperCollider integer address pattern
+        return p + 4;
+
+    // most strings are short. checking their words one at a time is
+    // quicker: the branches are predicted, so the next scan can start
+    // before the loads complete, whereas a vector comparison result
+    // has to wait for them.
+    for( int i = 0; i < 8; ++i, p += 4 ){
+        if( end - p < 4 )
+            return 0;
+        if( p[3] == '\0' )
+            return p + 4;
+    }
+
+    return findStr4End_.load( std::memory_order_relaxed )( p, end );
+}
+
+
+const char* SkipFixedSizeTypeTags( const char *p, const char *end,
+        std::size_t& argumentBytes, unsigned int& arrayLevel )
+{
+    return skipFixedSizeTypeTags_.load( std::memory_order_relaxed )( p, end, argumentBytes, arrayLevel );
+}
+
+
+const char* SkipTypeTagRun( const char *p, const char *end, char typeTag )
+{
+    return skipTypeTagRun_.load( std::memory_order_relaxed )( p, end, typeTag );
+}
+
+
+void CopyBigEndian32( void *dst, const char *src, std::size_t count )
+{
+#ifdef OSC_HOST_LITTLE_ENDIAN
+    copyBigEndian32_.load( std::memory_order_relaxed )( dst, src, count );
+#else
+    std::memcpy( dst, src, count * 4 );
+#endif
+}
+
+
+void CopyBigEndian64( void *dst, const char *src, std::size_t count )
+{
+#ifdef OSC_HOST_LITTLE_ENDIAN
+    copyBigEndian64_.load( std::memory_order_relaxed )( dst, src, count );
+#else
+    std::memcpy( dst, src, count * 8 );
+#endif
+}
+
+
+const char* StringScanImplementationName( StringScanImplementation implementation )
+{
+    switch( implementation ){
+        case SCALAR_STRING_SCAN: return "scalar";
+        case SSE2_STRING_SCAN: return "sse2";
+        case AVX2_STRING_SCAN: return "avx2";
+        case NEON_STRING_SCAN: return "neon";
+    }
+
+    return "unknown";
+}
+
+
+StringScanImplementation ActiveStringScanImplementation()
+{
+    SelectBestStringScanImplementation();
+    return (StringScanImplementation)activeImplementation_.load( std::memory_order_acquire );
+}
+
+
+bool IsStringScanImplementationSupported( StringScanImplementation implementation )
+{
+    switch( implementation ){
+        case SCALAR_STRING_SCAN:
+            return true;
+        case SSE2_STRING_SCAN:
+#ifdef OSC_HAVE_SSE2_STRING_SCAN
+            return true;
+#else
+            return false;
+#endif
+        case AVX2_STRING_SCAN:
+#ifdef OSC_HAVE_AVX2_STRING_SCAN
+            return CpuSupportsAvx2();
+#else
+            return false;
+#endif
+        case NEON_STRING_SCAN:
+#ifdef OSC_HAVE_NEON_STRING_SCAN
+            return true;
+#else
+            return false;
+#endif
+    }
+
+    return false;
+}
+
+
+bool SetStringScanImplementation( StringScanImplementation implementation )
+{
+    FindStr4EndFunction findStr4End = 0;
+    SkipFixedSizeTypeTagsFunction skipFixedSizeTypeTags = 0;
+    SkipTypeTagRunFunction skipTypeTagRun = 0;
+    CopyBigEndianFunction copyBigEndian32 = 0;
+    CopyBigEndianFunction copyBigEndian64 = 0;
+
+    switch( implementation ){
+        case SCALAR_STRING_SCAN:
+            findStr4End = FindStr4EndScalar;
+            skipFixedSizeTypeTags = SkipFixedSizeTypeTagsScalar;
+            skipTypeTagRun = SkipTypeTagRunScalar;
+            copyBigEndian32 = CopyBigEndian32Scalar;
+            copyBigEndian64 = CopyBigEndian64Scalar;
+            break;
+        case SSE2_STRING_SCAN:
+#ifdef OSC_HAVE_SSE2_STRING_SCAN
+            findStr4End = FindStr4EndSse2;
+            skipFixedSizeTypeTags = SkipFixedSizeTypeTagsSse2;
+            skipTypeTagRun = SkipTypeTagRunSse2;
+            copyBigEndian32 = CopyBigEndian32Sse2;
+            copyBigEndian64 = CopyBigEndian64Sse2;
+#endif
+            break;
+        case AVX2_STRING_SCAN:
+#ifdef OSC_HAVE_AVX2_STRING_SCAN
+            if( CpuSupportsAvx2() ){
+                findStr4End = FindStr4EndAvx2;
+                skipFixedSizeTypeTags = SkipFixedSizeTypeTagsAvx2;
+                skipTypeTagRun = SkipTypeTagRunAvx2;
+                copyBigEndian32 = CopyBigEndian32Avx2;
+                copyBigEndian64 = CopyBigEndian64Avx2;
+            }
+#endif
+            break;
+        case NEON_STRING_SCAN:
+#ifdef OSC_HAVE_NEON_STRING_SCAN
+            findStr4End = FindStr4EndNeon;
+            skipFixedSizeTypeTags = SkipFixedSizeTypeTagsNeon;
+            skipTypeTagRun = SkipTypeTagRunNeon;
+            copyBigEndian32 = CopyBigEndian32Neon;
+            copyBigEndian64 = CopyBigEndian64Neon;
+#endif
+            break;
+    }
+
+    if( !findStr4End )
+        return false;
+
+    findStr4End_.store( findStr4End, std::memory_order_relaxed );
+    skipFixedSizeTypeTags_.store( skipFixedSizeTypeTags, std::memory_order_relaxed );
+    skipTypeTagRun_.store( skipTypeTagRun, std::memory_order_relaxed );
+    copyBigEndian32_.store( copyBigEndian32, std::memory_order_relaxed );
+    copyBigEndian64_.store( copyBigEndian64, std::memory_order_relaxed );
+    activeImplementation_.store( (int)implementation, std::memory_order_release );
+    return true;
+}
+
+} // namespace osc
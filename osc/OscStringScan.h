@@ -0,0 +1,138 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_OSCSTRINGSCAN_H
+#define INCLUDED_OSCPACK_OSCSTRINGSCAN_H
+
+#include <cstddef> // size_t
+
+#include "OscTypes.h"
+
+
+namespace osc{
+
+// Scanning and copying functions used by the received packet parser and
+// decoders. Where the CPU supports it they process 16 or 32 bytes at a
+// time using SSE2, AVX2 or NEON. The implementation is chosen when first
+// used, according to the features of the CPU the program is running on,
+// and applies to all of them.
+
+// Returns the first 4 byte boundary after the end of the OSC string
+// (str4) starting at p, or 0 if p == end or the string isn't terminated
+// before end. Like the original word at a time scan, only the last byte
+// of each 4 byte word is checked for the terminating NUL, and no byte at
+// or after end is read.
+const char* FindStr4End( const char *p, const char *end );
+
+
+// The class of each type tag, which tells the parser how to find the end
+// of its argument. Fixed size arguments map to their size in bytes:
+// 0 (T, F, N, I and the array markers [ and ]), 4 (i, f, c, r, m) or
+// 8 (h, t, d). The others map to one of the negative values below.
+enum TypeTagClassValues{
+    STRING_TYPE_TAG_CLASS = -1,     // s and S: a padded string
+    BLOB_TYPE_TAG_CLASS = -2,       // b: a size followed by padded data
+    END_TYPE_TAG_CLASS = -3,        // the terminating '\0'
+    UNKNOWN_TYPE_TAG_CLASS = -4
+};
+
+extern const signed char typeTagClasses_[256];
+
+inline int TypeTagClass( char typeTag )
+{
+    return typeTagClasses_[ (unsigned char)typeTag ];
+}
+
+// Skips the run of fixed size type tags starting at p, adding the total
+// size of their arguments to argumentBytes, and the number of array
+// begin markers less the number of array end markers to arrayLevel.
+// Returns a pointer to the first tag of another class. One must occur
+// before end (e.g. the terminating '\0'), and all of [p, end) must be
+// readable. Runs of 16 or 32 tags are classified at a time.
+const char* SkipFixedSizeTypeTags( const char *p, const char *end,
+        std::size_t& argumentBytes, unsigned int& arrayLevel );
+
+// Returns a pointer to the first tag at or after p that isn't typeTag.
+// One must occur before end, and all of [p, end) must be readable.
+const char* SkipTypeTagRun( const char *p, const char *end, char typeTag );
+
+
+// Copy count big endian 4 or 8 byte values from src to dst, converting
+// them to host byte order. Neither needs to be aligned, and they mustn't
+// overlap.
+void CopyBigEndian32( void *dst, const char *src, std::size_t count );
+void CopyBigEndian64( void *dst, const char *src, std::size_t count );
+
+// Read the big endian 4 or 8 byte value at p, which needn't be aligned.
+// Compilers turn the shifts into a load and a bswap (or movbe), on any
+// host byte order.
+inline uint32 ReadBigEndian32( const char *p )
+{
+    const unsigned char *s = reinterpret_cast<const unsigned char*>( p );
+    return ((uint32)s[0] << 24) | ((uint32)s[1] << 16) | ((uint32)s[2] << 8) | (uint32)s[3];
+}
+
+inline uint64 ReadBigEndian64( const char *p )
+{
+    const unsigned char *s = reinterpret_cast<const unsigned char*>( p );
+    return ((uint64)s[0] << 56) | ((uint64)s[1] << 48) | ((uint64)s[2] << 40) | ((uint64)s[3] << 32)
+            | ((uint64)s[4] << 24) | ((uint64)s[5] << 16) | ((uint64)s[6] << 8) | (uint64)s[7];
+}
+
+
+enum StringScanImplementation{
+    SCALAR_STRING_SCAN,
+    SSE2_STRING_SCAN,
+    AVX2_STRING_SCAN,
+    NEON_STRING_SCAN
+};
+
+const char* StringScanImplementationName( StringScanImplementation implementation );
+
+// The implementation currently in use.
+StringScanImplementation ActiveStringScanImplementation();
+
+// Whether implementation is compiled in and supported by this CPU.
+bool IsStringScanImplementationSupported( StringScanImplementation implementation );
+
+// Override the automatic choice, for testing and benchmarking. Returns
+// false, leaving the active implementation unchanged, if implementation
+// isn't supported. Don't call while other threads are parsing.
+bool SetStringScanImplementation( StringScanImplementation implementation );
+
+} // namespace osc
+
+#endif /* INCLUDED_OSCPACK_OSCSTRINGSCAN_H */
@@ -0,0 +1,386 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_OSCTYPEDMESSAGE_H
+#define INCLUDED_OSCPACK_OSCTYPEDMESSAGE_H
+
+#include <cstddef> // size_t
+#include <cstring> // memcmp
+#include <tuple>
+#include <type_traits>
+
+#include "OscTypes.h"
+#include "OscReceivedElements.h"
+#include "OscStringScan.h"
+
+
+namespace osc{
+
+// TypedMessage matches a ReceivedMessage against a C++ signature and
+// decodes its arguments into a std::tuple in one step, e.g.:
+//
+//    std::tuple<int32, float, const char*> values;
+//    if( TypedMessage<int32, float, const char*>::TryDecode( m, values ) ){
+//        ...
+//    }
+//
+// The type tags are compared with a constant built at compile time, in a
+// single memcmp(), and the offsets of fixed size arguments are constants
+// too, so decoding doesn't check the type of each argument as
+// ArgumentStream() does. The supported argument types are int32, float,
+// char, RgbaColor, MidiMessage, int64, TimeTag, double, const char*
+// (string), Symbol, Blob, NilType and InfinitumType. bool isn't, because
+// its type tag depends on its value, and nor are arrays. ArrayView below
+// reads homogeneous arrays.
+//
+// Requires C++11.
+
+
+// The type tag, size and decoding of each supported argument type. Fixed
+// size types have FIXED_SIZE set and a Decode() reading SIZE bytes. The
+// others find the end of their argument with End(), given the end of the
+// message if it hasn't been validated (0 otherwise), which returns 0 if
+// the argument doesn't fit.
+template< typename T > struct TypedArgument; // not defined for unsupported types
+
+template<> struct TypedArgument< int32 >{
+    enum { TYPE_TAG = INT32_TYPE_TAG, FIXED_SIZE = 1, SIZE = 4 };
+    static int32 Decode( const char *p ) { return (int32)ReadBigEndian32( p ); }
+};
+
+template<> struct TypedArgument< float >{
+    enum { TYPE_TAG = FLOAT_TYPE_TAG, FIXED_SIZE = 1, SIZE = 4 };
+    static float Decode( const char *p )
+    {
+        union{
+            uint32 i;
+            float f;
+        } u;
+        u.i = ReadBigEndian32( p );
+        return u.f;
+    }
+};
+
+template<> struct TypedArgument< char >{
+    enum { TYPE_TAG = CHAR_TYPE_TAG, FIXED_SIZE = 1, SIZE = 4 };
+    static char Decode( const char *p ) { return (char)ReadBigEndian32( p ); }
+};
+
+template<> struct TypedArgument< RgbaColor >{
+    enum { TYPE_TAG = RGBA_COLOR_TYPE_TAG, FIXED_SIZE = 1, SIZE = 4 };
+    static RgbaColor Decode( const char *p ) { return RgbaColor( ReadBigEndian32( p ) ); }
+};
+
+template<> struct TypedArgument< MidiMessage >{
+    enum { TYPE_TAG = MIDI_MESSAGE_TYPE_TAG, FIXED_SIZE = 1, SIZE = 4 };
+    static MidiMessage Decode( const char *p ) { return MidiMessage( ReadBigEndian32( p ) ); }
+};
+
+template<> struct TypedArgument< int64 >{
+    enum { TYPE_TAG = INT64_TYPE_TAG, FIXED_SIZE = 1, SIZE = 8 };
+    static int64 Decode( const char *p ) { return (int64)ReadBigEndian64( p ); }
+};
+
+template<> struct TypedArgument< TimeTag >{
+    enum { TYPE_TAG = TIME_TAG_TYPE_TAG, FIXED_SIZE = 1, SIZE = 8 };
+    static TimeTag Decode( const char *p ) { return TimeTag( ReadBigEndian64( p ) ); }
+};
+
+template<> struct TypedArgument< double >{
+    enum { TYPE_TAG = DOUBLE_TYPE_TAG, FIXED_SIZE = 1, SIZE = 8 };
+    static double Decode( const char *p )
+    {
+        union{
+            uint64 i;
+            double d;
+        } u;
+        u.i = ReadBigEndian64( p );
+        return u.d;
+    }
+};
+
+template<> struct TypedArgument< NilType >{
+    enum { TYPE_TAG = NIL_TYPE_TAG, FIXED_SIZE = 1, SIZE = 0 };
+    static NilType Decode( const char * ) { return NilType(); }
+};
+
+template<> struct TypedArgument< InfinitumType >{
+    enum { TYPE_TAG = INFINITUM_TYPE_TAG, FIXED_SIZE = 1, SIZE = 0 };
+    static InfinitumType Decode( const char * ) { return InfinitumType(); }
+};
+
+template<> struct TypedArgument< const char* >{
+    enum { TYPE_TAG = STRING_TYPE_TAG, FIXED_SIZE = 0, SIZE = 0 };
+    static const char* Decode( const char *p ) { return p; }
+
+    static const char* End( const char *p, const char *end )
+    {
+        if( end )
+            return FindStr4End( p, end );
+
+        // the string is known to be terminated
+        p += 3;
+        while( *p )
+            p += 4;
+        return p + 1;
+    }
+};
+
+template<> struct TypedArgument< Symbol >{
+    enum { TYPE_TAG = SYMBOL_TYPE_TAG, FIXED_SIZE = 0, SIZE = 0 };
+    static Symbol Decode( const char *p ) { return Symbol( p ); }
+    static const char* End( const char *p, const char *end ) { return TypedArgument< const char* >::End( p, end ); }
+};
+
+template<> struct TypedArgument< Blob >{
+    enum { TYPE_TAG = BLOB_TYPE_TAG, FIXED_SIZE = 0, SIZE = 0 };
+    static Blob Decode( const char *p )
+    {
+        return Blob( p + OSC_SIZEOF_INT32, (osc_bundle_element_size_t)ReadBigEndian32( p ) );
+    }
+
+    static const char* End( const char *p, const char *end )
+    {
+        if( end && end - p < OSC_SIZEOF_INT32 )
+            return 0;
+
+        uint32 size = ReadBigEndian32( p );
+        p += OSC_SIZEOF_INT32;
+        if( end && size > (uint32)(end - p) )
+            return 0;
+        return p + ( (size + 3) & ~((uint32)0x03) );
+    }
+};
+
+
+template< typename... Args >
+class TypedMessage{
+public:
+    typedef std::tuple< Args... > tuple_type;
+
+    enum { ARGUMENT_COUNT = sizeof...(Args) };
+
+    // the type tags the message must have, without the leading ','
+    static const char* TypeTags() { return typeTags_; }
+
+    static bool Matches( const ReceivedMessage& m )
+    {
+        return m.ArgumentCount() == ARGUMENT_COUNT
+                && ( ARGUMENT_COUNT == 0 || std::memcmp( m.TypeTags(), typeTags_, ARGUMENT_COUNT ) == 0 );
+    }
+
+    // Decodes the arguments of m into values if its type tags match,
+    // returning false otherwise. Throws MalformedMessageException if m's
+    // arguments are validated on access and turn out to be malformed.
+    static bool TryDecode( const ReceivedMessage& m, tuple_type& values )
+    {
+        if( !Matches( m ) )
+            return false;
+
+        Decode< 0, 0 >( m.ArgumentData(), m.UncheckedArgumentsEnd(), values );
+        return true;
+    }
+
+    // Decodes the arguments of m, throwing WrongArgumentTypeException if
+    // its type tags don't match.
+    explicit TypedMessage( const ReceivedMessage& m )
+    {
+        if( !TryDecode( m, values_ ) )
+            throw WrongArgumentTypeException();
+    }
+
+    const tuple_type& Values() const { return values_; }
+
+    template< std::size_t I >
+    const typename std::tuple_element< I, tuple_type >::type& Get() const
+        { return std::get< I >( values_ ); }
+
+    // Constructs T from the arguments, e.g. an aggregate with members of
+    // the same types in the same order: T{ arg0, arg1, ... }
+    template< typename T >
+    T As() const { return As< T >( typename MakeIndices< ARGUMENT_COUNT >::type() ); }
+
+private:
+    tuple_type values_;
+
+    static const char typeTags_[ sizeof...(Args) + 1 ];
+
+    template< std::size_t... I > struct Indices{};
+
+    template< std::size_t N, std::size_t... I >
+    struct MakeIndices : MakeIndices< N - 1, N - 1, I... >{};
+
+    template< std::size_t... I >
+    struct MakeIndices< 0, I... >{ typedef Indices< I... > type; };
+
+    template< typename T, std::size_t... I >
+    T As( Indices< I... > ) const { return T{ std::get< I >( values_ )... }; }
+
+    template< std::size_t I >
+    using ArgumentType = TypedArgument< typename std::tuple_element< I, tuple_type >::type >;
+
+    template< std::size_t I, bool InRange = ( I < sizeof...(Args) ) >
+    struct IsFixedSize{
+        enum { value = ArgumentType< I >::FIXED_SIZE };
+    };
+
+    template< std::size_t I >
+    struct IsFixedSize< I, false >{
+        enum { value = 0 };
+    };
+
+    // Decodes argument I onwards. Offset is the distance from p to
+    // argument I, known at compile time since the last variable size
+    // argument.
+    template< std::size_t I, std::size_t Offset >
+    static typename std::enable_if< (I == sizeof...(Args)) >::type
+    Decode( const char *, const char *, tuple_type& ) {}
+
+    template< std::size_t I, std::size_t Offset >
+    static typename std::enable_if< (I < sizeof...(Args)) && IsFixedSize< I >::value >::type
+    Decode( const char *p, const char *end, tuple_type& values )
+    {
+        if( end && end - p < (std::ptrdiff_t)( Offset + ArgumentType< I >::SIZE ) )
+            throw MalformedMessageException( "arguments exceed message size" );
+
+        std::get< I >( values ) = ArgumentType< I >::Decode( p + Offset );
+        Decode< I + 1, Offset + ArgumentType< I >::SIZE >( p, end, values );
+    }
+
+    template< std::size_t I, std::size_t Offset >
+    static typename std::enable_if< (I < sizeof...(Args)) && !IsFixedSize< I >::value >::type
+    Decode( const char *p, const char *end, tuple_type& values )
+    {
+        if( end && end - p <= (std::ptrdiff_t)Offset )
+            throw MalformedMessageException( "arguments exceed message size" );
+
+        const char *argument = p + Offset;
+        const char *next = ArgumentType< I >::End( argument, end );
+        if( next == 0 )
+            throw MalformedMessageException( "arguments exceed message size" );
+
+        std::get< I >( values ) = ArgumentType< I >::Decode( argument );
+        Decode< I + 1, 0 >( next, end, values );
+    }
+};
+
+template< typename... Args >
+const char TypedMessage< Args... >::typeTags_[ sizeof...(Args) + 1 ] =
+        { (char)TypedArgument< Args >::TYPE_TAG..., '\0' };
+
+
+// ArrayView gives direct access to the elements of a homogeneous array,
+// or of a run of consecutive arguments of the same type. e.g. for a
+// message with the type tags "i[ff...f]":
+//
+//    ReceivedMessageArgumentIterator arg = m.ArgumentsBegin();
+//    ++arg;
+//    ArrayView< float > spectrum( m, *arg );
+//    std::size_t count = spectrum.CopyTo( buffer, bufferSize );
+//
+// CopyTo() converts a vector register of elements to host byte order at
+// a time, with CopyBigEndian32() or CopyBigEndian64(), rather than one
+// element per call as AsFloat() does. T may be int32, float, int64 or
+// double.
+template< typename T >
+class ArrayView{
+    static_assert( std::is_arithmetic< T >::value && (std::size_t)TypedArgument< T >::SIZE == sizeof(T),
+            "ArrayView elements must be int32, float, int64 or double" );
+public:
+    ArrayView() : data_( 0 ), size_( 0 ), argumentCount_( 0 ) {}
+
+    // If first is an array begin marker, views the elements of the array,
+    // which must all be of type T. Otherwise views the run of arguments
+    // of type T starting at first. Throws WrongArgumentTypeException if
+    // first or an element of the array (including a nested array) isn't
+    // of type T, and MalformedMessageException if m's arguments are
+    // validated on access and the elements run past the end of m.
+    ArrayView( const ReceivedMessage& m, const ReceivedMessageArgument& first )
+    {
+        const char *typeTag = first.TypeTagPointer();
+        bool isArray = ( *typeTag == ARRAY_BEGIN_TYPE_TAG );
+        const char *elementTags = isArray ? typeTag + 1 : typeTag;
+
+        // the type tags are terminated before the argument data starts
+        const char *elementTagsEnd = SkipTypeTagRun( elementTags, m.ArgumentData(), (char)TypedArgument< T >::TYPE_TAG );
+        if( isArray ? *elementTagsEnd != ARRAY_END_TYPE_TAG : elementTagsEnd == elementTags )
+            throw WrongArgumentTypeException();
+
+        data_ = first.ArgumentData();
+        size_ = (std::size_t)( elementTagsEnd - elementTags );
+        argumentCount_ = isArray ? size_ + 2 : size_;
+
+        const char *end = m.UncheckedArgumentsEnd();
+        if( end && (std::size_t)( end - data_ ) / sizeof(T) < size_ )
+            throw MalformedMessageException( "arguments exceed message size" );
+    }
+
+    std::size_t Size() const { return size_; }
+    bool Empty() const { return size_ == 0; }
+
+    T operator[]( std::size_t i ) const { return TypedArgument< T >::Decode( data_ + i * sizeof(T) ); }
+
+    // Copies the first n elements, or all of them if there are fewer, to
+    // out in host byte order. Returns the number copied.
+    std::size_t CopyTo( T *out, std::size_t n ) const
+    {
+        if( n > size_ )
+            n = size_;
+
+        if( sizeof(T) == 4 )
+            CopyBigEndian32( out, data_, n );
+        else
+            CopyBigEndian64( out, data_, n );
+        return n;
+    }
+
+    // The elements as they are in the message, big endian
+    const char *Data() const { return data_; }
+
+    // The number of message arguments the view spans, counting the
+    // array markers as ReceivedMessage::ArgumentCount() does
+    std::size_t ArgumentCount() const { return argumentCount_; }
+
+private:
+    const char *data_;
+    std::size_t size_;
+    std::size_t argumentCount_;
+};
+
+
+} // namespace osc
+
+#endif /* INCLUDED_OSCPACK_OSCTYPEDMESSAGE_H */
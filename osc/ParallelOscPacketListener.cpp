@@ -0,0 +1,335 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#include "ParallelOscPacketListener.h"
+
+#include <cassert>
+#include <cstring>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../ip/IpEndpointName.h"
+
+
+namespace osc{
+
+class ParallelOscPacketListener::Implementation{
+
+    // messages are queued as a header followed by the message contents,
+    // padded so that the next header is aligned
+    struct MessageHeader{
+        std::size_t size;
+        IpEndpointName remoteEndpoint;
+    };
+
+    static std::size_t RecordSize( std::size_t messageSize )
+    {
+        const std::size_t alignment = sizeof(std::size_t);
+        return sizeof(MessageHeader) + ((messageSize + alignment - 1) & ~(alignment - 1));
+    }
+
+    struct Worker{
+        Worker()
+            : queuedRecordCount( 0 ), isWaiting( false ), isRunning( false ), stopping( false ) {}
+
+        std::mutex mutex;
+        std::condition_variable workAvailable; // signalled when a message is queued for an idle worker
+        std::condition_variable workDone;      // signalled after each processed batch
+
+        // records appended by the receiving thread. the worker swaps the
+        // whole queue out and processes it as a batch without the lock.
+        std::vector<char> queue;
+        std::size_t queuedRecordCount;
+        bool isWaiting;
+        bool isRunning;     // accepting messages, between Start() and Stop()
+        bool stopping;
+
+        WorkerStatistics statistics;
+        std::thread thread;
+    };
+
+    ParallelOscPacketListener *listener_;
+    DispatchKey dispatchKey_;
+    std::size_t maxQueuedMessages_;
+    std::vector<Worker*> workers_;
+    bool isRunning_;
+
+    static void RunWorker( Implementation *impl, Worker *worker )
+    {
+        std::vector<char> batch;
+
+        std::unique_lock<std::mutex> lock( worker->mutex );
+        for(;;){
+            while( worker->queuedRecordCount == 0 && !worker->stopping ){
+                worker->isWaiting = true;
+                worker->workAvailable.wait( lock );
+                worker->isWaiting = false;
+            }
+
+            // queued messages are still processed when stopping
+            if( worker->queuedRecordCount == 0 )
+                break;
+
+            batch.clear();
+            batch.swap( worker->queue );
+            std::size_t count = worker->queuedRecordCount;
+            worker->queuedRecordCount = 0;
+            lock.unlock();
+
+            unsigned long errorCount = 0;
+            const char *record = batch.empty() ? 0 : &batch[0];
+            for( std::size_t i = 0; i < count; ++i ){
+                const MessageHeader *header = reinterpret_cast<const MessageHeader*>( record );
+                const char *contents = record + sizeof(MessageHeader);
+                try{
+                    // the message was validated on the receiving thread,
+                    // unless it came from a trusted sender
+                    ReceivedMessage m( ReceivedPacket( contents, header->size ), VALIDATE_ARGUMENTS_ON_ACCESS );
+                    impl->listener_->ProcessMessage( m, header->remoteEndpoint );
+                }catch( std::exception& e ){
+                    ++errorCount;
+                    impl->listener_->ProcessMessageException( e, header->remoteEndpoint );
+                }
+                record += RecordSize( header->size );
+            }
+
+            lock.lock();
+            worker->statistics.queuedCount -= count;
+            worker->statistics.processedCount += count;
+            worker->statistics.errorCount += errorCount;
+            worker->workDone.notify_all();
+        }
+    }
+
+    std::size_t WorkerIndex( const char *addressPattern, const IpEndpointName& remoteEndpoint ) const
+    {
+        unsigned long hash;
+        if( dispatchKey_ == ADDRESS_PATTERN_KEY ){
+            // FNV-1a
+            hash = 2166136261UL;
+            for( const char *c = addressPattern; *c != '\0'; ++c ){
+                hash ^= (unsigned char)*c;
+                hash = (hash * 16777619UL) & 0xFFFFFFFFUL;
+            }
+        }else{
+            hash = ((remoteEndpoint.address * 2654435761UL) & 0xFFFFFFFFUL) ^ (unsigned long)remoteEndpoint.port;
+        }
+
+        return (std::size_t)(hash % workers_.size());
+    }
+
+public:
+    Implementation( ParallelOscPacketListener *listener, std::size_t workerCount,
+            DispatchKey dispatchKey, std::size_t maxQueuedMessages )
+        : listener_( listener )
+        , dispatchKey_( dispatchKey )
+        , maxQueuedMessages_( maxQueuedMessages )
+        , isRunning_( false )
+    {
+        assert( workerCount > 0 );
+        assert( maxQueuedMessages > 0 );
+
+        for( std::size_t i = 0; i < workerCount; ++i )
+            workers_.push_back( new Worker );
+    }
+
+    ~Implementation()
+    {
+        Stop();
+
+        for( std::vector<Worker*>::iterator i = workers_.begin(); i != workers_.end(); ++i )
+            delete *i;
+    }
+
+    void Start()
+    {
+        assert( !isRunning_ );
+
+        for( std::vector<Worker*>::iterator i = workers_.begin(); i != workers_.end(); ++i ){
+            {
+                std::lock_guard<std::mutex> lock( (*i)->mutex );
+                (*i)->isRunning = true;
+            }
+            (*i)->thread = std::thread( RunWorker, this, *i );
+        }
+
+        isRunning_ = true;
+    }
+
+    void Stop()
+    {
+        if( !isRunning_ )
+            return;
+
+        for( std::vector<Worker*>::iterator i = workers_.begin(); i != workers_.end(); ++i ){
+            std::lock_guard<std::mutex> lock( (*i)->mutex );
+            (*i)->isRunning = false;
+            (*i)->stopping = true;
+            (*i)->workAvailable.notify_one();
+            (*i)->workDone.notify_all(); // a receiving thread waiting for queue space drops its message
+        }
+
+        for( std::vector<Worker*>::iterator i = workers_.begin(); i != workers_.end(); ++i ){
+            (*i)->thread.join();
+            (*i)->stopping = false;
+        }
+
+        isRunning_ = false;
+    }
+
+    void Flush()
+    {
+        for( std::vector<Worker*>::iterator i = workers_.begin(); i != workers_.end(); ++i ){
+            std::unique_lock<std::mutex> lock( (*i)->mutex );
+            while( (*i)->statistics.queuedCount > 0 )
+                (*i)->workDone.wait( lock );
+        }
+    }
+
+    void QueueMessage( const char *contents, std::size_t size,
+            const char *addressPattern, const IpEndpointName& remoteEndpoint )
+    {
+        Worker *worker = workers_[ WorkerIndex( addressPattern, remoteEndpoint ) ];
+
+        std::unique_lock<std::mutex> lock( worker->mutex );
+        if( worker->isRunning && worker->statistics.queuedCount >= maxQueuedMessages_ ){
+            ++worker->statistics.blockedCount;
+            while( worker->isRunning && worker->statistics.queuedCount >= maxQueuedMessages_ )
+                worker->workDone.wait( lock );
+        }
+
+        // nothing would process the message, and a full queue would never drain
+        if( !worker->isRunning ){
+            ++worker->statistics.droppedCount;
+            return;
+        }
+
+        std::size_t offset = worker->queue.size();
+        worker->queue.resize( offset + RecordSize( size ) );
+        MessageHeader *header = reinterpret_cast<MessageHeader*>( &worker->queue[ offset ] );
+        header->size = size;
+        header->remoteEndpoint = remoteEndpoint;
+        std::memcpy( &worker->queue[ offset + sizeof(MessageHeader) ], contents, size );
+
+        ++worker->queuedRecordCount;
+        if( ++worker->statistics.queuedCount > worker->statistics.maxQueuedCount )
+            worker->statistics.maxQueuedCount = worker->statistics.queuedCount;
+
+        bool wake = worker->isWaiting;
+        lock.unlock();
+
+        if( wake )
+            worker->workAvailable.notify_one();
+    }
+
+    std::size_t WorkerCount() const { return workers_.size(); }
+
+    WorkerStatistics GetWorkerStatistics( std::size_t workerIndex ) const
+    {
+        assert( workerIndex < workers_.size() );
+        Worker *worker = workers_[ workerIndex ];
+
+        std::lock_guard<std::mutex> lock( worker->mutex );
+        return worker->statistics;
+    }
+};
+
+
+ParallelOscPacketListener::ParallelOscPacketListener( std::size_t workerCount,
+        DispatchKey dispatchKey, std::size_t maxQueuedMessages )
+{
+    impl_ = new Implementation( this, workerCount, dispatchKey, maxQueuedMessages );
+}
+
+ParallelOscPacketListener::~ParallelOscPacketListener()
+{
+    delete impl_;
+}
+
+void ParallelOscPacketListener::Start()
+{
+    impl_->Start();
+}
+
+void ParallelOscPacketListener::Stop()
+{
+    impl_->Stop();
+}
+
+void ParallelOscPacketListener::Flush()
+{
+    impl_->Flush();
+}
+
+void ParallelOscPacketListener::QueueBundleElements( const ReceivedBundle& bundle,
+        const IpEndpointName& remoteEndpoint )
+{
+    for( ReceivedBundle::const_iterator i = bundle.ElementsBegin();
+            i != bundle.ElementsEnd(); ++i ){
+        if( i->IsBundle() ){
+            QueueBundleElements( ReceivedBundle(*i), remoteEndpoint );
+        }else{
+            ReceivedMessage m( *i, ArgumentValidationFor( remoteEndpoint ) ); // validates the message
+            impl_->QueueMessage( i->Contents(), i->Size(), m.AddressPattern(), remoteEndpoint );
+        }
+    }
+}
+
+void ParallelOscPacketListener::ProcessPacket( const char *data, int size,
+        const IpEndpointName& remoteEndpoint )
+{
+    osc::ReceivedPacket p( data, size );
+    if( p.IsBundle() ){
+        QueueBundleElements( ReceivedBundle(p), remoteEndpoint );
+    }else{
+        ReceivedMessage m( p, ArgumentValidationFor( remoteEndpoint ) ); // validates the message
+        impl_->QueueMessage( p.Contents(), p.Size(), m.AddressPattern(), remoteEndpoint );
+    }
+}
+
+std::size_t ParallelOscPacketListener::WorkerCount() const
+{
+    return impl_->WorkerCount();
+}
+
+ParallelOscPacketListener::WorkerStatistics ParallelOscPacketListener::GetWorkerStatistics( std::size_t workerIndex ) const
+{
+    return impl_->GetWorkerStatistics( workerIndex );
+}
+
+} // namespace osc
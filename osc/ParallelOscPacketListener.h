@@ -0,0 +1,131 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_PARALLELOSCPACKETLISTENER_H
+#define INCLUDED_OSCPACK_PARALLELOSCPACKETLISTENER_H
+
+#include <cstring> // size_t
+#include <exception>
+
+#include "OscPacketListener.h"
+
+
+namespace osc{
+
+// ParallelOscPacketListener dispatches the messages of each received
+// packet to a pool of worker threads. Each message is assigned to a worker
+// by hashing its address pattern (or the sender's endpoint), so messages
+// with the same key are processed in arrival order on the same worker,
+// while messages with different keys are processed in parallel.
+//
+// Derive from it as you would from OscPacketListener and implement
+// ProcessMessage(), which is called on the worker threads. The elements of
+// a bundle are dispatched separately, ProcessBundle() isn't called.
+// Packets are still parsed and validated on the receiving thread, so a
+// malformed packet throws from ProcessPacket() as before. The arguments of
+// messages from trusted senders are only checked as they are read (see
+// OscPacketListener::IsTrustedSender()).
+//
+// When a worker's queue is full the receiving thread waits for it, which
+// applies back pressure to the socket rather than reordering or dropping
+// messages. Messages received while the workers aren't running (before
+// Start() or after Stop()) are dropped and counted.
+
+class ParallelOscPacketListener : public OscPacketListener{
+    class Implementation;
+    Implementation *impl_;
+
+    void QueueBundleElements( const ReceivedBundle& bundle, const IpEndpointName& remoteEndpoint );
+
+protected:
+    // called on a worker thread
+    virtual void ProcessMessage( const osc::ReceivedMessage& m,
+            const IpEndpointName& remoteEndpoint ) = 0;
+
+    // Called on the worker thread when ProcessMessage() throws an
+    // exception derived from std::exception (including osc::Exception),
+    // since there is no caller to propagate it to. The message is counted
+    // in WorkerStatistics::errorCount and the worker moves on. Any other
+    // exception terminates the program, as on any other thread.
+    virtual void ProcessMessageException( const std::exception& e,
+            const IpEndpointName& remoteEndpoint )
+    {
+        (void) e;
+        (void) remoteEndpoint;
+    }
+
+public:
+    enum DispatchKey{
+        ADDRESS_PATTERN_KEY,  // per address ordering
+        REMOTE_ENDPOINT_KEY   // per sender ordering
+    };
+
+    struct WorkerStatistics{
+        WorkerStatistics()
+            : queuedCount( 0 ), maxQueuedCount( 0 ), processedCount( 0 )
+            , blockedCount( 0 ), errorCount( 0 ), droppedCount( 0 ) {}
+
+        std::size_t queuedCount;     // messages waiting or being processed
+        std::size_t maxQueuedCount;  // the largest queuedCount seen
+        unsigned long processedCount;
+        unsigned long blockedCount;  // times the receiving thread waited for a full queue
+        unsigned long errorCount;    // exceptions thrown by ProcessMessage(), see ProcessMessageException()
+        unsigned long droppedCount;  // messages received while the worker wasn't running
+    };
+
+    // Each worker queues up to maxQueuedMessages messages.
+    explicit ParallelOscPacketListener( std::size_t workerCount,
+            DispatchKey dispatchKey=ADDRESS_PATTERN_KEY, std::size_t maxQueuedMessages=4096 );
+    // Stop() must be called before the derived class is destroyed,
+    // otherwise a worker may call ProcessMessage() on a partly destroyed object.
+    virtual ~ParallelOscPacketListener();
+
+    void Start(); // start the worker threads
+    // process the queued messages, then stop the worker threads
+    void Stop();
+    // wait until every queued message has been processed
+    void Flush();
+
+    virtual void ProcessPacket( const char *data, int size,
+            const IpEndpointName& remoteEndpoint );
+
+    std::size_t WorkerCount() const;
+    WorkerStatistics GetWorkerStatistics( std::size_t workerIndex ) const;
+};
+
+} // namespace osc
+
+#endif /* INCLUDED_OSCPACK_PARALLELOSCPACKETLISTENER_H */
@@ -0,0 +1,1642 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#include "OscNetworkBenchmarks.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <poll.h>
+#include <sys/resource.h>
+#endif
+
+#include "ip/UdpSocket.h"
+#include "ip/IpEndpointName.h"
+#include "ip/PacketListener.h"
+#include "ip/SendCompletionListener.h"
+#include "ip/TimerListener.h"
+#include "ip/ShardedUdpReceiveServer.h"
+#include "ip/UdpSocketListenerThread.h"
+#include "osc/OscOutboundPacketStream.h"
+#include "osc/OscPacketListener.h"
+#include "osc/ParallelOscPacketListener.h"
+#include "osc/OscReceivedElements.h"
+
+
+namespace osc{
+
+static double CurrentTimeSeconds()
+{
+    return std::chrono::duration<double>(
+            std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+
+static void EnsureFileDescriptorLimit( std::size_t count )
+{
+#if !defined(_WIN32)
+    struct rlimit limit;
+    if( getrlimit( RLIMIT_NOFILE, &limit ) == 0 && limit.rlim_cur < count ){
+        limit.rlim_cur = ( limit.rlim_max == RLIM_INFINITY || limit.rlim_max >= count )
+                ? count : limit.rlim_max;
+        setrlimit( RLIMIT_NOFILE, &limit );
+    }
+#else
+    (void) count;
+#endif
+}
+
+
+// bind a socket to the next free loopback port and return its endpoint
+static IpEndpointName BindLoopback( UdpSocket& socket )
+{
+    static int nextPort = 20000;
+
+    while( nextPort < 65535 ){
+        IpEndpointName endpoint( "127.0.0.1", nextPort++ );
+        try{
+            socket.Bind( endpoint );
+            return endpoint;
+        }catch( std::exception& ){
+            // port in use, try the next one
+        }
+    }
+
+    throw std::runtime_error( "no free loopback ports\n" );
+}
+
+//-----------------------------------------------------------------------
+// wakeup benchmark: measures the cost of one multiplexer wakeup (wait,
+// receive, dispatch) as the number of attached sockets grows. a single
+// packet is kept in flight. each time it arrives the listener sends it on
+// to another of the attached sockets.
+
+class WakeupBenchmarkListener : public PacketListener{
+    SocketReceiveMultiplexer& mux_;
+    UdpSocket& transmitSocket_;
+    const std::vector<IpEndpointName>& endpoints_;
+    std::size_t packetCount_;
+    std::size_t receivedCount_;
+public:
+    WakeupBenchmarkListener( SocketReceiveMultiplexer& mux, UdpSocket& transmitSocket,
+            const std::vector<IpEndpointName>& endpoints, std::size_t packetCount )
+        : mux_( mux )
+        , transmitSocket_( transmitSocket )
+        , endpoints_( endpoints )
+        , packetCount_( packetCount )
+        , receivedCount_( 0 ) {}
+
+    std::size_t ReceivedCount() const { return receivedCount_; }
+
+    virtual void ProcessPacket( const char *data, int size,
+            const IpEndpointName& remoteEndpoint )
+    {
+        (void) remoteEndpoint;
+
+        if( ++receivedCount_ == packetCount_ ){
+            mux_.Break();
+            return;
+        }
+
+        // stride through the sockets with a large prime so that successive
+        // packets land on unrelated descriptors
+        std::size_t next = (receivedCount_ * 7919) % endpoints_.size();
+        transmitSocket_.SendTo( endpoints_[next], data, size );
+    }
+};
+
+
+// returns the mean wakeup cost in microseconds
+static double RunWakeupBenchmark( SocketReceiveMultiplexer::Backend backend,
+        const std::vector<UdpSocket*>& sockets, const std::vector<IpEndpointName>& endpoints,
+        std::size_t packetCount )
+{
+    SocketReceiveMultiplexer mux( backend );
+    UdpSocket transmitSocket;
+    WakeupBenchmarkListener listener( mux, transmitSocket, endpoints, packetCount );
+
+    // the transmit socket is attached too (it never receives anything) so
+    // that the io_uring backend can submit its sends through the ring
+    BindLoopback( transmitSocket );
+    mux.AttachSocketListener( &transmitSocket, &listener );
+
+    for( std::size_t i = 0; i < sockets.size(); ++i )
+        mux.AttachSocketListener( sockets[i], &listener );
+
+    char packet[16];
+    std::memset( packet, 0, sizeof(packet) );
+    std::strcpy( packet, "/ping" );
+
+    double startTime = CurrentTimeSeconds();
+    transmitSocket.SendTo( endpoints[0], packet, sizeof(packet) );
+    mux.Run();
+    double elapsed = CurrentTimeSeconds() - startTime;
+
+    for( std::size_t i = 0; i < sockets.size(); ++i )
+        mux.DetachSocketListener( sockets[i], &listener );
+    mux.DetachSocketListener( &transmitSocket, &listener );
+
+    return (elapsed * 1000000.) / listener.ReceivedCount();
+}
+
+
+static void RunWakeupBenchmarks()
+{
+    const std::size_t socketCounts[] = { 10, 100, 500, 1000, 2000, 5000 };
+    const std::size_t socketCountsCount = sizeof(socketCounts) / sizeof(socketCounts[0]);
+    const std::size_t packetCount = 20000;
+
+    EnsureFileDescriptorLimit( socketCounts[ socketCountsCount - 1 ] + 64 );
+
+    std::cout << "multiplexer wakeup cost (microseconds per packet, "
+            << packetCount << " packets)\n";
+    std::cout << std::setw(10) << "sockets" << std::setw(12) << "default"
+            << std::setw(12) << "select" << std::setw(12) << "io_uring" << "\n";
+
+    for( std::size_t i = 0; i < socketCountsCount; ++i ){
+        std::vector<UdpSocket*> sockets;
+        std::vector<IpEndpointName> endpoints;
+
+        try{
+            for( std::size_t j = 0; j < socketCounts[i]; ++j ){
+                sockets.push_back( new UdpSocket );
+                endpoints.push_back( BindLoopback( *sockets.back() ) );
+            }
+
+            double defaultUs = RunWakeupBenchmark(
+                    SocketReceiveMultiplexer::DEFAULT_BACKEND, sockets, endpoints, packetCount );
+
+            std::cout << std::setw(10) << socketCounts[i]
+                    << std::setw(12) << std::fixed << std::setprecision(2) << defaultUs;
+
+            try{
+                double selectUs = RunWakeupBenchmark(
+                        SocketReceiveMultiplexer::SELECT_BACKEND, sockets, endpoints, packetCount );
+                std::cout << std::setw(12) << selectUs;
+            }catch( std::exception& ){
+                // select() can't wait on descriptors >= FD_SETSIZE
+                std::cout << std::setw(12) << "n/a";
+            }
+
+            // falls back to the default backend if io_uring is unavailable
+            double ioUringUs = RunWakeupBenchmark(
+                    SocketReceiveMultiplexer::IO_URING_BACKEND, sockets, endpoints, packetCount );
+            std::cout << std::setw(12) << ioUringUs << "\n";
+        }catch( std::exception& e ){
+            std::cout << "error running wakeup benchmark with " << socketCounts[i]
+                    << " sockets: " << e.what();
+        }
+
+        for( std::size_t j = 0; j < sockets.size(); ++j )
+            delete sockets[j];
+    }
+}
+
+//-----------------------------------------------------------------------
+// receive batch benchmark: measures per-packet receive cost for different
+// receive batch sizes. bursts of packets are queued on the receive socket,
+// then drained by the multiplexer. packets carry a sequence number which is
+// checked to ensure that batches are dispatched in arrival order.
+
+class BurstBenchmarkListener : public PacketListener{
+    SocketReceiveMultiplexer& mux_;
+    UdpSocket& transmitSocket_;
+    IpEndpointName destination_;
+    std::size_t burstSize_;
+    std::size_t burstCount_;
+    std::size_t receivedCount_;
+    std::size_t outOfOrderCount_;
+    double sendSeconds_;
+public:
+    BurstBenchmarkListener( SocketReceiveMultiplexer& mux, UdpSocket& transmitSocket,
+            const IpEndpointName& destination, std::size_t burstSize, std::size_t burstCount )
+        : mux_( mux )
+        , transmitSocket_( transmitSocket )
+        , destination_( destination )
+        , burstSize_( burstSize )
+        , burstCount_( burstCount )
+        , receivedCount_( 0 )
+        , outOfOrderCount_( 0 )
+        , sendSeconds_( 0. ) {}
+
+    std::size_t ReceivedCount() const { return receivedCount_; }
+    std::size_t OutOfOrderCount() const { return outOfOrderCount_; }
+    double SendSeconds() const { return sendSeconds_; }
+
+    void SendBurst()
+    {
+        double startTime = CurrentTimeSeconds();
+
+        char packet[16];
+        std::memset( packet, 0, sizeof(packet) );
+        std::strcpy( packet, "/burst" );
+
+        for( std::size_t i = 0; i < burstSize_; ++i ){
+            unsigned int sequence = (unsigned int)(receivedCount_ + i);
+            std::memcpy( packet + 12, &sequence, sizeof(sequence) );
+            transmitSocket_.SendTo( destination_, packet, sizeof(packet) );
+        }
+
+        sendSeconds_ += CurrentTimeSeconds() - startTime;
+    }
+
+    virtual void ProcessPacket( const char *data, int size,
+            const IpEndpointName& remoteEndpoint )
+    {
+        (void) size;
+        (void) remoteEndpoint;
+
+        unsigned int sequence = 0;
+        std::memcpy( &sequence, data + 12, sizeof(sequence) );
+        if( sequence != (unsigned int)receivedCount_ )
+            ++outOfOrderCount_;
+
+        ++receivedCount_;
+        if( receivedCount_ % burstSize_ == 0 ){
+            if( receivedCount_ == burstSize_ * burstCount_ )
+                mux_.Break();
+            else
+                SendBurst();
+        }
+    }
+};
+
+
+static void RunReceiveBatchBenchmarks()
+{
+    const std::size_t batchSizes[] = { 1, 8, 32, 64 };
+    const std::size_t batchSizesCount = sizeof(batchSizes) / sizeof(batchSizes[0]);
+    const std::size_t burstSize = 64;
+    const std::size_t burstCount = 2000;
+
+    std::cout << "receive cost (microseconds per packet, bursts of " << burstSize
+            << " packets, excluding send)\n";
+    std::cout << std::setw(10) << "batch" << std::setw(12) << "us/packet"
+            << std::setw(14) << "out of order" << "\n";
+
+    UdpSocket receiveSocket;
+    IpEndpointName destination = BindLoopback( receiveSocket );
+
+    // the extra last row uses the io_uring backend, which receives through
+    // multishot recvmsg and ignores the receive batch size
+    for( std::size_t i = 0; i <= batchSizesCount; ++i ){
+        bool useIoUring = ( i == batchSizesCount );
+        receiveSocket.SetReceiveBatchSize( useIoUring ? 1 : batchSizes[i] );
+
+        SocketReceiveMultiplexer mux( useIoUring
+                ? SocketReceiveMultiplexer::IO_URING_BACKEND : SocketReceiveMultiplexer::DEFAULT_BACKEND );
+        UdpSocket transmitSocket;
+        BurstBenchmarkListener listener( mux, transmitSocket, destination, burstSize, burstCount );
+        mux.AttachSocketListener( &receiveSocket, &listener );
+
+        double startTime = CurrentTimeSeconds();
+        listener.SendBurst();
+        mux.Run();
+        double elapsed = CurrentTimeSeconds() - startTime;
+
+        mux.DetachSocketListener( &receiveSocket, &listener );
+
+        if( useIoUring )
+            std::cout << std::setw(10) << "io_uring";
+        else
+            std::cout << std::setw(10) << batchSizes[i];
+        std::cout << std::setw(12) << std::fixed << std::setprecision(2)
+                << ((elapsed - listener.SendSeconds()) * 1000000.) / listener.ReceivedCount()
+                << std::setw(14) << listener.OutOfOrderCount() << "\n";
+    }
+}
+
+//-----------------------------------------------------------------------
+// batch dispatch benchmark: a listener which hands each packet on to a
+// consumer thread through a mutex protected queue, locking once per packet
+// (ProcessPacket()) or once per batch (ProcessPackets()).
+
+class HandOffBurstListener : public BurstBenchmarkListener{
+    bool lockPerBatch_;
+    std::mutex mutex_;
+    std::deque<unsigned int> queue_;
+    std::atomic<bool> stopping_;
+    std::atomic<std::size_t> consumedCount_;
+    std::thread consumer_;
+
+    void Consume()
+    {
+        while( !stopping_.load() ){
+            std::size_t count = 0;
+            {
+                std::lock_guard<std::mutex> lock( mutex_ );
+                count = queue_.size();
+                queue_.clear();
+            }
+            consumedCount_.fetch_add( count );
+            if( count == 0 )
+                std::this_thread::yield();
+        }
+    }
+
+    void Enqueue( const char *data )
+    {
+        unsigned int sequence = 0;
+        std::memcpy( &sequence, data + 12, sizeof(sequence) );
+        queue_.push_back( sequence );
+    }
+
+public:
+    HandOffBurstListener( SocketReceiveMultiplexer& mux, UdpSocket& transmitSocket,
+            const IpEndpointName& destination, std::size_t burstSize, std::size_t burstCount, bool lockPerBatch )
+        : BurstBenchmarkListener( mux, transmitSocket, destination, burstSize, burstCount )
+        , lockPerBatch_( lockPerBatch )
+        , stopping_( false )
+        , consumedCount_( 0 )
+    {
+        consumer_ = std::thread( &HandOffBurstListener::Consume, this );
+    }
+
+    ~HandOffBurstListener()
+    {
+        stopping_.store( true );
+        consumer_.join();
+    }
+
+    virtual void ProcessPacket( const char *data, int size,
+            const IpEndpointName& remoteEndpoint )
+    {
+        {
+            std::lock_guard<std::mutex> lock( mutex_ );
+            Enqueue( data );
+        }
+        BurstBenchmarkListener::ProcessPacket( data, size, remoteEndpoint );
+    }
+
+    virtual void ProcessPackets( const PacketBatch& batch )
+    {
+        if( !lockPerBatch_ ){
+            PacketListener::ProcessPackets( batch );
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock( mutex_ );
+            for( std::size_t i = 0; i < batch.Size(); ++i )
+                Enqueue( batch[i].data );
+        }
+        for( std::size_t i = 0; i < batch.Size(); ++i )
+            BurstBenchmarkListener::ProcessPacket( batch[i].data, batch[i].size, batch[i].remoteEndpoint );
+    }
+};
+
+
+static void RunBatchDispatchBenchmarks()
+{
+    const std::size_t batchSizes[] = { 1, 8, 32, 64 };
+    const std::size_t batchSizesCount = sizeof(batchSizes) / sizeof(batchSizes[0]);
+    const std::size_t burstSize = 64;
+    const std::size_t burstCount = 2000;
+
+    std::cout << "receive and hand-off cost (microseconds per packet, bursts of " << burstSize
+            << " packets, excluding send)\n";
+    std::cout << std::setw(10) << "batch" << std::setw(14) << "lock/packet" << std::setw(14) << "lock/batch" << "\n";
+
+    UdpSocket receiveSocket;
+    IpEndpointName destination = BindLoopback( receiveSocket );
+
+    for( std::size_t i = 0; i < batchSizesCount; ++i ){
+        receiveSocket.SetReceiveBatchSize( batchSizes[i] );
+        std::cout << std::setw(10) << batchSizes[i];
+
+        for( int lockPerBatch = 0; lockPerBatch < 2; ++lockPerBatch ){
+            SocketReceiveMultiplexer mux;
+            UdpSocket transmitSocket;
+            HandOffBurstListener listener( mux, transmitSocket, destination, burstSize, burstCount, lockPerBatch != 0 );
+            mux.AttachSocketListener( &receiveSocket, &listener );
+
+            double startTime = CurrentTimeSeconds();
+            listener.SendBurst();
+            mux.Run();
+            double elapsed = CurrentTimeSeconds() - startTime;
+
+            mux.DetachSocketListener( &receiveSocket, &listener );
+
+            std::cout << std::setw(14) << std::fixed << std::setprecision(2)
+                    << ((elapsed - listener.SendSeconds()) * 1000000.) / listener.ReceivedCount();
+        }
+        std::cout << "\n";
+    }
+}
+
+//-----------------------------------------------------------------------
+// receive timestamp benchmark: measures how long datagrams wait in the
+// socket queue, from the kernel's receive timestamp to the listener
+// callback. bursts of packets are queued on the receive socket, so later
+// packets in a burst wait for the earlier ones to be dispatched.
+
+class DwellTimeListener : public BurstBenchmarkListener{
+    std::vector<double> dwellMicroseconds_;
+    std::size_t untimestampedCount_;
+public:
+    DwellTimeListener( SocketReceiveMultiplexer& mux, UdpSocket& transmitSocket,
+            const IpEndpointName& destination, std::size_t burstSize, std::size_t burstCount )
+        : BurstBenchmarkListener( mux, transmitSocket, destination, burstSize, burstCount )
+        , untimestampedCount_( 0 ) {}
+
+    std::vector<double>& DwellMicroseconds() { return dwellMicroseconds_; }
+    std::size_t UntimestampedCount() const { return untimestampedCount_; }
+
+    virtual void ProcessTimestampedPacket( const char *data, int size,
+            const IpEndpointName& remoteEndpoint, const PacketTimestamp& timestamp )
+    {
+        if( timestamp.source == PacketTimestamp::NO_TIMESTAMP ){
+            ++untimestampedCount_;
+        }else{
+            // receive timestamps use the system clock
+            double now = std::chrono::duration<double>(
+                    std::chrono::system_clock::now().time_since_epoch() ).count();
+            double received = (double)timestamp.seconds + timestamp.nanoseconds * 1e-9;
+            dwellMicroseconds_.push_back( (now - received) * 1000000. );
+        }
+
+        ProcessPacket( data, size, remoteEndpoint );
+    }
+};
+
+
+static void RunReceiveTimestampBenchmarks()
+{
+    const std::size_t burstSize = 64;
+    const std::size_t burstCount = 500;
+
+    struct Configuration{
+        const char *name;
+        SocketReceiveMultiplexer::Backend backend;
+        std::size_t batchSize;
+    };
+    const Configuration configurations[] = {
+        { "select", SocketReceiveMultiplexer::SELECT_BACKEND, 1 },
+        { "default", SocketReceiveMultiplexer::DEFAULT_BACKEND, 1 },
+        { "batch 64", SocketReceiveMultiplexer::DEFAULT_BACKEND, 64 },
+        { "io_uring", SocketReceiveMultiplexer::IO_URING_BACKEND, 1 },
+    };
+    const std::size_t configurationsCount = sizeof(configurations) / sizeof(configurations[0]);
+
+    UdpSocket receiveSocket;
+    IpEndpointName destination = BindLoopback( receiveSocket );
+    if( !receiveSocket.SetReceiveTimestamps( UdpSocket::SOFTWARE_RECEIVE_TIMESTAMPS ) ){
+        std::cout << "receive timestamps are not supported\n";
+        return;
+    }
+
+    std::cout << "socket queue dwell time (microseconds, bursts of " << burstSize << " packets)\n";
+    std::cout << std::setw(10) << "backend" << std::setw(10) << "p50" << std::setw(10) << "p99"
+            << std::setw(10) << "max" << std::setw(16) << "no timestamp" << "\n";
+
+    for( std::size_t i = 0; i < configurationsCount; ++i ){
+        receiveSocket.SetReceiveBatchSize( configurations[i].batchSize );
+
+        SocketReceiveMultiplexer mux( configurations[i].backend );
+        UdpSocket transmitSocket;
+        DwellTimeListener listener( mux, transmitSocket, destination, burstSize, burstCount );
+        mux.AttachSocketListener( &receiveSocket, &listener );
+
+        listener.SendBurst();
+        mux.Run();
+
+        mux.DetachSocketListener( &receiveSocket, &listener );
+
+        std::vector<double>& dwell = listener.DwellMicroseconds();
+        std::cout << std::setw(10) << configurations[i].name << std::fixed << std::setprecision(2);
+        if( dwell.empty() ){
+            std::cout << std::setw(10) << "n/a" << std::setw(10) << "n/a" << std::setw(10) << "n/a";
+        }else{
+            std::sort( dwell.begin(), dwell.end() );
+            std::cout << std::setw(10) << dwell[ dwell.size() / 2 ]
+                    << std::setw(10) << dwell[ (dwell.size() * 99) / 100 ]
+                    << std::setw(10) << dwell.back();
+        }
+        std::cout << std::setw(16) << listener.UntimestampedCount() << "\n";
+    }
+}
+
+//-----------------------------------------------------------------------
+// send batch benchmark: compares a loop of SendTo() calls against
+// SendToBatch() when fanning out small packets to many destinations.
+// the receiving sockets are never read, the kernel discards packets
+// once their receive buffers are full.
+
+static void RunSendBatchBenchmarks()
+{
+    const std::size_t destinationCount = 16;
+    const std::size_t packetsPerFrame = 1024;
+    const std::size_t frameCount = 200;
+
+    std::vector<UdpSocket*> receiveSockets;
+    std::vector<IpEndpointName> destinations;
+    for( std::size_t i = 0; i < destinationCount; ++i ){
+        receiveSockets.push_back( new UdpSocket );
+        destinations.push_back( BindLoopback( *receiveSockets.back() ) );
+    }
+
+    char packet[32];
+    std::memset( packet, 0, sizeof(packet) );
+    std::strcpy( packet, "/fan/out" );
+
+    std::vector<UdpBatchEntry> entries;
+    for( std::size_t i = 0; i < packetsPerFrame; ++i )
+        entries.push_back( UdpBatchEntry( destinations[ i % destinationCount ], packet, sizeof(packet) ) );
+
+    UdpSocket transmitSocket;
+
+    double startTime = CurrentTimeSeconds();
+    for( std::size_t frame = 0; frame < frameCount; ++frame ){
+        for( std::size_t i = 0; i < packetsPerFrame; ++i )
+            transmitSocket.SendTo( entries[i].remoteEndpoint, entries[i].data, entries[i].size );
+    }
+    double sendToSeconds = CurrentTimeSeconds() - startTime;
+
+    std::size_t failedCount = 0;
+    startTime = CurrentTimeSeconds();
+    for( std::size_t frame = 0; frame < frameCount; ++frame )
+        failedCount += packetsPerFrame - transmitSocket.SendToBatch( &entries[0], packetsPerFrame );
+    double sendToBatchSeconds = CurrentTimeSeconds() - startTime;
+
+    const double packetCount = (double)(packetsPerFrame * frameCount);
+    std::cout << "send cost (microseconds per packet, " << packetsPerFrame << " packets per frame to "
+            << destinationCount << " destinations)\n";
+    std::cout << std::setw(14) << "SendTo loop" << std::setw(14) << "SendToBatch"
+            << std::setw(10) << "failed" << "\n";
+    std::cout << std::setw(14) << std::fixed << std::setprecision(2) << (sendToSeconds * 1000000.) / packetCount
+            << std::setw(14) << (sendToBatchSeconds * 1000000.) / packetCount
+            << std::setw(10) << failedCount << "\n";
+
+    for( std::size_t i = 0; i < receiveSockets.size(); ++i )
+        delete receiveSockets[i];
+}
+
+//-----------------------------------------------------------------------
+// segmented send benchmark: compares per-packet Send() against SendBatch()
+// with and without UDP segmentation offload when streaming equal-sized
+// packets to one destination. afterwards one frame is sent with
+// segmentation enabled and drained from the receiver to check that it
+// arrives as individual datagrams.
+
+// receives until no datagram has arrived for 100ms, counting the
+// datagrams of the expected size
+class DrainListener : public PacketListener, public TimerListener{
+    SocketReceiveMultiplexer *mux_;
+    std::size_t expectedSize_;
+    std::size_t matchingCount_;
+    bool received_;
+public:
+    DrainListener( std::size_t expectedSize )
+        : mux_( 0 )
+        , expectedSize_( expectedSize )
+        , matchingCount_( 0 )
+        , received_( false ) {}
+
+    std::size_t MatchingCount() const { return matchingCount_; }
+
+    void Run( UdpSocket& socket )
+    {
+        SocketReceiveMultiplexer mux;
+        mux_ = &mux;
+        matchingCount_ = 0;
+        received_ = false;
+
+        mux.AttachSocketListener( &socket, this );
+        mux.AttachPeriodicTimerListener( 100, this );
+        mux.Run();
+        mux.DetachPeriodicTimerListener( this );
+        mux.DetachSocketListener( &socket, this );
+    }
+
+    virtual void ProcessPacket( const char *data, int size,
+            const IpEndpointName& remoteEndpoint )
+    {
+        (void) data;
+        (void) remoteEndpoint;
+
+        if( (std::size_t)size == expectedSize_ )
+            ++matchingCount_;
+        received_ = true;
+    }
+
+    virtual void TimerExpired()
+    {
+        if( !received_ )
+            mux_->Break();
+        received_ = false;
+    }
+};
+
+
+static void RunSegmentedSendBenchmarks()
+{
+    const std::size_t packetSizes[] = { 64, 256, 1024 };
+    const std::size_t packetSizesCount = sizeof(packetSizes) / sizeof(packetSizes[0]);
+    const std::size_t packetsPerFrame = 64;
+    const std::size_t frameCount = 2000;
+
+    UdpSocket receiveSocket;
+    IpEndpointName destination = BindLoopback( receiveSocket );
+
+    UdpSocket transmitSocket;
+    transmitSocket.Connect( destination );
+
+    std::cout << "send cost (microseconds per packet, " << packetsPerFrame
+            << " equal-sized packets per frame to one destination)\n";
+    std::cout << std::setw(8) << "bytes" << std::setw(10) << "Send"
+            << std::setw(12) << "SendBatch" << std::setw(12) << "segmented"
+            << std::setw(12) << "received" << "\n";
+
+    for( std::size_t i = 0; i < packetSizesCount; ++i ){
+        std::vector<char> frame( packetsPerFrame * packetSizes[i], 0 );
+        std::vector<UdpBatchEntry> entries;
+        for( std::size_t j = 0; j < packetsPerFrame; ++j ){
+            char *packet = &frame[ j * packetSizes[i] ];
+            std::strcpy( packet, "/meter" );
+            entries.push_back( UdpBatchEntry( destination, packet, packetSizes[i] ) );
+        }
+
+        double startTime = CurrentTimeSeconds();
+        for( std::size_t k = 0; k < frameCount; ++k ){
+            for( std::size_t j = 0; j < packetsPerFrame; ++j )
+                transmitSocket.Send( entries[j].data, entries[j].size );
+        }
+        double sendSeconds = CurrentTimeSeconds() - startTime;
+
+        transmitSocket.SetEnableSendSegmentation( false );
+        startTime = CurrentTimeSeconds();
+        for( std::size_t k = 0; k < frameCount; ++k )
+            transmitSocket.SendBatch( &entries[0], packetsPerFrame );
+        double sendBatchSeconds = CurrentTimeSeconds() - startTime;
+
+        transmitSocket.SetEnableSendSegmentation( true );
+        startTime = CurrentTimeSeconds();
+        for( std::size_t k = 0; k < frameCount; ++k )
+            transmitSocket.SendBatch( &entries[0], packetsPerFrame );
+        double segmentedSeconds = CurrentTimeSeconds() - startTime;
+
+        // drain the receive queue, then check that a segmented frame
+        // arrives as packetsPerFrame datagrams of the right size
+        receiveSocket.SetMaxReceivePacketSize( UdpSocket::MAX_UDP_PACKET_SIZE );
+        DrainListener drain( packetSizes[i] );
+        drain.Run( receiveSocket );
+
+        transmitSocket.SendBatch( &entries[0], packetsPerFrame );
+        drain.Run( receiveSocket );
+
+        const double packetCount = (double)(packetsPerFrame * frameCount);
+        std::cout << std::setw(8) << packetSizes[i]
+                << std::setw(10) << std::fixed << std::setprecision(2) << (sendSeconds * 1000000.) / packetCount
+                << std::setw(12) << (sendBatchSeconds * 1000000.) / packetCount
+                << std::setw(12) << (segmentedSeconds * 1000000.) / packetCount;
+        if( transmitSocket.SendSegmentation() )
+            std::cout << std::setw(9) << drain.MatchingCount() << "/" << packetsPerFrame << "\n";
+        else
+            std::cout << "  (segmentation unavailable)\n";
+    }
+}
+
+//-----------------------------------------------------------------------
+// zero-copy send benchmark: compares copying Send() against MSG_ZEROCOPY
+// sends of large blob-sized packets. note that the kernel always copies
+// data sent over loopback, so the "copied" column is expected to be 100%
+// here and the benchmark mostly shows the overhead of completion
+// handling. run it against a remote host to see the gain.
+
+class CountingSendCompletionListener : public SendCompletionListener{
+    std::size_t completedCount_;
+    std::size_t copiedCount_;
+public:
+    CountingSendCompletionListener() : completedCount_( 0 ), copiedCount_( 0 ) {}
+
+    std::size_t CompletedCount() const { return completedCount_; }
+    std::size_t CopiedCount() const { return copiedCount_; }
+
+    virtual void SendCompleted( const char *data, std::size_t size, bool copied )
+    {
+        (void) data;
+        (void) size;
+
+        ++completedCount_;
+        if( copied )
+            ++copiedCount_;
+    }
+};
+
+
+static void RunZeroCopySendBenchmarks()
+{
+    const std::size_t packetSizes[] = { 4096, 16384, 60000 };
+    const std::size_t packetSizesCount = sizeof(packetSizes) / sizeof(packetSizes[0]);
+    const std::size_t packetCount = 20000;
+
+    UdpSocket receiveSocket;
+    IpEndpointName destination = BindLoopback( receiveSocket );
+
+    std::cout << "send cost (microseconds per packet, " << packetCount << " packets)\n";
+    std::cout << std::setw(8) << "bytes" << std::setw(10) << "copy"
+            << std::setw(12) << "zero-copy" << std::setw(10) << "copied" << "\n";
+
+    for( std::size_t i = 0; i < packetSizesCount; ++i ){
+        std::vector<char> packet( packetSizes[i], 0 );
+        std::strcpy( &packet[0], "/blob" );
+
+        UdpSocket transmitSocket;
+        transmitSocket.Connect( destination );
+
+        double startTime = CurrentTimeSeconds();
+        for( std::size_t j = 0; j < packetCount; ++j )
+            transmitSocket.Send( &packet[0], packet.size() );
+        double copySeconds = CurrentTimeSeconds() - startTime;
+
+        CountingSendCompletionListener listener;
+        if( !transmitSocket.SetZeroCopySendThreshold( 1024, &listener ) ){
+            std::cout << std::setw(8) << packetSizes[i] << std::setw(10) << std::fixed
+                    << std::setprecision(2) << (copySeconds * 1000000.) / packetCount
+                    << "  (zero-copy unavailable)\n";
+            continue;
+        }
+
+        // the buffer is never modified so it is reused without waiting for
+        // completions, which are collected as they arrive
+        startTime = CurrentTimeSeconds();
+        for( std::size_t j = 0; j < packetCount; ++j ){
+            transmitSocket.Send( &packet[0], packet.size() );
+            if( j % 64 == 63 )
+                transmitSocket.ProcessSendCompletions();
+        }
+        while( transmitSocket.PendingZeroCopySendCount() > 0 )
+            transmitSocket.ProcessSendCompletions();
+        double zeroCopySeconds = CurrentTimeSeconds() - startTime;
+
+        std::cout << std::setw(8) << packetSizes[i]
+                << std::setw(10) << std::fixed << std::setprecision(2) << (copySeconds * 1000000.) / packetCount
+                << std::setw(12) << (zeroCopySeconds * 1000000.) / packetCount
+                << std::setw(9) << std::setprecision(0)
+                << (listener.CompletedCount() > 0 ? (100. * listener.CopiedCount()) / listener.CompletedCount() : 0.)
+                << "%\n";
+    }
+}
+
+//-----------------------------------------------------------------------
+// sharded receive benchmark: measures loopback receive throughput of a
+// ShardedUdpReceiveServer with 1 to 16 shards. packets are sent from 32
+// sockets so that the kernel has distinct flows to spread across shards.
+
+class CountingListener : public PacketListener{
+    std::size_t receivedCount_;
+public:
+    CountingListener() : receivedCount_( 0 ) {}
+
+    std::size_t ReceivedCount() const { return receivedCount_; }
+
+    virtual void ProcessPacket( const char *data, int size,
+            const IpEndpointName& remoteEndpoint )
+    {
+        (void) data;
+        (void) size;
+        (void) remoteEndpoint;
+
+        ++receivedCount_;
+    }
+};
+
+
+static void RunShardedReceiveBenchmarks()
+{
+    const std::size_t shardCounts[] = { 1, 2, 4, 8, 16 };
+    const std::size_t shardCountsCount = sizeof(shardCounts) / sizeof(shardCounts[0]);
+    const std::size_t flowCount = 32;
+    const std::size_t packetsPerSend = 64;
+    const double durationSeconds = 1.;
+
+    // find a free port for the shards to share
+    IpEndpointName localEndpoint;
+    {
+        UdpSocket probe;
+        localEndpoint = BindLoopback( probe );
+    }
+
+    std::vector<UdpSocket*> transmitSockets;
+    for( std::size_t i = 0; i < flowCount; ++i )
+        transmitSockets.push_back( new UdpSocket );
+
+    char packet[32];
+    std::memset( packet, 0, sizeof(packet) );
+    std::strcpy( packet, "/sharded" );
+    std::vector<UdpBatchEntry> entries( packetsPerSend, UdpBatchEntry( localEndpoint, packet, sizeof(packet) ) );
+
+    std::cout << "sharded receive throughput (" << flowCount << " flows, "
+            << std::thread::hardware_concurrency() << " hardware threads)\n";
+    std::cout << std::setw(8) << "shards" << std::setw(14) << "sent/s"
+            << std::setw(14) << "received/s" << std::setw(12) << "min shard"
+            << std::setw(12) << "max shard" << "\n";
+
+    for( std::size_t i = 0; i < shardCountsCount; ++i ){
+        std::vector<CountingListener> listeners( shardCounts[i] );
+        std::vector<PacketListener*> listenerPointers;
+        for( std::size_t j = 0; j < listeners.size(); ++j )
+            listenerPointers.push_back( &listeners[j] );
+
+        try{
+            ShardedUdpReceiveServer server( localEndpoint, &listenerPointers[0], shardCounts[i] );
+            for( std::size_t j = 0; j < server.ShardCount(); ++j )
+                server.Socket( j ).SetReceiveBatchSize( 32 );
+            server.Start();
+
+            std::size_t sentCount = 0;
+            double startTime = CurrentTimeSeconds();
+            double elapsed = 0.;
+            while( elapsed < durationSeconds ){
+                for( std::size_t j = 0; j < flowCount; ++j )
+                    sentCount += transmitSockets[j]->SendToBatch( &entries[0], entries.size() );
+                elapsed = CurrentTimeSeconds() - startTime;
+            }
+
+            // give the shards a moment to drain their queues
+            std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+            server.Stop();
+
+            std::size_t receivedCount = 0;
+            std::size_t minShardCount = listeners[0].ReceivedCount();
+            std::size_t maxShardCount = 0;
+            for( std::size_t j = 0; j < listeners.size(); ++j ){
+                receivedCount += listeners[j].ReceivedCount();
+                minShardCount = std::min( minShardCount, listeners[j].ReceivedCount() );
+                maxShardCount = std::max( maxShardCount, listeners[j].ReceivedCount() );
+            }
+
+            std::cout << std::setw(8) << shardCounts[i]
+                    << std::setw(14) << (std::size_t)(sentCount / elapsed)
+                    << std::setw(14) << (std::size_t)(receivedCount / elapsed)
+                    << std::setw(12) << minShardCount
+                    << std::setw(12) << maxShardCount << "\n";
+
+        }catch( std::exception& e ){
+            std::cout << "error running sharded receive benchmark with " << shardCounts[i]
+                    << " shards: " << e.what();
+        }
+    }
+
+    for( std::size_t i = 0; i < transmitSockets.size(); ++i )
+        delete transmitSockets[i];
+}
+
+//-----------------------------------------------------------------------
+// listener thread benchmark: a slow listener (a few microseconds of work
+// per packet) receives bursts of packets, either directly on the
+// multiplexer's thread or from a UdpSocketListenerThread queue drained by
+// an application thread. datagrams that the slow listener keeps the
+// socket from reading are lost in the kernel.
+
+class SlowListener : public PacketListener{
+    double workSeconds_;
+    std::atomic<std::size_t> receivedCount_;
+public:
+    explicit SlowListener( double workSeconds )
+        : workSeconds_( workSeconds )
+        , receivedCount_( 0 ) {}
+
+    std::size_t ReceivedCount() const { return receivedCount_.load(); }
+
+    virtual void ProcessPacket( const char *data, int size,
+            const IpEndpointName& remoteEndpoint )
+    {
+        (void) data;
+        (void) size;
+        (void) remoteEndpoint;
+
+        double endTime = CurrentTimeSeconds() + workSeconds_;
+        while( CurrentTimeSeconds() < endTime )
+            ;
+        ++receivedCount_;
+    }
+};
+
+
+// sends burstCount bursts of burstSize packets, pausing between bursts
+static std::size_t SendPacketBursts( const IpEndpointName& destination,
+        std::size_t burstSize, std::size_t burstCount )
+{
+    UdpSocket transmitSocket;
+
+    char packet[32];
+    std::memset( packet, 0, sizeof(packet) );
+    std::strcpy( packet, "/queued" );
+    std::vector<UdpBatchEntry> entries( burstSize, UdpBatchEntry( destination, packet, sizeof(packet) ) );
+
+    std::size_t sentCount = 0;
+    for( std::size_t i = 0; i < burstCount; ++i ){
+        sentCount += transmitSocket.SendToBatch( &entries[0], entries.size() );
+        std::this_thread::sleep_for( std::chrono::milliseconds( 2 ) );
+    }
+
+    // let the receivers catch up
+    std::this_thread::sleep_for( std::chrono::milliseconds( 500 ) );
+
+    return sentCount;
+}
+
+
+static void RunListenerThreadBenchmarks()
+{
+    const std::size_t burstSize = 256;
+    const std::size_t burstCount = 200;
+    const double workSeconds = 5e-6;
+    const std::size_t queueCapacity = 256;
+
+    std::cout << "slow listener (" << workSeconds * 1e6 << "us per packet, bursts of " << burstSize
+            << ", queue capacity " << queueCapacity << ")\n";
+    std::cout << std::setw(14) << "mode" << std::setw(10) << "sent" << std::setw(10) << "drained"
+            << std::setw(12) << "kernel lost" << std::setw(12) << "drop newest"
+            << std::setw(12) << "drop oldest" << std::setw(10) << "blocked" << "\n";
+
+    // the listener runs on the multiplexer's thread
+    {
+        UdpSocket receiveSocket;
+        IpEndpointName destination = BindLoopback( receiveSocket );
+        SlowListener listener( workSeconds );
+        SocketReceiveMultiplexer mux;
+        mux.AttachSocketListener( &receiveSocket, &listener );
+
+        std::thread receiveThread( [&mux]{ mux.Run(); } );
+        std::size_t sentCount = SendPacketBursts( destination, burstSize, burstCount );
+        mux.AsynchronousBreak();
+        receiveThread.join();
+        mux.DetachSocketListener( &receiveSocket, &listener );
+
+        std::cout << std::setw(14) << "direct" << std::setw(10) << sentCount
+                << std::setw(10) << listener.ReceivedCount()
+                << std::setw(12) << sentCount - listener.ReceivedCount()
+                << std::setw(12) << "-" << std::setw(12) << "-" << std::setw(10) << "-" << "\n";
+    }
+
+    const UdpSocketListenerThread::OverflowPolicy policies[] = {
+        UdpSocketListenerThread::DROP_NEWEST,
+        UdpSocketListenerThread::DROP_OLDEST,
+        UdpSocketListenerThread::BLOCK
+    };
+    const char *policyNames[] = { "drop newest", "drop oldest", "block" };
+
+    for( std::size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); ++i ){
+        UdpSocket receiveSocket;
+        IpEndpointName destination = BindLoopback( receiveSocket );
+        receiveSocket.SetReceiveBatchSize( 64 );
+        SlowListener listener( workSeconds );
+        UdpSocketListenerThread listenerThread( receiveSocket, queueCapacity, policies[i] );
+        listenerThread.Start();
+
+        // the application thread drains the queue in bulk, then sleeps
+        // briefly when it is empty
+        std::atomic<bool> done( false );
+        std::thread drainThread( [&]{
+            while( !done.load() ){
+                if( listenerThread.Drain( &listener, 256 ) == 0 )
+                    std::this_thread::sleep_for( std::chrono::microseconds( 200 ) );
+            }
+        } );
+
+        std::size_t sentCount = SendPacketBursts( destination, burstSize, burstCount );
+        listenerThread.Stop();
+        done.store( true );
+        drainThread.join();
+        listenerThread.Drain( &listener );
+
+        UdpSocketListenerThread::Counters counters = listenerThread.GetCounters();
+        std::cout << std::setw(14) << policyNames[i] << std::setw(10) << sentCount
+                << std::setw(10) << counters.drainedCount
+                << std::setw(12) << sentCount - counters.receivedCount
+                << std::setw(12) << counters.droppedNewestCount
+                << std::setw(12) << counters.droppedOldestCount
+                << std::setw(10) << counters.blockedCount << "\n";
+    }
+}
+
+//-----------------------------------------------------------------------
+// parallel dispatch benchmark: passes prebuilt packets straight to a
+// listener (no sockets). 16 addresses carry cheap messages, one carries
+// expensive messages. messages carry a per address sequence number which
+// is checked to ensure that per address order is preserved.
+
+static const std::size_t dispatchAddressCount_ = 17;
+
+class DispatchBenchmarkHandler{
+    std::vector<int> lastSequence_;
+    std::atomic<std::size_t> outOfOrderCount_;
+public:
+    DispatchBenchmarkHandler()
+        : lastSequence_( dispatchAddressCount_, -1 )
+        , outOfOrderCount_( 0 ) {}
+
+    std::size_t OutOfOrderCount() const { return outOfOrderCount_.load(); }
+
+    // called concurrently, but only ever from one thread for each address
+    void Handle( const ReceivedMessage& m )
+    {
+        ReceivedMessageArgumentStream args = m.ArgumentStream();
+        int32 addressIndex, sequence;
+        args >> addressIndex >> sequence >> EndMessage;
+
+        if( sequence <= lastSequence_[ addressIndex ] )
+            ++outOfOrderCount_;
+        lastSequence_[ addressIndex ] = sequence;
+
+        double workSeconds = ( addressIndex == 0 ) ? 50e-6 : 1e-6;
+        double endTime = CurrentTimeSeconds() + workSeconds;
+        while( CurrentTimeSeconds() < endTime )
+            ;
+    }
+};
+
+
+class SerialDispatchListener : public OscPacketListener{
+    DispatchBenchmarkHandler& handler_;
+protected:
+    virtual void ProcessMessage( const ReceivedMessage& m, const IpEndpointName& remoteEndpoint )
+    {
+        (void) remoteEndpoint;
+        handler_.Handle( m );
+    }
+public:
+    explicit SerialDispatchListener( DispatchBenchmarkHandler& handler ) : handler_( handler ) {}
+};
+
+
+class ParallelDispatchListener : public ParallelOscPacketListener{
+    DispatchBenchmarkHandler& handler_;
+protected:
+    virtual void ProcessMessage( const ReceivedMessage& m, const IpEndpointName& remoteEndpoint )
+    {
+        (void) remoteEndpoint;
+        handler_.Handle( m );
+    }
+public:
+    ParallelDispatchListener( DispatchBenchmarkHandler& handler, std::size_t workerCount )
+        : ParallelOscPacketListener( workerCount )
+        , handler_( handler ) {}
+
+    ~ParallelDispatchListener() { Stop(); }
+};
+
+
+static void RunParallelDispatchBenchmarks()
+{
+    const std::size_t workerCounts[] = { 1, 2, 4, 8 };
+    const std::size_t workerCountsCount = sizeof(workerCounts) / sizeof(workerCounts[0]);
+    const std::size_t messageCount = 20000;
+
+    // one message in 10 is expensive
+    std::vector< std::vector<char> > packets;
+    std::vector<int> sequences( dispatchAddressCount_, 0 );
+    for( std::size_t i = 0; i < messageCount; ++i ){
+        std::size_t addressIndex = ( i % 10 == 0 ) ? 0 : 1 + (i * 7) % (dispatchAddressCount_ - 1);
+        char address[32];
+        std::sprintf( address, "/dispatch/%d", (int)addressIndex );
+
+        char buffer[128];
+        OutboundPacketStream p( buffer, sizeof(buffer) );
+        p << BeginMessage( address ) << (int32)addressIndex << (int32)sequences[ addressIndex ]++ << EndMessage;
+        packets.push_back( std::vector<char>( p.Data(), p.Data() + p.Size() ) );
+    }
+
+    IpEndpointName remoteEndpoint( "127.0.0.1", 9000 );
+
+    std::cout << "message dispatch (" << messageCount << " messages, 10% expensive, "
+            << std::thread::hardware_concurrency() << " hardware threads)\n";
+    std::cout << std::setw(10) << "workers" << std::setw(14) << "messages/s"
+            << std::setw(14) << "max queued" << std::setw(14) << "out of order" << "\n";
+
+    {
+        DispatchBenchmarkHandler handler;
+        SerialDispatchListener listener( handler );
+
+        double startTime = CurrentTimeSeconds();
+        for( std::size_t i = 0; i < packets.size(); ++i )
+            listener.ProcessPacket( &packets[i][0], (int)packets[i].size(), remoteEndpoint );
+        double elapsed = CurrentTimeSeconds() - startTime;
+
+        std::cout << std::setw(10) << "serial" << std::setw(14) << (std::size_t)(messageCount / elapsed)
+                << std::setw(14) << "-" << std::setw(14) << handler.OutOfOrderCount() << "\n";
+    }
+
+    for( std::size_t i = 0; i < workerCountsCount; ++i ){
+        DispatchBenchmarkHandler handler;
+        ParallelDispatchListener listener( handler, workerCounts[i] );
+        listener.Start();
+
+        double startTime = CurrentTimeSeconds();
+        for( std::size_t j = 0; j < packets.size(); ++j )
+            listener.ProcessPacket( &packets[j][0], (int)packets[j].size(), remoteEndpoint );
+        listener.Flush();
+        double elapsed = CurrentTimeSeconds() - startTime;
+
+        listener.Stop();
+
+        std::size_t maxQueuedCount = 0;
+        for( std::size_t j = 0; j < listener.WorkerCount(); ++j )
+            maxQueuedCount = std::max( maxQueuedCount, listener.GetWorkerStatistics( j ).maxQueuedCount );
+
+        std::cout << std::setw(10) << workerCounts[i] << std::setw(14) << (std::size_t)(messageCount / elapsed)
+                << std::setw(14) << maxQueuedCount << std::setw(14) << handler.OutOfOrderCount() << "\n";
+    }
+}
+
+//-----------------------------------------------------------------------
+// timer jitter benchmark: measures how late a sub-millisecond periodic
+// timer fires, with and without thousands of other timers attached to the
+// same multiplexer. lateness is measured against the ideal schedule
+// starting at the first expiry, less the smallest lateness observed.
+
+class JitterProbeListener : public TimerListener{
+    SocketReceiveMultiplexer& mux_;
+    std::size_t expiryCount_;
+    std::vector<double> expiryTimes_;
+public:
+    JitterProbeListener( SocketReceiveMultiplexer& mux, std::size_t expiryCount )
+        : mux_( mux )
+        , expiryCount_( expiryCount ) {}
+
+    const std::vector<double>& ExpiryTimes() const { return expiryTimes_; }
+
+    virtual void TimerExpired()
+    {
+        expiryTimes_.push_back( CurrentTimeSeconds() );
+        if( expiryTimes_.size() == expiryCount_ )
+            mux_.Break();
+    }
+};
+
+
+class IdleTimerListener : public TimerListener{
+public:
+    virtual void TimerExpired() {}
+};
+
+
+static void RunTimerJitterBenchmarks()
+{
+    const long long periodsNs[] = { 250000, 1333333 }; // 1333333 is 64 frames at 48kHz
+    const std::size_t periodsCount = sizeof(periodsNs) / sizeof(periodsNs[0]);
+    const std::size_t backgroundTimerCounts[] = { 0, 5000 };
+    const std::size_t backgroundTimerCountsCount = sizeof(backgroundTimerCounts) / sizeof(backgroundTimerCounts[0]);
+    const double runSeconds = .5;
+
+    struct Backend{
+        const char *name;
+        SocketReceiveMultiplexer::Backend backend;
+    };
+    const Backend backends[] = {
+        { "select", SocketReceiveMultiplexer::SELECT_BACKEND },
+        { "default", SocketReceiveMultiplexer::DEFAULT_BACKEND },
+        { "io_uring", SocketReceiveMultiplexer::IO_URING_BACKEND },
+    };
+    const std::size_t backendsCount = sizeof(backends) / sizeof(backends[0]);
+
+    std::cout << "periodic timer jitter (microseconds)\n";
+    std::cout << std::setw(10) << "backend" << std::setw(12) << "period us" << std::setw(8) << "timers"
+            << std::setw(10) << "p50" << std::setw(10) << "p99" << std::setw(10) << "max" << "\n";
+
+    IdleTimerListener idleListener;
+
+    for( std::size_t i = 0; i < backendsCount; ++i ){
+        for( std::size_t j = 0; j < periodsCount; ++j ){
+            for( std::size_t k = 0; k < backgroundTimerCountsCount; ++k ){
+                SocketReceiveMultiplexer mux( backends[i].backend );
+
+                std::size_t expiryCount = (std::size_t)(runSeconds * 1e9 / periodsNs[j]);
+                JitterProbeListener probe( mux, expiryCount );
+                mux.AttachPeriodicTimerListenerNanoseconds( periodsNs[j], periodsNs[j], &probe );
+
+                // background timers with periods spread between 10 and 20ms
+                for( std::size_t n = 0; n < backgroundTimerCounts[k]; ++n ){
+                    long periodUs = 10000 + (long)((n * 7919) % 10000);
+                    mux.AttachPeriodicTimerListenerMicroseconds( periodUs, periodUs, &idleListener );
+                }
+
+                mux.Run();
+
+                const std::vector<double>& times = probe.ExpiryTimes();
+                std::vector<double> lateness;
+                for( std::size_t n = 0; n < times.size(); ++n )
+                    lateness.push_back( (times[n] - times[0] - n * periodsNs[j] * 1e-9) * 1000000. );
+                std::sort( lateness.begin(), lateness.end() );
+                double minimum = lateness.front();
+
+                std::cout << std::setw(10) << backends[i].name
+                        << std::setw(12) << std::fixed << std::setprecision(1) << periodsNs[j] * .001
+                        << std::setw(8) << backgroundTimerCounts[k] + 1 << std::setprecision(2)
+                        << std::setw(10) << lateness[ lateness.size() / 2 ] - minimum
+                        << std::setw(10) << lateness[ (lateness.size() * 99) / 100 ] - minimum
+                        << std::setw(10) << lateness.back() - minimum << "\n";
+
+                for( std::size_t n = 0; n < backgroundTimerCounts[k]; ++n )
+                    mux.DetachPeriodicTimerListener( &idleListener );
+                mux.DetachPeriodicTimerListener( &probe );
+            }
+        }
+    }
+}
+
+//-----------------------------------------------------------------------
+// latency benchmark: ping-pong over loopback between two multiplexers,
+// one echoing on a separate thread. measures round trip times with
+// blocking waits and with busy polling on both ends. busy polling only
+// pays off when each end has a core to itself.
+
+class EchoListener : public PacketListener{
+    UdpSocket& socket_;
+public:
+    explicit EchoListener( UdpSocket& socket ) : socket_( socket ) {}
+
+    virtual void ProcessPacket( const char *data, int size,
+            const IpEndpointName& remoteEndpoint )
+    {
+        socket_.SendTo( remoteEndpoint, data, size );
+    }
+};
+
+
+class PingPongListener : public PacketListener{
+    SocketReceiveMultiplexer& mux_;
+    UdpSocket& socket_;
+    IpEndpointName echoEndpoint_;
+    std::size_t warmupCount_;
+    std::size_t roundTripCount_;
+    std::size_t receivedCount_;
+    double sendTime_;
+    std::vector<double> roundTripTimes_;
+public:
+    PingPongListener( SocketReceiveMultiplexer& mux, UdpSocket& socket, const IpEndpointName& echoEndpoint,
+            std::size_t warmupCount, std::size_t roundTripCount )
+        : mux_( mux )
+        , socket_( socket )
+        , echoEndpoint_( echoEndpoint )
+        , warmupCount_( warmupCount )
+        , roundTripCount_( roundTripCount )
+        , receivedCount_( 0 )
+        , sendTime_( 0 ) {}
+
+    const std::vector<double>& RoundTripTimes() const { return roundTripTimes_; }
+
+    void SendPing()
+    {
+        char packet[16];
+        std::memset( packet, 0, sizeof(packet) );
+        std::strcpy( packet, "/ping" );
+
+        sendTime_ = CurrentTimeSeconds();
+        socket_.SendTo( echoEndpoint_, packet, sizeof(packet) );
+    }
+
+    virtual void ProcessPacket( const char *data, int size,
+            const IpEndpointName& remoteEndpoint )
+    {
+        (void) data;
+        (void) size;
+        (void) remoteEndpoint;
+
+        double roundTripTime = CurrentTimeSeconds() - sendTime_;
+        if( ++receivedCount_ > warmupCount_ )
+            roundTripTimes_.push_back( roundTripTime * 1000000. );
+
+        if( roundTripTimes_.size() == roundTripCount_ )
+            mux_.Break();
+        else
+            SendPing();
+    }
+};
+
+
+// returns the sorted round trip times in microseconds
+static std::vector<double> RunPingPong( SocketReceiveMultiplexer::Backend backend,
+        long busyPollMicroseconds, std::size_t roundTripCount )
+{
+    UdpSocket echoSocket, pingSocket;
+    IpEndpointName echoEndpoint = BindLoopback( echoSocket );
+    BindLoopback( pingSocket );
+
+    if( busyPollMicroseconds > 0 ){
+        // has no effect on loopback, but this is how a real deployment would set it up
+        echoSocket.SetKernelBusyPoll( 50 );
+        pingSocket.SetKernelBusyPoll( 50 );
+    }
+
+    SocketReceiveMultiplexer echoMux( backend );
+    echoMux.SetBusyPollPeriod( busyPollMicroseconds );
+    EchoListener echoListener( echoSocket );
+    echoMux.AttachSocketListener( &echoSocket, &echoListener );
+    std::thread echoThread( &SocketReceiveMultiplexer::Run, &echoMux );
+
+    SocketReceiveMultiplexer pingMux( backend );
+    pingMux.SetBusyPollPeriod( busyPollMicroseconds );
+    PingPongListener pingListener( pingMux, pingSocket, echoEndpoint, 100, roundTripCount );
+    pingMux.AttachSocketListener( &pingSocket, &pingListener );
+
+    pingListener.SendPing();
+    pingMux.Run();
+
+    echoMux.AsynchronousBreak();
+    echoThread.join();
+
+    std::vector<double> result = pingListener.RoundTripTimes();
+    std::sort( result.begin(), result.end() );
+    return result;
+}
+
+
+static void RunLatencyBenchmarks()
+{
+    const std::size_t roundTripCount = 10000;
+    const long busyPollMicroseconds = 200;
+
+    struct Mode{
+        const char *name;
+        SocketReceiveMultiplexer::Backend backend;
+        long busyPollMicroseconds;
+    };
+    const Mode modes[] = {
+        { "select", SocketReceiveMultiplexer::SELECT_BACKEND, 0 },
+        { "default", SocketReceiveMultiplexer::DEFAULT_BACKEND, 0 },
+        { "busy-poll", SocketReceiveMultiplexer::DEFAULT_BACKEND, busyPollMicroseconds },
+    };
+    const std::size_t modesCount = sizeof(modes) / sizeof(modes[0]);
+
+    std::cout << "ping-pong round trip time (microseconds, " << roundTripCount << " round trips, "
+            << std::thread::hardware_concurrency() << " hardware threads)\n";
+    std::cout << std::setw(10) << "mode" << std::setw(10) << "p50" << std::setw(10) << "p99"
+            << std::setw(10) << "p99.9" << std::setw(10) << "max" << "\n";
+
+    if( std::thread::hardware_concurrency() < 2 )
+        std::cout << "(with a single core the busy polling ends take turns, expect busy-poll to be slower)\n";
+
+    for( std::size_t i = 0; i < modesCount; ++i ){
+        std::vector<double> times = RunPingPong( modes[i].backend, modes[i].busyPollMicroseconds, roundTripCount );
+
+        std::cout << std::setw(10) << modes[i].name << std::fixed << std::setprecision(2)
+                << std::setw(10) << times[ times.size() / 2 ]
+                << std::setw(10) << times[ (times.size() * 99) / 100 ]
+                << std::setw(10) << times[ (times.size() * 999) / 1000 ]
+                << std::setw(10) << times.back() << "\n";
+    }
+}
+
+//-----------------------------------------------------------------------
+// embedded loop benchmark: ping-pong round trips where the pinging side
+// lives in the application's own poll() loop. compares running the
+// multiplexer on a thread of its own, which hands each reply over to the
+// application thread, with adding PollDescriptor() to the application's
+// poll set and calling ProcessReady() from the application thread.
+
+#if !defined(_WIN32)
+
+class HandOffPingListener : public PacketListener{
+    std::mutex mutex_;
+    std::condition_variable packetReceived_;
+    std::size_t pendingCount_;
+public:
+    HandOffPingListener() : pendingCount_( 0 ) {}
+
+    virtual void ProcessPacket( const char *data, int size,
+            const IpEndpointName& remoteEndpoint )
+    {
+        (void) data;
+        (void) size;
+        (void) remoteEndpoint;
+
+        std::lock_guard<std::mutex> lock( mutex_ );
+        ++pendingCount_;
+        packetReceived_.notify_one();
+    }
+
+    void WaitForPacket()
+    {
+        std::unique_lock<std::mutex> lock( mutex_ );
+        while( pendingCount_ == 0 )
+            packetReceived_.wait( lock );
+        --pendingCount_;
+    }
+};
+
+
+// returns the sorted round trip times in microseconds
+static std::vector<double> RunEmbeddedPingPong( bool embedded, std::size_t roundTripCount )
+{
+    UdpSocket echoSocket, pingSocket;
+    IpEndpointName echoEndpoint = BindLoopback( echoSocket );
+    BindLoopback( pingSocket );
+
+    SocketReceiveMultiplexer echoMux;
+    EchoListener echoListener( echoSocket );
+    echoMux.AttachSocketListener( &echoSocket, &echoListener );
+    std::thread echoThread( &SocketReceiveMultiplexer::Run, &echoMux );
+
+    SocketReceiveMultiplexer pingMux;
+    PingPongListener pingListener( pingMux, pingSocket, echoEndpoint, 100, roundTripCount );
+
+    if( embedded ){
+        pingMux.AttachSocketListener( &pingSocket, &pingListener );
+
+        struct pollfd pollFd;
+        pollFd.fd = pingMux.PollDescriptor();
+        pollFd.events = POLLIN;
+
+        pingListener.SendPing();
+        while( pingListener.RoundTripTimes().size() < roundTripCount ){
+            if( poll( &pollFd, 1, -1 ) > 0 )
+                pingMux.ProcessReady( 64 );
+        }
+    }else{
+        HandOffPingListener handOffListener;
+        pingMux.AttachSocketListener( &pingSocket, &handOffListener );
+        std::thread pingThread( &SocketReceiveMultiplexer::Run, &pingMux );
+
+        // the application thread processes the replies the multiplexer thread hands over
+        pingListener.SendPing();
+        while( pingListener.RoundTripTimes().size() < roundTripCount ){
+            handOffListener.WaitForPacket();
+            pingListener.ProcessPacket( 0, 0, echoEndpoint );
+        }
+
+        pingMux.AsynchronousBreak();
+        pingThread.join();
+    }
+
+    echoMux.AsynchronousBreak();
+    echoThread.join();
+
+    std::vector<double> result = pingListener.RoundTripTimes();
+    std::sort( result.begin(), result.end() );
+    return result;
+}
+
+#endif /* !_WIN32 */
+
+
+static void RunEmbeddedLoopBenchmarks()
+{
+#if !defined(_WIN32)
+    const std::size_t roundTripCount = 10000;
+
+    std::cout << "ping-pong round trip time from an application event loop (microseconds, "
+            << roundTripCount << " round trips)\n";
+    std::cout << std::setw(14) << "mode" << std::setw(10) << "p50" << std::setw(10) << "p99"
+            << std::setw(10) << "p99.9" << std::setw(10) << "max" << "\n";
+
+    for( int embedded = 0; embedded < 2; ++embedded ){
+        std::vector<double> times = RunEmbeddedPingPong( embedded != 0, roundTripCount );
+
+        std::cout << std::setw(14) << ((embedded) ? "ProcessReady" : "thread+handoff")
+                << std::fixed << std::setprecision(2)
+                << std::setw(10) << times[ times.size() / 2 ]
+                << std::setw(10) << times[ (times.size() * 99) / 100 ]
+                << std::setw(10) << times[ (times.size() * 999) / 1000 ]
+                << std::setw(10) << times.back() << "\n";
+    }
+#else
+    std::cout << "embedded loop benchmark: PollDescriptor() is not supported on Win32\n";
+#endif
+}
+
+//-----------------------------------------------------------------------
+// local endpoint benchmark: the cost of LocalEndpointFor() when replying
+// to many different peers, with and without the local endpoint cache.
+// the peers are spread over 127.0.0.0/8 so every lookup is routable.
+
+static void RunLocalEndpointBenchmarks()
+{
+    const std::size_t peerCounts[] = { 1, 1024 };
+    const std::size_t peerCountsCount = sizeof(peerCounts) / sizeof(peerCounts[0]);
+    const std::size_t lookupCount = 200000;
+
+    std::cout << "LocalEndpointFor() cost (" << lookupCount << " lookups)\n";
+    std::cout << std::setw(8) << "peers" << std::setw(14) << "uncached ns" << std::setw(14) << "cached ns" << "\n";
+
+    UdpSocket socket;
+    socket.Bind( IpEndpointName( IpEndpointName::ANY_ADDRESS, IpEndpointName::ANY_PORT ) );
+
+    for( std::size_t i = 0; i < peerCountsCount; ++i ){
+        double nsPerLookup[2];
+        for( int cached = 0; cached < 2; ++cached ){
+            socket.SetLocalEndpointCacheTimeout( (cached) ? 10000 : 0 );
+
+            double start = CurrentTimeSeconds();
+            for( std::size_t j = 0; j < lookupCount; ++j ){
+                unsigned long peer = (unsigned long)(j % peerCounts[i]);
+                socket.LocalEndpointFor( IpEndpointName( 0x7F000001UL + peer, 9000 ) );
+            }
+            nsPerLookup[cached] = (CurrentTimeSeconds() - start) * 1e9 / lookupCount;
+        }
+
+        std::cout << std::setw(8) << peerCounts[i] << std::fixed << std::setprecision(1)
+                << std::setw(14) << nsPerLookup[0] << std::setw(14) << nsPerLookup[1] << "\n";
+    }
+}
+
+//-----------------------------------------------------------------------
+
+struct NetworkBenchmark{
+    const char *name;
+    void (*run)();
+};
+
+static const NetworkBenchmark networkBenchmarks_[] = {
+    { "wakeup", RunWakeupBenchmarks },
+    { "receive-batch", RunReceiveBatchBenchmarks },
+    { "batch-dispatch", RunBatchDispatchBenchmarks },
+    { "receive-timestamp", RunReceiveTimestampBenchmarks },
+    { "send-batch", RunSendBatchBenchmarks },
+    { "send-segmented", RunSegmentedSendBenchmarks },
+    { "send-zerocopy", RunZeroCopySendBenchmarks },
+    { "sharded-receive", RunShardedReceiveBenchmarks },
+    { "listener-thread", RunListenerThreadBenchmarks },
+    { "timer-jitter", RunTimerJitterBenchmarks },
+    { "parallel-dispatch", RunParallelDispatchBenchmarks },
+    { "latency", RunLatencyBenchmarks },
+    { "embedded-loop", RunEmbeddedLoopBenchmarks },
+    { "local-endpoint", RunLocalEndpointBenchmarks },
+};
+
+void RunNetworkBenchmarks( const char *benchmarkName )
+{
+    const std::size_t count = sizeof(networkBenchmarks_) / sizeof(networkBenchmarks_[0]);
+    bool found = false;
+
+    for( std::size_t i = 0; i < count; ++i ){
+        if( benchmarkName == 0 || std::strcmp( benchmarkName, networkBenchmarks_[i].name ) == 0 ){
+            networkBenchmarks_[i].run();
+            std::cout << "\n";
+            found = true;
+        }
+    }
+
+    if( !found )
+        std::cout << "unknown benchmark: " << benchmarkName << "\n";
+}
+
+} // namespace osc
+
+#ifndef NO_OSC_TEST_MAIN
+
+int main(int argc, char* argv[])
+{
+    if( argc >= 2 && std::strcmp( argv[1], "-h" ) == 0 ){
+        std::cout << "usage: OscNetworkBenchmarks [benchmark]\n";
+        std::cout << "available benchmarks:";
+        for( std::size_t i = 0; i < sizeof(osc::networkBenchmarks_) / sizeof(osc::networkBenchmarks_[0]); ++i )
+            std::cout << " " << osc::networkBenchmarks_[i].name;
+        std::cout << "\n";
+        return 0;
+    }
+
+    osc::RunNetworkBenchmarks( (argc >= 2) ? argv[1] : 0 );
+
+    return 0;
+}
+
+#endif /* NO_OSC_TEST_MAIN */
@@ -0,0 +1,797 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#include "OscParseBenchmarks.h"
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "osc/OscOutboundPacketStream.h"
+#include "osc/OscPacketListener.h"
+#include "osc/NothrowOscPacketListener.h"
+#include "osc/OscReceivedElements.h"
+#include "osc/OscStringScan.h"
+#include "osc/OscTypedMessage.h"
+
+
+namespace osc{
+
+static double CurrentTimeSeconds()
+{
+    return std::chrono::duration<double>(
+            std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+
+static const StringScanImplementation stringScanImplementations_[] = {
+    SCALAR_STRING_SCAN, SSE2_STRING_SCAN, AVX2_STRING_SCAN, NEON_STRING_SCAN
+};
+static const std::size_t stringScanImplementationsCount_ =
+        sizeof(stringScanImplementations_) / sizeof(stringScanImplementations_[0]);
+
+//-----------------------------------------------------------------------
+// string scan benchmark: the cost of finding the end of a string with
+// each FindStr4End() implementation, across string lengths. a buffer of
+// back to back strings is scanned as ReceivedMessage does when it
+// validates string arguments. followed by the cost of parsing a message
+// with 8 string arguments of each length using the automatic choice.
+
+// fills buffer with padded strings of length characters, or of random
+// lengths below 64 if length is 0. returns the number of strings
+static std::size_t FillStrings( std::vector<char>& buffer, std::size_t length, std::size_t size )
+{
+    buffer.assign( size, '\0' );
+
+    unsigned long random = 12345;
+    std::size_t count = 0;
+    std::size_t offset = 0;
+    for( ;; ){
+        std::size_t stringLength = length;
+        if( length == 0 ){
+            random = random * 1103515245UL + 12345UL;
+            stringLength = (random >> 16) % 64;
+        }
+
+        std::size_t paddedLength = (stringLength + 4) & ~((std::size_t)3);
+        if( offset + paddedLength > size )
+            break;
+
+        for( std::size_t j = 0; j < stringLength; ++j )
+            buffer[ offset + j ] = (char)('a' + (count + j) % 26);
+        offset += paddedLength;
+        ++count;
+    }
+
+    buffer.resize( offset );
+    return count;
+}
+
+
+static void RunStringScanBenchmarks()
+{
+    // 0 stands for a mix of lengths below 64, which the branch predictor can't learn
+    const std::size_t lengths[] = { 3, 7, 15, 31, 63, 127, 255, 1023, 0 };
+    const std::size_t lengthsCount = sizeof(lengths) / sizeof(lengths[0]);
+    const std::size_t bytesPerPass = 64 * 1024;
+    const std::size_t scannedBytes = 64 * 1024 * 1024;
+
+    StringScanImplementation automatic = ActiveStringScanImplementation();
+
+    std::cout << "FindStr4End() cost (ns per string, automatic choice: "
+            << StringScanImplementationName( automatic ) << ")\n";
+    std::cout << std::setw(8) << "length";
+    for( std::size_t i = 0; i < stringScanImplementationsCount_; ++i ){
+        if( IsStringScanImplementationSupported( stringScanImplementations_[i] ) )
+            std::cout << std::setw(10) << StringScanImplementationName( stringScanImplementations_[i] );
+    }
+    std::cout << "\n";
+
+    std::size_t checksum = 0;
+    std::vector<char> buffer;
+    for( std::size_t i = 0; i < lengthsCount; ++i ){
+        std::size_t count = FillStrings( buffer, lengths[i], bytesPerPass );
+        const char *end = &buffer[0] + buffer.size();
+        std::size_t passes = scannedBytes / buffer.size();
+
+        if( lengths[i] == 0 )
+            std::cout << std::setw(8) << "mixed";
+        else
+            std::cout << std::setw(8) << lengths[i];
+        for( std::size_t j = 0; j < stringScanImplementationsCount_; ++j ){
+            if( !SetStringScanImplementation( stringScanImplementations_[j] ) )
+                continue;
+
+            double start = CurrentTimeSeconds();
+            for( std::size_t k = 0; k < passes; ++k ){
+                const char *p = &buffer[0];
+                while( p != end && p != 0 )
+                    p = FindStr4End( p, end );
+                checksum += (p == end);
+            }
+            double nsPerString = (CurrentTimeSeconds() - start) * 1e9 / (double)(passes * count);
+
+            std::cout << std::fixed << std::setprecision(2) << std::setw(10) << nsPerString;
+        }
+        std::cout << "\n";
+    }
+
+    SetStringScanImplementation( automatic );
+
+    const std::size_t argumentCount = 8;
+    const std::size_t messageCount = 200000;
+
+    std::cout << "message parse cost (ns per message, " << argumentCount << " string arguments)\n";
+    std::cout << std::setw(8) << "length" << std::setw(10) << "scalar"
+            << std::setw(10) << StringScanImplementationName( automatic ) << "\n";
+
+    std::vector<char> packet( 16 * 1024 );
+    for( std::size_t i = 0; i < lengthsCount && lengths[i] != 0; ++i ){
+        std::string argument( lengths[i], 'x' );
+        OutboundPacketStream ps( &packet[0], packet.size() );
+        ps << BeginMessage( "/benchmark/strings" );
+        for( std::size_t j = 0; j < argumentCount; ++j )
+            ps << argument.c_str();
+        ps << EndMessage;
+
+        std::cout << std::setw(8) << lengths[i];
+        StringScanImplementation modes[] = { SCALAR_STRING_SCAN, automatic };
+        for( int j = 0; j < 2; ++j ){
+            SetStringScanImplementation( modes[j] );
+
+            double start = CurrentTimeSeconds();
+            for( std::size_t k = 0; k < messageCount; ++k ){
+                ReceivedMessage m( ReceivedPacket( ps.Data(), ps.Size() ) );
+                checksum += m.ArgumentCount();
+            }
+            double nsPerMessage = (CurrentTimeSeconds() - start) * 1e9 / (double)messageCount;
+
+            std::cout << std::fixed << std::setprecision(2) << std::setw(10) << nsPerMessage;
+        }
+        std::cout << "\n";
+    }
+
+    SetStringScanImplementation( automatic );
+
+    // keeps the scans from being optimised away
+    if( checksum == 0 )
+        std::cout << "(no strings scanned)\n";
+}
+
+//-----------------------------------------------------------------------
+// type tag benchmark: the cost of parsing (validating) a message and of
+// iterating over its arguments as the number of arguments grows. the
+// mixed messages repeat the tags "ihdTf[ff]s".
+
+// builds a message with argumentCount arguments into packet, using
+// whole repeats of the mixed pattern and floats for the rest. returns
+// its size
+static std::size_t BuildTypeTagMessage( std::vector<char>& packet, std::size_t argumentCount, bool mixed )
+{
+    OutboundPacketStream ps( &packet[0], packet.size() );
+    ps << BeginMessage( "/benchmark/tags" );
+
+    const char pattern[] = "ihdTf[ff]s";
+    const std::size_t patternLength = sizeof(pattern) - 1;
+
+    std::size_t count = 0;
+    while( count < argumentCount ){
+        if( !mixed || argumentCount - count < patternLength ){
+            ps << (float)count;
+            ++count;
+            continue;
+        }
+
+        for( std::size_t i = 0; i < patternLength; ++i, ++count ){
+            switch( pattern[i] ){
+                case 'i': ps << (int32)count; break;
+                case 'h': ps << (int64)count; break;
+                case 'd': ps << (double)count; break;
+                case 'T': ps << true; break;
+                case 'f': ps << (float)count; break;
+                case '[': ps << BeginArray; break;
+                case ']': ps << EndArray; break;
+                case 's': ps << "string"; break;
+            }
+        }
+    }
+
+    ps << EndMessage;
+    return ps.Size();
+}
+
+
+static void RunTypeTagBenchmarks()
+{
+    const std::size_t argumentCounts[] = { 4, 16, 64, 256, 1024 };
+    const std::size_t argumentCountsCount = sizeof(argumentCounts) / sizeof(argumentCounts[0]);
+    const std::size_t argumentsPerRun = 8 * 1024 * 1024;
+
+    StringScanImplementation automatic = ActiveStringScanImplementation();
+
+    std::cout << "message parse and iteration cost (ns per argument)\n";
+    std::cout << std::setw(8) << "tags" << std::setw(8) << "args"
+            << std::setw(14) << "parse scalar" << std::setw(10) << "parse " << std::left << std::setw(4)
+            << StringScanImplementationName( automatic ) << std::right << std::setw(10) << "iterate" << "\n";
+
+    std::size_t checksum = 0;
+    std::vector<char> packet( 64 * 1024 );
+    for( int mixed = 0; mixed < 2; ++mixed ){
+        for( std::size_t i = 0; i < argumentCountsCount; ++i ){
+            std::size_t size = BuildTypeTagMessage( packet, argumentCounts[i], mixed != 0 );
+            std::size_t messageCount = argumentsPerRun / argumentCounts[i];
+
+            std::cout << std::setw(8) << ((mixed) ? "mixed" : "f") << std::setw(8) << argumentCounts[i];
+
+            StringScanImplementation modes[] = { SCALAR_STRING_SCAN, automatic };
+            for( int j = 0; j < 2; ++j ){
+                SetStringScanImplementation( modes[j] );
+
+                double start = CurrentTimeSeconds();
+                for( std::size_t k = 0; k < messageCount; ++k ){
+                    ReceivedMessage m( ReceivedPacket( &packet[0], size ) );
+                    checksum += m.ArgumentCount();
+                }
+                double nsPerArgument = (CurrentTimeSeconds() - start) * 1e9 / (double)(messageCount * argumentCounts[i]);
+
+                std::cout << std::fixed << std::setprecision(2) << std::setw(14) << nsPerArgument;
+            }
+
+            ReceivedMessage m( ReceivedPacket( &packet[0], size ) );
+            double start = CurrentTimeSeconds();
+            for( std::size_t k = 0; k < messageCount; ++k ){
+                for( ReceivedMessage::const_iterator a = m.ArgumentsBegin(); a != m.ArgumentsEnd(); ++a )
+                    ++checksum;
+            }
+            double nsPerArgument = (CurrentTimeSeconds() - start) * 1e9 / (double)(messageCount * argumentCounts[i]);
+
+            std::cout << std::fixed << std::setprecision(2) << std::setw(10) << nsPerArgument << "\n";
+        }
+    }
+
+    SetStringScanImplementation( automatic );
+
+    // keeps the loops from being optimised away
+    if( checksum == 0 )
+        std::cout << "(no arguments parsed)\n";
+}
+
+//-----------------------------------------------------------------------
+// random access benchmark: the cost of reading the first argument and
+// one 5/8 of the way through a message of strings and floats, by
+// stepping an iterator and with Argument() on a message parsed with an
+// argument index big enough for all of its arguments. ns per message,
+// including parsing.
+
+static std::size_t BuildRandomAccessMessage( std::vector<char>& packet, std::size_t argumentCount )
+{
+    OutboundPacketStream ps( &packet[0], packet.size() );
+    ps << BeginMessage( "/benchmark/random-access" );
+
+    std::string s;
+    for( std::size_t i = 0; i < argumentCount; ++i ){
+        if( i % 2 ){
+            s.assign( 4 + (i * 7) % 29, 'x' );
+            ps << s.c_str();
+        }else{
+            ps << (float)i;
+        }
+    }
+
+    ps << EndMessage;
+    return ps.Size();
+}
+
+
+static void RunRandomAccessBenchmarks()
+{
+    const std::size_t argumentCounts[] = { 16, 64, 256 };
+    const std::size_t argumentCountsCount = sizeof(argumentCounts) / sizeof(argumentCounts[0]);
+    const std::size_t argumentsPerRun = 8 * 1024 * 1024;
+
+    std::cout << "reading 2 arguments of a message, parse included (ns per message)\n";
+    std::cout << std::setw(8) << "args" << std::setw(8) << "read"
+            << std::setw(10) << "parse" << std::setw(14) << "parse index"
+            << std::setw(10) << "iterate" << std::setw(12) << "Argument()" << "\n";
+
+    std::size_t checksum = 0;
+    std::vector<char> packet( 64 * 1024 );
+    std::vector<uint32> offsets( 1024 );
+    for( std::size_t i = 0; i < argumentCountsCount; ++i ){
+        std::size_t size = BuildRandomAccessMessage( packet, argumentCounts[i] );
+        std::size_t messageCount = argumentsPerRun / argumentCounts[i];
+        uint32 target = (uint32)(argumentCounts[i] * 5 / 8) | 1; // a string
+
+        std::cout << std::setw(8) << argumentCounts[i] << std::setw(8) << target;
+
+        double start = CurrentTimeSeconds();
+        for( std::size_t k = 0; k < messageCount; ++k ){
+            ReceivedMessage m( ReceivedPacket( &packet[0], size ) );
+            checksum += m.ArgumentCount();
+        }
+        double parseNs = (CurrentTimeSeconds() - start) * 1e9 / (double)messageCount;
+
+        start = CurrentTimeSeconds();
+        for( std::size_t k = 0; k < messageCount; ++k ){
+            ReceivedMessage m( ReceivedPacket( &packet[0], size ), &offsets[0], offsets.size() );
+            checksum += m.ArgumentCount();
+        }
+        double parseIndexNs = (CurrentTimeSeconds() - start) * 1e9 / (double)messageCount;
+
+        start = CurrentTimeSeconds();
+        for( std::size_t k = 0; k < messageCount; ++k ){
+            ReceivedMessage m( ReceivedPacket( &packet[0], size ) );
+            ReceivedMessage::const_iterator a = m.ArgumentsBegin();
+            checksum += (std::size_t)a->AsFloat();
+            for( uint32 j = 0; j < target; ++j )
+                ++a;
+            checksum += (std::size_t)a->AsString()[0];
+        }
+        double iterateNs = (CurrentTimeSeconds() - start) * 1e9 / (double)messageCount;
+
+        start = CurrentTimeSeconds();
+        for( std::size_t k = 0; k < messageCount; ++k ){
+            ReceivedMessage m( ReceivedPacket( &packet[0], size ), &offsets[0], offsets.size() );
+            checksum += (std::size_t)m.Argument( 0 ).AsFloat();
+            checksum += (std::size_t)m.Argument( target ).AsString()[0];
+        }
+        double argumentNs = (CurrentTimeSeconds() - start) * 1e9 / (double)messageCount;
+
+        std::cout << std::fixed << std::setprecision(1) << std::setw(10) << parseNs
+                << std::setw(14) << parseIndexNs << std::setw(10) << iterateNs
+                << std::setw(12) << argumentNs << "\n";
+    }
+
+    // keeps the loops from being optimised away
+    if( checksum == 0 )
+        std::cout << "(no arguments read)\n";
+}
+
+//-----------------------------------------------------------------------
+// validation benchmark: the cost per message of parsing a typical message
+// of ints, floats and short strings and reading its arguments, when the
+// arguments are validated up front (untrusted senders) and on access
+// (trusted senders). ns per message, for reading only the first argument
+// and for reading all of them.
+
+static std::size_t BuildTypicalMessage( std::vector<char>& packet, std::size_t argumentCount )
+{
+    OutboundPacketStream ps( &packet[0], packet.size() );
+    ps << BeginMessage( "/mixer/channel/12/eq" );
+
+    for( std::size_t i = 0; i < argumentCount; ++i ){
+        switch( i % 4 ){
+            case 0: ps << (int32)i; break;
+            case 1:
+            case 2: ps << (float)i; break;
+            case 3: ps << "label"; break;
+        }
+    }
+
+    ps << EndMessage;
+    return ps.Size();
+}
+
+
+static std::size_t ReadArguments( const ReceivedMessage& m, bool all )
+{
+    std::size_t checksum = 0;
+    for( ReceivedMessage::const_iterator i = m.ArgumentsBegin(); i != m.ArgumentsEnd(); ++i ){
+        if( i->IsString() )
+            checksum += (std::size_t)i->AsStringUnchecked()[0];
+        else
+            checksum += (std::size_t)i->AsInt32Unchecked();
+        if( !all )
+            break;
+    }
+    return checksum;
+}
+
+
+static void RunValidationBenchmarks()
+{
+    const std::size_t argumentCounts[] = { 8, 16, 32 };
+    const std::size_t argumentCountsCount = sizeof(argumentCounts) / sizeof(argumentCounts[0]);
+    const std::size_t messageCount = 1000000;
+
+    std::cout << "parsing and reading a message (ns per message)\n";
+    std::cout << std::setw(8) << "args" << std::setw(8) << "read"
+            << std::setw(10) << "up front" << std::setw(11) << "on access" << std::setw(8) << "saved" << "\n";
+
+    std::size_t checksum = 0;
+    std::vector<char> packet( 64 * 1024 );
+    for( std::size_t i = 0; i < argumentCountsCount; ++i ){
+        std::size_t size = BuildTypicalMessage( packet, argumentCounts[i] );
+
+        for( int all = 0; all < 2; ++all ){
+            double ns[2];
+            const ArgumentValidation validations[] = { VALIDATE_ARGUMENTS_UP_FRONT, VALIDATE_ARGUMENTS_ON_ACCESS };
+            for( int j = 0; j < 2; ++j ){
+                double start = CurrentTimeSeconds();
+                for( std::size_t k = 0; k < messageCount; ++k ){
+                    ReceivedMessage m( ReceivedPacket( &packet[0], size ), validations[j] );
+                    checksum += ReadArguments( m, all != 0 );
+                }
+                ns[j] = (CurrentTimeSeconds() - start) * 1e9 / (double)messageCount;
+            }
+
+            std::cout << std::setw(8) << argumentCounts[i] << std::setw(8) << ((all) ? "all" : "first")
+                    << std::fixed << std::setprecision(1) << std::setw(10) << ns[0] << std::setw(11) << ns[1]
+                    << std::setw(7) << std::setprecision(0) << (100.0 * (ns[0] - ns[1]) / ns[0]) << "%\n";
+        }
+    }
+
+    // keeps the loops from being optimised away
+    if( checksum == 0 )
+        std::cout << "(no arguments read)\n";
+}
+
+//-----------------------------------------------------------------------
+// garbage flood benchmark: the cost of rejecting malformed packets with
+// OscPacketListener, which throws an exception for each one (caught per
+// packet, as a receive loop has to), and with NothrowOscPacketListener.
+// followed by the cost of accepting well formed packets with each.
+
+class CountingOscPacketListener : public OscPacketListener{
+public:
+    std::size_t messageCount;
+    CountingOscPacketListener() : messageCount( 0 ) {}
+protected:
+    virtual void ProcessMessage( const ReceivedMessage& m, const IpEndpointName& )
+        { messageCount += m.ArgumentCount(); }
+};
+
+
+class CountingNothrowOscPacketListener : public NothrowOscPacketListener{
+public:
+    std::size_t messageCount, malformedCount;
+    CountingNothrowOscPacketListener() : messageCount( 0 ), malformedCount( 0 ) {}
+protected:
+    virtual void ProcessMessage( const ReceivedMessage& m, const IpEndpointName& )
+        { messageCount += m.ArgumentCount(); }
+    virtual void ProcessMalformedPacket( const char *, int, const IpEndpointName&, ParseStatus )
+        { ++malformedCount; }
+};
+
+
+// builds packets of the kinds of garbage a misbehaving device sends:
+// random bytes, truncated messages, bad type tags and bundles with bad
+// element sizes. each packet starts at a multiple of 64 bytes in packets
+static void BuildGarbagePackets( std::vector<char>& packets, std::vector<int>& sizes, std::size_t count )
+{
+    packets.assign( count * 64, '\0' );
+    sizes.assign( count, 0 );
+
+    unsigned long random = 12345;
+    for( std::size_t i = 0; i < count; ++i ){
+        char *p = &packets[ i * 64 ];
+        OutboundPacketStream ps( p, 64 );
+        switch( i % 4 ){
+            case 0:
+                for( int j = 0; j < 64; ++j ){
+                    random = random * 1103515245UL + 12345UL;
+                    p[j] = (char)( (random >> 16) | 1 );
+                }
+                sizes[i] = 4 * (int)( 1 + (random >> 8) % 16 );
+                break;
+            case 1:
+                ps << BeginMessage( "/garbage/truncated" ) << 1 << 2.0f << "three" << EndMessage;
+                sizes[i] = (int)ps.Size() - 8;
+                break;
+            case 2:
+                ps << BeginMessage( "/garbage/tag" ) << 1 << 2 << 3 << EndMessage;
+                p[ 17 ] = 'x';
+                sizes[i] = (int)ps.Size();
+                break;
+            case 3:
+                ps << BeginBundle() << BeginMessage( "/garbage/bundle" ) << 1 << EndMessage << EndBundle;
+                p[ 19 ] += 4;
+                sizes[i] = (int)ps.Size();
+                break;
+        }
+    }
+}
+
+
+static void BuildValidPackets( std::vector<char>& packets, std::vector<int>& sizes, std::size_t count )
+{
+    packets.assign( count * 64, '\0' );
+    sizes.assign( count, 0 );
+
+    for( std::size_t i = 0; i < count; ++i ){
+        OutboundPacketStream ps( &packets[ i * 64 ], 64 );
+        ps << BeginMessage( "/valid" ) << (int32)i << 2.0f << "three" << EndMessage;
+        sizes[i] = (int)ps.Size();
+    }
+}
+
+
+// returns ns per packet
+template< typename Listener >
+static double TimePackets( Listener& listener, const std::vector<char>& packets,
+        const std::vector<int>& sizes, std::size_t repeats, std::size_t& rejectedCount )
+{
+    IpEndpointName endpoint( 127, 0, 0, 1, 7000 );
+    double start = CurrentTimeSeconds();
+    for( std::size_t r = 0; r < repeats; ++r ){
+        for( std::size_t i = 0; i < sizes.size(); ++i ){
+            try{
+                listener.ProcessPacket( &packets[ i * 64 ], sizes[i], endpoint );
+            }catch( Exception& ){
+                ++rejectedCount;
+            }
+        }
+    }
+    return (CurrentTimeSeconds() - start) * 1e9 / (double)(repeats * sizes.size());
+}
+
+
+static void RunGarbageFloodBenchmarks()
+{
+    const std::size_t packetCount = 1024;
+    const std::size_t repeats = 500;
+
+    std::vector<char> garbage, valid;
+    std::vector<int> garbageSizes, validSizes;
+    BuildGarbagePackets( garbage, garbageSizes, packetCount );
+    BuildValidPackets( valid, validSizes, packetCount );
+
+    std::cout << "packet rejection and acceptance cost (ns per packet)\n";
+    std::cout << std::setw(26) << "listener" << std::setw(10) << "garbage" << std::setw(10) << "valid"
+            << std::setw(16) << "rejects/s" << "\n";
+
+    {
+        CountingOscPacketListener listener;
+        std::size_t rejected = 0;
+        double garbageNs = TimePackets( listener, garbage, garbageSizes, repeats, rejected );
+        std::size_t unused = 0;
+        double validNs = TimePackets( listener, valid, validSizes, repeats, unused );
+
+        std::cout << std::setw(26) << "OscPacketListener" << std::fixed << std::setprecision(1)
+                << std::setw(10) << garbageNs << std::setw(10) << validNs
+                << std::setw(16) << std::setprecision(0) << 1e9 / garbageNs
+                << "   (" << rejected / repeats << " of " << packetCount << " rejected)\n";
+    }
+
+    {
+        CountingNothrowOscPacketListener listener;
+        std::size_t unused = 0;
+        double garbageNs = TimePackets( listener, garbage, garbageSizes, repeats, unused );
+        std::size_t rejected = listener.malformedCount;
+        double validNs = TimePackets( listener, valid, validSizes, repeats, unused );
+
+        std::cout << std::setw(26) << "NothrowOscPacketListener" << std::fixed << std::setprecision(1)
+                << std::setw(10) << garbageNs << std::setw(10) << validNs
+                << std::setw(16) << std::setprecision(0) << 1e9 / garbageNs
+                << "   (" << rejected / repeats << " of " << packetCount << " rejected)\n";
+    }
+}
+
+//-----------------------------------------------------------------------
+// typed message benchmark: the cost of reading the arguments of a parsed
+// message with ArgumentStream(), with an argument iterator and the As()
+// methods, and with TypedMessage. ns per message.
+
+struct TypedBenchmarkValues{
+    int32 voice;
+    float frequency;
+    float amplitude;
+    const char *name;
+    double time;
+    float pan;
+};
+
+
+static void RunTypedMessageBenchmarks()
+{
+    const std::size_t messageCount = 4 * 1000 * 1000;
+
+    // a set of messages with different values, so that the compiler
+    // can't hoist the reading of one message out of the loops
+    const std::size_t variants = 64;
+    std::vector<char> packets( variants * 64 );
+    std::vector<ReceivedMessage> messages;
+    for( std::size_t j = 0; j < variants; ++j ){
+        OutboundPacketStream ps( &packets[ j * 64 ], 64 );
+        ps << BeginMessage( "/synth/note" ) << (int32)j << 440.0f + j << 0.5f << "sine" << 1.25 << -0.2f << EndMessage;
+        messages.push_back( ReceivedMessage( ReceivedPacket( ps.Data(), ps.Size() ) ) );
+    }
+
+    std::cout << "reading 6 arguments of a parsed message (ns per message)\n";
+
+    double checksum = 0;
+    TypedBenchmarkValues v;
+
+    double start = CurrentTimeSeconds();
+    for( std::size_t k = 0; k < messageCount; ++k ){
+        const ReceivedMessage& m = messages[ k % variants ];
+        m.ArgumentStream() >> v.voice >> v.frequency >> v.amplitude >> v.name >> v.time >> v.pan >> EndMessage;
+        checksum += v.voice + v.frequency + v.amplitude + v.name[0] + v.time + v.pan;
+    }
+    double streamNs = (CurrentTimeSeconds() - start) * 1e9 / (double)messageCount;
+
+    start = CurrentTimeSeconds();
+    for( std::size_t k = 0; k < messageCount; ++k ){
+        const ReceivedMessage& m = messages[ k % variants ];
+        ReceivedMessage::const_iterator i = m.ArgumentsBegin();
+        v.voice = (i++)->AsInt32();
+        v.frequency = (i++)->AsFloat();
+        v.amplitude = (i++)->AsFloat();
+        v.name = (i++)->AsString();
+        v.time = (i++)->AsDouble();
+        v.pan = (i++)->AsFloat();
+        checksum += v.voice + v.frequency + v.amplitude + v.name[0] + v.time + v.pan;
+    }
+    double iteratorNs = (CurrentTimeSeconds() - start) * 1e9 / (double)messageCount;
+
+    typedef TypedMessage< int32, float, float, const char*, double, float > NoteMessage;
+    start = CurrentTimeSeconds();
+    for( std::size_t k = 0; k < messageCount; ++k ){
+        const ReceivedMessage& m = messages[ k % variants ];
+        NoteMessage::tuple_type values;
+        if( NoteMessage::TryDecode( m, values ) )
+            checksum += std::get<0>( values ) + std::get<1>( values ) + std::get<2>( values )
+                    + std::get<3>( values )[0] + std::get<4>( values ) + std::get<5>( values );
+    }
+    double typedNs = (CurrentTimeSeconds() - start) * 1e9 / (double)messageCount;
+
+    std::cout << std::setw(26) << "ArgumentStream()" << std::fixed << std::setprecision(1) << std::setw(8) << streamNs << "\n";
+    std::cout << std::setw(26) << "iterator and As()" << std::setw(8) << iteratorNs << "\n";
+    std::cout << std::setw(26) << "TypedMessage::TryDecode()" << std::setw(8) << typedNs << "\n";
+
+    // keeps the loops from being optimised away
+    if( checksum == 0 )
+        std::cout << "(no arguments read)\n";
+}
+
+//-----------------------------------------------------------------------
+// array benchmark: the cost of reading a 512 element float array from a
+// parsed message into a buffer, with an argument iterator and AsFloat(),
+// and with ArrayView::CopyTo() using each CopyBigEndian32()
+// implementation. ns per message.
+
+static void RunArrayBenchmarks()
+{
+    const std::size_t elementCount = 512;
+    const std::size_t messageCount = 200000;
+
+    // the message is "/spectrum" with type tags "i[ff...f]"
+    std::vector<char> packet( 8 * 1024 );
+    OutboundPacketStream ps( &packet[0], packet.size() );
+    ps << BeginMessage( "/spectrum" ) << (int32)1 << BeginArray;
+    for( std::size_t i = 0; i < elementCount; ++i )
+        ps << (float)i * 0.01f;
+    ps << EndArray << EndMessage;
+    ReceivedMessage m( ReceivedPacket( ps.Data(), ps.Size() ) );
+
+    std::vector<float> spectrum( elementCount );
+    double checksum = 0;
+
+    std::cout << "reading a " << elementCount << " element float array (ns per message)\n";
+
+    double start = CurrentTimeSeconds();
+    for( std::size_t k = 0; k < messageCount; ++k ){
+        ReceivedMessage::const_iterator arg = m.ArgumentsBegin();
+        ++arg; ++arg;
+        for( std::size_t i = 0; i < elementCount; ++i, ++arg )
+            spectrum[i] = arg->AsFloat();
+        checksum += spectrum[ k % elementCount ];
+    }
+    double iteratorNs = (CurrentTimeSeconds() - start) * 1e9 / (double)messageCount;
+    std::cout << std::setw(26) << "iterator and AsFloat()" << std::fixed << std::setprecision(1) << std::setw(10) << iteratorNs << "\n";
+
+    StringScanImplementation automatic = ActiveStringScanImplementation();
+    for( std::size_t j = 0; j < stringScanImplementationsCount_; ++j ){
+        if( !SetStringScanImplementation( stringScanImplementations_[j] ) )
+            continue;
+
+        start = CurrentTimeSeconds();
+        for( std::size_t k = 0; k < messageCount; ++k ){
+            ArrayView< float > view( m, m.Argument( 1 ) );
+            view.CopyTo( &spectrum[0], spectrum.size() );
+            checksum += spectrum[ k % elementCount ];
+        }
+        double viewNs = (CurrentTimeSeconds() - start) * 1e9 / (double)messageCount;
+
+        std::string label = std::string( "ArrayView::CopyTo() " ) + StringScanImplementationName( stringScanImplementations_[j] );
+        std::cout << std::setw(26) << label << std::setw(10) << viewNs << "\n";
+    }
+
+    SetStringScanImplementation( automatic );
+
+    // keeps the loops from being optimised away
+    if( checksum == 0 )
+        std::cout << "(no elements read)\n";
+}
+
+//-----------------------------------------------------------------------
+
+struct ParseBenchmark{
+    const char *name;
+    void (*run)();
+};
+
+static const ParseBenchmark parseBenchmarks_[] = {
+    { "string-scan", RunStringScanBenchmarks },
+    { "type-tags", RunTypeTagBenchmarks },
+    { "random-access", RunRandomAccessBenchmarks },
+    { "validation", RunValidationBenchmarks },
+    { "garbage-flood", RunGarbageFloodBenchmarks },
+    { "typed-message", RunTypedMessageBenchmarks },
+    { "array", RunArrayBenchmarks },
+};
+
+void RunParseBenchmarks( const char *benchmarkName )
+{
+    const std::size_t count = sizeof(parseBenchmarks_) / sizeof(parseBenchmarks_[0]);
+    bool found = false;
+
+    for( std::size_t i = 0; i < count; ++i ){
+        if( benchmarkName == 0 || std::strcmp( benchmarkName, parseBenchmarks_[i].name ) == 0 ){
+            parseBenchmarks_[i].run();
+            std::cout << "\n";
+            found = true;
+        }
+    }
+
+    if( !found )
+        std::cout << "unknown benchmark: " << benchmarkName << "\n";
+}
+
+} // namespace osc
+
+#ifndef NO_OSC_TEST_MAIN
+
+int main(int argc, char* argv[])
+{
+    if( argc >= 2 && std::strcmp( argv[1], "-h" ) == 0 ){
+        std::cout << "usage: OscParseBenchmarks [benchmark]\n";
+        std::cout << "available benchmarks:";
+        for( std::size_t i = 0; i < sizeof(osc::parseBenchmarks_) / sizeof(osc::parseBenchmarks_[0]); ++i )
+            std::cout << " " << osc::parseBenchmarks_[i].name;
+        std::cout << "\n";
+        return 0;
+    }
+
+    osc::RunParseBenchmarks( (argc >= 2) ? argv[1] : 0 );
+
+    return 0;
+}
+
+#endif /* NO_OSC_TEST_MAIN */
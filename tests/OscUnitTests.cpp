@@ -37,12 +37,40 @@
 #include "OscUnitTests.h"
 
 #include <cstring>
+#include <stdexcept>
 #include <iomanip>
 #include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <netinet/in.h>
+#include <netinet/udp.h> // UDP_SEGMENT
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
 
 #include "osc/OscReceivedElements.h"
 #include "osc/OscPrintReceivedElements.h"
 #include "osc/OscOutboundPacketStream.h"
+#include "osc/OscStringScan.h"
+#include "osc/OscTypedMessage.h"
+#include "osc/OscPacketListener.h"
+#include "osc/NothrowOscPacketListener.h"
+#include "osc/ParallelOscPacketListener.h"
+#include "ip/UdpSocket.h"
+#include "ip/PacketListener.h"
+#include "ip/PacketBuffer.h"
+#include "ip/TimerListener.h"
+#include "ip/UdpSocketListenerThread.h"
+#include "ip/SendCompletionListener.h"
 
 #if defined(__BORLANDC__) // workaround for BCB4 release build intrinsics bug
 namespace std {
@@ -435,12 +463,1869 @@ void test3()
     }
 }
 
+//---------------------------------------------------------------------------
+
+// the original word at a time scan, which the vector versions must agree with
+static const char* ReferenceFindStr4End( const char *p, const char *end )
+{
+    if( p >= end )
+        return 0;
+
+    if( p[0] == '\0' )
+        return p + 4;
+
+    for( ; end - p >= 4; p += 4 ){
+        if( p[3] == '\0' )
+            return p + 4;
+    }
+
+    return 0;
+}
+
+
+void test4()
+{
+    const std::size_t maxSize = 160;
+    char *buffer = AllocateAligned4( maxSize );
+
+    StringScanImplementation automatic = ActiveStringScanImplementation();
+    const StringScanImplementation implementations[] = {
+        SCALAR_STRING_SCAN, SSE2_STRING_SCAN, AVX2_STRING_SCAN, NEON_STRING_SCAN };
+
+    for( std::size_t i = 0; i < sizeof(implementations) / sizeof(implementations[0]); ++i ){
+        if( !SetStringScanImplementation( implementations[i] ) )
+            continue;
+
+        std::cout << "string scan: " << StringScanImplementationName( implementations[i] ) << "\n";
+
+        // strings terminated at every position, or not at all, starting at
+        // each word of buffers of every size. the end of the buffer is
+        // moved so that a scan reading past it would see a terminator.
+        int mismatches = 0;
+        for( std::size_t size = 4; size + 4 <= maxSize; size += 4 ){
+            for( std::size_t terminator = 0; terminator <= size; ++terminator ){
+                std::memset( buffer, 'x', maxSize );
+                if( terminator < size )
+                    buffer[ terminator ] = '\0';
+                std::memset( buffer + size, '\0', maxSize - size );
+
+                for( std::size_t start = 0; start <= size; start += 4 ){
+                    if( FindStr4End( buffer + start, buffer + size )
+                            != ReferenceFindStr4End( buffer + start, buffer + size ) )
+                        ++mismatches;
+                }
+            }
+        }
+        assertEqual( mismatches, 0 );
+    }
+
+    SetStringScanImplementation( automatic );
+}
+
+
+// builds a message with the given type tags and well formed arguments for
+// them. int32 arguments hold their argument index so that iteration can
+// check that each argument was found at the right offset.
+static std::size_t BuildTypeTagTestMessage( char *buffer, const char *typeTags )
+{
+    char *p = buffer;
+    std::memcpy( p, "/t\0\0,", 5 );
+    p += 5;
+    std::size_t tagCount = std::strlen( typeTags );
+    std::memcpy( p, typeTags, tagCount + 1 );
+    p += tagCount + 1;
+    while( (p - buffer) & 0x03 )
+        *p++ = '\0';
+
+    for( std::size_t i = 0; i < tagCount; ++i ){
+        switch( typeTags[i] ){
+            case INT32_TYPE_TAG:
+                p[0] = p[1] = p[2] = 0;
+                p[3] = (char)i;
+                p += 4;
+                break;
+            case FLOAT_TYPE_TAG:
+            case CHAR_TYPE_TAG:
+            case RGBA_COLOR_TYPE_TAG:
+            case MIDI_MESSAGE_TYPE_TAG:
+                std::memset( p, 0, 4 );
+                p += 4;
+                break;
+            case INT64_TYPE_TAG:
+            case TIME_TAG_TYPE_TAG:
+            case DOUBLE_TYPE_TAG:
+                std::memset( p, 0, 8 );
+                p += 8;
+                break;
+            case STRING_TYPE_TAG:
+            case SYMBOL_TYPE_TAG:
+                std::memcpy( p, "abc\0", 4 );
+                p += 4;
+                break;
+            case BLOB_TYPE_TAG:
+                std::memcpy( p, "\0\0\0\x04wxyz", 8 );
+                p += 8;
+                break;
+        }
+    }
+
+    return (std::size_t)(p - buffer);
+}
+
+
+// describes what parsing and iterating a message produced, or that it threw
+static std::string DescribeParse( const char *data, std::size_t size,
+        ArgumentValidation validation=VALIDATE_ARGUMENTS_UP_FRONT )
+{
+    std::string result;
+    try{
+        ReceivedMessage m( ReceivedPacket( data, (osc_bundle_element_size_t)size ), validation );
+        result += (char)('0' + m.ArgumentCount() % 64);
+        for( ReceivedMessage::const_iterator i = m.ArgumentsBegin(); i != m.ArgumentsEnd(); ++i ){
+            result += i->TypeTag();
+            if( i->IsInt32() )
+                result += (char)('0' + i->AsInt32() % 64);
+        }
+    }catch( MalformedMessageException& ){
+        result += "malformed";
+    }
+    return result;
+}
+
+
+// fills typeTags with up to maxTags random type tags. mostly fixed size
+// tags, so that long runs reach the vector code, with strings, blobs,
+// arrays and the occasional unknown tag mixed in
+static void MakeRandomTypeTags( unsigned int& seed, char *typeTags, std::size_t maxTags )
+{
+    const char fixedTags[] = "ifhdtcrmTFNI";
+    const char otherTags[] = "[]sSb[]x";
+
+    seed = seed * 1103515245U + 12345U;
+    std::size_t tagCount = (seed >> 8) % (maxTags + 1);
+    unsigned int otherChance = 2 + (seed >> 20) % 30;
+    for( std::size_t i = 0; i < tagCount; ++i ){
+        seed = seed * 1103515245U + 12345U;
+        if( (seed >> 16) % otherChance == 0 )
+            typeTags[i] = otherTags[ (seed >> 8) % (sizeof(otherTags) - 1) ];
+        else
+            typeTags[i] = fixedTags[ (seed >> 8) % (sizeof(fixedTags) - 1) ];
+    }
+    typeTags[ tagCount ] = '\0';
+}
+
+
+void test5()
+{
+    const std::size_t maxTags = 96;
+    const std::size_t bufferSize = 8 + maxTags * 12;
+    char *buffer = AllocateAligned4( bufferSize );
+    char typeTags[ maxTags + 1 ];
+
+    StringScanImplementation automatic = ActiveStringScanImplementation();
+    const StringScanImplementation implementations[] = {
+        SSE2_STRING_SCAN, AVX2_STRING_SCAN, NEON_STRING_SCAN };
+
+    unsigned int seed = 12345;
+    int mismatches = 0;
+    for( int message = 0; message < 2000; ++message ){
+        MakeRandomTypeTags( seed, typeTags, maxTags );
+        std::size_t size = BuildTypeTagTestMessage( buffer, typeTags );
+
+        // whole messages, and messages truncated by a few words
+        for( std::size_t truncate = 0; truncate <= 8 && truncate < size; truncate += 4 ){
+            SetStringScanImplementation( SCALAR_STRING_SCAN );
+            std::string expected = DescribeParse( buffer, size - truncate );
+
+            for( std::size_t i = 0; i < sizeof(implementations) / sizeof(implementations[0]); ++i ){
+                if( !SetStringScanImplementation( implementations[i] ) )
+                    continue;
+                if( DescribeParse( buffer, size - truncate ) != expected )
+                    ++mismatches;
+            }
+        }
+    }
+    assertEqual( mismatches, 0 );
+
+    SetStringScanImplementation( automatic );
+
+    // a blob whose size runs past the end of the message
+    {
+        std::size_t size = BuildTypeTagTestMessage( buffer, "fb" );
+        buffer[ size - 5 ] = 0x08;
+        assertEqual( DescribeParse( buffer, size ), std::string( "malformed" ) );
+    }
+
+    // fixed size arguments that run past the end of the message
+    {
+        std::size_t size = BuildTypeTagTestMessage( buffer, "iiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiid" );
+        assertEqual( DescribeParse( buffer, size - 4 ), std::string( "malformed" ) );
+    }
+}
+
+
+// checks Argument() and the indexed iterator against forward iteration
+static int CountArgumentIndexMismatches( const ReceivedMessage& m )
+{
+    int mismatches = 0;
+    uint32 i = 0;
+    for( ReceivedMessage::const_iterator j = m.ArgumentsBegin(); j != m.ArgumentsEnd(); ++j, ++i ){
+        ReceivedMessageArgument a = m.Argument( i );
+        if( a.TypeTag() != j->TypeTag() || a.AsStringUnchecked() != j->AsStringUnchecked() )
+            ++mismatches;
+
+        ReceivedMessageIndexedArgumentIterator k = m.IndexedArgumentsBegin() + i;
+        if( k->AsStringUnchecked() != j->AsStringUnchecked() )
+            ++mismatches;
+    }
+
+    if( i != m.ArgumentCount() )
+        ++mismatches;
+
+    return mismatches;
+}
+
+
+void test6()
+{
+    int bufferSize = 1000;
+    char *buffer = AllocateAligned4( bufferSize );
+
+    char blobData[] = "abcdefg";
+    OutboundPacketStream ps( buffer, bufferSize );
+    ps << BeginMessage( "/indexed" );
+    for( int i = 0; i < 24; ++i ){
+        switch( i % 6 ){
+            case 0: ps << (int32)i; break;
+            case 1: ps << std::string( i, 'x' ).c_str(); break;
+            case 2: ps << BeginArray << 1.5f << EndArray; break;
+            case 3: ps << Blob( blobData, i % 8 ); break;
+            case 4: ps << (int64)i << Symbol( "s" ); break;
+            case 5: ps << true << (double)i; break;
+        }
+    }
+    ps << EndMessage;
+    assertEqual( ps.IsReady(), true );
+    ReceivedPacket p( ps.Data(), ps.Size() );
+
+    // the default inline index covers the first few arguments
+    {
+        ReceivedMessage m( p );
+        assertEqual( m.IndexedArgumentCount(), (uint32)ReceivedMessage::INLINE_ARGUMENT_INDEX_SIZE );
+        assertEqual( CountArgumentIndexMismatches( m ), 0 );
+    }
+
+    // caller supplied index storage, large enough and too small
+    {
+        uint32 offsets[64];
+        ReceivedMessage m( p, offsets, 64 );
+        assertEqual( m.IndexedArgumentCount(), m.ArgumentCount() );
+        assertEqual( CountArgumentIndexMismatches( m ), 0 );
+
+        ReceivedMessage copy( m );
+        assertEqual( CountArgumentIndexMismatches( copy ), 0 );
+    }
+    {
+        uint32 offsets[3];
+        ReceivedMessage m( p, offsets, 3 );
+        assertEqual( m.IndexedArgumentCount(), (uint32)3 );
+        assertEqual( CountArgumentIndexMismatches( m ), 0 );
+    }
+    {
+        ReceivedMessage m( p, 0, 0 );
+        assertEqual( m.IndexedArgumentCount(), (uint32)0 );
+        assertEqual( CountArgumentIndexMismatches( m ), 0 );
+    }
+
+    // random access iterator operations
+    {
+        ReceivedMessage m( p );
+        ReceivedMessage::const_indexed_iterator begin = m.IndexedArgumentsBegin();
+        ReceivedMessage::const_indexed_iterator end = m.IndexedArgumentsEnd();
+        assertEqual( (uint32)(end - begin), m.ArgumentCount() );
+        assertEqual( (uint32)std::distance( begin, end ), m.ArgumentCount() );
+        assertEqual( begin[6].AsInt64(), (int64)4 );
+        assertEqual( (*(end - 1)).IsDouble(), true );
+        assertEqual( (begin + 1 < end), true );
+
+        ReceivedMessage::const_indexed_iterator i = end;
+        --i;
+        i -= 4;
+        assertEqual( i->IsBlob(), true );
+        assertEqual( i.Index(), m.ArgumentCount() - 5 );
+
+        bool threw = false;
+        try{
+            m.Argument( m.ArgumentCount() );
+        }catch( MissingArgumentException& ){
+            threw = true;
+        }
+        assertEqual( threw, true );
+    }
+}
+
+
+static bool ArrayTypeTagsBalanced( const char *typeTags )
+{
+    int level = 0;
+    for( ; *typeTags; ++typeTags ){
+        if( *typeTags == ARRAY_BEGIN_TYPE_TAG )
+            ++level;
+        else if( *typeTags == ARRAY_END_TYPE_TAG && --level < 0 )
+            return false;
+    }
+    return level == 0;
+}
+
+
+void test7()
+{
+    const std::size_t maxTags = 96;
+    const std::size_t bufferSize = 8 + maxTags * 12;
+    char *buffer = AllocateAligned4( bufferSize );
+    char typeTags[ maxTags + 1 ];
+
+    // messages validated on access read the same as validated messages,
+    // and malformed ones throw while being read instead. only unbalanced
+    // array markers go unreported
+    unsigned int seed = 54321;
+    int mismatches = 0;
+    for( int message = 0; message < 2000; ++message ){
+        MakeRandomTypeTags( seed, typeTags, maxTags );
+        std::size_t size = BuildTypeTagTestMessage( buffer, typeTags );
+
+        for( std::size_t truncate = 0; truncate <= 8 && truncate < size; truncate += 4 ){
+            std::string expected = DescribeParse( buffer, size - truncate );
+            std::string onAccess = DescribeParse( buffer, size - truncate, VALIDATE_ARGUMENTS_ON_ACCESS );
+            if( expected == "malformed" ){
+                // the arguments before the malformed one can be read
+                if( onAccess.find( "malformed" ) == std::string::npos && ArrayTypeTagsBalanced( typeTags ) )
+                    ++mismatches;
+            }else if( onAccess != expected ){
+                ++mismatches;
+            }
+        }
+    }
+    assertEqual( mismatches, 0 );
+
+    // the address pattern and type tags are still checked up front
+    {
+        std::size_t size = BuildTypeTagTestMessage( buffer, "iii" );
+        buffer[ 4 ] = 'i'; // no ',' before the type tags
+        assertEqual( DescribeParse( buffer, size, VALIDATE_ARGUMENTS_ON_ACCESS ), std::string( "malformed" ) );
+    }
+
+    // a string argument running past the end is found when it's reached
+    {
+        std::size_t size = BuildTypeTagTestMessage( buffer, "is" );
+        buffer[ size - 1 ] = 'x';
+        ReceivedMessage m( ReceivedPacket( buffer, (osc_bundle_element_size_t)size ), VALIDATE_ARGUMENTS_ON_ACCESS );
+        assertEqual( m.ArgumentCount(), (uint32)2 );
+        ReceivedMessage::const_iterator i = m.ArgumentsBegin();
+        assertEqual( i->AsInt32(), (int32)0 );
+
+        bool threw = false;
+        try{
+            ++i;
+        }catch( MalformedMessageException& ){
+            threw = true;
+        }
+        assertEqual( threw, true );
+    }
+}
+
+
+// records the address of each message, followed by "+" if its arguments
+// are validated on access (the sender is trusted) or "-" if up front
+class ValidationRecordingListener : public OscPacketListener{
+public:
+    std::string received;
+
+protected:
+    virtual void ProcessMessage( const ReceivedMessage& m, const IpEndpointName& )
+    {
+        received += m.AddressPattern();
+        received += ( m.UncheckedArgumentsEnd() != 0 ) ? "+" : "-";
+    }
+};
+
+
+// the validation of each message of a bundle "/a [ /b [ /c ] ]" from remoteEndpoint
+static std::string NestedBundleValidation( ValidationRecordingListener& listener, const IpEndpointName& remoteEndpoint )
+{
+    char buffer[ 256 ];
+    OutboundPacketStream ps( buffer, sizeof(buffer) );
+    ps << BeginBundleImmediate
+        << BeginMessage( "/a" ) << (int32)1 << EndMessage
+        << BeginBundleImmediate
+            << BeginMessage( "/b" ) << (int32)2 << EndMessage
+            << BeginBundleImmediate
+                << BeginMessage( "/c" ) << "three" << EndMessage
+            << EndBundle
+        << EndBundle
+        << EndBundle;
+
+    listener.received.clear();
+    listener.ProcessPacket( ps.Data(), (int)ps.Size(), remoteEndpoint );
+    return listener.received;
+}
+
+
+static std::string MessageValidation( ValidationRecordingListener& listener, const IpEndpointName& remoteEndpoint )
+{
+    char buffer[ 64 ];
+    OutboundPacketStream ps( buffer, sizeof(buffer) );
+    ps << BeginMessage( "/m" ) << (int32)1 << EndMessage;
+
+    listener.received.clear();
+    listener.ProcessPacket( ps.Data(), (int)ps.Size(), remoteEndpoint );
+    return listener.received;
+}
+
+
+void test14()
+{
+    // the OscPacketListener trust policy: which messages are validated on access
+    ValidationRecordingListener listener;
+    IpEndpointName trusted( "127.0.0.1", 9000 );
+    IpEndpointName otherPort( "127.0.0.1", 9001 );
+    IpEndpointName otherAddress( "127.0.0.2", 9000 );
+    IpEndpointName anyPortHost( "10.0.0.1", 5000 );
+
+    // nobody is trusted by default
+    assertEqual( MessageValidation( listener, trusted ), std::string( "/m-" ) );
+    assertEqual( NestedBundleValidation( listener, trusted ), std::string( "/a-/b-/c-" ) );
+
+    // a trusted endpoint matches its address and port exactly
+    listener.AddTrustedSender( trusted );
+    assertEqual( MessageValidation( listener, trusted ), std::string( "/m+" ) );
+    assertEqual( MessageValidation( listener, otherPort ), std::string( "/m-" ) );
+    assertEqual( MessageValidation( listener, otherAddress ), std::string( "/m-" ) );
+
+    // including the messages of nested bundles
+    assertEqual( NestedBundleValidation( listener, trusted ), std::string( "/a+/b+/c+" ) );
+    assertEqual( NestedBundleValidation( listener, otherPort ), std::string( "/a-/b-/c-" ) );
+
+    // ANY_PORT trusts every port at the address, but no other address
+    listener.AddTrustedSender( IpEndpointName( "10.0.0.1", IpEndpointName::ANY_PORT ) );
+    assertEqual( MessageValidation( listener, anyPortHost ), std::string( "/m+" ) );
+    assertEqual( MessageValidation( listener, IpEndpointName( "10.0.0.1", 65000 ) ), std::string( "/m+" ) );
+    assertEqual( NestedBundleValidation( listener, anyPortHost ), std::string( "/a+/b+/c+" ) );
+    assertEqual( MessageValidation( listener, IpEndpointName( "10.0.0.2", 5000 ) ), std::string( "/m-" ) );
+
+    // trusting all senders overrides the list, and can be turned off again
+    listener.SetTrustAllSenders( true );
+    assertEqual( MessageValidation( listener, otherAddress ), std::string( "/m+" ) );
+    assertEqual( NestedBundleValidation( listener, otherAddress ), std::string( "/a+/b+/c+" ) );
+    listener.SetTrustAllSenders( false );
+    assertEqual( MessageValidation( listener, otherAddress ), std::string( "/m-" ) );
+    assertEqual( MessageValidation( listener, trusted ), std::string( "/m+" ) );
+}
+
+
+// describes the result of TryParse() in the same terms as DescribeParse()
+static std::string DescribeTryParse( const char *data, std::size_t size )
+{
+    std::string result;
+    ReceivedMessage m;
+    if( m.TryParse( data, (osc_bundle_element_size_t)size ) != PARSE_OK ){
+        if( m.ArgumentCount() != 0 || m.AddressPattern() != 0 )
+            result += "not empty ";
+        result += "malformed";
+        return result;
+    }
+
+    result += (char)('0' + m.ArgumentCount() % 64);
+    for( ReceivedMessage::const_iterator i = m.ArgumentsBegin(); i != m.ArgumentsEnd(); ++i ){
+        result += i->TypeTag();
+        if( i->IsInt32() )
+            result += (char)('0' + i->AsInt32() % 64);
+    }
+    return result;
+}
+
+
+// the status TryParse() returns for a bundle, as the exception the
+// constructor throws
+static std::string BundleStatusAsException( const char *data, std::size_t size )
+{
+    ReceivedBundle b;
+    ParseStatus status = b.TryParse( data, (osc_bundle_element_size_t)size );
+    if( status != PARSE_OK && ( b.ElementCount() != 0 || b.ElementsBegin() != b.ElementsEnd() ) )
+        return "not empty";
+    return ParseStatusString( status );
+}
+
+
+static std::string BundleException( const char *data, std::size_t size )
+{
+    try{
+        ReceivedBundle b( ReceivedPacket( data, (osc_bundle_element_size_t)size ) );
+    }catch( MalformedBundleException& e ){
+        return e.what();
+    }
+    return "ok";
+}
+
+
+void test8()
+{
+    const std::size_t maxTags = 96;
+    const std::size_t bufferSize = 8 + maxTags * 12;
+    char *buffer = AllocateAligned4( bufferSize );
+    char typeTags[ maxTags + 1 ];
+
+    // TryParse() accepts and rejects the same messages as the constructor,
+    // for the same reasons
+    unsigned int seed = 2468;
+    int mismatches = 0;
+    for( int message = 0; message < 2000; ++message ){
+        MakeRandomTypeTags( seed, typeTags, maxTags );
+        std::size_t size = BuildTypeTagTestMessage( buffer, typeTags );
+
+        for( std::size_t truncate = 0; truncate <= 8 && truncate < size; truncate += 4 ){
+            if( DescribeTryParse( buffer, size - truncate ) != DescribeParse( buffer, size - truncate ) )
+                ++mismatches;
+
+            std::string what = "ok";
+            try{
+                ReceivedMessage m( ReceivedPacket( buffer, (osc_bundle_element_size_t)(size - truncate) ) );
+            }catch( MalformedMessageException& e ){
+                what = e.what();
+            }
+            ReceivedMessage m;
+            if( what != ParseStatusString( m.TryParse( buffer, (osc_bundle_element_size_t)(size - truncate) ) ) )
+                ++mismatches;
+        }
+    }
+    assertEqual( mismatches, 0 );
+
+    // packet size checks
+    {
+        ReceivedPacket p;
+        assertEqual( p.TryParse( buffer, 6 ), PARSE_PACKET_SIZE_NOT_MULTIPLE_OF_4 );
+        assertEqual( p.TryParse( buffer, 0 ), PARSE_ZERO_LENGTH_PACKET );
+        assertEqual( p.TryParse( buffer, 8 ), PARSE_OK );
+        assertEqual( p.Size(), (osc_bundle_element_size_t)8 );
+    }
+
+    // bundles, whole and with broken element sizes
+    {
+        std::memset( buffer, 0x74, bufferSize );
+        OutboundPacketStream ps( buffer, bufferSize );
+        ps << BeginBundle()
+            << BeginMessage( "/one" ) << 1 << EndMessage
+            << BeginMessage( "/two" ) << 2 << EndMessage
+            << EndBundle;
+        std::size_t size = ps.Size();
+
+        ReceivedBundle b;
+        assertEqual( b.TryParse( buffer, (osc_bundle_element_size_t)size ), PARSE_OK );
+        assertEqual( b.ElementCount(), (uint32)2 );
+
+        assertEqual( BundleStatusAsException( buffer, size ), BundleException( buffer, size ) );
+        assertEqual( BundleStatusAsException( buffer, size - 4 ), BundleException( buffer, size - 4 ) );
+        assertEqual( BundleStatusAsException( buffer, 12 ), std::string( "packet too short for bundle" ) );
+        buffer[ 19 ] = 0x0D;
+        assertEqual( BundleStatusAsException( buffer, size ), BundleException( buffer, size ) );
+        buffer[ 0 ] = '*';
+        assertEqual( BundleStatusAsException( buffer, size ), std::string( "bad bundle address pattern" ) );
+    }
+
+    // a message reused for messages without arguments doesn't keep the
+    // argument index of the one before
+    {
+        char five[ 64 ], noTypeTags[ 16 ], noArguments[ 16 ];
+        OutboundPacketStream ps( five, sizeof(five) );
+        ps << BeginMessage( "/five" ) << 1 << 2 << 3 << 4 << 5 << EndMessage;
+        std::size_t fiveSize = ps.Size();
+        std::memcpy( noTypeTags, "/addr\0\0\0", 8 );
+        std::memcpy( noArguments, "/addr\0\0\0,\0\0\0", 12 );
+
+        ReceivedMessage m;
+        assertEqual( m.TryParse( five, (osc_bundle_element_size_t)fiveSize ), PARSE_OK );
+        assertEqual( m.IndexedArgumentCount(), (uint32)5 );
+
+        assertEqual( m.TryParse( noTypeTags, 8 ), PARSE_OK );
+        assertEqual( m.ArgumentCount(), (uint32)0 );
+        assertEqual( m.IndexedArgumentCount(), (uint32)0 );
+        assertEqual( m.ArgumentsBegin() == m.ArgumentsEnd(), true );
+
+        assertEqual( m.TryParse( five, (osc_bundle_element_size_t)fiveSize ), PARSE_OK );
+        assertEqual( m.TryParse( noArguments, 12 ), PARSE_OK );
+        assertEqual( m.ArgumentCount(), (uint32)0 );
+        assertEqual( m.IndexedArgumentCount(), (uint32)0 );
+        assertEqual( m.ArgumentsBegin() == m.ArgumentsEnd(), true );
+    }
+}
+
+
+// records the address of each message processed, and each malformed
+// packet or bundle element reported
+class MalformedRecordingListener : public NothrowOscPacketListener{
+public:
+    std::string received;
+    std::vector<const char*> malformedData;
+    std::vector<int> malformedSizes;
+    std::vector<ParseStatus> malformedStatuses;
+
+protected:
+    virtual void ProcessMessage( const ReceivedMessage& m, const IpEndpointName& )
+    {
+        received += m.AddressPattern();
+    }
+
+    virtual void ProcessMalformedPacket( const char *data, int size,
+            const IpEndpointName&, ParseStatus status )
+    {
+        malformedData.push_back( data );
+        malformedSizes.push_back( size );
+        malformedStatuses.push_back( status );
+    }
+};
+
+
+// the first occurrence of s in [begin, end) at or after from
+static char* FindBytes( char *begin, char *end, const char *s, std::size_t from=0 )
+{
+    char *result = std::search( begin + from, end, s, s + std::strlen( s ) );
+    return ( result == end ) ? 0 : result;
+}
+
+
+void test15()
+{
+    char buffer[ 256 ];
+    IpEndpointName sender( "127.0.0.1", 9000 );
+
+    // a malformed element of a bundle is reported with its own status,
+    // and the other elements are still delivered
+    {
+        OutboundPacketStream ps( buffer, sizeof(buffer) );
+        ps << BeginBundleImmediate
+            << BeginMessage( "/one" ) << (int32)1 << EndMessage
+            << BeginMessage( "/two" ) << (int32)2 << EndMessage
+            << BeginBundleImmediate
+                << BeginMessage( "/three" ) << (int32)3 << EndMessage
+            << EndBundle
+            << BeginMessage( "/four" ) << (int32)4 << EndMessage
+            << EndBundle;
+        char *end = buffer + ps.Size();
+
+        // "/two" gets an unknown type tag, the nested bundle a bad "#bundle"
+        char *two = FindBytes( buffer, end, "/two" );
+        two[ 9 ] = 'x';
+        char *nestedBundle = FindBytes( buffer, end, "#bundle", 1 );
+        nestedBundle[ 6 ] = 'X';
+
+        MalformedRecordingListener listener;
+        listener.ProcessPacket( buffer, (int)ps.Size(), sender );
+
+        assertEqual( listener.received, std::string( "/one/four" ) );
+        assertEqual( listener.malformedStatuses.size(), (std::size_t)2 );
+        if( listener.malformedStatuses.size() == 2 ){
+            assertEqual( listener.malformedStatuses[0], PARSE_UNKNOWN_TYPE_TAG );
+            assertEqual( listener.malformedData[0], (const char*)two );
+            assertEqual( listener.malformedSizes[0], 16 );
+            assertEqual( listener.malformedStatuses[1], PARSE_BAD_BUNDLE_ADDRESS_PATTERN );
+            assertEqual( listener.malformedData[1], (const char*)nestedBundle );
+        }
+    }
+
+    // malformed top level packets are reported whole and never reach
+    // ProcessMessage()
+    {
+        OutboundPacketStream ps( buffer, sizeof(buffer) );
+        ps << BeginMessage( "/bad" ) << (int32)1 << EndMessage;
+        buffer[ 9 ] = 'x';
+
+        MalformedRecordingListener listener;
+        listener.ProcessPacket( buffer, (int)ps.Size(), sender );
+        listener.ProcessPacket( buffer, 6, sender );
+        buffer[ 9 ] = 'i';
+        listener.ProcessPacket( buffer, (int)ps.Size() - 4, sender );
+
+        assertEqual( listener.received, std::string( "" ) );
+        assertEqual( listener.malformedStatuses.size(), (std::size_t)3 );
+        if( listener.malformedStatuses.size() == 3 ){
+            assertEqual( listener.malformedStatuses[0], PARSE_UNKNOWN_TYPE_TAG );
+            assertEqual( listener.malformedData[0], (const char*)buffer );
+            assertEqual( listener.malformedSizes[0], (int)ps.Size() );
+            assertEqual( listener.malformedStatuses[1], PARSE_PACKET_SIZE_NOT_MULTIPLE_OF_4 );
+            assertEqual( listener.malformedStatuses[2], PARSE_ARGUMENTS_EXCEED_MESSAGE_SIZE );
+        }
+    }
+
+    // a bundle whose element size runs past its end
+    {
+        OutboundPacketStream ps( buffer, sizeof(buffer) );
+        ps << BeginBundleImmediate
+            << BeginMessage( "/one" ) << (int32)1 << EndMessage
+            << EndBundle;
+        buffer[ 19 ] = 0x40;
+
+        MalformedRecordingListener listener;
+        listener.ProcessPacket( buffer, (int)ps.Size(), sender );
+
+        assertEqual( listener.received, std::string( "" ) );
+        assertEqual( listener.malformedStatuses.size(), (std::size_t)1 );
+        if( listener.malformedStatuses.size() == 1 ){
+            assertEqual( listener.malformedStatuses[0], PARSE_BUNDLE_TOO_SHORT_FOR_ELEMENT );
+            assertEqual( listener.malformedData[0], (const char*)buffer );
+        }
+    }
+}
+
+
+struct TypedTestValues{
+    int32 i;
+    float f;
+    const char *s;
+};
+
+
+void test9()
+{
+    int bufferSize = 1000;
+    char *buffer = AllocateAligned4( bufferSize );
+
+    char blobData[] = "abcde";
+    std::memset( buffer, 0x74, bufferSize );
+    OutboundPacketStream ps( buffer, bufferSize );
+    ps << BeginMessage( "/typed" ) << (int32)-7 << 2.5f << 'x' << RgbaColor( 0x11223344 )
+        << MidiMessage( 0x556677 ) << (int64)-1234567890123LL << TimeTag( 0x0102030405060708ULL )
+        << 3.25 << "a string" << Symbol( "sym" ) << Blob( blobData, 5 ) << OscNil << Infinitum
+        << (int32)99 << EndMessage;
+    assertEqual( ps.IsReady(), true );
+    ReceivedMessage m( ReceivedPacket( ps.Data(), ps.Size() ) );
+
+    typedef TypedMessage< int32, float, char, RgbaColor, MidiMessage, int64, TimeTag,
+            double, const char*, Symbol, Blob, NilType, InfinitumType, int32 > AllTypes;
+    assertEqual( AllTypes::TypeTags(), "ifcrmhtdsSbNIi" );
+    assertEqual( AllTypes::Matches( m ), true );
+
+    AllTypes t( m );
+    assertEqual( t.Get<0>(), (int32)-7 );
+    assertEqual( t.Get<1>(), 2.5f );
+    assertEqual( t.Get<2>(), 'x' );
+    assertEqual( t.Get<3>().value, (uint32)0x11223344 );
+    assertEqual( t.Get<4>().value, (uint32)0x556677 );
+    assertEqual( t.Get<5>(), (int64)-1234567890123LL );
+    assertEqual( t.Get<6>().value, (uint64)0x0102030405060708ULL );
+    assertEqual( t.Get<7>(), 3.25 );
+    assertEqual( t.Get<8>(), "a string" );
+    assertEqual( (const char*)t.Get<9>(), "sym" );
+    assertEqual( t.Get<10>().size, (osc_bundle_element_size_t)5 );
+    assertEqual( std::memcmp( t.Get<10>().data, blobData, 5 ) == 0, true );
+    assertEqual( t.Get<13>(), (int32)99 );
+
+    // signatures that don't match
+    std::tuple< int32, float > tooFew;
+    assertEqual( (TypedMessage< int32, float >::TryDecode( m, tooFew )), false );
+    assertEqual( (TypedMessage< float, float, char, RgbaColor, MidiMessage, int64, TimeTag,
+            double, const char*, Symbol, Blob, NilType, InfinitumType, int32 >::Matches( m )), false );
+
+    bool threw = false;
+    try{
+        TypedMessage< int32 > wrong( m );
+    }catch( WrongArgumentTypeException& ){
+        threw = true;
+    }
+    assertEqual( threw, true );
+
+    // decoding into an aggregate, and from a message validated on access
+    {
+        OutboundPacketStream ps2( buffer, bufferSize );
+        ps2 << BeginMessage( "/typed" ) << (int32)3 << 0.5f << "str" << EndMessage;
+        ReceivedMessage m2( ReceivedPacket( ps2.Data(), ps2.Size() ), VALIDATE_ARGUMENTS_ON_ACCESS );
+
+        TypedTestValues values = TypedMessage< int32, float, const char* >( m2 ).As< TypedTestValues >();
+        assertEqual( values.i, (int32)3 );
+        assertEqual( values.f, 0.5f );
+        assertEqual( values.s, "str" );
+
+        // the string runs past the end of the message
+        buffer[ ps2.Size() - 1 ] = 'x';
+        threw = false;
+        try{
+            TypedMessage< int32, float, const char* > truncated( m2 );
+        }catch( MalformedMessageException& ){
+            threw = true;
+        }
+        assertEqual( threw, true );
+    }
+}
+
+
+// reads count big endian values of size bytes into host order one byte at a time
+static bool MatchesBigEndian( const char *converted, const char *src, std::size_t size, std::size_t count )
+{
+    for( std::size_t i = 0; i < count; ++i, src += size, converted += size ){
+        uint64 expected = 0, actual = 0;
+        for( std::size_t j = 0; j < size; ++j )
+            expected = (expected << 8) | (unsigned char)src[j];
+        if( size == 4 ){
+            uint32 value;
+            std::memcpy( &value, converted, 4 );
+            actual = value;
+        }else{
+            std::memcpy( &actual, converted, 8 );
+        }
+        if( actual != expected )
+            return false;
+    }
+    return true;
+}
+
+
+void test10()
+{
+    const std::size_t maxCount = 40;
+    char source[ maxCount * 8 + 8 ], converted[ maxCount * 8 + 8 ];
+    for( std::size_t i = 0; i < sizeof(source); ++i )
+        source[i] = (char)(i * 37 + 1);
+
+    StringScanImplementation automatic = ActiveStringScanImplementation();
+    const StringScanImplementation implementations[] = {
+        SCALAR_STRING_SCAN, SSE2_STRING_SCAN, AVX2_STRING_SCAN, NEON_STRING_SCAN };
+
+    for( std::size_t i = 0; i < sizeof(implementations) / sizeof(implementations[0]); ++i ){
+        if( !SetStringScanImplementation( implementations[i] ) )
+            continue;
+
+        std::cout << "array copy: " << StringScanImplementationName( implementations[i] ) << "\n";
+
+        // every count, with unaligned sources and destinations. nothing
+        // past the last element may be written.
+        int mismatches = 0;
+        for( std::size_t count = 0; count <= maxCount; ++count ){
+            for( std::size_t offset = 0; offset < 8; offset += 3 ){
+                std::memset( converted, 'x', sizeof(converted) );
+                CopyBigEndian32( converted + offset, source + 8 - offset, count );
+                if( !MatchesBigEndian( converted + offset, source + 8 - offset, 4, count )
+                        || converted[ offset + count * 4 ] != 'x' )
+                    ++mismatches;
+
+                std::memset( converted, 'x', sizeof(converted) );
+                CopyBigEndian64( converted + offset, source + 8 - offset, count );
+                if( !MatchesBigEndian( converted + offset, source + 8 - offset, 8, count )
+                        || converted[ offset + count * 8 ] != 'x' )
+                    ++mismatches;
+            }
+        }
+        assertEqual( mismatches, 0 );
+
+        // runs of every length, ended by another tag
+        mismatches = 0;
+        char tags[ 80 ];
+        for( std::size_t length = 0; length < 64; ++length ){
+            std::memset( tags, 'f', sizeof(tags) );
+            tags[ length ] = ']';
+            if( SkipTypeTagRun( tags, tags + sizeof(tags), 'f' ) != tags + length )
+                ++mismatches;
+        }
+        assertEqual( mismatches, 0 );
+    }
+
+    SetStringScanImplementation( automatic );
+
+    int bufferSize = 32768;
+    char *buffer = AllocateAligned4( bufferSize );
+
+    // arrays of each element type, and a run of doubles after them
+    const std::size_t counts[] = { 0, 1, 5, 33, 512 };
+    for( std::size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c ){
+        std::size_t count = counts[c];
+
+        OutboundPacketStream ps( buffer, bufferSize );
+        ps << BeginMessage( "/array" ) << (int32)1 << BeginArray;
+        for( std::size_t i = 0; i < count; ++i )
+            ps << (float)i * -0.25f;
+        ps << EndArray << BeginArray;
+        for( std::size_t i = 0; i < count; ++i )
+            ps << (int32)(i * 100003);
+        ps << EndArray << BeginArray;
+        for( std::size_t i = 0; i < count; ++i )
+            ps << (int64)( i * -1000000007LL );
+        ps << EndArray;
+        for( std::size_t i = 0; i < count; ++i )
+            ps << (double)i / 3.;
+        ps << "end" << EndMessage;
+        assertEqual( ps.IsReady(), true );
+        ReceivedMessage m( ReceivedPacket( ps.Data(), ps.Size() ) );
+
+        std::vector<float> floats( count + 1 );
+        ArrayView< float > floatView( m, m.Argument( 1 ) );
+        assertEqual( floatView.Size(), count );
+        assertEqual( floatView.ArgumentCount(), count + 2 );
+        assertEqual( floatView.CopyTo( &floats[0], count + 1 ), count );
+
+        std::vector<int32> int32s( count + 1 );
+        ArrayView< int32 > int32View( m, m.Argument( (uint32)( 1 + floatView.ArgumentCount() ) ) );
+        assertEqual( int32View.CopyTo( &int32s[0], count ), count );
+
+        std::vector<int64> int64s( count + 1 );
+        ArrayView< int64 > int64View( m, m.Argument( (uint32)( 5 + 2 * count ) ) );
+        assertEqual( int64View.CopyTo( &int64s[0], count ), count );
+
+        std::vector<double> doubles( count + 1 );
+        if( count > 0 ){
+            ArrayView< double > doubleView( m, m.Argument( (uint32)( 7 + 3 * count ) ) );
+            assertEqual( doubleView.Size(), count );
+            assertEqual( doubleView.CopyTo( &doubles[0], count ), count );
+        }
+
+        int mismatches = 0;
+        ReceivedMessage::const_iterator arg = m.ArgumentsBegin();
+        ++arg; ++arg;
+        for( std::size_t i = 0; i < count; ++i, ++arg ){
+            if( floats[i] != arg->AsFloat() || floatView[i] != arg->AsFloat() )
+                ++mismatches;
+        }
+        ++arg; ++arg;
+        for( std::size_t i = 0; i < count; ++i, ++arg ){
+            if( int32s[i] != arg->AsInt32() || int32View[i] != arg->AsInt32() )
+                ++mismatches;
+        }
+        ++arg; ++arg;
+        for( std::size_t i = 0; i < count; ++i, ++arg ){
+            if( int64s[i] != arg->AsInt64() )
+                ++mismatches;
+        }
+        ++arg;
+        for( std::size_t i = 0; i < count; ++i, ++arg ){
+            if( doubles[i] != arg->AsDouble() )
+                ++mismatches;
+        }
+        assertEqual( mismatches, 0 );
+        assertEqual( arg->AsString(), "end" );
+    }
+
+    // arrays and arguments of the wrong types
+    {
+        OutboundPacketStream ps( buffer, bufferSize );
+        ps << BeginMessage( "/array" ) << BeginArray << 1.f << (int32)2 << EndArray
+            << BeginArray << 1.f << BeginArray << EndArray << EndArray << (int32)3 << EndMessage;
+        ReceivedMessage m( ReceivedPacket( ps.Data(), ps.Size() ) );
+
+        const uint32 wrong[] = { 0, 2, 4, 9 };
+        int throws = 0;
+        for( std::size_t i = 0; i < sizeof(wrong) / sizeof(wrong[0]); ++i ){
+            try{
+                ArrayView< float > view( m, m.Argument( wrong[i] ) );
+            }catch( WrongArgumentTypeException& ){
+                ++throws;
+            }
+        }
+        assertEqual( throws, 4 );
+
+        ArrayView< float > empty( m, m.Argument( 6 ) );
+        assertEqual( empty.Empty(), true );
+
+        ArrayView< int32 > run( m, m.Argument( 9 ) );
+        assertEqual( run.Size(), (std::size_t)1 );
+        assertEqual( run[0], (int32)3 );
+    }
+
+    // elements running past the end of a message validated on access
+    {
+        OutboundPacketStream ps( buffer, bufferSize );
+        ps << BeginMessage( "/array" ) << BeginArray << 1.f << 2.f << 3.f << EndArray << EndMessage;
+        ReceivedMessage m( ReceivedPacket( ps.Data(), ps.Size() - 4 ), VALIDATE_ARGUMENTS_ON_ACCESS );
+
+        bool threw = false;
+        try{
+            ArrayView< float > view( m, *m.ArgumentsBegin() );
+        }catch( MalformedMessageException& ){
+            threw = true;
+        }
+        assertEqual( threw, true );
+    }
+}
+
+
+//---------------------------------------------------------------------------
+
+// bind a socket to the next free loopback port and return its endpoint
+static IpEndpointName BindLoopback( UdpSocket& socket )
+{
+    static int nextPort = 21000;
+
+    while( nextPort < 65535 ){
+        IpEndpointName endpoint( "127.0.0.1", nextPort++ );
+        try{
+            socket.Bind( endpoint );
+            return endpoint;
+        }catch( std::exception& ){
+            // port in use, try the next one
+        }
+    }
+
+    throw std::runtime_error( "no free loopback ports\n" );
+}
+
+
+class NullPacketListener : public PacketListener{
+public:
+    virtual void ProcessPacket( const char *, int, const IpEndpointName& ) {}
+};
+
+
+class NullSendCompletionListener : public SendCompletionListener{
+public:
+    virtual void SendCompleted( const char *, std::size_t, bool ) {}
+};
+
+
+// when the trigger datagram arrives, sends a small datagram then a large
+// one to itself from sender, and records the sizes of the datagrams that
+// arrive after the trigger
+class SendOrderListener : public PacketListener, public TimerListener{
+    SocketReceiveMultiplexer& multiplexer_;
+    UdpSocket& sender_;
+    IpEndpointName destination_;
+    std::vector<char> small_;
+    std::vector<char> large_;
+
+public:
+    std::vector<int> receivedSizes;
+
+    SendOrderListener( SocketReceiveMultiplexer& multiplexer, UdpSocket& sender,
+            const IpEndpointName& destination )
+        : multiplexer_( multiplexer )
+        , sender_( sender )
+        , destination_( destination )
+        , small_( 16, 's' )
+        , large_( 2048, 'l' ) {}
+
+    virtual void ProcessPacket( const char *data, int size, const IpEndpointName& )
+    {
+        if( size == 7 && std::memcmp( data, "trigger", 7 ) == 0 ){
+            sender_.SendTo( destination_, &small_[0], small_.size() );
+            sender_.SendTo( destination_, &large_[0], large_.size() );
+            return;
+        }
+
+        receivedSizes.push_back( size );
+        if( receivedSizes.size() == 2 )
+            multiplexer_.Break();
+    }
+
+    virtual void TimerExpired() { multiplexer_.Break(); } // the datagrams were lost
+};
+
+
+void test11()
+{
+    // a large datagram sent with MSG_ZEROCOPY by a listener must not
+    // overtake a small one queued before it in the io_uring send queue.
+    // the queue (and zero-copy) are used when available.
+    SocketReceiveMultiplexer multiplexer( SocketReceiveMultiplexer::IO_URING_BACKEND );
+
+    UdpSocket receiveSocket;
+    IpEndpointName destination = BindLoopback( receiveSocket );
+
+    UdpSocket sendSocket;
+    BindLoopback( sendSocket );
+    NullSendCompletionListener completionListener;
+    sendSocket.SetZeroCopySendThreshold( 1024, &completionListener );
+
+    SendOrderListener listener( multiplexer, sendSocket, destination );
+    NullPacketListener nullListener;
+    multiplexer.AttachSocketListener( &receiveSocket, &listener );
+    multiplexer.AttachSocketListener( &sendSocket, &nullListener );
+    multiplexer.AttachPeriodicTimerListener( 2000, &listener );
+
+    UdpSocket triggerSocket;
+    triggerSocket.SendTo( destination, "trigger", 7 );
+    multiplexer.Run();
+
+    assertEqual( listener.receivedSizes.size(), (std::size_t)2 );
+    if( listener.receivedSizes.size() == 2 ){
+        assertEqual( listener.receivedSizes[0], 16 );
+        assertEqual( listener.receivedSizes[1], 2048 );
+    }
+
+    multiplexer.DetachPeriodicTimerListener( &listener );
+    multiplexer.DetachSocketListener( &sendSocket, &nullListener );
+    multiplexer.DetachSocketListener( &receiveSocket, &listener );
+}
+
+
+//---------------------------------------------------------------------------
+
+// records the int32 argument of each message by address, in the order the
+// workers process them. messages to /throw make ProcessMessage() throw.
+class ParallelTestListener : public ParallelOscPacketListener{
+    std::mutex mutex_;
+
+public:
+    std::map< std::string, std::vector<int32> > received;
+    std::vector<std::string> exceptionMessages;
+
+    ParallelTestListener( std::size_t workerCount, std::size_t maxQueuedMessages=4096 )
+        : ParallelOscPacketListener( workerCount, ADDRESS_PATTERN_KEY, maxQueuedMessages ) {}
+
+    ~ParallelTestListener() { Stop(); }
+
+    unsigned long TotalErrorCount() const
+    {
+        unsigned long count = 0;
+        for( std::size_t i = 0; i < WorkerCount(); ++i )
+            count += GetWorkerStatistics( i ).errorCount;
+        return count;
+    }
+
+    unsigned long TotalDroppedCount() const
+    {
+        unsigned long count = 0;
+        for( std::size_t i = 0; i < WorkerCount(); ++i )
+            count += GetWorkerStatistics( i ).droppedCount;
+        return count;
+    }
+
+protected:
+    virtual void ProcessMessage( const ReceivedMessage& m, const IpEndpointName& )
+    {
+        int32 value = m.ArgumentsBegin()->AsInt32();
+        if( std::strcmp( m.AddressPattern(), "/throw" ) == 0 )
+            throw std::runtime_error( "handler failed" );
+
+        std::lock_guard<std::mutex> lock( mutex_ );
+        received[ m.AddressPattern() ].push_back( value );
+    }
+
+    virtual void ProcessMessageException( const std::exception& e, const IpEndpointName& )
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        exceptionMessages.push_back( e.what() );
+    }
+};
+
+
+static void SendParallelTestMessage( ParallelOscPacketListener& listener, const char *address, int32 value )
+{
+    char buffer[ 64 ];
+    OutboundPacketStream ps( buffer, sizeof(buffer) );
+    ps << BeginMessage( address ) << value << EndMessage;
+    listener.ProcessPacket( ps.Data(), (int)ps.Size(), IpEndpointName( "127.0.0.1", 9000 ) );
+}
+
+
+void test12()
+{
+    // exceptions thrown by ProcessMessage() are reported and counted, and
+    // the worker carries on with the next message
+    ParallelTestListener listener( 2 );
+    listener.Start();
+
+    for( int32 i = 0; i < 10; ++i )
+        SendParallelTestMessage( listener, ( i % 3 == 0 ) ? "/throw" : "/ok", i );
+    listener.Flush();
+
+    assertEqual( listener.exceptionMessages.size(), (std::size_t)4 );
+    assertEqual( listener.exceptionMessages.empty() ? "" : listener.exceptionMessages[0].c_str(), "handler failed" );
+    assertEqual( listener.TotalErrorCount(), 4UL );
+    assertEqual( listener.received[ "/ok" ].size(), (std::size_t)6 );
+
+    listener.Stop();
+}
+
+
+
+static bool IsIncreasing( const std::vector<int32>& values )
+{
+    for( std::size_t i = 1; i < values.size(); ++i ){
+        if( values[i] <= values[i - 1] )
+            return false;
+    }
+    return true;
+}
+
+
+void test13()
+{
+    // small queues, so that the receiving thread also waits for workers
+    ParallelTestListener listener( 4, 8 );
+    const char *addresses[] = { "/a", "/b", "/c", "/d", "/e" };
+    const int32 addressCount = 5;
+
+    // dropped rather than queued while the workers aren't running
+    for( int32 i = 0; i < 3; ++i )
+        SendParallelTestMessage( listener, "/a", i );
+    assertEqual( listener.TotalDroppedCount(), 3UL );
+
+    listener.Start();
+
+    // messages with the same address are processed in the order received,
+    // and Flush() waits for all of them
+    for( int32 i = 0; i < 1000; ++i )
+        SendParallelTestMessage( listener, addresses[ i % addressCount ], i );
+    listener.Flush();
+
+    int unordered = 0;
+    std::size_t total = 0;
+    for( int32 i = 0; i < addressCount; ++i ){
+        const std::vector<int32>& values = listener.received[ addresses[i] ];
+        total += values.size();
+        if( !IsIncreasing( values ) )
+            ++unordered;
+    }
+    assertEqual( total, (std::size_t)1000 );
+    assertEqual( unordered, 0 );
+
+    // Stop() processes the messages still queued
+    for( int32 i = 1000; i < 1500; ++i )
+        SendParallelTestMessage( listener, addresses[ i % addressCount ], i );
+    listener.Stop();
+
+    total = 0;
+    for( int32 i = 0; i < addressCount; ++i ){
+        const std::vector<int32>& values = listener.received[ addresses[i] ];
+        total += values.size();
+        if( !IsIncreasing( values ) )
+            ++unordered;
+    }
+    assertEqual( total, (std::size_t)1500 );
+    assertEqual( unordered, 0 );
+
+    SendParallelTestMessage( listener, "/a", 2000 );
+    assertEqual( listener.TotalDroppedCount(), 4UL );
+    assertEqual( listener.received[ "/a" ].size(), (std::size_t)300 );
+}
+
+
+//---------------------------------------------------------------------------
+
+static const int POOLED_TEST_PACKET_SIZE = 100;
+
+
+// datagram index holds index followed by a pattern derived from it
+static void FillPooledTestPacket( char *data, int32 index )
+{
+    std::memcpy( data, &index, sizeof(index) );
+    for( int i = sizeof(index); i < POOLED_TEST_PACKET_SIZE; ++i )
+        data[i] = (char)(index * 7 + i);
+}
+
+
+static bool PooledTestPacketIntact( const PacketRef& packet, int32 index )
+{
+    char expected[ POOLED_TEST_PACKET_SIZE ];
+    FillPooledTestPacket( expected, index );
+    return packet.Size() == (std::size_t)POOLED_TEST_PACKET_SIZE
+            && std::memcmp( packet.Data(), expected, POOLED_TEST_PACKET_SIZE ) == 0;
+}
+
+
+// keeps the PacketRef of every keepEvery'th datagram, and breaks once
+// expectedCount datagrams have arrived
+class PoolKeepingListener : public PacketListener, public TimerListener{
+    SocketReceiveMultiplexer& multiplexer_;
+    int keepEvery_;
+    int expectedCount_;
+
+public:
+    int receivedCount;
+    int unpooledCount;      // datagrams not received into the pool
+    int damagedCount;       // datagrams with the wrong contents on arrival
+    std::vector< std::pair<int32, PacketRef> > kept;
+
+    PoolKeepingListener( SocketReceiveMultiplexer& multiplexer, int keepEvery, int expectedCount )
+        : multiplexer_( multiplexer )
+        , keepEvery_( keepEvery )
+        , expectedCount_( expectedCount )
+        , receivedCount( 0 )
+        , unpooledCount( 0 )
+        , damagedCount( 0 ) {}
+
+    virtual void ProcessPacket( const char *, int, const IpEndpointName& )
+    {
+        ++unpooledCount;
+        if( ++receivedCount == expectedCount_ )
+            multiplexer_.Break();
+    }
+
+    virtual void ProcessPooledPacket( const BatchedPacket& packet )
+    {
+        int32 index = receivedCount;
+        if( !PooledTestPacketIntact( *packet.packet, index ) )
+            ++damagedCount;
+        if( index % keepEvery_ == 0 )
+            kept.push_back( std::make_pair( index, *packet.packet ) );
+
+        if( ++receivedCount == expectedCount_ )
+            multiplexer_.Break();
+    }
+
+    virtual void TimerExpired() { multiplexer_.Break(); } // datagrams were lost
+};
+
+
+static void TestPooledReceive( SocketReceiveMultiplexer::Backend backend, std::size_t batchSize,
+        std::size_t poolBufferCount, int keepEvery, int count, bool expectHeapAllocations )
+{
+    PacketBufferPool pool( 256, poolBufferCount );
+    {
+        SocketReceiveMultiplexer multiplexer( backend );
+        multiplexer.SetPacketBufferPool( &pool );
+        PoolKeepingListener listener( multiplexer, keepEvery, count );
+
+        UdpSocket receiveSocket;
+        IpEndpointName destination = BindLoopback( receiveSocket );
+        receiveSocket.SetReceiveBatchSize( batchSize );
+        multiplexer.AttachSocketListener( &receiveSocket, &listener );
+        multiplexer.AttachPeriodicTimerListener( 2000, &listener );
+
+        UdpSocket sendSocket;
+        char data[ POOLED_TEST_PACKET_SIZE ];
+        for( int32 i = 0; i < count; ++i ){
+            FillPooledTestPacket( data, i );
+            sendSocket.SendTo( destination, data, sizeof(data) );
+        }
+
+        multiplexer.Run();
+
+        assertEqual( listener.receivedCount, count );
+        assertEqual( listener.unpooledCount, 0 );
+        assertEqual( listener.damagedCount, 0 );
+
+        // the kept datagrams were not overwritten by later reads, because
+        // keeping one made the next read use a different buffer
+        int damaged = 0;
+        std::vector<const PacketBuffer*> keptBuffers;
+        for( std::size_t i = 0; i < listener.kept.size(); ++i ){
+            if( !PooledTestPacketIntact( listener.kept[i].second, listener.kept[i].first ) )
+                ++damaged;
+            keptBuffers.push_back( listener.kept[i].second.Buffer() );
+        }
+        std::sort( keptBuffers.begin(), keptBuffers.end() );
+        keptBuffers.erase( std::unique( keptBuffers.begin(), keptBuffers.end() ), keptBuffers.end() );
+        assertEqual( listener.kept.size(), (std::size_t)((count + keepEvery - 1) / keepEvery) );
+        assertEqual( damaged, 0 );
+        assertEqual( keptBuffers.size(), listener.kept.size() );
+
+        // buffers which weren't kept were reused rather than drawn from the
+        // pool for every read, unless the pool was too small
+        assertEqual( pool.HeapAllocationCount() > 0, expectHeapAllocations );
+
+        multiplexer.DetachPeriodicTimerListener( &listener );
+        multiplexer.DetachSocketListener( &receiveSocket, &listener );
+    }
+
+    // the listener, multiplexer and socket have released their buffers
+    assertEqual( pool.AvailableCount(), pool.BufferCount() );
+}
+
+
+void test16()
+{
+    SocketReceiveMultiplexer::Backend backends[] = {
+        SocketReceiveMultiplexer::SELECT_BACKEND,
+        SocketReceiveMultiplexer::EPOLL_BACKEND,
+        SocketReceiveMultiplexer::IO_URING_BACKEND
+    };
+    std::size_t batchSizes[] = { 1, 8 };
+
+    for( int i = 0; i < 3; ++i ){
+        for( int j = 0; j < 2; ++j ){
+            // keeping every 4th of 64 datagrams fits in a pool of 48
+            // buffers, along with those lent to the socket or the ring
+            TestPooledReceive( backends[i], batchSizes[j], 48, 4, 64, false );
+
+            // keeping all of them doesn't fit in 4, so buffers are
+            // allocated from the heap, and freed when released
+            TestPooledReceive( backends[i], batchSizes[j], 4, 1, 32, true );
+        }
+    }
+}
+
+
+// acquires buffers from pool, holding up to three at a time, and counts
+// the buffers whose contents changed while held: that is, those which
+// were also handed to another thread
+static void StressPacketBufferPool( PacketBufferPool& pool, int32 threadIndex, int32 iterations,
+        std::atomic<int> *overwrittenCount )
+{
+    PacketRef held[3];
+    int32 stamps[3] = { 0, 0, 0 };
+
+    for( int32 i = 0; i < iterations; ++i ){
+        std::size_t slot = (std::size_t)(i % 3);
+        if( !held[ slot ].IsNull() && std::memcmp( held[ slot ].Data(), &stamps[ slot ], sizeof(int32) ) != 0 )
+            overwrittenCount->fetch_add( 1 );
+
+        held[ slot ] = PacketRef( pool.Acquire() );
+        stamps[ slot ] = threadIndex * iterations + i;
+        std::memcpy( held[ slot ].Buffer()->Data(), &stamps[ slot ], sizeof(int32) );
+    }
+}
+
+
+static void TestPacketBufferPoolThreads( std::size_t bufferCount, bool expectHeapAllocations )
+{
+    const int32 THREAD_COUNT = 4;
+    const int32 ITERATIONS = 100000;
+
+    PacketBufferPool pool( 64, bufferCount );
+    std::atomic<int> overwrittenCount( 0 );
+
+    std::vector<std::thread> threads;
+    for( int32 i = 0; i < THREAD_COUNT; ++i )
+        threads.push_back( std::thread( StressPacketBufferPool, std::ref( pool ), i, ITERATIONS, &overwrittenCount ) );
+    for( std::size_t i = 0; i < threads.size(); ++i )
+        threads[i].join();
+
+    assertEqual( overwrittenCount.load(), 0 );
+    assertEqual( pool.HeapAllocationCount() > 0, expectHeapAllocations );
+    assertEqual( pool.AvailableCount(), bufferCount );
+}
+
+
+void test17()
+{
+    // four threads holding at most three buffers each never empty a pool
+    // of 16, and oversubscribe a pool of 8 so that some come from the heap
+    TestPacketBufferPoolThreads( 16, false );
+    TestPacketBufferPoolThreads( 8, true );
+}
+
+
+//---------------------------------------------------------------------------
+
+class CountingPacketListener : public PacketListener{
+public:
+    std::atomic<int> count;
+
+    CountingPacketListener() : count( 0 ) {}
+
+    virtual void ProcessPacket( const char *, int, const IpEndpointName& ) { ++count; }
+};
+
+
+class CountingTimerListener : public TimerListener{
+public:
+    std::atomic<int> count;
+
+    CountingTimerListener() : count( 0 ) {}
+
+    virtual void TimerExpired() { ++count; }
+};
+
+
+// waits up to two seconds for count to reach expected
+static bool WaitForCount( const std::atomic<int>& count, int expected )
+{
+    for( int i = 0; i < 2000 && count.load() < expected; ++i )
+        std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+    return count.load() >= expected;
+}
+
+
+// detaches itself in its first ProcessPacket() call, then sends a
+// datagram to a second socket whose listener breaks
+class SelfDetachingListener : public PacketListener{
+    SocketReceiveMultiplexer& multiplexer_;
+    UdpSocket& socket_;
+    UdpSocket& sender_;
+    IpEndpointName breakDestination_;
+
+public:
+    int count;
+    int detachReturnedCount;
+
+    SelfDetachingListener( SocketReceiveMultiplexer& multiplexer, UdpSocket& socket,
+            UdpSocket& sender, const IpEndpointName& breakDestination )
+        : multiplexer_( multiplexer )
+        , socket_( socket )
+        , sender_( sender )
+        , breakDestination_( breakDestination )
+        , count( 0 )
+        , detachReturnedCount( 0 ) {}
+
+    virtual void ProcessPacket( const char *, int, const IpEndpointName& )
+    {
+        if( ++count == 1 ){
+            multiplexer_.DetachSocketListener( &socket_, this );
+            ++detachReturnedCount;
+            sender_.SendTo( breakDestination_, "break", 5 );
+        }
+    }
+};
+
+
+class BreakingPacketListener : public PacketListener, public TimerListener{
+    SocketReceiveMultiplexer& multiplexer_;
+
+public:
+    explicit BreakingPacketListener( SocketReceiveMultiplexer& multiplexer )
+        : multiplexer_( multiplexer ) {}
+
+    virtual void ProcessPacket( const char *, int, const IpEndpointName& ) { multiplexer_.Break(); }
+
+    virtual void TimerExpired() { multiplexer_.Break(); } // the datagrams were lost
+};
+
+
+static void TestAttachWhileRunning( SocketReceiveMultiplexer::Backend backend )
+{
+    SocketReceiveMultiplexer multiplexer( backend );
+    CountingTimerListener started;
+    multiplexer.AttachPeriodicTimerListener( 1, 1, &started );
+
+    std::thread runThread( &SocketReceiveMultiplexer::Run, &multiplexer );
+    WaitForCount( started.count, 1 );
+
+    // attach calls from another thread return once the loop has applied them
+    UdpSocket socket;
+    IpEndpointName destination = BindLoopback( socket );
+    CountingPacketListener listener;
+    CountingTimerListener timer;
+    multiplexer.AttachSocketListener( &socket, &listener );
+    multiplexer.AttachPeriodicTimerListener( 1, 1, &timer );
+
+    UdpSocket sender;
+    sender.SendTo( destination, "x", 1 );
+    assertEqual( WaitForCount( listener.count, 1 ), true );
+    assertEqual( WaitForCount( timer.count, 1 ), true );
+
+    // and once detach calls return the listeners aren't called again
+    multiplexer.DetachSocketListener( &socket, &listener );
+    multiplexer.DetachPeriodicTimerListener( &timer );
+    int packetCount = listener.count.load();
+    int expiryCount = timer.count.load();
+
+    sender.SendTo( destination, "x", 1 );
+    std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+    assertEqual( listener.count.load(), packetCount );
+    assertEqual( timer.count.load(), expiryCount );
+
+    multiplexer.AsynchronousBreak();
+    runThread.join();
+    multiplexer.DetachPeriodicTimerListener( &started );
+}
+
+
+static void TestDetachFromListener( SocketReceiveMultiplexer::Backend backend )
+{
+    SocketReceiveMultiplexer multiplexer( backend );
+
+    UdpSocket socket;
+    IpEndpointName destination = BindLoopback( socket );
+    UdpSocket breakSocket;
+    IpEndpointName breakDestination = BindLoopback( breakSocket );
+    UdpSocket sender;
+
+    // the detach is queued without waiting for the loop, which is the
+    // calling thread
+    SelfDetachingListener listener( multiplexer, socket, sender, breakDestination );
+    BreakingPacketListener breakingListener( multiplexer );
+    multiplexer.AttachSocketListener( &socket, &listener );
+    multiplexer.AttachSocketListener( &breakSocket, &breakingListener );
+    multiplexer.AttachPeriodicTimerListener( 2000, &breakingListener );
+
+    sender.SendTo( destination, "x", 1 );
+    multiplexer.Run();
+    assertEqual( listener.count, 1 );
+    assertEqual( listener.detachReturnedCount, 1 );
+
+    // and was applied: the socket's datagrams are no longer dispatched
+    sender.SendTo( destination, "x", 1 );
+    sender.SendTo( breakDestination, "break", 5 );
+    multiplexer.Run();
+    assertEqual( listener.count, 1 );
+
+    multiplexer.DetachPeriodicTimerListener( &breakingListener );
+    multiplexer.DetachSocketListener( &breakSocket, &breakingListener );
+}
+
+
+static void TestDetachDuringBreak( SocketReceiveMultiplexer::Backend backend )
+{
+    SocketReceiveMultiplexer multiplexer( backend );
+
+    UdpSocket socket;
+    IpEndpointName destination = BindLoopback( socket );
+    CountingPacketListener listener;
+    CountingTimerListener started;
+
+    // the detach calls race the loop's exit, so they are applied by the
+    // loop, by Run() on its way out, or directly once it has returned.
+    // in every case they return, and are applied exactly once.
+    for( int i = 0; i < 20; ++i ){
+        started.count = 0;
+        multiplexer.AttachSocketListener( &socket, &listener );
+        multiplexer.AttachPeriodicTimerListener( 1, 1, &started );
+
+        std::thread runThread( &SocketReceiveMultiplexer::Run, &multiplexer );
+        WaitForCount( started.count, 1 );
+
+        multiplexer.AsynchronousBreak();
+        multiplexer.DetachSocketListener( &socket, &listener );
+        multiplexer.DetachPeriodicTimerListener( &started );
+        runThread.join();
+    }
+
+    started.count = 0;
+    multiplexer.AttachSocketListener( &socket, &listener );
+    std::thread runThread( &SocketReceiveMultiplexer::Run, &multiplexer );
+
+    UdpSocket sender;
+    sender.SendTo( destination, "x", 1 );
+    WaitForCount( listener.count, 1 );
+    std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+
+    multiplexer.AsynchronousBreak();
+    runThread.join();
+    multiplexer.DetachSocketListener( &socket, &listener );
+
+    assertEqual( listener.count.load(), 1 );
+    assertEqual( started.count.load(), 0 );
+}
+
+
+void test18()
+{
+    SocketReceiveMultiplexer::Backend backends[] = {
+        SocketReceiveMultiplexer::SELECT_BACKEND,
+        SocketReceiveMultiplexer::EPOLL_BACKEND,
+        SocketReceiveMultiplexer::IO_URING_BACKEND
+    };
+
+    for( int i = 0; i < 3; ++i ){
+        TestAttachWhileRunning( backends[i] );
+        TestDetachFromListener( backends[i] );
+        TestDetachDuringBreak( backends[i] );
+    }
+}
+
+
+//---------------------------------------------------------------------------
+
+// records the size and first byte of each datagram, and a copy of the
+// last one, and breaks once expectedCount have arrived
+class SizeRecordingListener : public PacketListener, public TimerListener{
+    SocketReceiveMultiplexer& multiplexer_;
+    std::size_t expectedCount_;
+
+public:
+    std::vector<int> sizes;
+    std::vector<int> firstBytes;
+    std::vector<char> lastPacket;
+
+    SizeRecordingListener( SocketReceiveMultiplexer& multiplexer, std::size_t expectedCount )
+        : multiplexer_( multiplexer )
+        , expectedCount_( expectedCount ) {}
+
+    virtual void ProcessPacket( const char *data, int size, const IpEndpointName& )
+    {
+        sizes.push_back( size );
+        firstBytes.push_back( (size > 0) ? (unsigned char)data[0] : -1 );
+        lastPacket.assign( data, data + size );
+        if( sizes.size() == expectedCount_ )
+            multiplexer_.Break();
+    }
+
+    virtual void TimerExpired() { multiplexer_.Break(); } // datagrams were lost
+};
+
+
+#if defined(__linux__) && defined(UDP_SEGMENT)
+
+// send data to destination as one UDP_SEGMENT send, which the kernel
+// splits into segmentSize datagrams (the last may be shorter). over
+// loopback a socket with UDP_GRO enabled receives it as a single read.
+static bool SendSegmentTrain( const IpEndpointName& destination, const char *data, std::size_t size,
+        unsigned short segmentSize )
+{
+    int s = socket( AF_INET, SOCK_DGRAM, 0 );
+    if( s == -1 )
+        return false;
+
+    struct sockaddr_in address;
+    std::memset( &address, 0, sizeof(address) );
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl( destination.address );
+    address.sin_port = htons( (unsigned short)destination.port );
+
+    struct iovec iov;
+    iov.iov_base = (void*)data;
+    iov.iov_len = size;
+
+    union{
+        char buffer[ CMSG_SPACE( sizeof(unsigned short) ) ];
+        struct cmsghdr align;
+    } control;
+    std::memset( &control, 0, sizeof(control) );
+
+    struct msghdr msg;
+    std::memset( &msg, 0, sizeof(msg) );
+    msg.msg_name = &address;
+    msg.msg_namelen = sizeof(address);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buffer;
+    msg.msg_controllen = sizeof(control.buffer);
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR( &msg );
+    cmsg->cmsg_level = SOL_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN( sizeof(unsigned short) );
+    std::memcpy( CMSG_DATA( cmsg ), &segmentSize, sizeof(segmentSize) );
+
+    bool sent = ( sendmsg( s, &msg, 0 ) == (ssize_t)size );
+    close( s );
+    return sent;
+}
+
+
+static void TestReceiveCoalescing( SocketReceiveMultiplexer::Backend backend, std::size_t batchSize )
+{
+    const int SEGMENT_SIZE = 1000;
+    const int SEGMENT_COUNT = 6;
+    const int LAST_SEGMENT_SIZE = 300;
+
+    // segment i is filled with i
+    std::vector<char> train( (SEGMENT_COUNT - 1) * SEGMENT_SIZE + LAST_SEGMENT_SIZE );
+    for( std::size_t i = 0; i < train.size(); ++i )
+        train[i] = (char)(i / SEGMENT_SIZE);
+
+    SocketReceiveMultiplexer multiplexer( backend );
+    UdpSocket receiveSocket;
+    IpEndpointName destination = BindLoopback( receiveSocket );
+    receiveSocket.SetEnableReceiveCoalescing( true );
+    receiveSocket.SetReceiveBatchSize( batchSize );
+
+    SizeRecordingListener listener( multiplexer, SEGMENT_COUNT );
+    multiplexer.AttachSocketListener( &receiveSocket, &listener );
+    multiplexer.AttachPeriodicTimerListener( 2000, &listener );
+
+    if( SendSegmentTrain( destination, &train[0], train.size(), SEGMENT_SIZE ) ){
+        multiplexer.Run();
+
+        // the listener sees the individual datagrams, in order
+        std::vector<int> expectedSizes( SEGMENT_COUNT, SEGMENT_SIZE );
+        expectedSizes.back() = LAST_SEGMENT_SIZE;
+        std::vector<int> expectedFirstBytes;
+        for( int i = 0; i < SEGMENT_COUNT; ++i )
+            expectedFirstBytes.push_back( i );
+
+        assertEqual( listener.sizes == expectedSizes, true );
+        assertEqual( listener.firstBytes == expectedFirstBytes, true );
+    }
+
+    multiplexer.DetachPeriodicTimerListener( &listener );
+    multiplexer.DetachSocketListener( &receiveSocket, &listener );
+}
+
+#endif /* __linux__ && UDP_SEGMENT */
+
+
+static void TestMaxReceivePacketSize( SocketReceiveMultiplexer::Backend backend, std::size_t batchSize )
+{
+    const std::size_t PACKET_SIZE = 20000; // more than DEFAULT_MAX_RECEIVE_PACKET_SIZE
+
+    std::vector<char> packet( PACKET_SIZE );
+    for( std::size_t i = 0; i < packet.size(); ++i )
+        packet[i] = (char)(i * 13);
+
+    SocketReceiveMultiplexer multiplexer( backend );
+    UdpSocket receiveSocket;
+    IpEndpointName destination = BindLoopback( receiveSocket );
+    receiveSocket.SetMaxReceivePacketSize( UdpSocket::MAX_UDP_PACKET_SIZE );
+    receiveSocket.SetReceiveBatchSize( batchSize );
+
+    SizeRecordingListener listener( multiplexer, 1 );
+    multiplexer.AttachSocketListener( &receiveSocket, &listener );
+    multiplexer.AttachPeriodicTimerListener( 2000, &listener );
+
+    UdpSocket sender;
+    sender.SendTo( destination, &packet[0], packet.size() );
+    multiplexer.Run();
+
+    assertEqual( listener.lastPacket.size(), PACKET_SIZE );
+    assertEqual( listener.lastPacket == packet, true );
+
+    multiplexer.DetachPeriodicTimerListener( &listener );
+    multiplexer.DetachSocketListener( &receiveSocket, &listener );
+}
+
+
+void test19()
+{
+    SocketReceiveMultiplexer::Backend backends[] = {
+        SocketReceiveMultiplexer::SELECT_BACKEND,
+        SocketReceiveMultiplexer::EPOLL_BACKEND,
+        SocketReceiveMultiplexer::IO_URING_BACKEND
+    };
+    std::size_t batchSizes[] = { 1, 8 };
+
+    for( int i = 0; i < 3; ++i ){
+        for( int j = 0; j < 2; ++j ){
+#if defined(__linux__) && defined(UDP_SEGMENT)
+            TestReceiveCoalescing( backends[i], batchSizes[j] );
+#endif
+            TestMaxReceivePacketSize( backends[i], batchSizes[j] );
+        }
+    }
+}
+
+
+//---------------------------------------------------------------------------
+
+void test20()
+{
+    // the queue's slots are sized when the thread is constructed. packets
+    // which no longer fit after the socket's limit is raised are counted.
+    UdpSocket receiveSocket;
+    IpEndpointName destination = BindLoopback( receiveSocket );
+    receiveSocket.SetMaxReceivePacketSize( 100 );
+    UdpSocketListenerThread listenerThread( receiveSocket, 4 );
+    receiveSocket.SetMaxReceivePacketSize( 2000 );
+    listenerThread.Start();
+
+    UdpSocket sender;
+    std::vector<char> packet( 1500, 'x' );
+    sender.SendTo( destination, &packet[0], 50 );
+    sender.SendTo( destination, &packet[0], packet.size() );
+    for( int i = 0; i < 2000 && listenerThread.QueuedCount() < 2; ++i )
+        std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+    listenerThread.Stop();
+
+    SocketReceiveMultiplexer multiplexer; // not run
+    SizeRecordingListener listener( multiplexer, 2 );
+    assertEqual( listenerThread.Drain( &listener ), (std::size_t)2 );
+    assertEqual( listener.sizes.size(), (std::size_t)2 );
+    if( listener.sizes.size() == 2 ){
+        assertEqual( listener.sizes[0], 50 );
+        assertEqual( listener.sizes[1], 100 );
+    }
+    assertEqual( listenerThread.GetCounters().truncatedCount, 1UL );
+}
+
 
 void RunUnitTests()
 {
     test1();
     test2();
     test3();
+    test4();
+    test5();
+    test6();
+    test7();
+    test8();
+    test9();
+    test10();
+    test11();
+    test12();
+    test13();
+    test14();
+    test15();
+    test16();
+    test17();
+    test18();
+    test19();
+    test20();
     PrintTestSummary();
 }
 